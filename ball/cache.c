@@ -0,0 +1,376 @@
+/*
+ * Copyright (C) 2003-2010 Neverball authors
+ *
+ * NEVERBALL is  free software; you can redistribute  it and/or modify
+ * it under the  terms of the GNU General  Public License as published
+ * by the Free  Software Foundation; either version 2  of the License,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT  ANY  WARRANTY;  without   even  the  implied  warranty  of
+ * MERCHANTABILITY or  FITNESS FOR A PARTICULAR PURPOSE.   See the GNU
+ * General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+#include "common.h"
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * The index is a text file.  After a version line, each entry is a
+ * line holding the stamp, the number of strings, and the path of a
+ * file, followed by the strings, one per line:
+ *
+ *     index 1
+ *     1234 1700000000 0 2 map-easy/easy.sol
+ *     message
+ *     Welcome!
+ */
+
+#define CACHE_VERSION 1
+
+struct entry
+{
+    char *path;
+
+    struct fs_stamp stamp;
+
+    Array lines;                        /* List of strings                   */
+};
+
+#define ENTRY_GET(a, i) ((struct entry *) array_get((a), (i)))
+
+static Array entries;                   /* Sorted by path up to "sorted"     */
+static int   sorted;
+static int   dirty;
+static int   users;                     /* Count of unmatched cache_init     */
+
+/*---------------------------------------------------------------------------*/
+
+void cache_free_lines(Array lines)
+{
+    int i;
+
+    if (lines)
+    {
+        for (i = 0; i < array_len(lines); i++)
+            free(CACHE_LINE(lines, i));
+
+        array_free(lines);
+    }
+}
+
+static Array copy_lines(Array src)
+{
+    Array dst;
+    int i;
+
+    if ((dst = array_new(sizeof (char *))))
+        for (i = 0; i < array_len(src); i++)
+        {
+            char **line;
+
+            if ((line = array_add(dst)))
+                *line = strdup(CACHE_LINE(src, i));
+        }
+
+    return dst;
+}
+
+static int is_line(const char *str)
+{
+    return str && !strchr(str, '\n') && !strchr(str, '\r');
+}
+
+static int same_stamp(const struct fs_stamp *a, const struct fs_stamp *b)
+{
+    return a->size == b->size && a->time == b->time && a->crc == b->crc;
+}
+
+static int cmp_entries(const void *A, const void *B)
+{
+    const struct entry *a = A, *b = B;
+    return strcmp(a->path, b->path);
+}
+
+/*
+ * Find the entry for PATH.  Entries added since the index was last
+ * sorted are searched linearly.
+ */
+static struct entry *find_entry(const char *path)
+{
+    struct entry key, *e = NULL;
+    int i;
+
+    key.path = (char *) path;
+
+    if (sorted)
+        e = bsearch(&key, array_get(entries, 0), sorted, sizeof (key),
+                    cmp_entries);
+
+    for (i = sorted; !e && i < array_len(entries); i++)
+        if (strcmp(ENTRY_GET(entries, i)->path, path) == 0)
+            e = ENTRY_GET(entries, i);
+
+    return e;
+}
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Cut the next line from the text at *P, in place.
+ */
+static char *next_line(char **p)
+{
+    char *line = *p, *end;
+
+    if (!line || !*line)
+        return NULL;
+
+    if ((end = strchr(line, '\n')))
+    {
+        *end = 0;
+        *p = end + 1;
+    }
+    else *p = line + strlen(line);
+
+    return line;
+}
+
+static int load_entry(char **p, struct entry *e)
+{
+    struct fs_stamp stamp;
+    char *line;
+    int i, n, k = 0;
+
+    if (!(line = next_line(p)))
+        return 0;
+
+    if (sscanf(line, "%ld %lu %lu %d %n",
+               &stamp.size, &stamp.time, &stamp.crc, &n, &k) < 4 ||
+        k == 0 || line[k] == 0 || n < 0)
+        return 0;
+
+    e->path  = strdup(line + k);
+    e->stamp = stamp;
+    e->lines = array_new(sizeof (char *));
+
+    for (i = 0; i < n && (line = next_line(p)); i++)
+    {
+        char **q;
+
+        if ((q = array_add(e->lines)))
+            *q = strdup(line);
+    }
+
+    if (i < n)
+    {
+        free(e->path);
+        cache_free_lines(e->lines);
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * Drop the entries of files that no longer exist.
+ */
+static void cache_prune(void)
+{
+    struct fs_stamp stamp;
+    int i, n = 0;
+
+    for (i = 0; i < array_len(entries); i++)
+    {
+        struct entry *e = ENTRY_GET(entries, i);
+
+        if (fs_stamp(e->path, &stamp))
+            *ENTRY_GET(entries, n++) = *e;
+        else
+        {
+            free(e->path);
+            cache_free_lines(e->lines);
+        }
+    }
+
+    if (array_len(entries) > n)
+        dirty = 1;
+
+    while (array_len(entries) > n)
+        array_del(entries);
+}
+
+static void cache_load(void)
+{
+    char *data, *p, *line;
+    int size, version = 0;
+
+    /* The whole index is read at once and cut into lines in place. */
+
+    if ((data = fs_load(CACHE_FILE, &size)))
+    {
+        if ((p = realloc(data, size + 1)))
+        {
+            data = p;
+            data[size] = 0;
+
+            if ((line = next_line(&p)))
+                sscanf(line, "index %d", &version);
+
+            if (version == CACHE_VERSION)
+            {
+                struct entry *e;
+
+                while ((e = array_add(entries)))
+                    if (!load_entry(&p, e))
+                    {
+                        array_del(entries);
+                        break;
+                    }
+            }
+        }
+        free(data);
+    }
+
+    dirty = 0;
+
+    cache_prune();
+
+    if (array_len(entries))
+        array_sort(entries, cmp_entries);
+
+    sorted = array_len(entries);
+}
+
+void cache_save(void)
+{
+    fs_file fp;
+    int i, j;
+
+    if (!entries || !dirty)
+        return;
+
+    /* Sort the entries added since loading, for lookup. */
+
+    if (sorted < array_len(entries))
+    {
+        array_sort(entries, cmp_entries);
+        sorted = array_len(entries);
+    }
+
+    fs_mkdir("Cache");
+
+    /* Write a new index and replace the old one only when complete. */
+
+    if ((fp = fs_open_write(CACHE_FILE ".new")))
+    {
+        fs_printf(fp, "index %d\n", CACHE_VERSION);
+
+        for (i = 0; i < array_len(entries); i++)
+        {
+            const struct entry *e = ENTRY_GET(entries, i);
+
+            fs_printf(fp, "%ld %lu %lu %d %s\n",
+                      e->stamp.size, e->stamp.time, e->stamp.crc,
+                      array_len(e->lines), e->path);
+
+            for (j = 0; j < array_len(e->lines); j++)
+                fs_printf(fp, "%s\n", CACHE_LINE(e->lines, j));
+        }
+
+        fs_close(fp);
+        fs_rename(CACHE_FILE ".new", CACHE_FILE);
+        fs_persistent_sync();
+
+        dirty = 0;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * The index is shared by sets, levels and replays.  It is loaded by
+ * the first cache_init and freed by the matching last cache_quit.
+ */
+void cache_init(void)
+{
+    if (users++ == 0 && (entries = array_new(sizeof (struct entry))))
+        cache_load();
+}
+
+void cache_quit(void)
+{
+    int i;
+
+    if (users > 0 && --users == 0 && entries)
+    {
+        cache_save();
+
+        for (i = 0; i < array_len(entries); i++)
+        {
+            free(ENTRY_GET(entries, i)->path);
+            cache_free_lines(ENTRY_GET(entries, i)->lines);
+        }
+
+        array_free(entries);
+        entries = NULL;
+        sorted  = 0;
+    }
+}
+
+/*
+ * Return the strings recorded for PATH, if the file has not changed
+ * since.  Either way, store the current stamp of the file in STAMP for
+ * a subsequent cache_put.  The strings belong to the index.
+ */
+Array cache_get(const char *path, struct fs_stamp *stamp)
+{
+    struct entry *e;
+
+    if (!entries || !fs_stamp(path, stamp))
+    {
+        memset(stamp, 0, sizeof (*stamp));
+        stamp->size = -1;
+        return NULL;
+    }
+
+    if ((e = find_entry(path)) && same_stamp(&e->stamp, stamp))
+        return e->lines;
+
+    return NULL;
+}
+
+/*
+ * Record a copy of the strings read from PATH under STAMP.
+ */
+void cache_put(const char *path, const struct fs_stamp *stamp, Array lines)
+{
+    struct entry *e;
+    int i;
+
+    if (!entries || stamp->size < 0 || !is_line(path))
+        return;
+
+    for (i = 0; i < array_len(lines); i++)
+        if (!is_line(CACHE_LINE(lines, i)))
+            return;
+
+    if ((e = find_entry(path)))
+        cache_free_lines(e->lines);
+    else if ((e = array_add(entries)))
+        e->path = strdup(path);
+    else
+        return;
+
+    e->stamp = *stamp;
+    e->lines = copy_lines(lines);
+
+    dirty = 1;
+}
+
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,29 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "array.h"
+#include "fs.h"
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * A persistent index of what was read from set and level files, kept
+ * as lists of strings and keyed by path and file stamp.
+ */
+
+#define CACHE_FILE "Cache/index.txt"
+
+#define CACHE_LINE(a, i) (*(char **) array_get((a), (i)))
+
+void  cache_init(void);
+void  cache_quit(void);
+void  cache_save(void);
+
+Array cache_get(const char *path, struct fs_stamp *);
+void  cache_put(const char *path, const struct fs_stamp *, Array);
+
+void  cache_free_lines(Array);
+
+/*---------------------------------------------------------------------------*/
+
+#endif
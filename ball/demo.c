@@ -17,6 +17,7 @@
 #include <string.h>
 #include <time.h>
 #include <assert.h>
+#include <limits.h>
 
 #include "demo.h"
 #include "audio.h"
@@ -26,6 +27,7 @@
 #include "level.h"
 #include "array.h"
 #include "dir.h"
+#include "log.h"
 
 #include "game_server.h"
 #include "game_client.h"
@@ -33,12 +35,49 @@
 #include "game_common.h"
 
 #define DEMO_MAGIC (0xAF | 'N' << 8 | 'B' << 16 | 'R' << 24)
-#define DEMO_VERSION 9
+#define DEMO_VERSION 11
+
+/*
+ * Replays since version 10 carry keyframes.  After every DEMO_KEY_STEP
+ * updates, and after the first, the recorder writes a snapshot of the
+ * client state.  An index of keyframe offsets follows the last update,
+ * and the header gives its offset.  Both are framed as commands of
+ * types unknown to cmd_get, which skips them.
+ *
+ * Since version 11, commands are packed (see cmd_pack.h) in blocks of
+ * the same framing.  A block ends before each keyframe, so that reading
+ * can start over from any of them.  A frame too large for its size to
+ * fit a short gives a size of zero, followed by the real size.
+ */
+
+#define DEMO_KEY_TYPE   0xF0
+#define DEMO_INDEX_TYPE 0xF1
+#define DEMO_BLOCK_TYPE 0xF2
+
+#define DEMO_BLOCK_MAX  16384           /* Packed bytes before a block ends  */
+#define DEMO_PACKED     11              /* First version with packed blocks  */
+
+#define DEMO_KEY_STEP   (2 * UPS)
+#define DEMO_KEY_MAX    4000            /* Fits the index in one frame       */
+
+#define DEMO_INDEX_POS  24              /* Header offset of the index offset */
+
+struct keyframe
+{
+    int update;                         /* Updates before the keyframe       */
+    int offset;                         /* File offset of its frame          */
+};
 
 #define DATELEN sizeof ("YYYY-MM-DDTHH:MM:SS")
 
 fs_file demo_fp;
 
+static Array keys;                      /* Keyframes recorded or read        */
+static int   updates;                   /* Updates recorded or read          */
+
+static struct cmd_pack    pack;         /* Block being recorded              */
+static struct demo_stream stream;       /* Commands being read               */
+
 /*---------------------------------------------------------------------------*/
 
 static const char *demo_path(const char *name)
@@ -71,14 +110,18 @@ static int demo_header_read(fs_file fp, struct demo *d)
 
     t = get_index(fp);
 
-    if (magic == DEMO_MAGIC && version == DEMO_VERSION && t)
+    if (magic == DEMO_MAGIC && version >= 9 && version <= DEMO_VERSION && t)
     {
-        d->timer = t;
+        d->version = version;
+        d->timer   = t;
 
         d->coins  = get_index(fp);
         d->status = get_index(fp);
         d->mode   = get_index(fp);
 
+        if (version >= 10)
+            d->index = get_index(fp);
+
         get_string(fp, d->player, sizeof (d->player));
         get_string(fp, datestr, sizeof (datestr));
 
@@ -124,6 +167,7 @@ static void demo_header_write(fs_file fp, struct demo *d)
     put_index(fp, 0);
     put_index(fp, 0);
     put_index(fp, d->mode);
+    put_index(fp, 0);                   /* Index offset, set when done.      */
 
     put_string(fp, d->player);
     put_string(fp, datestr);
@@ -166,12 +210,107 @@ int demo_load(struct demo *d, const char *path)
     return rc;
 }
 
+/*
+ * Open the replay at PATH and read its header into D.  Return the file
+ * positioned at the start of the command stream.
+ */
+fs_file demo_open(struct demo *d, const char *path)
+{
+    fs_file fp;
+
+    memset(d, 0, sizeof (*d));
+
+    if ((fp = fs_open_read(path)))
+    {
+        SAFECPY(d->path, path);
+
+        if (demo_header_read(fp, d))
+            return fp;
+
+        fs_close(fp);
+    }
+    return NULL;
+}
+
 void demo_free(struct demo *d)
 {
 }
 
 /*---------------------------------------------------------------------------*/
 
+void demo_stream_init(struct demo_stream *s, fs_file fp, const struct demo *d)
+{
+    cmd_pack_init(&s->pack);
+
+    s->fp     = fp;
+    s->packed = (d->version >= DEMO_PACKED);
+}
+
+void demo_stream_free(struct demo_stream *s)
+{
+    cmd_pack_free(&s->pack);
+}
+
+/*
+ * Write and read the size of a frame.
+ */
+static void put_frame_size(fs_file fp, int size)
+{
+    if (0 < size && size <= SHRT_MAX)
+        put_short(fp, (short) size);
+    else
+    {
+        put_short(fp, 0);
+        put_index(fp, size);
+    }
+}
+
+static int get_frame_size(fs_file fp)
+{
+    int size = get_short(fp);
+    return size ? size : get_index(fp);
+}
+
+/*
+ * Forget the current block, as after a seek.
+ */
+void demo_stream_clear(struct demo_stream *s)
+{
+    cmd_pack_clear(&s->pack);
+}
+
+/*
+ * Read the next command.  Keyframes and the index read as CMD_NONE from
+ * replays without packed blocks, and are passed over in those with.
+ */
+int demo_stream_get(struct demo_stream *s, union cmd *cmd)
+{
+    int type, size;
+
+    if (!s->packed)
+        return cmd_get(s->fp, cmd);
+
+    while (!cmd_pack_get(&s->pack, cmd))
+    {
+        if ((type = fs_getc(s->fp)) < 0)
+            return 0;
+
+        if ((size = get_frame_size(s->fp)) < 0)
+            return 0;
+
+        if (type == DEMO_BLOCK_TYPE)
+        {
+            if (!cmd_pack_read(s->fp, size, &s->pack))
+                return 0;
+        }
+        else if (fs_seek(s->fp, size, SEEK_CUR) != 0)
+            return 0;
+    }
+    return 1;
+}
+
+/*---------------------------------------------------------------------------*/
+
 int demo_exists(const char *name)
 {
     return fs_exists(demo_path(name));
@@ -266,6 +405,78 @@ const char *demo_format_name(const char *fmt,
 
 /*---------------------------------------------------------------------------*/
 
+static void keys_init(void)
+{
+    if (keys)
+        array_free(keys);
+
+    keys    = array_new(sizeof (struct keyframe));
+    updates = 0;
+}
+
+static void keys_free(void)
+{
+    if (keys)
+    {
+        array_free(keys);
+        keys = NULL;
+    }
+    updates = 0;
+}
+
+/*
+ * Append the keyframe index and point the header at it.
+ */
+static void demo_index_write(fs_file fp)
+{
+    long pos = fs_tell(fp);
+    int i, n = array_len(keys);
+
+    fs_putc(DEMO_INDEX_TYPE, fp);
+    put_frame_size(fp, INDEX_BYTES * (1 + 2 * n));
+    put_index(fp, n);
+
+    for (i = 0; i < n; i++)
+    {
+        const struct keyframe *k = array_get(keys, i);
+
+        put_index(fp, k->update);
+        put_index(fp, k->offset);
+    }
+
+    fs_seek(fp, DEMO_INDEX_POS, SEEK_SET);
+    put_index(fp, (int) pos);
+    fs_seek(fp, 0, SEEK_END);
+}
+
+static void demo_index_read(fs_file fp, int offset)
+{
+    long pos = fs_tell(fp);
+    int i, n;
+
+    if (fs_seek(fp, offset, SEEK_SET) == 0 && fs_getc(fp) == DEMO_INDEX_TYPE)
+    {
+        (void) get_frame_size(fp);
+
+        n = get_index(fp);
+
+        for (i = 0; i < n && i < DEMO_KEY_MAX && !fs_eof(fp); i++)
+        {
+            struct keyframe *k;
+
+            if ((k = array_add(keys)))
+            {
+                k->update = get_index(fp);
+                k->offset = get_index(fp);
+            }
+        }
+    }
+
+    fs_seek(fp, pos, SEEK_SET);
+}
+
+/*---------------------------------------------------------------------------*/
+
 static struct demo demo_play;
 
 int demo_play_init(const char *name, const struct level *level,
@@ -292,11 +503,71 @@ int demo_play_init(const char *name, const struct level *level,
     if ((demo_fp = fs_open_write(d->path)))
     {
         demo_header_write(demo_fp, d);
+        keys_init();
+        cmd_pack_init(&pack);
         return 1;
     }
     return 0;
 }
 
+/*
+ * Write the pending block.  A block that cannot be written is dropped
+ * rather than left to grow.
+ */
+static void demo_pack_write(void)
+{
+    if (!cmd_pack_write(demo_fp, DEMO_BLOCK_TYPE, &pack))
+    {
+        log_printf("Failure to write replay block to %s\n", demo_play.path);
+        cmd_pack_clear(&pack);
+    }
+}
+
+/*
+ * Add a command to the replay.
+ */
+void demo_play_cmd(const union cmd *cmd)
+{
+    if (demo_fp)
+    {
+        cmd_pack_put(&pack, cmd);
+
+        if (pack.len >= DEMO_BLOCK_MAX)
+            demo_pack_write();
+    }
+}
+
+/*
+ * Count an update written to the replay, and follow it with a keyframe
+ * when one is due.
+ */
+void demo_play_update(void)
+{
+    struct keyframe *k;
+    int size;
+
+    if (demo_fp && keys)
+    {
+        updates++;
+
+        if ((updates == 1 || updates % DEMO_KEY_STEP == 0) &&
+            array_len(keys) < DEMO_KEY_MAX &&
+            (k = array_add(keys)))
+        {
+            size = game_client_snap_size();
+
+            demo_pack_write();
+
+            k->update = updates;
+            k->offset = (int) fs_tell(demo_fp);
+
+            fs_putc(DEMO_KEY_TYPE, demo_fp);
+            put_frame_size(demo_fp, size);
+            game_client_snap_put(demo_fp);
+        }
+    }
+}
+
 void demo_play_stat(int status, int coins, int timer)
 {
     if (demo_fp)
@@ -317,6 +588,12 @@ void demo_play_stop(int d)
 {
     if (demo_fp)
     {
+        if (!d)
+            demo_pack_write();
+
+        if (!d && keys)
+            demo_index_write(demo_fp);
+
         fs_close(demo_fp);
         demo_fp = NULL;
 
@@ -324,6 +601,9 @@ void demo_play_stop(int d)
 
         fs_persistent_sync();
     }
+
+    cmd_pack_free(&pack);
+    keys_free();
 }
 
 int demo_saved(void)
@@ -357,14 +637,27 @@ void demo_rename_player(const char *name, const char *player)
 
 static struct lockstep update_step;
 
-static void demo_update_read(float dt)
+static int seeking;                     /* Skip sounds                       */
+
+static void demo_update_read(void *data, float dt)
 {
     if (demo_fp)
     {
         union cmd cmd;
 
-        while (cmd_get(demo_fp, &cmd))
+        while (demo_stream_get(&stream, &cmd))
         {
+            /* Keyframes and the index read as nothing. */
+
+            if (cmd.type == CMD_NONE)
+                continue;
+
+            if (seeking && cmd.type == CMD_SOUND)
+            {
+                free(cmd.sound.n);
+                continue;
+            }
+
             game_proxy_enq(&cmd);
 
             if (cmd.type == CMD_UPDATES_PER_SECOND)
@@ -373,6 +666,7 @@ static void demo_update_read(float dt)
             if (cmd.type == CMD_END_OF_UPDATE)
             {
                 game_client_sync(NULL);
+                updates++;
                 break;
             }
         }
@@ -380,7 +674,7 @@ static void demo_update_read(float dt)
     }
 }
 
-static struct lockstep update_step = { demo_update_read, DT };
+static struct lockstep update_step = { demo_update_read, NULL, DT };
 
 float demo_replay_blend(void)
 {
@@ -399,6 +693,7 @@ const char *curr_demo(void)
 int demo_replay_init(const char *path, int *g, int *m, int *b, int *s, int *tt)
 {
     lockstep_clr(&update_step);
+    keys_init();
 
     if ((demo_fp = fs_open_read(path)))
     {
@@ -406,6 +701,11 @@ int demo_replay_init(const char *path, int *g, int *m, int *b, int *s, int *tt)
         {
             struct level level;
 
+            demo_stream_init(&stream, demo_fp, &demo_replay);
+
+            if (demo_replay.index && keys)
+                demo_index_read(demo_fp, demo_replay.index);
+
             SAFECPY(demo_replay.path, path);
             SAFECPY(demo_replay.name, demo_name(path));
 
@@ -435,7 +735,7 @@ int demo_replay_init(const char *path, int *g, int *m, int *b, int *s, int *tt)
                         game_proxy_enq(&cmd);
                     }
 
-                    demo_update_read(0);
+                    demo_update_read(NULL, 0);
 
                     if (!fs_eof(demo_fp))
                         return 1;
@@ -443,6 +743,7 @@ int demo_replay_init(const char *path, int *g, int *m, int *b, int *s, int *tt)
             }
         }
 
+        demo_stream_free(&stream);
         fs_close(demo_fp);
         demo_fp = NULL;
     }
@@ -464,11 +765,14 @@ void demo_replay_stop(int d)
 {
     if (demo_fp)
     {
+        demo_stream_free(&stream);
         fs_close(demo_fp);
         demo_fp = NULL;
 
         if (d) fs_remove(demo_replay.path);
     }
+
+    keys_free();
 }
 
 void demo_replay_speed(int speed)
@@ -477,4 +781,74 @@ void demo_replay_speed(int speed)
         lockstep_scl(&update_step, SPEED_FACTORS[speed]);
 }
 
+/*
+ * Restore the client state of a keyframe and position the replay after
+ * it.
+ */
+static int demo_key_read(const struct keyframe *k)
+{
+    long pos;
+    int size;
+
+    if (fs_seek(demo_fp, k->offset, SEEK_SET) == 0 &&
+        fs_getc(demo_fp) == DEMO_KEY_TYPE)
+    {
+        size = get_frame_size(demo_fp);
+        pos  = fs_tell(demo_fp);
+
+        if (game_client_snap_get(demo_fp) &&
+            fs_seek(demo_fp, pos + size, SEEK_SET) == 0)
+        {
+            demo_stream_clear(&stream);
+            game_proxy_clr();
+            updates = k->update;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Move playback by DT seconds, either way.  The nearest keyframe before
+ * the target is restored and the remaining updates are played silently.
+ * Replays without keyframes can only go forward.
+ */
+int demo_replay_seek(float dt)
+{
+    const struct keyframe *k = NULL;
+    int i, target;
+
+    if (!demo_fp)
+        return 0;
+
+    target = MAX(updates + (int) (dt / update_step.dt), 1);
+
+    for (i = 0; i < array_len(keys); i++)
+    {
+        const struct keyframe *ki = array_get(keys, i);
+
+        if (ki->update <= target)
+            k = ki;
+        else
+            break;
+    }
+
+    if (k && (target < updates || k->update > updates))
+    {
+        if (!demo_key_read(k))
+            return 0;
+    }
+    else if (target < updates)
+        return 0;
+
+    seeking = 1;
+
+    while (updates < target && !fs_eof(demo_fp))
+        demo_update_read(NULL, 0.0f);
+
+    seeking = 0;
+
+    return 1;
+}
+
 /*---------------------------------------------------------------------------*/
@@ -6,6 +6,7 @@
 
 #include "level.h"
 #include "fs.h"
+#include "cmd_pack.h"
 
 /*---------------------------------------------------------------------------*/
 
@@ -21,6 +22,8 @@ struct demo
     int    coins;
     int    status;
     int    mode;
+    int    version;                     /* Replay format version             */
+    int    index;                       /* Offset of the keyframe index      */
 
     char   shot[PATHMAX];               /* Image filename                    */
     char   file[PATHMAX];               /* Level filename                    */
@@ -38,6 +41,8 @@ struct demo
 int  demo_load(struct demo *, const char *);
 void demo_free(struct demo *);
 
+fs_file demo_open(struct demo *, const char *);
+
 int demo_exists(const char *);
 
 const char *demo_format_name(const char *fmt,
@@ -46,10 +51,29 @@ const char *demo_format_name(const char *fmt,
 
 /*---------------------------------------------------------------------------*/
 
+/*
+ * A reader of the commands of a replay of any version.
+ */
+struct demo_stream
+{
+    fs_file         fp;
+    int             packed;             /* Commands come in packed blocks    */
+    struct cmd_pack pack;               /* Block being read                  */
+};
+
+void demo_stream_init(struct demo_stream *, fs_file, const struct demo *);
+void demo_stream_free(struct demo_stream *);
+void demo_stream_clear(struct demo_stream *);
+int  demo_stream_get(struct demo_stream *, union cmd *);
+
+/*---------------------------------------------------------------------------*/
+
 int  demo_play_init(const char *, const struct level *, int, int, int, int);
 void demo_play_step(void);
 void demo_play_stat(int, int, int);
 void demo_play_stop(int);
+void demo_play_update(void);
+void demo_play_cmd(const union cmd *);
 
 int  demo_saved (void);
 void demo_rename(const char *);
@@ -66,6 +90,7 @@ float demo_replay_blend(void);
 const char *curr_demo(void);
 
 void demo_replay_speed(int);
+int  demo_replay_seek(float);
 
 /*---------------------------------------------------------------------------*/
 
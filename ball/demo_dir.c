@@ -12,16 +12,27 @@
  * General Public License for more details.
  */
 
+#include <SDL.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include "array.h"
+#include "cache.h"
 #include "common.h"
 #include "demo.h"
 #include "demo_dir.h"
 #include "fs.h"
 
+/*
+ * Replay headers are read on a few threads at once.  What they hold is
+ * also kept in the cache index, so that a replay is only read again
+ * once it has changed.
+ */
+
+#define DEMO_JOBS 4
+
 /*---------------------------------------------------------------------------*/
 
 static void free_item(struct dir_item *item)
@@ -35,20 +46,177 @@ static void free_item(struct dir_item *item)
     }
 }
 
-static void load_item(struct dir_item *item)
+/*
+ * Summarize a replay header as strings for the cache index.
+ */
+static Array summary_lines(const struct demo *d)
+{
+    const char *strs[4];
+    char nums[MAXSTR];
+    Array lines;
+    int i;
+
+    sprintf(nums, "%ld %d %d %d %d %d %d %d %d %d",
+            (long) d->date, d->timer, d->coins, d->status, d->mode,
+            d->time, d->goal, d->score, d->balls, d->times);
+
+    strs[0] = nums;
+    strs[1] = d->player;
+    strs[2] = d->shot;
+    strs[3] = d->file;
+
+    if ((lines = array_new(sizeof (char *))))
+        for (i = 0; i < ARRAYSIZE(strs); i++)
+        {
+            char **line;
+
+            if ((line = array_add(lines)))
+                *line = strdup(strs[i]);
+        }
+
+    return lines;
+}
+
+static int summary_read(struct demo *d, Array lines)
+{
+    long date;
+
+    if (array_len(lines) != 4)
+        return 0;
+
+    if (sscanf(CACHE_LINE(lines, 0), "%ld %d %d %d %d %d %d %d %d %d",
+               &date, &d->timer, &d->coins, &d->status, &d->mode,
+               &d->time, &d->goal, &d->score, &d->balls, &d->times) != 10)
+        return 0;
+
+    d->date = (time_t) date;
+
+    SAFECPY(d->player, CACHE_LINE(lines, 1));
+    SAFECPY(d->shot,   CACHE_LINE(lines, 2));
+    SAFECPY(d->file,   CACHE_LINE(lines, 3));
+
+    return 1;
+}
+
+/*---------------------------------------------------------------------------*/
+
+struct job
+{
+    struct dir_item *item;
+    struct fs_stamp  stamp;
+    struct demo     *demo;
+};
+
+struct pool
+{
+    SDL_mutex *lock;
+    Array      jobs;
+    int        next;
+};
+
+/*
+ * Read the header of a replay.  This may run on any thread.
+ */
+static void read_item(struct job *job)
+{
+    fs_file fp;
+
+    if ((job->demo = malloc(sizeof (*job->demo))))
+    {
+        if ((fp = demo_open(job->demo, job->item->path)))
+            fs_close(fp);
+        else
+        {
+            free(job->demo);
+            job->demo = NULL;
+        }
+    }
+}
+
+static int read_thread(void *data)
+{
+    struct pool *pool = data;
+
+    while (1)
+    {
+        struct job *job = NULL;
+
+        SDL_mutexP(pool->lock);
+        {
+            if (pool->next < array_len(pool->jobs))
+                job = array_get(pool->jobs, pool->next++);
+        }
+        SDL_mutexV(pool->lock);
+
+        if (!job)
+            break;
+
+        read_item(job);
+    }
+    return 0;
+}
+
+/*
+ * Read the headers of the given jobs, using up to DEMO_JOBS threads.
+ */
+static void read_items(Array jobs)
+{
+    SDL_Thread *threads[DEMO_JOBS - 1];
+    struct pool pool;
+    int i, n;
+
+    pool.jobs = jobs;
+    pool.next = 0;
+
+    n = MIN(DEMO_JOBS, array_len(jobs)) - 1;
+
+    if (n > 0 && (pool.lock = SDL_CreateMutex()))
+    {
+        /* This thread is one of the workers. */
+
+        for (i = 0; i < n; i++)
+            threads[i] = SDL_CreateThread(read_thread, "demo_dir", &pool);
+
+        read_thread(&pool);
+
+        for (i = 0; i < n; i++)
+            if (threads[i])
+                SDL_WaitThread(threads[i], NULL);
+
+        SDL_DestroyMutex(pool.lock);
+    }
+    else for (i = 0; i < array_len(jobs); i++)
+        read_item(array_get(jobs, i));
+}
+
+/*
+ * Fill in an item from the cache index, if the replay has not changed.
+ */
+static int load_cached(struct dir_item *item, struct fs_stamp *stamp)
 {
-    if (!item->data)
+    struct demo *d;
+    Array lines;
+
+    if ((lines = cache_get(item->path, stamp)) && (d = malloc(sizeof (*d))))
     {
-        struct demo *d;
+        memset(d, 0, sizeof (*d));
 
-        if ((d = malloc(sizeof (*d))))
+        if (summary_read(d, lines))
         {
-            if (demo_load(d, item->path))
-                item->data = d;
-            else
-                free(d);
+            item->data = d;
+            return 1;
         }
+        free(d);
     }
+    return 0;
+}
+
+static void name_item(struct dir_item *item)
+{
+    struct demo *d = item->data;
+
+    SAFECPY(d->path, item->path);
+    SAFECPY(d->name, base_name_sans(item->path, ".nbr"));
 }
 
 static int scan_item(struct dir_item *item)
@@ -74,31 +242,89 @@ Array demo_dir_scan(void)
 {
     Array items;
 
+    cache_init();
+
     if ((items = fs_dir_scan("Replays", scan_item)))
         array_sort(items, cmp_items);
+    else
+        cache_quit();
 
     return items;
 }
 
 void demo_dir_load(Array items, int lo, int hi)
 {
+    struct fs_stamp stamp;
+    Array jobs;
     int i;
 
     assert(lo >= 0  && lo < array_len(items));
     assert(hi >= lo && hi < array_len(items));
 
+    if (!(jobs = array_new(sizeof (struct job))))
+        return;
+
+    /* Take what the index knows and queue the rest. */
+
     for (i = lo; i <= hi; i++)
-        load_item(array_get(items, i));
+    {
+        struct dir_item *item = array_get(items, i);
+        struct job *job;
+
+        if (item->data)
+            continue;
+
+        if (load_cached(item, &stamp))
+            name_item(item);
+        else if ((job = array_add(jobs)))
+        {
+            job->item  = item;
+            job->stamp = stamp;
+            job->demo  = NULL;
+        }
+    }
+
+    if (array_len(jobs))
+    {
+        read_items(jobs);
+
+        for (i = 0; i < array_len(jobs); i++)
+        {
+            struct job *job = array_get(jobs, i);
+            Array lines;
+
+            if ((job->item->data = job->demo))
+            {
+                name_item(job->item);
+
+                if ((lines = summary_lines(job->demo)))
+                {
+                    cache_put(job->item->path, &job->stamp, lines);
+                    cache_free_lines(lines);
+                }
+            }
+        }
+    }
+
+    array_free(jobs);
 }
 
 void demo_dir_free(Array items)
 {
     int i;
 
+    /* A failed scan has already let go of the cache. */
+
+    if (!items)
+        return;
+
     for (i = 0; i < array_len(items); i++)
         free_item(array_get(items, i));
 
     dir_free(items);
+
+    cache_save();
+    cache_quit();
 }
 
 /*---------------------------------------------------------------------------*/
@@ -0,0 +1,411 @@
+/*
+ * Copyright (C) 2003-2010 Neverball authors
+ *
+ * NEVERBALL is  free software; you can redistribute  it and/or modify
+ * it under the  terms of the GNU General  Public License as published
+ * by the Free  Software Foundation; either version 2  of the License,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT  ANY  WARRANTY;  without   even  the  implied  warranty  of
+ * MERCHANTABILITY or  FITNESS FOR A PARTICULAR PURPOSE.   See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * Replay verification.  Each replay is re-simulated headless by the
+ * game server and the outcome is compared against the one recorded in
+ * the replay header.  A replay holds the server's output rather than
+ * the player's input, but the floor tilt it records, together with the
+ * opening of the goal, is all the input the simulation ever sees.
+ */
+
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "demo.h"
+#include "demo_verify.h"
+#include "array.h"
+#include "common.h"
+#include "vec3.h"
+#include "dir.h"
+#include "fs.h"
+#include "cmd.h"
+#include "cmd_pack.h"
+
+#include "game_common.h"
+#include "game_server.h"
+
+/*---------------------------------------------------------------------------*/
+
+enum
+{
+    VERIFY_NONE = 0,
+    VERIFY_MATCH,
+    VERIFY_DIFFER,
+    VERIFY_ERROR
+};
+
+struct verify
+{
+    char path[MAXSTR];
+    int  result;
+
+    struct demo demo;                   /* Recorded header                   */
+
+    float timer;                        /* Re-simulated clock time           */
+    int   coins;                        /* Re-simulated coins                */
+    int   status;                       /* Re-simulated outcome              */
+
+    int   ball;                         /* Was the ball position reported?   */
+    float p[3];                         /* Re-simulated ball position        */
+
+    int   updates;                      /* Number of updates simulated       */
+    int   diverged;                     /* First update off the recording    */
+};
+
+/*
+ * Everything of interest in one update of a replay.
+ */
+struct update
+{
+    int ups;
+    int goal;
+
+    int tilt;
+    struct game_tilt t;
+
+    int   ball;
+    float p[3];
+};
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Read commands up to and including the next end-of-update.  Return 0
+ * if the replay ends first.
+ */
+static int read_update(struct demo_stream *s, struct update *u)
+{
+    union cmd cmd;
+    int done = 0;
+
+    memset(u, 0, sizeof (*u));
+
+    while (!done && demo_stream_get(s, &cmd))
+    {
+        switch (cmd.type)
+        {
+        case CMD_END_OF_UPDATE:
+            done = 1;
+            break;
+
+        case CMD_UPDATES_PER_SECOND:
+            u->ups = cmd.ups.n;
+            break;
+
+        case CMD_GOAL_OPEN:
+            u->goal = 1;
+            break;
+
+        case CMD_TILT_AXES:
+            v_cpy(u->t.x, cmd.tiltaxes.x);
+            v_cpy(u->t.z, cmd.tiltaxes.z);
+            u->tilt = 1;
+            break;
+
+        case CMD_TILT_ANGLES:
+            u->t.rx = cmd.tiltangles.x;
+            u->t.rz = cmd.tiltangles.z;
+            u->tilt = 1;
+            break;
+
+        case CMD_BALL_POSITION:
+            v_cpy(u->p, cmd.ballpos.p);
+            u->ball = 1;
+            break;
+
+        default:
+            break;
+        }
+
+        cmd_clear(&cmd);
+    }
+    return done;
+}
+
+/*
+ * Consume the server's output, tracking the state that ends up in a
+ * replay header.
+ */
+static void verify_put(void *data, const union cmd *cmd)
+{
+    struct verify *v = data;
+
+    switch (cmd->type)
+    {
+    case CMD_TIMER:
+        v->timer = cmd->timer.t;
+        break;
+
+    case CMD_COINS:
+        v->coins = cmd->coins.n;
+        break;
+
+    case CMD_STATUS:
+        v->status = cmd->status.t;
+        break;
+
+    case CMD_BALL_POSITION:
+        v_cpy(v->p, cmd->ballpos.p);
+        v->ball = 1;
+        break;
+
+    case CMD_SOUND:
+        free(cmd->sound.n);
+        break;
+
+    case CMD_MAP:
+        free(cmd->map.name);
+        break;
+
+    default:
+        break;
+    }
+}
+
+/*
+ * Compare the re-simulated ball position with the recorded one, which
+ * packed replays keep on a grid.
+ */
+static int same_position(const struct demo_stream *s,
+                         const float p[3], const float q[3])
+{
+    int i;
+
+    for (i = 0; i < 3; i++)
+        if ((s->packed ? cmd_pack_snap(p[i], PACK_POSITION) : p[i]) != q[i])
+            return 0;
+
+    return 1;
+}
+
+/*
+ * Compute the clock value recorded in a replay header.  See progress_stat.
+ */
+static int header_timer(const struct verify *v)
+{
+    int clock = (int) (v->timer * 100.f);
+
+    return v->demo.time == 0 ? clock : v->demo.time - clock;
+}
+
+/*---------------------------------------------------------------------------*/
+
+static void verify_demo(struct verify *v)
+{
+    struct cmd_sink sink = { verify_put, v };
+    struct demo_stream s;
+    struct game_server *gs;
+    struct update u;
+    fs_file fp;
+
+    v->result   = VERIFY_ERROR;
+    v->diverged = -1;
+
+    if (!(fp = demo_open(&v->demo, v->path)))
+        return;
+
+    demo_stream_init(&s, fp, &v->demo);
+
+    /* The first update sets up the level, goal included. */
+
+    if (read_update(&s, &u) && (u.ups == 0 || u.ups == UPS) &&
+        (gs = game_server_new(&sink, 0)))
+    {
+        if (game_server_init(gs, v->demo.file, v->demo.time, u.goal))
+        {
+            while (read_update(&s, &u))
+            {
+                if (u.goal)
+                    game_set_goal(gs);
+
+                v->ball = 0;
+
+                game_set_tilt(gs, u.tilt ? &u.t : NULL);
+                game_server_step(gs, DT);
+
+                if (v->ball && u.ball && v->diverged < 0)
+                {
+                    if (!same_position(&s, v->p, u.p))
+                        v->diverged = v->updates;
+                }
+
+                v->updates++;
+            }
+
+            if (v->status == v->demo.status &&
+                v->coins  == v->demo.coins  &&
+                header_timer(v) == v->demo.timer)
+                v->result = VERIFY_MATCH;
+            else
+                v->result = VERIFY_DIFFER;
+        }
+
+        game_server_delete(gs);
+    }
+
+    demo_stream_free(&s);
+    fs_close(fp);
+}
+
+/*---------------------------------------------------------------------------*/
+
+struct pool
+{
+    SDL_mutex *lock;
+    Array      items;
+    int        next;
+};
+
+static int verify_thread(void *data)
+{
+    struct pool *pool = data;
+
+    while (1)
+    {
+        struct verify *v = NULL;
+
+        SDL_mutexP(pool->lock);
+        {
+            if (pool->next < array_len(pool->items))
+                v = array_get(pool->items, pool->next++);
+        }
+        SDL_mutexV(pool->lock);
+
+        if (!v)
+            break;
+
+        verify_demo(v);
+    }
+    return 0;
+}
+
+static int is_replay(struct dir_item *item)
+{
+    return str_ends_with(item->path, ".nbr");
+}
+
+static int cmp_dir_items(const void *A, const void *B)
+{
+    const struct dir_item *a = A, *b = B;
+    return strcmp(a->path, b->path);
+}
+
+static void print_result(const struct verify *v)
+{
+    switch (v->result)
+    {
+    case VERIFY_MATCH:
+        printf("%s: ok\n", v->path);
+        break;
+
+    case VERIFY_DIFFER:
+        printf("%s: MISMATCH (%s, %d coins, %d) instead of (%s, %d coins, %d)",
+               v->path,
+               status_to_str(v->status), v->coins, header_timer(v),
+               status_to_str(v->demo.status), v->demo.coins, v->demo.timer);
+
+        if (v->diverged >= 0)
+            printf(", diverged at update %d of %d", v->diverged, v->updates);
+
+        printf("\n");
+        break;
+
+    default:
+        printf("%s: unreadable\n", v->path);
+        break;
+    }
+}
+
+/*
+ * Verify every replay in DIR using up to JOBS threads.  Results are
+ * printed in file name order.  Return the number of replays that fail.
+ */
+int demo_verify_dir(const char *dir, int jobs)
+{
+    struct pool pool;
+    SDL_Thread **threads;
+    Array files;
+    int i, n, fail = 0;
+
+    if (!fs_add_path(dir))
+    {
+        fprintf(stderr, "%s: not a directory\n", dir);
+        return 1;
+    }
+
+    if (!(files = fs_dir_scan("", is_replay)))
+        return 0;
+
+    array_sort(files, cmp_dir_items);
+
+    memset(&pool, 0, sizeof (pool));
+
+    pool.items = array_new(sizeof (struct verify));
+
+    for (i = 0; i < array_len(files); i++)
+    {
+        struct verify *v = array_add(pool.items);
+
+        memset(v, 0, sizeof (*v));
+        SAFECPY(v->path, DIR_ITEM_GET(files, i)->path);
+    }
+
+    fs_dir_free(files);
+
+    pool.lock = SDL_CreateMutex();
+
+    /* Start the workers.  This thread is one of them. */
+
+    n = MAX(jobs, 1) - 1;
+
+    if (n && (threads = calloc(n, sizeof (*threads))))
+    {
+        for (i = 0; i < n; i++)
+            threads[i] = SDL_CreateThread(verify_thread, "verify", &pool);
+
+        verify_thread(&pool);
+
+        for (i = 0; i < n; i++)
+            if (threads[i])
+                SDL_WaitThread(threads[i], NULL);
+
+        free(threads);
+    }
+    else verify_thread(&pool);
+
+    SDL_DestroyMutex(pool.lock);
+
+    /* Report. */
+
+    for (i = 0; i < array_len(pool.items); i++)
+    {
+        const struct verify *v = array_get(pool.items, i);
+
+        print_result(v);
+
+        if (v->result != VERIFY_MATCH)
+            fail++;
+    }
+
+    printf("%d replays, %d failed\n", array_len(pool.items), fail);
+
+    array_free(pool.items);
+
+    return fail;
+}
+
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,6 @@
+#ifndef DEMO_VERIFY_H
+#define DEMO_VERIFY_H
+
+int demo_verify_dir(const char *dir, int jobs);
+
+#endif
@@ -32,8 +32,10 @@
 #include "game_common.h"
 #include "game_proxy.h"
 #include "game_draw.h"
+#include "demo.h"
 
 #include "cmd.h"
+#include "binary.h"
 
 /*---------------------------------------------------------------------------*/
 
@@ -325,19 +327,352 @@ static void game_run_cmd(const union cmd *cmd)
     }
 }
 
-void game_client_sync(fs_file demo_fp)
+void game_client_sync(fs_file fp)
 {
-    union cmd *cmdp;
+    union cmd cmd;
 
-    while ((cmdp = game_proxy_deq()))
+    while (game_proxy_deq(&cmd))
     {
-        if (demo_fp)
-            cmd_put(demo_fp, cmdp);
+        if (fp)
+            demo_play_cmd(&cmd);
 
-        game_run_cmd(cmdp);
+        game_run_cmd(&cmd);
 
-        cmd_free(cmdp);
+        if (fp && cmd.type == CMD_END_OF_UPDATE)
+            demo_play_update();
+
+        cmd_clear(&cmd);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Client state snapshots.  A snapshot holds everything that the
+ * commands of a replay have changed since game_client_init, so that
+ * restoring one puts the client where it was.  Particles are not kept.
+ */
+
+#define SNAP_MAX (1 << 16)              /* Sanity limit on snapshot counts   */
+
+static void put_tilt(fs_file fp, const struct game_tilt *tilt)
+{
+    put_array(fp, tilt->x, 3);
+    put_float(fp, tilt->rx);
+    put_array(fp, tilt->z, 3);
+    put_float(fp, tilt->rz);
+}
+
+static void get_tilt(fs_file fp, struct game_tilt *tilt)
+{
+    get_array(fp, tilt->x, 3);
+    tilt->rx = get_float(fp);
+    get_array(fp, tilt->z, 3);
+    tilt->rz = get_float(fp);
+}
+
+static void put_view(fs_file fp, const struct game_view *view)
+{
+    put_float(fp, view->dc);
+    put_float(fp, view->dp);
+    put_float(fp, view->dz);
+    put_array(fp, view->c, 3);
+    put_array(fp, view->p, 3);
+    put_array(fp, view->e[0], 9);
+    put_float(fp, view->a);
+}
+
+static void get_view(fs_file fp, struct game_view *view)
+{
+    view->dc = get_float(fp);
+    view->dp = get_float(fp);
+    view->dz = get_float(fp);
+    get_array(fp, view->c, 3);
+    get_array(fp, view->p, 3);
+    get_array(fp, view->e[0], 9);
+    view->a = get_float(fp);
+}
+
+static void put_l_ball(fs_file fp, const struct l_ball *up)
+{
+    put_array(fp, up->e[0], 9);
+    put_array(fp, up->p, 3);
+    put_array(fp, up->E[0], 9);
+    put_float(fp, up->r);
+}
+
+static void get_l_ball(fs_file fp, struct l_ball *up)
+{
+    get_array(fp, up->e[0], 9);
+    get_array(fp, up->p, 3);
+    get_array(fp, up->E[0], 9);
+    up->r = get_float(fp);
+}
+
+static void put_v_ball(fs_file fp, const struct v_ball *up)
+{
+    put_array(fp, up->e[0], 9);
+    put_array(fp, up->p, 3);
+    put_array(fp, up->v, 3);
+    put_array(fp, up->w, 3);
+    put_array(fp, up->E[0], 9);
+    put_array(fp, up->W, 3);
+    put_float(fp, up->r);
+}
+
+static void get_v_ball(fs_file fp, struct v_ball *up)
+{
+    get_array(fp, up->e[0], 9);
+    get_array(fp, up->p, 3);
+    get_array(fp, up->v, 3);
+    get_array(fp, up->w, 3);
+    get_array(fp, up->E[0], 9);
+    get_array(fp, up->W, 3);
+    up->r = get_float(fp);
+}
+
+/*
+ * Return the size in bytes of a snapshot of the current state.
+ */
+int game_client_snap_size(void)
+{
+    const struct s_vary *vary = &gd.vary;
+
+    int n = 6 + 4 + 5 + 5 + 8 + 19 + 2 * (8 + 19) + 4 + 1;
+
+    n += vary->pc;
+    n += vary->mc * (3 + 2 * 2);
+    n += vary->xc * 4;
+    n += vary->hc * 5;
+    n += vary->uc * 31;
+    n += gl.lerp.uc * 2 * 22;
+
+    return n * 4;
+}
+
+void game_client_snap_put(fs_file fp)
+{
+    const struct s_vary *vary = &gd.vary;
+    const struct s_lerp *lerp = &gl.lerp;
+    int i, j;
+
+    put_index(fp, vary->pc);
+    put_index(fp, vary->mc);
+    put_index(fp, vary->xc);
+    put_index(fp, vary->hc);
+    put_index(fp, vary->uc);
+    put_index(fp, lerp->uc);
+
+    put_float(fp, timer);
+    put_index(fp, status);
+    put_index(fp, coins);
+    put_index(fp, game_compat_map);
+
+    put_index(fp, cs.ups);
+    put_index(fp, cs.first_update);
+    put_index(fp, cs.next_update);
+    put_index(fp, cs.curr_ball);
+    put_index(fp, cs.got_tilt_axes);
+
+    put_index(fp, gd.goal_e);
+    put_float(fp, gd.goal_k);
+    put_index(fp, gd.jump_e);
+    put_index(fp, gd.jump_b);
+    put_float(fp, gd.jump_dt);
+
+    put_tilt(fp, &gd.tilt);
+    put_view(fp, &gd.view);
+
+    for (j = 0; j < 2; j++)
+    {
+        put_tilt(fp, &gl.tilt[j]);
+        put_view(fp, &gl.view[j]);
+    }
+
+    put_array(fp, gl.goal_k,  2);
+    put_array(fp, gl.jump_dt, 2);
+
+    for (i = 0; i < vary->pc; i++)
+        put_index(fp, vary->pv[i].f);
+
+    for (i = 0; i < vary->mc; i++)
+    {
+        put_float(fp, vary->mv[i].t);
+        put_index(fp, vary->mv[i].tm);
+        put_index(fp, vary->mv[i].pi);
+
+        for (j = 0; j < 2; j++)
+        {
+            put_float(fp, lerp->mv[i][j].t);
+            put_index(fp, lerp->mv[i][j].pi);
+        }
+    }
+
+    for (i = 0; i < vary->xc; i++)
+    {
+        put_float(fp, vary->xv[i].t);
+        put_index(fp, vary->xv[i].tm);
+        put_index(fp, vary->xv[i].f);
+        put_index(fp, vary->xv[i].e);
+    }
+
+    for (i = 0; i < vary->hc; i++)
+    {
+        put_array(fp, vary->hv[i].p, 3);
+        put_index(fp, vary->hv[i].t);
+        put_index(fp, vary->hv[i].n);
+    }
+
+    for (i = 0; i < vary->uc; i++)
+        put_v_ball(fp, &vary->uv[i]);
+
+    for (i = 0; i < lerp->uc; i++)
+        for (j = 0; j < 2; j++)
+            put_l_ball(fp, &lerp->uv[i][j]);
+
+    put_float(fp, vary->ms_accum);
+}
+
+/*
+ * Restore a snapshot taken of the same level.  Return 0 if it does not
+ * fit, leaving the state undefined.
+ */
+int game_client_snap_get(fs_file fp)
+{
+    struct s_vary *vary = &gd.vary;
+    struct s_lerp *lerp = &gl.lerp;
+    int pc, mc, xc, hc, uc, lc;
+    int i, j;
+
+    if (!gd.state)
+        return 0;
+
+    pc = get_index(fp);
+    mc = get_index(fp);
+    xc = get_index(fp);
+    hc = get_index(fp);
+    uc = get_index(fp);
+    lc = get_index(fp);
+
+    if (pc != vary->pc || mc != vary->mc || xc != vary->xc || mc != lerp->mc ||
+        hc < 0 || hc > SNAP_MAX ||
+        uc < 0 || uc > SNAP_MAX ||
+        lc < 0 || lc > SNAP_MAX)
+        return 0;
+
+    /* Resize the item and ball lists. */
+
+    if (hc != vary->hc)
+    {
+        free(vary->hv);
+        vary->hv = hc ? calloc(hc, sizeof (*vary->hv)) : NULL;
+        vary->hc = vary->hv ? hc : 0;
+    }
+
+    if (uc != vary->uc)
+    {
+        free(vary->uv);
+        vary->uv = uc ? calloc(uc, sizeof (*vary->uv)) : NULL;
+        vary->uc = vary->uv ? uc : 0;
+    }
+
+    if (lc != lerp->uc)
+    {
+        free(lerp->uv);
+        lerp->uv = lc ? calloc(lc, sizeof (*lerp->uv)) : NULL;
+        lerp->uc = lerp->uv ? lc : 0;
+    }
+
+    if (vary->hc != hc || vary->uc != uc || lerp->uc != lc)
+        return 0;
+
+    timer           = get_float(fp);
+    status          = get_index(fp);
+    coins           = get_index(fp);
+    game_compat_map = get_index(fp);
+
+    cs.ups           = get_index(fp);
+    cs.first_update  = get_index(fp);
+    cs.next_update   = get_index(fp);
+    cs.curr_ball     = get_index(fp);
+    cs.got_tilt_axes = get_index(fp);
+
+    gd.goal_e  = get_index(fp);
+    gd.goal_k  = get_float(fp);
+    gd.jump_e  = get_index(fp);
+    gd.jump_b  = get_index(fp);
+    gd.jump_dt = get_float(fp);
+
+    get_tilt(fp, &gd.tilt);
+    get_view(fp, &gd.view);
+
+    for (j = 0; j < 2; j++)
+    {
+        get_tilt(fp, &gl.tilt[j]);
+        get_view(fp, &gl.view[j]);
+    }
+
+    get_array(fp, gl.goal_k,  2);
+    get_array(fp, gl.jump_dt, 2);
+
+    for (i = 0; i < pc; i++)
+        vary->pv[i].f = get_index(fp);
+
+    for (i = 0; i < mc; i++)
+    {
+        vary->mv[i].t  = get_float(fp);
+        vary->mv[i].tm = get_index(fp);
+        vary->mv[i].pi = get_index(fp);
+
+        for (j = 0; j < 2; j++)
+        {
+            lerp->mv[i][j].t  = get_float(fp);
+            lerp->mv[i][j].pi = get_index(fp);
+        }
     }
+
+    for (i = 0; i < xc; i++)
+    {
+        vary->xv[i].t  = get_float(fp);
+        vary->xv[i].tm = get_index(fp);
+        vary->xv[i].f  = get_index(fp);
+        vary->xv[i].e  = get_index(fp);
+    }
+
+    for (i = 0; i < hc; i++)
+    {
+        get_array(fp, vary->hv[i].p, 3);
+        vary->hv[i].t = get_index(fp);
+        vary->hv[i].n = get_index(fp);
+    }
+
+    for (i = 0; i < uc; i++)
+        get_v_ball(fp, &vary->uv[i]);
+
+    for (i = 0; i < lc; i++)
+        for (j = 0; j < 2; j++)
+            get_l_ball(fp, &lerp->uv[i][j]);
+
+    vary->ms_accum = get_float(fp);
+
+    /* Guard the indices that later commands rely on. */
+
+    for (i = 0; i < mc; i++)
+    {
+        if (vary->mv[i].pi < 0 || vary->mv[i].pi >= vary->base->pc)
+            vary->mv[i].pi = 0;
+
+        for (j = 0; j < 2; j++)
+            if (lerp->mv[i][j].pi < 0 || lerp->mv[i][j].pi >= vary->base->pc)
+                lerp->mv[i][j].pi = 0;
+    }
+
+    if (cs.curr_ball < 0 || cs.curr_ball >= MAX(lc, 1))
+        cs.curr_ball = 0;
+
+    part_reset();
+
+    return !fs_eof(fp);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -30,6 +30,10 @@ void  game_fade(float);
 
 void game_client_fly(float);
 
+int  game_client_snap_size(void);
+void game_client_snap_put(fs_file);
+int  game_client_snap_get(fs_file);
+
 /*---------------------------------------------------------------------------*/
 
 extern int game_compat_map;
@@ -18,6 +18,7 @@
 #include "solid_vary.h"
 #include "hmd.h"
 #include "common.h"
+#include "preload.h"
 
 /*---------------------------------------------------------------------------*/
 
@@ -219,7 +220,7 @@ void lockstep_run(struct lockstep *ls, float dt)
 
     while (ls->at >= ls->dt)
     {
-        ls->step(ls->dt);
+        ls->step(ls->data, ls->dt);
         ls->at -= ls->dt;
     }
 }
@@ -249,7 +250,7 @@ int game_base_load(const char *path)
         base_path = NULL;
     }
 
-    if (sol_load_base(&game_base, path))
+    if (preload_take(path, &game_base) || sol_load_base(&game_base, path))
     {
         base_path = strdup(path);
         return 1;
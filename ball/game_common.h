@@ -104,7 +104,8 @@ void game_view_fly(struct game_view *, const struct s_vary *, float);
 
 struct lockstep
 {
-    void (*step)(float);
+    void (*step)(void *, float);
+    void  *data;                        /* Argument to step                  */
 
     float dt;                           /* Time step length                  */
     float at;                           /* Accumulator                       */
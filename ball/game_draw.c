@@ -68,17 +68,10 @@ static void game_draw_items(struct s_rend *rend,
         if (hp->t == ITEM_NONE)
             continue;
 
-        /* Draw model. */
-
-        glPushMatrix();
-        {
-            glTranslatef(hp->p[0],
-                         hp->p[1],
-                         hp->p[2]);
-            item_draw(rend, hp, bill_M, t);
-        }
-        glPopMatrix();
+        item_push(hp);
     }
+
+    item_draw(rend, bill_M, t);
 }
 
 static void game_draw_beams(struct s_rend *rend, const struct game_draw *gd)
@@ -100,21 +93,23 @@ static void game_draw_beams(struct s_rend *rend, const struct game_draw *gd)
 
     if (gd->goal_e)
         for (i = 0; i < base->zc; i++)
-            beam_draw(rend, base->zv[i].p, goal_c,
-                            base->zv[i].r, gd->goal_k * 3.0f);
+            beam_push(base->zv[i].p, goal_c,
+                      base->zv[i].r, gd->goal_k * 3.0f);
 
     /* Jump beams */
 
     for (i = 0; i < base->jc; i++)
-        beam_draw(rend, base->jv[i].p, jump_c[gd->jump_e ? 0 : 1],
-                        base->jv[i].r, 2.0f);
+        beam_push(base->jv[i].p, jump_c[gd->jump_e ? 0 : 1],
+                  base->jv[i].r, 2.0f);
 
     /* Switch beams */
 
     for (i = 0; i < base->xc; i++)
         if (!vary->xv[i].base->i)
-            beam_draw(rend, base->xv[i].p, swch_c[vary->xv[i].f][vary->xv[i].e],
-                            base->xv[i].r, 2.0f);
+            beam_push(base->xv[i].p, swch_c[vary->xv[i].f][vary->xv[i].e],
+                      base->xv[i].r, 2.0f);
+
+    beam_draw(rend);
 }
 
 static void game_draw_goals(struct s_rend *rend,
@@ -126,7 +121,9 @@ static void game_draw_goals(struct s_rend *rend,
 
     if (gd->goal_e)
         for (i = 0; i < base->zc; i++)
-            goal_draw(rend, base->zv[i].p, base->zv[i].r, gd->goal_k, t);
+            goal_push(base->zv[i].p, base->zv[i].r, gd->goal_k);
+
+    goal_draw(rend);
 }
 
 static void game_draw_jumps(struct s_rend *rend,
@@ -137,7 +134,9 @@ static void game_draw_jumps(struct s_rend *rend,
     int i;
 
     for (i = 0; i < base->jc; i++)
-        jump_draw(rend, base->jv[i].p, base->jv[i].r, 1.0f);
+        jump_push(base->jv[i].p, base->jv[i].r, 1.0f);
+
+    jump_draw(rend);
 }
 
 /*---------------------------------------------------------------------------*/
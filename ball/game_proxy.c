@@ -13,12 +13,48 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "game_proxy.h"
-#include "queue.h"
+#include "game_server.h"
 #include "cmd.h"
 
-static Queue cmd_queue;
+/*
+ * The command queue is a ring of commands, stored by value.  It grows
+ * when full and is never shrunk, so that once it has grown to fit the
+ * busiest update, queueing allocates nothing.
+ */
+
+#define RING_MIN 256
+
+static union cmd *ring;                 /* Queued commands                   */
+static int        ring_size;            /* Allocated commands                */
+static int        ring_head;            /* Index of the first command        */
+static int        ring_len;             /* Number of commands                */
+
+static int ring_grow(void)
+{
+    int size = ring_size ? ring_size * 2 : RING_MIN;
+    union cmd *p;
+
+    if (!(p = realloc(ring, size * sizeof (*p))))
+        return 0;
+
+    /* Move the wrapped-around part of the ring to the end. */
+
+    if (ring_head + ring_len > ring_size)
+    {
+        int n = ring_size - ring_head;
+
+        memmove(p + size - n, p + ring_head, n * sizeof (*p));
+        ring_head = size - n;
+    }
+
+    ring      = p;
+    ring_size = size;
+
+    return 1;
+}
 
 /*
  * Command filtering.
@@ -34,42 +70,37 @@ void game_proxy_filter(int (*fn)(const union cmd *))
 }
 
 /*
- * Enqueue SRC in the game's command queue.
+ * Enqueue a copy of SRC in the game's command queue.  The queue takes
+ * ownership of any strings SRC holds.
  */
 void game_proxy_enq(const union cmd *src)
 {
-    union cmd *dst;
-
     if (!FILTER(src))
         return;
 
-    /*
-     * Create the queue.  This is done only once during the life time
-     * of the program.  For simplicity's sake, the queue is never
-     * destroyed.
-     */
-
-    if (!cmd_queue)
-        cmd_queue = queue_new();
-
-    /*
-     * Add a copy of the command to the end of the queue.
-     */
-
-    if ((dst = malloc(sizeof (*dst))))
+    if (ring_len < ring_size || ring_grow())
     {
-        *dst = *src;
-        queue_enq(cmd_queue, dst);
+        ring[(ring_head + ring_len) % ring_size] = *src;
+        ring_len++;
     }
 }
 
 /*
- * Dequeue and return the head element in the game's command queue.
- * The element must be freed after use.
+ * Dequeue the head element of the game's command queue into DST.  The
+ * strings of DST must be freed with cmd_clear after use.
  */
-union cmd *game_proxy_deq(void)
+int game_proxy_deq(union cmd *dst)
 {
-    return cmd_queue ? queue_deq(cmd_queue) : NULL;
+    if (ring_len)
+    {
+        *dst = ring[ring_head];
+
+        ring_head = (ring_head + 1) % ring_size;
+        ring_len--;
+
+        return 1;
+    }
+    return 0;
 }
 
 /*
@@ -77,8 +108,35 @@ union cmd *game_proxy_deq(void)
  */
 void game_proxy_clr(void)
 {
-    union cmd *cmdp;
+    union cmd cmd;
+
+    while (game_proxy_deq(&cmd))
+        cmd_clear(&cmd);
+}
+
+/*---------------------------------------------------------------------------*/
+
+static void proxy_put(void *data, const union cmd *cmd)
+{
+    game_proxy_enq(cmd);
+}
+
+/*
+ * The sink through which a server talks to the client.
+ */
+const struct cmd_sink game_proxy_sink = { proxy_put, NULL };
+
+/*
+ * Return the game's own server, which feeds the queue and shares level
+ * data with the client.  Like the queue, it lives as long as the
+ * program does.
+ */
+struct game_server *game_proxy_server(void)
+{
+    static struct game_server *server;
+
+    if (!server)
+        server = game_server_new(&game_proxy_sink, 1);
 
-    while ((cmdp = game_proxy_deq()))
-        cmd_free(cmdp);
+    return server;
 }
@@ -5,7 +5,13 @@
 
 void       game_proxy_filter(int (*fn)(const union cmd *));
 void       game_proxy_enq(const union cmd *);
-union cmd *game_proxy_deq(void);
+int        game_proxy_deq(union cmd *);
 void       game_proxy_clr(void);
 
+struct game_server;
+
+extern const struct cmd_sink game_proxy_sink;
+
+struct game_server *game_proxy_server(void);
+
 #endif
@@ -13,6 +13,7 @@
  */
 
 #include <SDL.h>
+#include <stdlib.h>
 #include <math.h>
 #include <assert.h>
 
@@ -27,41 +28,11 @@
 
 #include "game_common.h"
 #include "game_server.h"
-#include "game_proxy.h"
 
 #include "cmd.h"
 
 /*---------------------------------------------------------------------------*/
 
-static int server_state = 0;
-
-static struct s_vary vary;
-
-static float timer      = 0.f;          /* Clock time                        */
-static int   timer_down = 1;            /* Timer go up or down?              */
-
-static int status = GAME_NONE;          /* Outcome of the game               */
-
-static struct game_tilt tilt;           /* Floor rotation                    */
-static struct game_view view;           /* Current view                      */
-
-static float view_k;
-
-static float view_time;                 /* Manual rotation time              */
-static float view_fade;
-
-#define VIEW_FADE_MIN 0.2f
-#define VIEW_FADE_MAX 1.0f
-
-static int   coins  = 0;                /* Collected coins                   */
-static int   goal_e = 0;                /* Goal enabled flag                 */
-static int   jump_e = 1;                /* Jumping enabled flag              */
-static int   jump_b = 0;                /* Jump-in-progress flag             */
-static float jump_dt;                   /* Jump duration                     */
-static float jump_p[3];                 /* Jump destination                  */
-
-/*---------------------------------------------------------------------------*/
-
 /*
  * This is an abstraction of the game's input state.  All input is
  * encapsulated here, and all references to the input by the game are
@@ -77,317 +48,361 @@ struct input
     int   c;
 };
 
-static struct input input_current;
-
-static void input_init(void)
+static void input_init(struct input *in)
 {
-    input_current.s = RESPONSE;
-    input_current.x = 0;
-    input_current.z = 0;
-    input_current.r = 0;
-    input_current.c = 0;
+    in->s = RESPONSE;
+    in->x = 0;
+    in->z = 0;
+    in->r = 0;
+    in->c = 0;
 }
 
-static void input_set_s(float s)
+static void input_set_s(struct input *in, float s)
 {
-    input_current.s = s;
+    in->s = s;
 }
 
-static void input_set_x(float x)
+static void input_set_x(struct input *in, float x)
 {
     if (x < -ANGLE_BOUND) x = -ANGLE_BOUND;
     if (x >  ANGLE_BOUND) x =  ANGLE_BOUND;
 
-    input_current.x = x;
+    in->x = x;
 }
 
-static void input_set_z(float z)
+static void input_set_z(struct input *in, float z)
 {
     if (z < -ANGLE_BOUND) z = -ANGLE_BOUND;
     if (z >  ANGLE_BOUND) z =  ANGLE_BOUND;
 
-    input_current.z = z;
+    in->z = z;
 }
 
-static void input_set_r(float r)
+static void input_set_r(struct input *in, float r)
 {
     if (r < -VIEWR_BOUND) r = -VIEWR_BOUND;
     if (r >  VIEWR_BOUND) r =  VIEWR_BOUND;
 
-    input_current.r = r;
+    in->r = r;
 }
 
-static void input_set_c(int c)
+static void input_set_c(struct input *in, int c)
 {
-    input_current.c = c;
+    in->c = c;
 }
 
-static float input_get_s(void)
+static float input_get_s(const struct input *in)
 {
-    return input_current.s;
+    return in->s;
 }
 
-static float input_get_x(void)
+static float input_get_x(const struct input *in)
 {
-    return input_current.x;
+    return in->x;
 }
 
-static float input_get_z(void)
+static float input_get_z(const struct input *in)
 {
-    return input_current.z;
+    return in->z;
 }
 
-static float input_get_r(void)
+static float input_get_r(const struct input *in)
 {
-    return input_current.r;
+    return in->r;
 }
 
-static int input_get_c(void)
+static int input_get_c(const struct input *in)
 {
-    return input_current.c;
+    return in->c;
 }
 
 /*---------------------------------------------------------------------------*/
 
+#define VIEW_FADE_MIN 0.2f
+#define VIEW_FADE_MAX 1.0f
+
+#define GROW_TIME  0.5f                 /* sec for the ball to get to size.  */
+#define GROW_BIG   1.5f                 /* large factor                      */
+#define GROW_SMALL 0.5f                 /* small factor                      */
+
+/*
+ * The complete state of one simulation.  Nothing here is shared with
+ * any other server, so any number of them may run side by side.
+ */
+
+struct game_server
+{
+    struct cmd_sink sink;               /* Destination of output             */
+    union cmd       cmd;                /* Output scratch                    */
+
+    int state;
+    int shared;                         /* Load levels via game_base?        */
+
+    struct s_base base;                 /* Level data, if not shared         */
+    struct s_vary vary;
+
+    float timer;                        /* Clock time                        */
+    int   timer_down;                   /* Timer go up or down?              */
+
+    int status;                         /* Outcome of the game               */
+
+    struct game_tilt tilt;              /* Floor rotation                    */
+    int              tilt_fixed;        /* Is floor rotation given directly? */
+    struct game_view view;              /* Current view                      */
+
+    float view_k;
+
+    float view_time;                    /* Manual rotation time              */
+    float view_fade;
+
+    int   coins;                        /* Collected coins                   */
+    int   goal_e;                       /* Goal enabled flag                 */
+    int   jump_e;                       /* Jumping enabled flag              */
+    int   jump_b;                       /* Jump-in-progress flag             */
+    float jump_dt;                      /* Jump duration                     */
+    float jump_p[3];                    /* Jump destination                  */
+
+    struct input input;
+
+    int   grow;                         /* Should the ball be changing size? */
+    float grow_orig;                    /* the original ball size            */
+    float grow_goal;                    /* how big or small to get!          */
+    float grow_t;                       /* timer for the ball to grow...     */
+    float grow_strt;                    /* starting value for growth         */
+    int   got_orig;                     /* Do we know original ball size?    */
+    int   grow_state;                   /* Current state (values -1, 0, +1)  */
+
+    struct lockstep step;
+};
+
+/*---------------------------------------------------------------------------*/
+
 /*
  * Utility functions for preparing the "server" state and events for
  * consumption by the "client".
  */
 
-static union cmd cmd;
-
-static void game_cmd_map(const char *name, int ver_x, int ver_y)
+static void game_cmd_map(struct game_server *gs,
+                         const char *name, int ver_x, int ver_y)
 {
-    cmd.type          = CMD_MAP;
-    cmd.map.name      = strdup(name);
-    cmd.map.version.x = ver_x;
-    cmd.map.version.y = ver_y;
-    game_proxy_enq(&cmd);
+    gs->cmd.type          = CMD_MAP;
+    gs->cmd.map.name      = strdup(name);
+    gs->cmd.map.version.x = ver_x;
+    gs->cmd.map.version.y = ver_y;
+    cmd_sink_put(&gs->sink, &gs->cmd);
 }
 
-static void game_cmd_eou(void)
+static void game_cmd_eou(struct game_server *gs)
 {
-    cmd.type = CMD_END_OF_UPDATE;
-    game_proxy_enq(&cmd);
+    gs->cmd.type = CMD_END_OF_UPDATE;
+    cmd_sink_put(&gs->sink, &gs->cmd);
 }
 
-static void game_cmd_ups(void)
+static void game_cmd_ups(struct game_server *gs)
 {
-    cmd.type  = CMD_UPDATES_PER_SECOND;
-    cmd.ups.n = UPS;
-    game_proxy_enq(&cmd);
+    gs->cmd.type  = CMD_UPDATES_PER_SECOND;
+    gs->cmd.ups.n = UPS;
+    cmd_sink_put(&gs->sink, &gs->cmd);
 }
 
-static void game_cmd_sound(const char *filename, float a)
+static void game_cmd_sound(struct game_server *gs,
+                           const char *filename, float a)
 {
-    cmd.type = CMD_SOUND;
+    gs->cmd.type = CMD_SOUND;
 
-    cmd.sound.n = strdup(filename);
-    cmd.sound.a = a;
+    gs->cmd.sound.n = strdup(filename);
+    gs->cmd.sound.a = a;
 
-    game_proxy_enq(&cmd);
+    cmd_sink_put(&gs->sink, &gs->cmd);
 }
 
-#define audio_play(s, f) game_cmd_sound((s), (f))
+#define audio_play(gs, s, f) game_cmd_sound((gs), (s), (f))
 
-static void game_cmd_goalopen(void)
+static void game_cmd_goalopen(struct game_server *gs)
 {
-    cmd.type = CMD_GOAL_OPEN;
-    game_proxy_enq(&cmd);
+    gs->cmd.type = CMD_GOAL_OPEN;
+    cmd_sink_put(&gs->sink, &gs->cmd);
 }
 
-static void game_cmd_updball(void)
+static void game_cmd_updball(struct game_server *gs)
 {
-    cmd.type = CMD_BALL_POSITION;
-    v_cpy(cmd.ballpos.p, vary.uv[0].p);
-    game_proxy_enq(&cmd);
-
-    cmd.type = CMD_BALL_BASIS;
-    v_cpy(cmd.ballbasis.e[0], vary.uv[0].e[0]);
-    v_cpy(cmd.ballbasis.e[1], vary.uv[0].e[1]);
-    game_proxy_enq(&cmd);
-
-    cmd.type = CMD_BALL_PEND_BASIS;
-    v_cpy(cmd.ballpendbasis.E[0], vary.uv[0].E[0]);
-    v_cpy(cmd.ballpendbasis.E[1], vary.uv[0].E[1]);
-    game_proxy_enq(&cmd);
+    gs->cmd.type = CMD_BALL_POSITION;
+    v_cpy(gs->cmd.ballpos.p, gs->vary.uv[0].p);
+    cmd_sink_put(&gs->sink, &gs->cmd);
+
+    gs->cmd.type = CMD_BALL_BASIS;
+    v_cpy(gs->cmd.ballbasis.e[0], gs->vary.uv[0].e[0]);
+    v_cpy(gs->cmd.ballbasis.e[1], gs->vary.uv[0].e[1]);
+    cmd_sink_put(&gs->sink, &gs->cmd);
+
+    gs->cmd.type = CMD_BALL_PEND_BASIS;
+    v_cpy(gs->cmd.ballpendbasis.E[0], gs->vary.uv[0].E[0]);
+    v_cpy(gs->cmd.ballpendbasis.E[1], gs->vary.uv[0].E[1]);
+    cmd_sink_put(&gs->sink, &gs->cmd);
 }
 
-static void game_cmd_updview(void)
+static void game_cmd_updview(struct game_server *gs)
 {
-    cmd.type = CMD_VIEW_POSITION;
-    v_cpy(cmd.viewpos.p, view.p);
-    game_proxy_enq(&cmd);
-
-    cmd.type = CMD_VIEW_CENTER;
-    v_cpy(cmd.viewcenter.c, view.c);
-    game_proxy_enq(&cmd);
-
-    cmd.type = CMD_VIEW_BASIS;
-    v_cpy(cmd.viewbasis.e[0], view.e[0]);
-    v_cpy(cmd.viewbasis.e[1], view.e[1]);
-    game_proxy_enq(&cmd);
+    gs->cmd.type = CMD_VIEW_POSITION;
+    v_cpy(gs->cmd.viewpos.p, gs->view.p);
+    cmd_sink_put(&gs->sink, &gs->cmd);
+
+    gs->cmd.type = CMD_VIEW_CENTER;
+    v_cpy(gs->cmd.viewcenter.c, gs->view.c);
+    cmd_sink_put(&gs->sink, &gs->cmd);
+
+    gs->cmd.type = CMD_VIEW_BASIS;
+    v_cpy(gs->cmd.viewbasis.e[0], gs->view.e[0]);
+    v_cpy(gs->cmd.viewbasis.e[1], gs->view.e[1]);
+    cmd_sink_put(&gs->sink, &gs->cmd);
 }
 
-static void game_cmd_ballradius(void)
+static void game_cmd_ballradius(struct game_server *gs)
 {
-    cmd.type         = CMD_BALL_RADIUS;
-    cmd.ballradius.r = vary.uv[0].r;
-    game_proxy_enq(&cmd);
+    gs->cmd.type         = CMD_BALL_RADIUS;
+    gs->cmd.ballradius.r = gs->vary.uv[0].r;
+    cmd_sink_put(&gs->sink, &gs->cmd);
 }
 
-static void game_cmd_init_balls(void)
+static void game_cmd_init_balls(struct game_server *gs)
 {
-    cmd.type = CMD_CLEAR_BALLS;
-    game_proxy_enq(&cmd);
+    gs->cmd.type = CMD_CLEAR_BALLS;
+    cmd_sink_put(&gs->sink, &gs->cmd);
 
-    cmd.type = CMD_MAKE_BALL;
-    game_proxy_enq(&cmd);
+    gs->cmd.type = CMD_MAKE_BALL;
+    cmd_sink_put(&gs->sink, &gs->cmd);
 
-    game_cmd_updball();
-    game_cmd_ballradius();
+    game_cmd_updball(gs);
+    game_cmd_ballradius(gs);
 }
 
-static void game_cmd_init_items(void)
+static void game_cmd_init_items(struct game_server *gs)
 {
     int i;
 
-    cmd.type = CMD_CLEAR_ITEMS;
-    game_proxy_enq(&cmd);
+    gs->cmd.type = CMD_CLEAR_ITEMS;
+    cmd_sink_put(&gs->sink, &gs->cmd);
 
-    for (i = 0; i < vary.hc; i++)
+    for (i = 0; i < gs->vary.hc; i++)
     {
-        cmd.type = CMD_MAKE_ITEM;
+        gs->cmd.type = CMD_MAKE_ITEM;
 
-        v_cpy(cmd.mkitem.p, vary.hv[i].p);
+        v_cpy(gs->cmd.mkitem.p, gs->vary.hv[i].p);
 
-        cmd.mkitem.t = vary.hv[i].t;
-        cmd.mkitem.n = vary.hv[i].n;
+        gs->cmd.mkitem.t = gs->vary.hv[i].t;
+        gs->cmd.mkitem.n = gs->vary.hv[i].n;
 
-        game_proxy_enq(&cmd);
+        cmd_sink_put(&gs->sink, &gs->cmd);
     }
 }
 
-static void game_cmd_pkitem(int hi)
+static void game_cmd_pkitem(struct game_server *gs, int hi)
 {
-    cmd.type      = CMD_PICK_ITEM;
-    cmd.pkitem.hi = hi;
-    game_proxy_enq(&cmd);
+    gs->cmd.type      = CMD_PICK_ITEM;
+    gs->cmd.pkitem.hi = hi;
+    cmd_sink_put(&gs->sink, &gs->cmd);
 }
 
-static void game_cmd_jump(int e)
+static void game_cmd_jump(struct game_server *gs, int e)
 {
-    cmd.type = e ? CMD_JUMP_ENTER : CMD_JUMP_EXIT;
-    game_proxy_enq(&cmd);
+    gs->cmd.type = e ? CMD_JUMP_ENTER : CMD_JUMP_EXIT;
+    cmd_sink_put(&gs->sink, &gs->cmd);
 }
 
-static void game_cmd_tiltangles(void)
+static void game_cmd_tiltangles(struct game_server *gs)
 {
-    cmd.type = CMD_TILT_ANGLES;
+    gs->cmd.type = CMD_TILT_ANGLES;
 
-    cmd.tiltangles.x = tilt.rx;
-    cmd.tiltangles.z = tilt.rz;
+    gs->cmd.tiltangles.x = gs->tilt.rx;
+    gs->cmd.tiltangles.z = gs->tilt.rz;
 
-    game_proxy_enq(&cmd);
+    cmd_sink_put(&gs->sink, &gs->cmd);
 }
 
-static void game_cmd_tiltaxes(void)
+static void game_cmd_tiltaxes(struct game_server *gs)
 {
-    cmd.type = CMD_TILT_AXES;
+    gs->cmd.type = CMD_TILT_AXES;
 
-    v_cpy(cmd.tiltaxes.x, tilt.x);
-    v_cpy(cmd.tiltaxes.z, tilt.z);
+    v_cpy(gs->cmd.tiltaxes.x, gs->tilt.x);
+    v_cpy(gs->cmd.tiltaxes.z, gs->tilt.z);
 
-    game_proxy_enq(&cmd);
+    cmd_sink_put(&gs->sink, &gs->cmd);
 }
 
-static void game_cmd_timer(void)
+static void game_cmd_timer(struct game_server *gs)
 {
-    cmd.type    = CMD_TIMER;
-    cmd.timer.t = timer;
-    game_proxy_enq(&cmd);
+    gs->cmd.type    = CMD_TIMER;
+    gs->cmd.timer.t = gs->timer;
+    cmd_sink_put(&gs->sink, &gs->cmd);
 }
 
-static void game_cmd_coins(void)
+static void game_cmd_coins(struct game_server *gs)
 {
-    cmd.type    = CMD_COINS;
-    cmd.coins.n = coins;
-    game_proxy_enq(&cmd);
+    gs->cmd.type    = CMD_COINS;
+    gs->cmd.coins.n = gs->coins;
+    cmd_sink_put(&gs->sink, &gs->cmd);
 }
 
-static void game_cmd_status(void)
+static void game_cmd_status(struct game_server *gs)
 {
-    cmd.type     = CMD_STATUS;
-    cmd.status.t = status;
-    game_proxy_enq(&cmd);
+    gs->cmd.type     = CMD_STATUS;
+    gs->cmd.status.t = gs->status;
+    cmd_sink_put(&gs->sink, &gs->cmd);
 }
 
 /*---------------------------------------------------------------------------*/
 
-static int   grow = 0;                  /* Should the ball be changing size? */
-static float grow_orig = 0;             /* the original ball size            */
-static float grow_goal = 0;             /* how big or small to get!          */
-static float grow_t = 0.0;              /* timer for the ball to grow...     */
-static float grow_strt = 0;             /* starting value for growth         */
-static int   got_orig = 0;              /* Do we know original ball size?    */
-
-#define GROW_TIME  0.5f                 /* sec for the ball to get to size.  */
-#define GROW_BIG   1.5f                 /* large factor                      */
-#define GROW_SMALL 0.5f                 /* small factor                      */
-
-static int   grow_state = 0;            /* Current state (values -1, 0, +1)  */
-
-static void grow_init(int type)
+static void grow_init(struct game_server *gs, int type)
 {
-    if (!got_orig)
+    if (!gs->got_orig)
     {
-        grow_orig  = vary.uv->r;
-        grow_goal  = grow_orig;
-        grow_strt  = grow_orig;
+        gs->grow_orig  = gs->vary.uv->r;
+        gs->grow_goal  = gs->grow_orig;
+        gs->grow_strt  = gs->grow_orig;
 
-        grow_state = 0;
+        gs->grow_state = 0;
 
-        got_orig   = 1;
+        gs->got_orig   = 1;
     }
 
     if (type == ITEM_SHRINK)
     {
-        switch (grow_state)
+        switch (gs->grow_state)
         {
         case -1:
             break;
 
         case  0:
-            audio_play(AUD_SHRINK, 1.f);
-            grow_goal = grow_orig * GROW_SMALL;
-            grow_state = -1;
-            grow = 1;
+            audio_play(gs, AUD_SHRINK, 1.f);
+            gs->grow_goal = gs->grow_orig * GROW_SMALL;
+            gs->grow_state = -1;
+            gs->grow = 1;
             break;
 
         case +1:
-            audio_play(AUD_SHRINK, 1.f);
-            grow_goal = grow_orig;
-            grow_state = 0;
-            grow = 1;
+            audio_play(gs, AUD_SHRINK, 1.f);
+            gs->grow_goal = gs->grow_orig;
+            gs->grow_state = 0;
+            gs->grow = 1;
             break;
         }
     }
     else if (type == ITEM_GROW)
     {
-        switch (grow_state)
+        switch (gs->grow_state)
         {
         case -1:
-            audio_play(AUD_GROW, 1.f);
-            grow_goal = grow_orig;
-            grow_state = 0;
-            grow = 1;
+            audio_play(gs, AUD_GROW, 1.f);
+            gs->grow_goal = gs->grow_orig;
+            gs->grow_state = 0;
+            gs->grow = 1;
             break;
 
         case  0:
-            audio_play(AUD_GROW, 1.f);
-            grow_goal = grow_orig * GROW_BIG;
-            grow_state = +1;
-            grow = 1;
+            audio_play(gs, AUD_GROW, 1.f);
+            gs->grow_goal = gs->grow_orig * GROW_BIG;
+            gs->grow_state = +1;
+            gs->grow = 1;
             break;
 
         case +1:
@@ -395,196 +410,261 @@ static void grow_init(int type)
         }
     }
 
-    if (grow)
+    if (gs->grow)
     {
-        grow_t = 0.0;
-        grow_strt = vary.uv->r;
+        gs->grow_t = 0.0;
+        gs->grow_strt = gs->vary.uv->r;
     }
 }
 
-static void grow_step(float dt)
+static void grow_step(struct game_server *gs, float dt)
 {
     float dr;
 
-    if (!grow)
+    if (!gs->grow)
         return;
 
     /* Calculate new size based on how long since you touched the coin... */
 
-    grow_t += dt;
+    gs->grow_t += dt;
 
-    if (grow_t >= GROW_TIME)
+    if (gs->grow_t >= GROW_TIME)
     {
-        grow = 0;
-        grow_t = GROW_TIME;
+        gs->grow = 0;
+        gs->grow_t = GROW_TIME;
     }
 
-    dr = grow_strt + ((grow_goal-grow_strt) * (1.0f / (GROW_TIME / grow_t)));
+    dr = gs->grow_strt + ((gs->grow_goal - gs->grow_strt) *
+                          (1.0f / (GROW_TIME / gs->grow_t)));
 
     /* No sinking through the floor! Keeps ball's bottom constant. */
 
-    vary.uv->p[1] += (dr - vary.uv->r);
-    vary.uv->r     =  dr;
+    gs->vary.uv->p[1] += (dr - gs->vary.uv->r);
+    gs->vary.uv->r     =  dr;
 
-    game_cmd_ballradius();
+    game_cmd_ballradius(gs);
 }
 
 /*---------------------------------------------------------------------------*/
 
-static struct lockstep server_step;
+static void game_server_iter(void *, float);
 
-int game_server_init(const char *file_name, int t, int e)
+/*
+ * Create a server that sends its output to SINK.  A shared server
+ * loads levels through the game_base cache it has in common with the
+ * client.  Any other keeps a copy of its own.
+ */
+struct game_server *game_server_new(const struct cmd_sink *sink, int shared)
 {
-    struct { int x, y; } version;
-    int i;
+    struct game_server *gs;
 
-    timer      = (float) t / 100.f;
-    timer_down = (t > 0);
-    coins      = 0;
-    status     = GAME_NONE;
+    if ((gs = calloc(1, sizeof (*gs))))
+    {
+        gs->sink   = *sink;
+        gs->shared = shared;
 
-    game_server_free(file_name);
+        gs->step.step = game_server_iter;
+        gs->step.data = gs;
+        gs->step.dt   = DT;
 
-    /* Load SOL data. */
+        lockstep_clr(&gs->step);
+    }
+    return gs;
+}
+
+void game_server_delete(struct game_server *gs)
+{
+    if (gs)
+    {
+        game_server_free(gs, NULL);
+        free(gs);
+    }
+}
 
-    if (!game_base_load(file_name))
-        return (server_state = 0);
+static int game_server_load(struct game_server *gs, const char *file_name)
+{
+    struct s_base *base = gs->shared ? &game_base : &gs->base;
 
-    if (!sol_load_vary(&vary, &game_base))
+    if (gs->shared)
+    {
+        if (!game_base_load(file_name))
+            return 0;
+    }
+    else
     {
-        game_base_free(NULL);
-        return (server_state = 0);
+        if (!sol_load_base(&gs->base, file_name))
+            return 0;
     }
 
-    server_state = 1;
+    if (!sol_load_vary(&gs->vary, base))
+    {
+        if (gs->shared)
+            game_base_free(NULL);
+        else
+            sol_free_base(&gs->base);
+
+        return 0;
+    }
+    return 1;
+}
+
+int game_server_init(struct game_server *gs,
+                     const char *file_name, int t, int e)
+{
+    struct { int x, y; } version;
+    int i;
+
+    gs->timer      = (float) t / 100.f;
+    gs->timer_down = (t > 0);
+    gs->coins      = 0;
+    gs->status     = GAME_NONE;
+
+    game_server_free(gs, file_name);
+
+    /* Load SOL data. */
+
+    if (!game_server_load(gs, file_name))
+        return (gs->state = 0);
+
+    gs->state = 1;
 
     /* Get SOL version. */
 
     version.x = 0;
     version.y = 0;
 
-    for (i = 0; i < vary.base->dc; i++)
+    for (i = 0; i < gs->vary.base->dc; i++)
     {
-        char *k = vary.base->av + vary.base->dv[i].ai;
-        char *v = vary.base->av + vary.base->dv[i].aj;
+        char *k = gs->vary.base->av + gs->vary.base->dv[i].ai;
+        char *v = gs->vary.base->av + gs->vary.base->dv[i].aj;
 
         if (strcmp(k, "version") == 0)
             sscanf(v, "%d.%d", &version.x, &version.y);
     }
 
-    input_init();
+    input_init(&gs->input);
+
+    game_tilt_init(&gs->tilt);
 
-    game_tilt_init(&tilt);
+    gs->tilt_fixed = 0;
 
     /* Initialize jump and goal states. */
 
-    jump_e = 1;
-    jump_b = 0;
+    gs->jump_e = 1;
+    gs->jump_b = 0;
 
-    goal_e = e ? 1 : 0;
+    gs->goal_e = e ? 1 : 0;
 
     /* Initialize the view (and put it at the ball). */
 
-    game_view_fly(&view, &vary, 0.0f);
+    game_view_fly(&gs->view, &gs->vary, 0.0f);
 
-    view_k = 1.0f;
+    gs->view_k = 1.0f;
 
-    view_time = 0.0f;
-    view_fade = 0.0f;
+    gs->view_time = 0.0f;
+    gs->view_fade = 0.0f;
 
     /* Initialize ball size tracking. */
 
-    got_orig = 0;
-    grow = 0;
+    gs->got_orig = 0;
+    gs->grow = 0;
 
     /* Initialize simulation. */
 
-    sol_init_sim(&vary);
+    sol_init_sim(&gs->vary);
 
     /* Send initial update. */
 
-    game_cmd_map(file_name, version.x, version.y);
-    game_cmd_ups();
-    game_cmd_timer();
+    game_cmd_map(gs, file_name, version.x, version.y);
+    game_cmd_ups(gs);
+    game_cmd_timer(gs);
 
-    if (goal_e)
-        game_cmd_goalopen();
+    if (gs->goal_e)
+        game_cmd_goalopen(gs);
 
-    game_cmd_init_balls();
-    game_cmd_init_items();
+    game_cmd_init_balls(gs);
+    game_cmd_init_items(gs);
 
-    game_cmd_updview();
-    game_cmd_eou();
+    game_cmd_updview(gs);
+    game_cmd_eou(gs);
 
     /* Reset lockstep state. */
 
-    lockstep_clr(&server_step);
+    lockstep_clr(&gs->step);
 
-    return server_state;
+    return gs->state;
 }
 
-void game_server_free(const char *next)
+void game_server_free(struct game_server *gs, const char *next)
 {
-    if (server_state)
+    if (gs->state)
     {
         sol_quit_sim();
-        sol_free_vary(&vary);
+        sol_free_vary(&gs->vary);
 
-        game_base_free(next);
+        if (gs->shared)
+            game_base_free(next);
+        else
+            sol_free_base(&gs->base);
 
-        server_state = 0;
+        gs->state = 0;
     }
 }
 
 /*---------------------------------------------------------------------------*/
 
-static void game_update_view(float dt)
+static void game_update_view(struct game_server *gs, float dt)
 {
-    float dc = view.dc * (jump_b > 0 ? 2.0f * fabsf(jump_dt - 0.5f) : 1.0f);
-    float da = input_get_r() * dt * 90.0f;
+    struct game_view *view = &gs->view;
+    struct s_vary    *vary = &gs->vary;
+
+    float dc = view->dc * (gs->jump_b > 0 ? 2.0f * fabsf(gs->jump_dt - 0.5f)
+                                          : 1.0f);
+    float da = input_get_r(&gs->input) * dt * 90.0f;
     float k;
 
     float M[16], v[3], Y[3] = { 0.0f, 1.0f, 0.0f };
     float view_v[3];
 
-    float spd = (float) cam_speed(input_get_c()) / 1000.0f;
+    float spd = (float) cam_speed(input_get_c(&gs->input)) / 1000.0f;
 
     /* Track manual rotation time. */
 
     if (da == 0.0f)
     {
-        if (view_time < 0.0f)
+        if (gs->view_time < 0.0f)
         {
             /* Transition time is influenced by activity time. */
 
-            view_fade = CLAMP(VIEW_FADE_MIN, -view_time, VIEW_FADE_MAX);
-            view_time = 0.0f;
+            gs->view_fade = CLAMP(VIEW_FADE_MIN, -gs->view_time,
+                                  VIEW_FADE_MAX);
+            gs->view_time = 0.0f;
         }
 
         /* Inactivity. */
 
-        view_time += dt;
+        gs->view_time += dt;
     }
     else
     {
-        if (view_time > 0.0f)
+        if (gs->view_time > 0.0f)
         {
-            view_fade = 0.0f;
-            view_time = 0.0f;
+            gs->view_fade = 0.0f;
+            gs->view_time = 0.0f;
         }
 
         /* Activity (yes, this is negative). */
 
-        view_time -= dt;
+        gs->view_time -= dt;
     }
 
     /* Center the view about the ball. */
 
-    v_cpy(view.c, vary.uv->p);
+    v_cpy(view->c, vary->uv->p);
 
-    view_v[0] = -vary.uv->v[0];
+    view_v[0] = -vary->uv->v[0];
     view_v[1] =  0.0f;
-    view_v[2] = -vary.uv->v[2];
+    view_v[2] = -vary->uv->v[2];
 
     /* Compute view vector. */
 
@@ -596,24 +676,25 @@ static void game_update_view(float dt)
         {
             float s;
 
-            v_sub(view.e[2], view.p, view.c);
-            v_nrm(view.e[2], view.e[2]);
+            v_sub(view->e[2], view->p, view->c);
+            v_nrm(view->e[2], view->e[2]);
 
             /* Gradually restore view vector convergence rate. */
 
-            s = fpowf(view_time, 3.0f) / fpowf(view_fade, 3.0f);
+            s = fpowf(gs->view_time, 3.0f) / fpowf(gs->view_fade, 3.0f);
             s = CLAMP(0.0f, s, 1.0f);
 
-            v_mad(view.e[2], view.e[2], view_v, v_len(view_v) * spd * s * dt);
+            v_mad(view->e[2], view->e[2], view_v,
+                  v_len(view_v) * spd * s * dt);
         }
     }
     else
     {
         /* View vector is given by view angle. */
 
-        view.e[2][0] = fsinf(V_RAD(view.a));
-        view.e[2][1] = 0.0;
-        view.e[2][2] = fcosf(V_RAD(view.a));
+        view->e[2][0] = fsinf(V_RAD(view->a));
+        view->e[2][1] = 0.0;
+        view->e[2][2] = fcosf(V_RAD(view->a));
     }
 
     /* Apply manual rotation. */
@@ -621,62 +702,63 @@ static void game_update_view(float dt)
     if (da != 0.0f)
     {
         m_rot(M, Y, V_RAD(da));
-        m_vxfm(v, M, view.e[2]);
-        v_cpy(view.e[2], v);
+        m_vxfm(v, M, view->e[2]);
+        v_cpy(view->e[2], v);
     }
 
     /* Orthonormalize the new view reference frame. */
 
-    v_crs(view.e[0], view.e[1], view.e[2]);
-    v_crs(view.e[2], view.e[0], view.e[1]);
-    v_nrm(view.e[0], view.e[0]);
-    v_nrm(view.e[2], view.e[2]);
+    v_crs(view->e[0], view->e[1], view->e[2]);
+    v_crs(view->e[2], view->e[0], view->e[1]);
+    v_nrm(view->e[0], view->e[0]);
+    v_nrm(view->e[2], view->e[2]);
 
     /* Compute the new view position. */
 
-    k = 1.0f + v_dot(view.e[2], view_v) / 10.0f;
+    k = 1.0f + v_dot(view->e[2], view_v) / 10.0f;
 
-    view_k = view_k + (k - view_k) * dt;
+    gs->view_k = gs->view_k + (k - gs->view_k) * dt;
 
-    if (view_k < 0.5f) view_k = 0.5;
+    if (gs->view_k < 0.5f) gs->view_k = 0.5;
 
-    v_scl(v,    view.e[1], view.dp * view_k);
-    v_mad(v, v, view.e[2], view.dz * view_k);
-    v_add(view.p, v, vary.uv->p);
+    v_scl(v,    view->e[1], view->dp * gs->view_k);
+    v_mad(v, v, view->e[2], view->dz * gs->view_k);
+    v_add(view->p, v, vary->uv->p);
 
     /* Compute the new view center. */
 
-    v_cpy(view.c, vary.uv->p);
-    v_mad(view.c, view.c, view.e[1], dc);
+    v_cpy(view->c, vary->uv->p);
+    v_mad(view->c, view->c, view->e[1], dc);
 
     /* Note the current view angle. */
 
-    view.a = V_DEG(fatan2f(view.e[2][0], view.e[2][2]));
+    view->a = V_DEG(fatan2f(view->e[2][0], view->e[2][2]));
 
-    game_cmd_updview();
+    game_cmd_updview(gs);
 }
 
-static void game_update_time(float dt, int b)
+static void game_update_time(struct game_server *gs, float dt, int b)
 {
    /* The ticking clock. */
 
-    if (b && timer_down)
+    if (b && gs->timer_down)
     {
-        if (timer < 600.f)
-            timer -= dt;
-        if (timer < 0.f)
-            timer = 0.f;
+        if (gs->timer < 600.f)
+            gs->timer -= dt;
+        if (gs->timer < 0.f)
+            gs->timer = 0.f;
     }
     else if (b)
     {
-        timer += dt;
+        gs->timer += dt;
     }
 
-    if (b) game_cmd_timer();
+    if (b) game_cmd_timer(gs);
 }
 
-static int game_update_state(int bt)
+static int game_update_state(struct game_server *gs, int bt)
 {
+    struct s_vary *vary = &gs->vary;
     struct b_goal *zp;
     int hi;
 
@@ -684,21 +766,21 @@ static int game_update_state(int bt)
 
     /* Test for an item. */
 
-    if (bt && (hi = sol_item_test(&vary, p, ITEM_RADIUS)) != -1)
+    if (bt && (hi = sol_item_test(vary, p, ITEM_RADIUS)) != -1)
     {
-        struct v_item *hp = vary.hv + hi;
+        struct v_item *hp = vary->hv + hi;
 
-        game_cmd_pkitem(hi);
+        game_cmd_pkitem(gs, hi);
 
-        grow_init(hp->t);
+        grow_init(gs, hp->t);
 
         if (hp->t == ITEM_COIN)
         {
-            coins += hp->n;
-            game_cmd_coins();
+            gs->coins += hp->n;
+            game_cmd_coins(gs);
         }
 
-        audio_play(AUD_COIN, 1.f);
+        audio_play(gs, AUD_COIN, 1.f);
 
         /* Discard item. */
 
@@ -707,109 +789,118 @@ static int game_update_state(int bt)
 
     /* Test for a switch. */
 
-    if (sol_swch_test(&vary, game_proxy_enq, 0) == SWCH_INSIDE)
-        audio_play(AUD_SWITCH, 1.f);
+    if (sol_swch_test(vary, &gs->sink, 0) == SWCH_INSIDE)
+        audio_play(gs, AUD_SWITCH, 1.f);
 
     /* Test for a jump. */
 
-    if (jump_e == 1 && jump_b == 0 && (sol_jump_test(&vary, jump_p, 0) ==
-                                       JUMP_INSIDE))
+    if (gs->jump_e == 1 && gs->jump_b == 0 &&
+        sol_jump_test(vary, gs->jump_p, 0) == JUMP_INSIDE)
     {
-        jump_b  = 1;
-        jump_e  = 0;
-        jump_dt = 0.f;
+        gs->jump_b  = 1;
+        gs->jump_e  = 0;
+        gs->jump_dt = 0.f;
 
-        audio_play(AUD_JUMP, 1.f);
+        audio_play(gs, AUD_JUMP, 1.f);
 
-        game_cmd_jump(1);
+        game_cmd_jump(gs, 1);
     }
-    if (jump_e == 0 && jump_b == 0 && (sol_jump_test(&vary, jump_p, 0) ==
-                                       JUMP_OUTSIDE))
+    if (gs->jump_e == 0 && gs->jump_b == 0 &&
+        sol_jump_test(vary, gs->jump_p, 0) == JUMP_OUTSIDE)
     {
-        jump_e = 1;
-        game_cmd_jump(0);
+        gs->jump_e = 1;
+        game_cmd_jump(gs, 0);
     }
 
     /* Test for a goal. */
 
-    if (bt && goal_e && (zp = sol_goal_test(&vary, p, 0)))
+    if (bt && gs->goal_e && (zp = sol_goal_test(vary, p, 0)))
     {
-        audio_play(AUD_GOAL, 1.0f);
+        audio_play(gs, AUD_GOAL, 1.0f);
         return GAME_GOAL;
     }
 
     /* Test for time-out. */
 
-    if (bt && timer_down && timer <= 0.f)
+    if (bt && gs->timer_down && gs->timer <= 0.f)
     {
-        audio_play(AUD_TIME, 1.0f);
+        audio_play(gs, AUD_TIME, 1.0f);
         return GAME_TIME;
     }
 
     /* Test for fall-out. */
 
-    if (bt && (vary.base->vc == 0 || vary.uv[0].p[1] < vary.base->vv[0].p[1]))
+    if (bt && (vary->base->vc == 0 ||
+               vary->uv[0].p[1] < vary->base->vv[0].p[1]))
     {
-        audio_play(AUD_FALL, 1.0f);
+        audio_play(gs, AUD_FALL, 1.0f);
         return GAME_FALL;
     }
 
     return GAME_NONE;
 }
 
-static int game_step(const float g[3], float dt, int bt)
+static int game_step(struct game_server *gs,
+                     const float g[3], float dt, int bt)
 {
-    if (server_state)
+    if (gs->state)
     {
         float h[3];
 
-        /* Smooth jittery or discontinuous input. */
+        if (!gs->tilt_fixed)
+        {
+            /* Smooth jittery or discontinuous input. */
+
+            const struct input *in = &gs->input;
+
+            const float s = MAX(dt, input_get_s(in));
 
-        tilt.rx += (input_get_x() - tilt.rx) * dt / MAX(dt, input_get_s());
-        tilt.rz += (input_get_z() - tilt.rz) * dt / MAX(dt, input_get_s());
+            gs->tilt.rx += (input_get_x(in) - gs->tilt.rx) * dt / s;
+            gs->tilt.rz += (input_get_z(in) - gs->tilt.rz) * dt / s;
 
-        game_tilt_axes(&tilt, view.e);
+            game_tilt_axes(&gs->tilt, gs->view.e);
+        }
 
-        game_cmd_tiltaxes();
-        game_cmd_tiltangles();
+        game_cmd_tiltaxes(gs);
+        game_cmd_tiltangles(gs);
 
-        grow_step(dt);
+        grow_step(gs, dt);
 
-        game_tilt_grav(h, g, &tilt);
+        game_tilt_grav(h, g, &gs->tilt);
 
-        if (jump_b > 0)
+        if (gs->jump_b > 0)
         {
-            jump_dt += dt;
+            gs->jump_dt += dt;
 
             /* Handle a jump. */
 
-            if (jump_dt >= 0.5f)
+            if (gs->jump_dt >= 0.5f)
             {
                 /* Translate view at the exact instant of the jump. */
 
-                if (jump_b == 1)
+                if (gs->jump_b == 1)
                 {
                     float dp[3];
 
-                    v_sub(dp,     jump_p, vary.uv->p);
-                    v_add(view.p, view.p, dp);
+                    v_sub(dp,     gs->jump_p, gs->vary.uv->p);
+                    v_add(gs->view.p, gs->view.p, dp);
 
-                    jump_b = 2;
+                    gs->jump_b = 2;
                 }
 
                 /* Translate ball and hold it at the destination. */
 
-                v_cpy(vary.uv->p, jump_p);
+                v_cpy(gs->vary.uv->p, gs->jump_p);
             }
 
-            if (jump_dt >= 1.0f)
-                jump_b = 0;
+            if (gs->jump_dt >= 1.0f)
+                gs->jump_b = 0;
         }
         else
         {
             /* Run the sim. */
 
-            float b = sol_step(&vary, game_proxy_enq, h, dt, 0, NULL);
+            float b = sol_step(&gs->vary, &gs->sink, h, dt, 0, NULL);
 
             /* Mix the sound of a ball bounce. */
 
@@ -817,104 +908,124 @@ static int game_step(const float g[3], float dt, int bt)
             {
                 float k = (b - 0.5f) * 2.0f;
 
-                if (got_orig)
+                if (gs->got_orig)
                 {
-                    if      (vary.uv->r > grow_orig) audio_play(AUD_BUMPL, k);
-                    else if (vary.uv->r < grow_orig) audio_play(AUD_BUMPS, k);
-                    else                             audio_play(AUD_BUMPM, k);
+                    float r = gs->vary.uv->r;
+
+                    if      (r > gs->grow_orig) audio_play(gs, AUD_BUMPL, k);
+                    else if (r < gs->grow_orig) audio_play(gs, AUD_BUMPS, k);
+                    else                        audio_play(gs, AUD_BUMPM, k);
                 }
-                else audio_play(AUD_BUMPM, k);
+                else audio_play(gs, AUD_BUMPM, k);
             }
         }
 
-        game_cmd_updball();
+        game_cmd_updball(gs);
 
-        game_update_view(dt);
-        game_update_time(dt, bt);
+        game_update_view(gs, dt);
+        game_update_time(gs, dt, bt);
 
-        return game_update_state(bt);
+        return game_update_state(gs, bt);
     }
     return GAME_NONE;
 }
 
-static void game_server_iter(float dt)
+static void game_server_iter(void *data, float dt)
 {
-    switch (status)
+    struct game_server *gs = data;
+
+    switch (gs->status)
     {
-    case GAME_GOAL: game_step(GRAVITY_UP, dt, 0); break;
-    case GAME_FALL: game_step(GRAVITY_DN, dt, 0); break;
+    case GAME_GOAL: game_step(gs, GRAVITY_UP, dt, 0); break;
+    case GAME_FALL: game_step(gs, GRAVITY_DN, dt, 0); break;
 
     case GAME_NONE:
-        if ((status = game_step(GRAVITY_DN, dt, 1)) != GAME_NONE)
-            game_cmd_status();
+        if ((gs->status = game_step(gs, GRAVITY_DN, dt, 1)) != GAME_NONE)
+            game_cmd_status(gs);
         break;
     }
 
-    game_cmd_eou();
+    game_cmd_eou(gs);
 }
 
-static struct lockstep server_step = { game_server_iter, DT };
-
-void game_server_step(float dt)
+void game_server_step(struct game_server *gs, float dt)
 {
-    lockstep_run(&server_step, dt);
+    lockstep_run(&gs->step, dt);
 }
 
-float game_server_blend(void)
+float game_server_blend(struct game_server *gs)
 {
-    return lockstep_blend(&server_step);
+    return lockstep_blend(&gs->step);
 }
 
 /*---------------------------------------------------------------------------*/
 
-void game_set_goal(void)
+void game_set_goal(struct game_server *gs)
 {
-    audio_play(AUD_SWITCH, 1.0f);
-    goal_e = 1;
+    audio_play(gs, AUD_SWITCH, 1.0f);
+    gs->goal_e = 1;
 
-    game_cmd_goalopen();
+    game_cmd_goalopen(gs);
 }
 
 /*---------------------------------------------------------------------------*/
 
-void game_set_x(float k)
+void game_set_x(struct game_server *gs, float k)
 {
-    input_set_x(-ANGLE_BOUND * k);
+    input_set_x(&gs->input, -ANGLE_BOUND * k);
 
-    input_set_s(config_get_d(CONFIG_JOYSTICK_RESPONSE) * 0.001f);
+    input_set_s(&gs->input, config_get_d(CONFIG_JOYSTICK_RESPONSE) * 0.001f);
 }
 
-void game_set_z(float k)
+void game_set_z(struct game_server *gs, float k)
 {
-    input_set_z(+ANGLE_BOUND * k);
+    input_set_z(&gs->input, +ANGLE_BOUND * k);
 
-    input_set_s(config_get_d(CONFIG_JOYSTICK_RESPONSE) * 0.001f);
+    input_set_s(&gs->input, config_get_d(CONFIG_JOYSTICK_RESPONSE) * 0.001f);
 }
 
-void game_set_ang(float x, float z)
+void game_set_ang(struct game_server *gs, float x, float z)
 {
-    input_set_x(x);
-    input_set_z(z);
+    input_set_x(&gs->input, x);
+    input_set_z(&gs->input, z);
 }
 
-void game_set_pos(int x, int y)
+void game_set_pos(struct game_server *gs, int x, int y)
 {
     const float range = ANGLE_BOUND * 2;
 
-    input_set_x(input_get_x() + range * y / config_get_d(CONFIG_MOUSE_SENSE));
-    input_set_z(input_get_z() + range * x / config_get_d(CONFIG_MOUSE_SENSE));
+    struct input *in = &gs->input;
+
+    const int sense = config_get_d(CONFIG_MOUSE_SENSE);
+
+    input_set_x(in, input_get_x(in) + range * y / sense);
+    input_set_z(in, input_get_z(in) + range * x / sense);
+
+    input_set_s(&gs->input, config_get_d(CONFIG_MOUSE_RESPONSE) * 0.001f);
+}
 
-    input_set_s(config_get_d(CONFIG_MOUSE_RESPONSE) * 0.001f);
+/*
+ * Use the given floor rotation verbatim, bypassing input and view, as
+ * when re-simulating a replay.  NULL returns control to the input.
+ */
+void game_set_tilt(struct game_server *gs, const struct game_tilt *t)
+{
+    if (t)
+    {
+        gs->tilt = *t;
+        gs->tilt_fixed = 1;
+    }
+    else gs->tilt_fixed = 0;
 }
 
-void game_set_cam(int c)
+void game_set_cam(struct game_server *gs, int c)
 {
-    input_set_c(c);
+    input_set_c(&gs->input, c);
 }
 
-void game_set_rot(float r)
+void game_set_rot(struct game_server *gs, float r)
 {
-    input_set_r(r);
+    input_set_r(&gs->input, r);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -9,19 +9,28 @@
 
 /*---------------------------------------------------------------------------*/
 
-int   game_server_init(const char *, int, int);
-void  game_server_free(const char *);
-void  game_server_step(float);
-float game_server_blend(void);
-
-void  game_set_goal(void);
-
-void  game_set_ang(float, float);
-void  game_set_pos(int, int);
-void  game_set_x  (float);
-void  game_set_z  (float);
-void  game_set_cam(int);
-void  game_set_rot(float);
+struct game_server;
+struct game_tilt;
+struct cmd_sink;
+
+struct game_server *game_server_new(const struct cmd_sink *, int shared);
+void                game_server_delete(struct game_server *);
+
+int   game_server_init(struct game_server *, const char *, int, int);
+void  game_server_free(struct game_server *, const char *);
+void  game_server_step(struct game_server *, float);
+float game_server_blend(struct game_server *);
+
+void  game_set_goal(struct game_server *);
+
+void  game_set_ang(struct game_server *, float, float);
+void  game_set_pos(struct game_server *, int, int);
+void  game_set_x  (struct game_server *, float);
+void  game_set_z  (struct game_server *, float);
+void  game_set_cam(struct game_server *, int);
+void  game_set_rot(struct game_server *, float);
+
+void  game_set_tilt(struct game_server *, const struct game_tilt *);
 
 /*---------------------------------------------------------------------------*/
 
@@ -20,6 +20,7 @@
 
 #include "solid_base.h"
 
+#include "cache.h"
 #include "common.h"
 #include "config.h"
 #include "level.h"
@@ -126,6 +127,79 @@ static void scan_level_attribs(struct level *l, const struct s_base *base)
     }
 }
 
+/*
+ * Convert between the dictionary of a level and the strings of its
+ * index entry, keys and values alternating.
+ */
+static Array dict_to_lines(const struct s_base *base)
+{
+    Array lines;
+    int i;
+
+    if ((lines = array_new(sizeof (char *))))
+        for (i = 0; i < base->dc * 2; i++)
+        {
+            const struct b_dict *dp = base->dv + i / 2;
+            char **p;
+
+            if ((p = array_add(lines)))
+                *p = strdup(base->av + (i % 2 ? dp->aj : dp->ai));
+        }
+
+    return lines;
+}
+
+static int lines_to_dict(Array lines, struct s_base *base)
+{
+    int i, n = array_len(lines);
+    char *p;
+
+    for (i = 0; i < n; i++)
+        base->ac += strlen(CACHE_LINE(lines, i)) + 1;
+
+    base->dc = n / 2;
+
+    if (!(p = base->av = (char *) malloc(base->ac ? base->ac : 1)) ||
+        !(base->dv = (struct b_dict *) calloc(base->dc + 1, sizeof (*base->dv))))
+        return 0;
+
+    for (i = 0; i < base->dc * 2; i++)
+    {
+        if (i % 2)
+            base->dv[i / 2].aj = (int) (p - base->av);
+        else
+            base->dv[i / 2].ai = (int) (p - base->av);
+
+        strcpy(p, CACHE_LINE(lines, i));
+        p += strlen(p) + 1;
+    }
+    return 1;
+}
+
+/*
+ * Read the dictionary of a level from the index, if current, or else
+ * from the level file.
+ */
+static int level_load_meta(struct s_base *base, const char *filename)
+{
+    struct fs_stamp stamp;
+    Array lines;
+
+    if ((lines = cache_get(filename, &stamp)))
+        return lines_to_dict(lines, base);
+
+    if (sol_load_meta(base, filename))
+    {
+        if ((lines = dict_to_lines(base)))
+        {
+            cache_put(filename, &stamp, lines);
+            cache_free_lines(lines);
+        }
+        return 1;
+    }
+    return 0;
+}
+
 int level_load(const char *filename, struct level *level)
 {
     struct s_base base;
@@ -133,8 +207,10 @@ int level_load(const char *filename, struct level *level)
     memset(level, 0, sizeof (struct level));
     memset(&base, 0, sizeof (base));
 
-    if (!sol_load_meta(&base, filename))
+    if (!level_load_meta(&base, filename))
     {
+        sol_free_base(&base);
+
         log_printf("Failure to load level file '%s'\n", filename);
         return 0;
     }
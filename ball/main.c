@@ -29,6 +29,7 @@
 #include "image.h"
 #include "audio.h"
 #include "demo.h"
+#include "demo_verify.h"
 #include "progress.h"
 #include "gui.h"
 #include "set.h"
@@ -40,6 +41,8 @@
 #include "mtrl.h"
 #include "geom.h"
 #include "joy.h"
+#include "preload.h"
+#include "cache.h"
 
 #include "st_conf.h"
 #include "st_title.h"
@@ -395,6 +398,7 @@ static int loop(void)
 static char *opt_data;
 static char *opt_replay;
 static char *opt_level;
+static char *opt_verify;
 
 #define opt_usage                                                     \
     "Usage: %s [options ...]\n"                                       \
@@ -403,7 +407,8 @@ static char *opt_level;
     "  -v, --version             show version.\n"                     \
     "  -d, --data <dir>          use 'dir' as game data directory.\n" \
     "  -r, --replay <file>       play the replay 'file'.\n"           \
-    "  -l, --level <file>        load the level 'file'\n"
+    "  -l, --level <file>        load the level 'file'\n"             \
+    "      --verify <dir>        check the replays in 'dir' and exit.\n"
 
 #define opt_error(option) \
     fprintf(stderr, "Option '%s' requires an argument.\n", option)
@@ -461,6 +466,17 @@ static void opt_parse(int argc, char **argv)
             continue;
         }
 
+        if (strcmp(argv[i], "--verify") == 0)
+        {
+            if (i + 1 == argc)
+            {
+                opt_error(argv[i]);
+                exit(EXIT_FAILURE);
+            }
+            opt_verify = argv[++i];
+            continue;
+        }
+
         /* Perform magic on a single unrecognized argument. */
 
         if (argc == 2)
@@ -552,6 +568,22 @@ static void make_dirs_and_migrate(void)
 
 /*---------------------------------------------------------------------------*/
 
+/*
+ * Serialize reads from packages, which the audio thread, the level
+ * preloader, and the replay verifier all do alongside the main thread.
+ */
+static void lock_fs(void *data)
+{
+    SDL_mutexP((SDL_mutex *) data);
+}
+
+static void unlock_fs(void *data)
+{
+    SDL_mutexV((SDL_mutex *) data);
+}
+
+/*---------------------------------------------------------------------------*/
+
 struct main_loop
 {
     Uint32 now;
@@ -591,6 +623,8 @@ static void step(void *data)
 int main(int argc, char *argv[])
 {
     struct main_loop mainloop = { 0 };
+    SDL_mutex *fs_lock;
+    int status = 0;
 
     if (!fs_init(argc > 0 ? argv[0] : NULL))
     {
@@ -599,12 +633,25 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    if ((fs_lock = SDL_CreateMutex()))
+        fs_set_lock(lock_fs, unlock_fs, fs_lock);
+
     opt_parse(argc, argv);
 
     config_paths(opt_data);
     log_init("Neverball", "neverball.log");
     make_dirs_and_migrate();
 
+    /* Verify replays without bringing up the rest of the game. */
+
+    if (opt_verify)
+    {
+        config_init();
+
+        status = demo_verify_dir(opt_verify, SDL_GetCPUCount()) ? 1 : 0;
+        goto quit;
+    }
+
     /* Initialize SDL. */
 
 #ifdef SDL_HINT_TOUCH_MOUSE_EVENTS
@@ -644,6 +691,10 @@ int main(int argc, char *argv[])
 
     mtrl_init();
 
+    /* Index of set, level and replay files, kept for the whole session. */
+
+    cache_init();
+
     /* Screen states. */
 
     init_state(&st_null);
@@ -708,6 +759,8 @@ int main(int argc, char *argv[])
 
     config_save();
 
+    preload_quit();
+    cache_quit();
     mtrl_quit();
 
     tilt_free();
@@ -715,7 +768,18 @@ int main(int argc, char *argv[])
     joy_quit();
     SDL_Quit();
 
-    return 0;
+quit:
+    log_quit();
+
+    if (fs_lock)
+    {
+        fs_set_lock(NULL, NULL, NULL);
+        SDL_DestroyMutex(fs_lock);
+    }
+
+    fs_quit();
+
+    return status;
 }
 
 /*---------------------------------------------------------------------------*/
@@ -0,0 +1,302 @@
+/*
+ * Copyright (C) 2003-2010 Neverball authors
+ *
+ * NEVERBALL is  free software; you can redistribute  it and/or modify
+ * it under the  terms of the GNU General  Public License as published
+ * by the Free  Software Foundation; either version 2  of the License,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT  ANY  WARRANTY;  without   even  the  implied  warranty  of
+ * MERCHANTABILITY or  FITNESS FOR A PARTICULAR PURPOSE.   See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * Level preloading.  While a menu is on screen, a loader thread reads
+ * the SOL of the level likely to be played next, along with that of its
+ * background, and decodes their textures.  The main thread makes the
+ * textures one per frame, holding a reference to each material so that
+ * the level's own load finds them cached.  The loaded SOL is handed to
+ * game_base_load.
+ */
+
+#include <SDL.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "preload.h"
+#include "array.h"
+#include "common.h"
+#include "image.h"
+#include "mtrl.h"
+
+/*---------------------------------------------------------------------------*/
+
+struct item
+{
+    struct b_mtrl     mtrl;
+    struct mtrl_image image;
+
+    int mi;                             /* Cached material, or -1            */
+};
+
+static SDL_mutex  *lock;
+static SDL_Thread *thread;
+
+static char path[PATHMAX];              /* Level being preloaded, if any     */
+
+static int ready;                       /* Loader thread is done             */
+static int cancel;                      /* Loader thread should stop         */
+
+static struct s_base base;
+static int           base_ok;
+
+static Array items;                     /* Materials of level and background */
+static int   next_item;                 /* Next material to cache            */
+
+/*---------------------------------------------------------------------------*/
+
+static int is_cancelled(void)
+{
+    int c;
+
+    SDL_mutexP(lock);
+    c = cancel;
+    SDL_mutexV(lock);
+
+    return c;
+}
+
+static int is_ready(void)
+{
+    int r;
+
+    SDL_mutexP(lock);
+    r = ready;
+    SDL_mutexV(lock);
+
+    return r;
+}
+
+/*
+ * Add the materials of FP, skipping duplicates.
+ */
+static void add_items(const struct s_base *fp)
+{
+    int i, j;
+
+    for (i = 0; i < fp->mc; i++)
+    {
+        struct item *it;
+
+        for (j = 0; j < array_len(items); j++)
+            if (strcmp(((struct item *) array_get(items, j))->mtrl.f,
+                       fp->mv[i].f) == 0)
+                break;
+
+        if (j == array_len(items) && (it = array_add(items)))
+        {
+            memset(it, 0, sizeof (*it));
+
+            it->mtrl = fp->mv[i];
+            it->mi   = -1;
+        }
+    }
+}
+
+static int preload_thread(void *data)
+{
+    int i;
+
+    if ((base_ok = sol_load_base(&base, path)))
+    {
+        add_items(&base);
+
+        /* The background is loaded by the level, so list its materials. */
+
+        for (i = 0; i < base.dc; i++)
+            if (strcmp(base.av + base.dv[i].ai, "back") == 0)
+            {
+                struct s_base back;
+
+                if (sol_load_base(&back, base.av + base.dv[i].aj))
+                {
+                    add_items(&back);
+                    sol_free_base(&back);
+                }
+            }
+
+        /* Decode the textures. */
+
+        for (i = 0; i < array_len(items) && !is_cancelled(); i++)
+        {
+            struct item *it = array_get(items, i);
+            mtrl_load_image(&it->mtrl, &it->image);
+        }
+    }
+
+    SDL_mutexP(lock);
+    ready = 1;
+    SDL_mutexV(lock);
+
+    return 0;
+}
+
+/*
+ * Make the texture of a preloaded material.
+ */
+static void cache_item(struct item *it)
+{
+    if (it->image.p)
+    {
+        image_stash(it->image.path, it->image.p,
+                    it->image.w, it->image.h, it->image.b);
+        it->image.p = NULL;
+    }
+
+    it->mi = mtrl_cache(&it->mtrl);
+
+    /* Drop the image if the material was already cached. */
+
+    image_stash(NULL, NULL, 0, 0, 0);
+}
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Start loading the named level in the background.
+ */
+void preload_level(const char *file)
+{
+    if (*path && strcmp(path, file) == 0)
+        return;
+
+    preload_free();
+
+    if (!lock && !(lock = SDL_CreateMutex()))
+        return;
+
+    if ((items = array_new(sizeof (struct item))))
+    {
+        SAFECPY(path, file);
+
+        ready     = 0;
+        cancel    = 0;
+        next_item = 0;
+
+        if (!(thread = SDL_CreateThread(preload_thread, "preload", NULL)))
+            preload_free();
+    }
+}
+
+/*
+ * Make at most one preloaded texture.  Call this once per frame.
+ */
+void preload_step(void)
+{
+    if (thread && is_ready() && next_item < array_len(items))
+        cache_item(array_get(items, next_item++));
+}
+
+/*
+ * Finish preloading the named level now, or forget about a different
+ * one.
+ */
+void preload_sync(const char *file)
+{
+    if (*path && strcmp(path, file) == 0)
+    {
+        if (thread)
+        {
+            SDL_WaitThread(thread, NULL);
+            thread = NULL;
+        }
+
+        while (next_item < array_len(items))
+            cache_item(array_get(items, next_item++));
+    }
+    else preload_free();
+}
+
+/*
+ * Hand over the SOL of the named level, if it was preloaded.
+ */
+int preload_take(const char *file, struct s_base *fp)
+{
+    if (*path && strcmp(path, file) == 0)
+    {
+        if (thread)
+        {
+            SDL_WaitThread(thread, NULL);
+            thread = NULL;
+        }
+
+        if (base_ok)
+        {
+            *fp = base;
+
+            memset(&base, 0, sizeof (base));
+            base_ok = 0;
+
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Stop preloading and release everything preloaded.  Textures in use by
+ * a loaded level stay.
+ */
+void preload_free(void)
+{
+    int i;
+
+    if (thread)
+    {
+        SDL_mutexP(lock);
+        cancel = 1;
+        SDL_mutexV(lock);
+
+        SDL_WaitThread(thread, NULL);
+        thread = NULL;
+    }
+
+    if (items)
+    {
+        for (i = 0; i < array_len(items); i++)
+        {
+            struct item *it = array_get(items, i);
+
+            if (it->mi >= 0)
+                mtrl_free(it->mi);
+
+            free(it->image.p);
+        }
+
+        array_free(items);
+        items = NULL;
+    }
+
+    if (base_ok)
+    {
+        sol_free_base(&base);
+        base_ok = 0;
+    }
+
+    path[0] = 0;
+}
+
+void preload_quit(void)
+{
+    preload_free();
+
+    if (lock)
+    {
+        SDL_DestroyMutex(lock);
+        lock = NULL;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,17 @@
+#ifndef PRELOAD_H
+#define PRELOAD_H
+
+#include "solid_base.h"
+
+/*---------------------------------------------------------------------------*/
+
+void preload_level(const char *);
+void preload_step(void);
+void preload_sync(const char *);
+int  preload_take(const char *, struct s_base *);
+void preload_free(void);
+void preload_quit(void);
+
+/*---------------------------------------------------------------------------*/
+
+#endif
@@ -20,10 +20,12 @@
 #include "lang.h"
 #include "score.h"
 #include "audio.h"
+#include "preload.h"
 
 #include "game_common.h"
 #include "game_client.h"
 #include "game_server.h"
+#include "game_proxy.h"
 
 #include <assert.h>
 
@@ -100,14 +102,21 @@ static int init_level(void)
      * server.
      */
 
+    preload_sync(level_file(level));
+
     if (game_client_init(level_file(level)) &&
-        game_server_init(level_file(level), level_time(level), goal_e))
+        game_server_init(game_proxy_server(),
+                         level_file(level), level_time(level), goal_e))
     {
+        preload_free();
+
         game_client_sync(demo_fp);
         audio_music_fade_to(2.0f, level_song(level));
         return 1;
     }
 
+    preload_free();
+
     demo_play_stop(1);
     return 0;
 }
@@ -147,7 +156,7 @@ void progress_step(void)
         if (goal <= 0)
         {
             if (!replay)
-                game_set_goal();
+                game_set_goal(game_proxy_server());
 
             goal = 0;
         }
@@ -323,6 +332,17 @@ int  progress_same(void)
     return progress_play(level);
 }
 
+/*
+ * Start loading the level most likely to be played next.
+ */
+void progress_preload(void)
+{
+    if (status == GAME_GOAL && progress_next_avail())
+        preload_level(level_file(next));
+    else if (progress_same_avail() && level)
+        preload_level(level_file(level));
+}
+
 int  progress_dead(void)
 {
     return mode == MODE_CHALLENGE ? curr.balls < 0 : 0;
@@ -22,6 +22,7 @@
 #include "image.h"
 #include "set.h"
 #include "common.h"
+#include "cache.h"
 #include "fs.h"
 
 #include "game_server.h"
@@ -259,23 +260,43 @@ static void set_load_hs(void)
 
 /*---------------------------------------------------------------------------*/
 
-static int set_load(struct set *s, const char *filename)
+/*
+ * Read the lines of a set file: the name, description, identifier,
+ * screenshot, and challenge scores, followed by the level files.
+ */
+static Array set_read_lines(const char *filename)
 {
     fs_file fin;
-    char *scores, *level_name;
+    Array lines;
+    char *line;
 
-    /* Skip "Misc" set when not in dev mode. */
+    if (!(fin = fs_open_read(filename)))
+        return NULL;
 
-    if (strcmp(filename, SET_MISC) == 0 && !config_cheat())
-        return 0;
+    if ((lines = array_new(sizeof (char *))))
+    {
+        while (array_len(lines) < 5 + MAXLVL && read_line(&line, fin))
+        {
+            char **p;
 
-    fin = fs_open_read(filename);
+            if ((p = array_add(lines)))
+                *p = line;
+            else
+                free(line);
+        }
+    }
 
-    if (!fin)
-    {
-        log_printf("Failure to load set file %s\n", filename);
+    fs_close(fin);
+
+    return lines;
+}
+
+static int set_parse(struct set *s, const char *filename, Array lines)
+{
+    int i;
+
+    if (array_len(lines) < 5)
         return 0;
-    }
 
     memset(s, 0, sizeof (struct set));
 
@@ -286,48 +307,58 @@ static int set_load(struct set *s, const char *filename)
 
     SAFECPY(s->file, filename);
 
-    if (read_line(&s->name, fin) &&
-        read_line(&s->desc, fin) &&
-        read_line(&s->id,   fin) &&
-        read_line(&s->shot, fin) &&
-        read_line(&scores,  fin))
-    {
-        sscanf(scores, "%d %d %d %d %d %d",
-               &s->time_score.timer[RANK_HARD],
-               &s->time_score.timer[RANK_MEDM],
-               &s->time_score.timer[RANK_EASY],
-               &s->coin_score.coins[RANK_HARD],
-               &s->coin_score.coins[RANK_MEDM],
-               &s->coin_score.coins[RANK_EASY]);
+    s->name = strdup(CACHE_LINE(lines, 0));
+    s->desc = strdup(CACHE_LINE(lines, 1));
+    s->id   = strdup(CACHE_LINE(lines, 2));
+    s->shot = strdup(CACHE_LINE(lines, 3));
 
-        free(scores);
+    sscanf(CACHE_LINE(lines, 4), "%d %d %d %d %d %d",
+           &s->time_score.timer[RANK_HARD],
+           &s->time_score.timer[RANK_MEDM],
+           &s->time_score.timer[RANK_EASY],
+           &s->coin_score.coins[RANK_HARD],
+           &s->coin_score.coins[RANK_MEDM],
+           &s->coin_score.coins[RANK_EASY]);
 
-        s->user_scores  = concat_string("Scores/", s->id, ".txt",       NULL);
-        s->cheat_scores = concat_string("Scores/", s->id, "-cheat.txt", NULL);
+    s->user_scores  = concat_string("Scores/", s->id, ".txt",       NULL);
+    s->cheat_scores = concat_string("Scores/", s->id, "-cheat.txt", NULL);
 
-        s->count = 0;
+    s->count = 0;
 
-        while (s->count < MAXLVL && read_line(&level_name, fin))
-        {
-            s->level_name_v[s->count] = level_name;
-            s->count++;
-        }
+    for (i = 5; i < array_len(lines) && s->count < MAXLVL; i++)
+        s->level_name_v[s->count++] = strdup(CACHE_LINE(lines, i));
 
-        fs_close(fin);
+    return 1;
+}
 
-        return 1;
-    }
+static int set_load(struct set *s, const char *filename)
+{
+    struct fs_stamp stamp;
+    Array lines;
+    int res = 0;
 
-    log_printf("Failure to load set file %s\n", filename);
+    /* Skip "Misc" set when not in dev mode. */
 
-    free(s->name);
-    free(s->desc);
-    free(s->id);
-    free(s->shot);
+    if (strcmp(filename, SET_MISC) == 0 && !config_cheat())
+        return 0;
 
-    fs_close(fin);
+    /* Take the contents of the file from the index, if current. */
 
-    return 0;
+    if ((lines = cache_get(filename, &stamp)))
+        res = set_parse(s, filename, lines);
+
+    else if ((lines = set_read_lines(filename)))
+    {
+        if ((res = set_parse(s, filename, lines)))
+            cache_put(filename, &stamp, lines);
+
+        cache_free_lines(lines);
+    }
+
+    if (!res)
+        log_printf("Failure to load set file %s\n", filename);
+
+    return res;
 }
 
 static void set_free(struct set *s)
@@ -386,6 +417,8 @@ int set_init()
     sets = array_new(sizeof (struct set));
     curr = 0;
 
+    cache_init();
+
     /*
      * First, load the sets listed in the set file, preserving order.
      */
@@ -424,6 +457,8 @@ int set_init()
         fs_dir_free(items);
     }
 
+    cache_save();
+
     return array_len(sets);
 }
 
@@ -436,6 +471,9 @@ void set_quit(void)
 
     array_free(sets);
     sets = NULL;
+
+    cache_save();
+    cache_quit();
 }
 
 /*---------------------------------------------------------------------------*/
@@ -525,6 +563,8 @@ void set_goto(int i)
 
     set_load_levels();
     set_load_hs();
+
+    cache_save();
 }
 
 int curr_set(void)
@@ -25,6 +25,7 @@
 #include "common.h"
 #include "demo_dir.h"
 #include "video.h"
+#include "image.h"
 
 #include "game_common.h"
 #include "game_server.h"
@@ -141,6 +142,61 @@ static int gui_demo_thumbs(int id)
     return jd;
 }
 
+/*
+ * Textures of recently shown screenshots, most recent first.  Paging
+ * back and forth reuses them instead of decoding the images again.
+ */
+
+#define SHOT_MAX (DEMO_STEP * 3)
+
+static struct shot
+{
+    char   file[PATHMAX];
+    GLuint image;
+} shots[SHOT_MAX];
+
+static GLuint get_shot(const char *file)
+{
+    struct shot s;
+    int i;
+
+    for (i = 0; i < SHOT_MAX; i++)
+        if (shots[i].image && strcmp(shots[i].file, file) == 0)
+            break;
+
+    /* Replace the least recently shown, if not found. */
+
+    if (i == SHOT_MAX)
+    {
+        i = SHOT_MAX - 1;
+
+        if (shots[i].image)
+            glDeleteTextures(1, &shots[i].image);
+
+        SAFECPY(shots[i].file, file);
+        shots[i].image = make_image_from_file(file, IF_MIPMAP);
+    }
+
+    /* Move it to the front. */
+
+    s = shots[i];
+    memmove(shots + 1, shots, i * sizeof (*shots));
+    shots[0] = s;
+
+    return s.image;
+}
+
+static void free_shots(void)
+{
+    int i;
+
+    for (i = 0; i < SHOT_MAX; i++)
+        if (shots[i].image)
+            glDeleteTextures(1, &shots[i].image);
+
+    memset(shots, 0, sizeof (shots));
+}
+
 static void gui_demo_update_thumbs(void)
 {
     struct dir_item *item;
@@ -152,7 +208,7 @@ static void gui_demo_update_thumbs(void)
         item = DIR_ITEM_GET(items, thumbs[i].item);
         demo = item->data;
 
-        gui_set_image(thumbs[i].shot, demo ? demo->shot : "");
+        gui_set_texture(thumbs[i].shot, demo ? get_shot(demo->shot) : 0);
         gui_set_label(thumbs[i].name, demo ? demo->name : base_name(item->path));
     }
 }
@@ -341,13 +397,15 @@ static int demo_enter(struct state *st, struct state *prev)
 
 static void demo_leave(struct state *st, struct state *next, int id)
 {
+    gui_delete(id);
+
     if (next == &st_title)
     {
         demo_dir_free(items);
         items = NULL;
-    }
 
-    gui_delete(id);
+        free_shots();
+    }
 }
 
 static void demo_timer(int id, float dt)
@@ -511,6 +569,14 @@ static void demo_play_timer(int id, float dt)
     }
 }
 
+#define DEMO_SEEK 5.0f
+
+static void seek(float d)
+{
+    if (demo_replay_seek(d))
+        game_client_blend(demo_replay_blend());
+}
+
 static void set_speed(int d)
 {
     if (d > 0) speed = SPEED_UP(speed);
@@ -530,6 +596,11 @@ static void demo_play_stick(int id, int a, float v, int bump)
         if (v < 0) set_speed(+1);
         if (v > 0) set_speed(-1);
     }
+    if (config_tst_d(CONFIG_JOYSTICK_AXIS_X0, a))
+    {
+        if (v < 0) seek(-DEMO_SEEK);
+        if (v > 0) seek(+DEMO_SEEK);
+    }
 }
 
 static void demo_play_wheel(int x, int y)
@@ -550,6 +621,11 @@ static int demo_play_keybd(int c, int d)
 
         if (c == KEY_POSE)
             show_hud = !show_hud;
+
+        if (config_tst_d(CONFIG_KEY_LEFT, c))
+            seek(-DEMO_SEEK);
+        if (config_tst_d(CONFIG_KEY_RIGHT, c))
+            seek(+DEMO_SEEK);
     }
     return 1;
 }
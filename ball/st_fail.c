@@ -15,6 +15,7 @@
 #include "util.h"
 #include "progress.h"
 #include "demo.h"
+#include "preload.h"
 #include "audio.h"
 #include "gui.h"
 #include "config.h"
@@ -22,6 +23,7 @@
 
 #include "game_common.h"
 #include "game_server.h"
+#include "game_proxy.h"
 #include "game_client.h"
 
 #include "st_save.h"
@@ -130,6 +132,8 @@ static int fail_enter(struct state *st, struct state *prev)
     if (!resume)
         status = curr_status();
 
+    progress_preload();
+
     return fail_gui();
 }
 
@@ -139,12 +143,13 @@ static void fail_timer(int id, float dt)
     {
         if (!resume && time_state() < 2.f)
         {
-            game_server_step(dt);
+            game_server_step(game_proxy_server(), dt);
             game_client_sync(demo_fp);
-            game_client_blend(game_server_blend());
+            game_client_blend(game_server_blend(game_proxy_server()));
         }
     }
 
+    preload_step();
     gui_timer(id, dt);
 }
 
@@ -21,9 +21,11 @@
 #include "config.h"
 #include "video.h"
 #include "demo.h"
+#include "preload.h"
 
 #include "game_common.h"
 #include "game_server.h"
+#include "game_proxy.h"
 #include "game_client.h"
 
 #include "st_goal.h"
@@ -243,6 +245,9 @@ static int goal_enter(struct state *st, struct state *prev)
     audio_music_fade_out(2.0f);
     video_clr_grab();
     resume = (prev == &st_goal || prev == &st_name || prev == &st_save);
+
+    progress_preload();
+
     return goal_gui();
 }
 
@@ -256,9 +261,9 @@ static void goal_timer(int id, float dt)
 
         if (time_state() < 1.f)
         {
-            game_server_step(dt);
+            game_server_step(game_proxy_server(), dt);
             game_client_sync(demo_fp);
-            game_client_blend(game_server_blend());
+            game_client_blend(game_server_blend(game_proxy_server()));
         }
         else if (t > 0.05f && coins_id)
         {
@@ -286,6 +291,7 @@ static void goal_timer(int id, float dt)
         }
     }
 
+    preload_step();
     gui_timer(id, dt);
 }
 
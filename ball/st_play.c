@@ -379,22 +379,22 @@ static void play_loop_timer(int id, float dt)
          * and holding down both rotation buttons freezes the camera
          * rotation.
          */
-        game_set_rot(0.0f);
-        game_set_cam(CAM_3);
+        game_set_rot(game_proxy_server(), 0.0f);
+        game_set_cam(game_proxy_server(), CAM_3);
         break;
 
     case ROT_ROTATE:
     case ROT_NONE:
-        game_set_rot(r * k);
-        game_set_cam(config_get_d(CONFIG_CAMERA));
+        game_set_rot(game_proxy_server(), r * k);
+        game_set_cam(game_proxy_server(), config_get_d(CONFIG_CAMERA));
         break;
     }
 
     game_step_fade(dt);
 
-    game_server_step(dt);
+    game_server_step(game_proxy_server(), dt);
     game_client_sync(demo_fp);
-    game_client_blend(game_server_blend());
+    game_client_blend(game_server_blend(game_proxy_server()));
 
     switch (curr_status())
     {
@@ -421,15 +421,15 @@ static void play_loop_timer(int id, float dt)
 
 static void play_loop_point(int id, int x, int y, int dx, int dy)
 {
-    game_set_pos(dx, dy);
+    game_set_pos(game_proxy_server(), dx, dy);
 }
 
 static void play_loop_stick(int id, int a, float v, int bump)
 {
     if (config_tst_d(CONFIG_JOYSTICK_AXIS_X0, a))
-        game_set_z(v);
+        game_set_z(game_proxy_server(), v);
     if (config_tst_d(CONFIG_JOYSTICK_AXIS_Y0, a))
-        game_set_x(v);
+        game_set_x(game_proxy_server(), v);
     if (config_tst_d(CONFIG_JOYSTICK_AXIS_X1, a))
     {
         if      (v > 0.0f)
@@ -544,7 +544,7 @@ static int play_loop_touch(const SDL_TouchFingerEvent *event)
         int dx = (int) ((float) video.device_w * event->dx);
         int dy = (int) ((float) video.device_h * -event->dy);
 
-        game_set_pos(dx, dy);
+        game_set_pos(game_proxy_server(), dx, dy);
     }
 
     // TODO: rotate camera, change camera, etc.
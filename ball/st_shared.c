@@ -19,6 +19,7 @@
 #include "state.h"
 
 #include "game_server.h"
+#include "game_proxy.h"
 #include "game_client.h"
 
 #include "st_shared.h"
@@ -71,7 +72,7 @@ void shared_stick(int id, int a, float v, int bump)
 
 void shared_angle(int id, float x, float z)
 {
-    game_set_ang(x, z);
+    game_set_ang(game_proxy_server(), x, z);
 }
 
 int shared_click_basic(int b, int d)
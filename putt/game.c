@@ -236,8 +236,8 @@ static void game_draw_beams(struct s_rend *rend, const struct s_base *bp,
     /* Jump beams */
 
     for (i = 0; i < bp->jc; i++)
-        beam_draw(rend, bp->jv[i].p, jump_c[jump_e ? 0 : 1],
-                        bp->jv[i].r, 2.0f);
+        beam_push(bp->jv[i].p, jump_c[jump_e ? 0 : 1],
+                  bp->jv[i].r, 2.0f);
 
     /* Switch beams */
 
@@ -246,9 +246,11 @@ static void game_draw_beams(struct s_rend *rend, const struct s_base *bp,
         struct v_swch *xp = vp->xv + i;
 
         if (!xp->base->i)
-            beam_draw(rend, xp->base->p, swch_c[xp->f][xp->e],
-                            xp->base->r, 2.0f);
+            beam_push(xp->base->p, swch_c[xp->f][xp->e],
+                      xp->base->r, 2.0f);
     }
+
+    beam_draw(rend);
 }
 
 /*---------------------------------------------------------------------------*/
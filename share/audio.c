@@ -21,6 +21,10 @@
 #include <string.h>
 #include <stdlib.h>
 
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 #include "config.h"
 #include "audio.h"
 #include "common.h"
@@ -32,6 +36,22 @@
 #define AUDIO_RATE 44100
 #define AUDIO_CHAN 2
 
+#define SAMPLE_MAX (1 << 21)            /* Longest cached sound in bytes     */
+#define MIX_STEP   64                   /* Frames mixed at one amplitude     */
+
+/*
+ * A sound decoded in full.  Sounds are decoded on first play and kept,
+ * so that playing them again reads neither file nor Ogg stream.
+ */
+struct sample
+{
+    char          *name;
+    short         *data;
+    int            frames;
+    int            chan;
+    struct sample *next;
+};
+
 struct voice
 {
     OggVorbis_File  vf;
@@ -42,6 +62,9 @@ struct voice
     int           loop;
     char         *name;
     struct voice *next;
+
+    struct sample *sample;              /* Cached sound, if not streamed     */
+    int            pos;                 /* Frame position in the sample      */
 };
 
 static int   audio_state = 0;
@@ -50,84 +73,183 @@ static float music_vol   = 1.0f;
 
 static SDL_AudioSpec spec;
 
-static struct voice *music  = NULL;
-static struct voice *queue  = NULL;
-static struct voice *voices = NULL;
-static short        *buffer = NULL;
+static struct voice  *music   = NULL;
+static struct voice  *queue   = NULL;
+static struct voice  *voices  = NULL;
+static struct voice  *retired = NULL;
+static struct sample *samples = NULL;
+static short         *buffer  = NULL;
+static int           *mixbuf  = NULL;
 
 static ov_callbacks callbacks = {
     fs_ov_read, fs_ov_seek, fs_ov_close, fs_ov_tell
 };
 
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+#define ORDER 1
+#else
+#define ORDER 0
+#endif
+
 /*---------------------------------------------------------------------------*/
 
-#define MIX(d, s) {                           \
-        int T = (int) (d) + (int) (s);        \
-        if      (T >  32767) (d) =  32767;    \
-        else if (T < -32768) (d) = -32768;    \
-        else                 (d) = (short) T; \
+/*
+ * Voices are summed at 32 bits and saturated to 16 only once, after
+ * all of them are in.  With SSE2, eight samples are scaled at a time,
+ * giving the same results as the scalar loops, which finish the rest.
+ */
+
+#if defined(__SSE2__)
+
+/*
+ * Scale eight samples X by gain G, giving (x * g) >> 15 in A and B.
+ */
+static void mix_scale(__m128i x, __m128i g, __m128i *a, __m128i *b)
+{
+    const __m128i lo = _mm_mullo_epi16(x, g);
+    const __m128i hi = _mm_mulhi_epi16(x, g);
+
+    *a = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 15);
+    *b = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 15);
+}
+
+static void mix_add(int *out, __m128i a)
+{
+    __m128i *p = (__m128i *) out;
+
+    _mm_storeu_si128(p, _mm_add_epi32(_mm_loadu_si128(p), a));
+}
+
+#endif
+
+static void mix_mono(int *out, const short *in, int n, int g)
+{
+    int i = 0;
+
+#if defined(__SSE2__)
+    const __m128i gv = _mm_set1_epi16((short) g);
+    __m128i a, b;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        mix_scale(_mm_loadu_si128((const __m128i *) (in + i)), gv, &a, &b);
+
+        mix_add(out + 2 * i +  0, _mm_unpacklo_epi32(a, a));
+        mix_add(out + 2 * i +  4, _mm_unpackhi_epi32(a, a));
+        mix_add(out + 2 * i +  8, _mm_unpacklo_epi32(b, b));
+        mix_add(out + 2 * i + 12, _mm_unpackhi_epi32(b, b));
     }
+#endif
+
+    for (; i < n; i++)
+    {
+        const int s = (in[i] * g) >> 15;
 
-static int voice_step(struct voice *V, float volume, Uint8 *stream, int length)
+        out[2 * i + 0] += s;
+        out[2 * i + 1] += s;
+    }
+}
+
+static void mix_stereo(int *out, const short *in, int n, int g)
 {
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-    int order = 1;
-#else
-    int order = 0;
+    int i = 0;
+
+#if defined(__SSE2__)
+    const __m128i gv = _mm_set1_epi16((short) g);
+    __m128i a, b;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        mix_scale(_mm_loadu_si128((const __m128i *) (in + i)), gv, &a, &b);
+
+        mix_add(out + i + 0, a);
+        mix_add(out + i + 4, b);
+    }
 #endif
 
-    short *obuf = (short *) stream;
-    char  *ibuf = (char  *) buffer;
+    for (; i < n; i++)
+        out[i] += (in[i] * g) >> 15;
+}
 
-    int i, b = 0, n = 1, c = 0, r = 0;
+static void mix_saturate(short *out, const int *in, int n)
+{
+    int i = 0;
 
-    /* Compute the total request size for the current stream. */
+#if defined(__SSE2__)
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m128i a = _mm_loadu_si128((const __m128i *) (in + i + 0));
+        const __m128i b = _mm_loadu_si128((const __m128i *) (in + i + 4));
 
-    if (V->chan == 1) r = length / 2;
-    if (V->chan == 2) r = length    ;
+        _mm_storeu_si128((__m128i *) (out + i), _mm_packs_epi32(a, b));
+    }
+#endif
 
-    /* While data is coming in and data is still needed... */
+    for (; i < n; i++)
+        out[i] = (short) CLAMP(-32768, in[i], 32767);
+}
 
-    while (n > 0 && r > 0)
+/*
+ * Add FRAMES frames of IN to the mix at OUT.  The amplitude of V is
+ * stepped once every MIX_STEP frames.
+ */
+static void voice_mix(struct voice *V, float volume,
+                      const short *in, int *out, int frames)
+{
+    while (frames > 0)
     {
-        /* Read audio from the stream. */
+        const int n = MIN(frames, MIX_STEP);
+        const int g = (int) (V->amp * volume * 32767.0f);
 
-        if ((n = (int) ov_read(&V->vf, ibuf, r, order, 2, 1, &b)) > 0)
+        if (g > 0)
         {
-            /* Mix mono audio. */
+            if (V->chan == 1) mix_mono  (out, in, n,     g);
+            if (V->chan == 2) mix_stereo(out, in, n * 2, g);
+        }
 
-            if (V->chan == 1)
-                for (i = 0; i < n / 2; i += 1)
-                {
-                    short M = (short) (V->amp * volume * buffer[i]);
+        V->amp = CLAMP(0.0f, V->amp + V->damp * n, 1.0f);
 
-                    MIX(obuf[c], M); c++;
-                    MIX(obuf[c], M); c++;
+        in     += n * V->chan;
+        out    += n * AUDIO_CHAN;
+        frames -= n;
+    }
+}
 
-                    V->amp += V->damp;
+static int voice_step(struct voice *V, float volume, int *out, int frames)
+{
+    int n = 1, b = 0;
 
-                    if (V->amp < 0.0f) V->amp = 0.0;
-                    if (V->amp > 1.0f) V->amp = 1.0;
-                }
+    /* Mix a cached sound. */
 
-            /* Mix stereo audio. */
+    if (V->sample)
+    {
+        n = MIN(frames, V->sample->frames - V->pos);
 
-            if (V->chan == 2)
-                for (i = 0; i < n / 2; i += 2)
-                {
-                    short L = (short) (V->amp * volume * buffer[i + 0]);
-                    short R = (short) (V->amp * volume * buffer[i + 1]);
+        voice_mix(V, volume, V->sample->data + V->pos * V->chan, out, n);
 
-                    MIX(obuf[c], L); c++;
-                    MIX(obuf[c], R); c++;
+        V->pos += n;
 
-                    V->amp += V->damp;
+        return (V->pos >= V->sample->frames);
+    }
 
-                    if (V->amp < 0.0f) V->amp = 0.0;
-                    if (V->amp > 1.0f) V->amp = 1.0;
-                }
+    if (V->chan != 1 && V->chan != 2)
+        return 1;
+
+    /* While data is coming in and data is still needed... */
+
+    while (n > 0 && frames > 0)
+    {
+        /* Read audio from the stream. */
 
-            r -= n;
+        if ((n = (int) ov_read(&V->vf, (char *) buffer,
+                               frames * V->chan * 2, ORDER, 2, 1, &b)) > 0)
+        {
+            const int m = n / (V->chan * 2);
+
+            voice_mix(V, volume, buffer, out, m);
+
+            out    += m * AUDIO_CHAN;
+            frames -= m;
         }
         else
         {
@@ -144,6 +266,97 @@ static int voice_step(struct voice *V, float volume, Uint8 *stream, int length)
     return 0;
 }
 
+/*
+ * Decode the named sound in full.  A sound too long to be worth keeping,
+ * or one that cannot be decoded, gets a sample with no data, so that it
+ * is streamed from then on without another attempt.
+ */
+static struct sample *sample_load(const char *filename)
+{
+    struct sample *S;
+    OggVorbis_File vf;
+    fs_file fp;
+
+    if (!(S = calloc(1, sizeof (*S))))
+        return NULL;
+
+    if (!(S->name = strdup(filename)))
+    {
+        free(S);
+        return NULL;
+    }
+
+    if ((fp = fs_open_read(filename)))
+    {
+        if (ov_open_callbacks(fp, &vf, NULL, 0, callbacks) == 0)
+        {
+            const int chan = ov_info(&vf, -1)->channels;
+
+            char *data = NULL;
+            int size = 0, len = 0, n = 1, b = 0;
+
+            while (n > 0 && size <= SAMPLE_MAX)
+            {
+                if (len == size)
+                {
+                    char *p;
+
+                    if (!(p = realloc(data, size = MAX(size * 2, 65536))))
+                        break;
+
+                    data = p;
+                }
+
+                if ((n = (int) ov_read(&vf, data + len, size - len,
+                                       ORDER, 2, 1, &b)) > 0)
+                    len += n;
+            }
+
+            if (n <= 0 && (chan == 1 || chan == 2))
+            {
+                S->data   = (short *) data;
+                S->frames = len / (chan * 2);
+                S->chan   = chan;
+
+                data = NULL;
+            }
+
+            free(data);
+            ov_clear(&vf);
+        }
+        else fs_close(fp);
+    }
+    return S;
+}
+
+/*
+ * Find the named sound among those decoded, decoding it if needed.
+ */
+static struct sample *sample_find(const char *filename)
+{
+    struct sample *S;
+
+    for (S = samples; S; S = S->next)
+        if (strcmp(S->name, filename) == 0)
+            return S;
+
+    if ((S = sample_load(filename)))
+    {
+        S->next = samples;
+        samples = S;
+    }
+    return S;
+}
+
+static void sample_free(struct sample *S)
+{
+    free(S->data);
+    free(S->name);
+    free(S);
+}
+
+/*---------------------------------------------------------------------------*/
+
 static struct voice *voice_init(const char *filename, float a)
 {
     struct voice *V;
@@ -184,9 +397,32 @@ static struct voice *voice_init(const char *filename, float a)
     return V;
 }
 
+/*
+ * Make a voice for a sound, from its cached samples if possible.
+ */
+static struct voice *voice_sound(const char *filename, float a)
+{
+    struct sample *S;
+    struct voice  *V;
+
+    if (!(S = sample_find(filename)) || !S->data)
+        return voice_init(filename, a);
+
+    if ((V = (struct voice *) calloc(1, sizeof (struct voice))))
+    {
+        V->name   = strdup(filename);
+        V->sample = S;
+        V->amp    = CLAMP(0.0f, a, 1.0f);
+        V->chan   = S->chan;
+        V->play   = 1;
+    }
+    return V;
+}
+
 static void voice_free(struct voice *V)
 {
-    ov_clear(&V->vf);
+    if (!V->sample)
+        ov_clear(&V->vf);
 
     free(V->name);
     free(V);
@@ -194,40 +430,247 @@ static void voice_free(struct voice *V)
 
 /*---------------------------------------------------------------------------*/
 
+/*
+ * The game thread never touches the voices that the audio thread is
+ * mixing.  Instead, it posts new sounds to a single-producer single-
+ * consumer ring, and the latest music, queue, fade and volume to one
+ * slot each, which the audio thread reads at the top of each callback.
+ * A slot holds only the last value posted, so state changes are never
+ * lost, however late the callback.  Voices are made and freed on the
+ * game thread only: a new voice travels with its post, and voices the
+ * audio thread is done with are pushed on a lock-free stack for the
+ * game thread to free.
+ */
+
+#define MSG_MAX 256
+
+static struct voice *sounds[MSG_MAX];
+
+static SDL_atomic_t msg_head;           /* Next sound to read                */
+static SDL_atomic_t msg_tail;           /* Next sound to write               */
+
+static struct voice  voice_none;        /* Posted to stop music or queue     */
+
+static struct voice *post_music;        /* New music, or NULL if none posted */
+static struct voice *post_queue;        /* New queue, or NULL if none posted */
+static SDL_atomic_t  post_fade;         /* Fade rate bits, or 0 if none      */
+static SDL_atomic_t  post_volume;       /* Volumes, or 0 if none posted      */
+
+/*
+ * Hand a voice over to the game thread.
+ */
+static void voice_retire(struct voice *V)
+{
+    if (V)
+    {
+        do
+            V->next = (struct voice *) SDL_AtomicGetPtr((void **) &retired);
+        while (!SDL_AtomicCASPtr((void **) &retired, V->next, V));
+    }
+}
+
+/*
+ * Free the voices that the audio thread is done with.
+ */
+static void voice_reap(void)
+{
+    struct voice *V = SDL_AtomicSetPtr((void **) &retired, NULL);
+
+    while (V)
+    {
+        struct voice *T = V;
+        V = V->next;
+        voice_free(T);
+    }
+}
+
+/*
+ * Post a sound to the audio thread.  If the ring is full, the sound is
+ * dropped.
+ */
+static void audio_post_sound(struct voice *V)
+{
+    const int tail = SDL_AtomicGet(&msg_tail);
+    const int next = (tail + 1) % MSG_MAX;
+
+    voice_reap();
+
+    if (next != SDL_AtomicGet(&msg_head))
+    {
+        sounds[tail] = V;
+
+        SDL_MemoryBarrierRelease();
+        SDL_AtomicSet(&msg_tail, next);
+    }
+    else voice_free(V);
+}
+
+/*
+ * Post voice V, or NULL for none, to slot P.  A voice still waiting in
+ * the slot was never seen by the audio thread and is freed here.
+ */
+static void audio_post_voice(struct voice **P, struct voice *V)
+{
+    struct voice *W = SDL_AtomicSetPtr((void **) P, V ? V : &voice_none);
+
+    voice_reap();
+
+    if (W && W != &voice_none)
+        voice_free(W);
+}
+
+static void audio_post_fade(float a)
+{
+    int i;
+
+    memcpy(&i, &a, sizeof (i));
+    SDL_AtomicSet(&post_fade, i);
+}
+
+static void audio_recv_sound(struct voice *V)
+{
+    struct voice *P;
+
+    if (!V)
+        return;
+
+    /* If we're already playing this sound, replace the running copy. */
+
+    if (voices && strcmp(voices->name, V->name) == 0)
+    {
+        V->next = voices->next;
+        voice_retire(voices);
+        voices = V;
+        return;
+    }
+
+    for (P = voices; P && P->next; P = P->next)
+        if (strcmp(P->next->name, V->name) == 0)
+        {
+            V->next = P->next->next;
+            voice_retire(P->next);
+            P->next = V;
+            return;
+        }
+
+    /* Add it to the list of sounding voices. */
+
+    V->next = voices;
+    voices  = V;
+}
+
+/*
+ * Take the voice posted to slot P, if any.
+ */
+static int audio_recv_voice(struct voice **P, struct voice **V)
+{
+    struct voice *W;
+
+    if ((W = SDL_AtomicSetPtr((void **) P, NULL)))
+    {
+        *V = (W == &voice_none) ? NULL : W;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Apply the posts made since the last callback.  This is the audio
+ * thread's side of the ring and the slots.
+ */
+static void audio_recv(void)
+{
+    const int tail = SDL_AtomicGet(&msg_tail);
+    int       head = SDL_AtomicGet(&msg_head);
+
+    struct voice *V;
+    float a;
+    int i;
+
+    SDL_MemoryBarrierAcquire();
+
+    while (head != tail)
+    {
+        audio_recv_sound(sounds[head]);
+        head = (head + 1) % MSG_MAX;
+    }
+
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&msg_head, head);
+
+    /* Music changes before the fade, which applies to the new track. */
+
+    if (audio_recv_voice(&post_music, &V))
+    {
+        voice_retire(music);
+        SDL_AtomicSetPtr((void **) &music, V);
+    }
+
+    if (audio_recv_voice(&post_queue, &V))
+    {
+        voice_retire(queue);
+        SDL_AtomicSetPtr((void **) &queue, V);
+    }
+
+    if ((i = SDL_AtomicSet(&post_fade, 0)))
+    {
+        memcpy(&a, &i, sizeof (a));
+
+        if (music) music->damp = a;
+    }
+
+    if ((i = SDL_AtomicSet(&post_volume, 0)))
+    {
+        sound_vol = (float) ((i >> 8) & 0xFF) / 10.0f;
+        music_vol = (float) ((i     ) & 0xFF) / 10.0f;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+
 static void audio_step(void *data, Uint8 *stream, int length)
 {
-    struct voice *V = voices;
+    struct voice *V;
     struct voice *P = NULL;
 
-    /* Zero the output buffer. */
+    int frames = MIN(length / (AUDIO_CHAN * 2), (int) spec.samples);
+
+    /* Catch up with the game thread. */
+
+    audio_recv();
+
+    /* Zero the mix buffer. */
 
     memset(stream, 0, length);
+    memset(mixbuf, 0, frames * AUDIO_CHAN * sizeof (int));
 
     /* Mix the background music. */
 
     if (music)
     {
-        voice_step(music, music_vol, stream, length);
+        voice_step(music, music_vol, mixbuf, frames);
 
         /* If the track has faded out, move to a queued track. */
 
         if (music->amp <= 0.0f && music->damp < 0.0f && queue)
         {
-            voice_free(music);
-            music = queue;
-            queue = NULL;
+            voice_retire(music);
+            SDL_AtomicSetPtr((void **) &music, queue);
+            SDL_AtomicSetPtr((void **) &queue, NULL);
         }
     }
 
     /* Iterate over all active voices. */
 
+    V = voices;
+
     while (V)
     {
         /* Mix this voice. */
 
-        if (V->play && voice_step(V, sound_vol, stream, length))
+        if (V->play && voice_step(V, sound_vol, mixbuf, frames))
         {
-            /* Delete a finished voice... */
+            /* Retire a finished voice... */
 
             struct voice *T = V;
 
@@ -236,7 +679,7 @@ static void audio_step(void *data, Uint8 *stream, int length)
             else
                 V = voices  = V->next;
 
-            voice_free(T);
+            voice_retire(T);
         }
         else
         {
@@ -246,6 +689,10 @@ static void audio_step(void *data, Uint8 *stream, int length)
             V = V->next;
         }
     }
+
+    /* Saturate the mix to the output. */
+
+    mix_saturate((short *) stream, mixbuf, frames * AUDIO_CHAN);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -262,9 +709,12 @@ void audio_init(void)
     spec.freq     = AUDIO_RATE;
     spec.callback = audio_step;
 
-    /* Allocate an input buffer. */
+    /* Allocate an input buffer and a mix buffer. */
 
-    if ((buffer = (short *) malloc(spec.samples * 4)))
+    buffer = (short *) malloc(spec.samples * AUDIO_CHAN * sizeof (short));
+    mixbuf = (int   *) malloc(spec.samples * AUDIO_CHAN * sizeof (int));
+
+    if (buffer && mixbuf)
     {
         /* Start the audio thread. */
 
@@ -284,13 +734,37 @@ void audio_init(void)
 
 void audio_free(void)
 {
-    /* Halt the audio thread. */
+    /* Halt the audio thread and take over its side of the ring. */
 
     SDL_CloseAudio();
 
-    /* Release the input buffer. */
+    audio_recv();
+
+    /* Release the input and mix buffers. */
 
     free(buffer);
+    free(mixbuf);
+
+    buffer = NULL;
+    mixbuf = NULL;
+
+    /* Release the sounds, which are all cached. */
+
+    while (voices)
+    {
+        struct voice *V = voices;
+        voices = V->next;
+        voice_free(V);
+    }
+
+    voice_reap();
+
+    while (samples)
+    {
+        struct sample *S = samples;
+        samples = S->next;
+        sample_free(S);
+    }
 
     /* Ogg streams and voice structure remain open to allow quality setting. */
 }
@@ -301,38 +775,10 @@ void audio_play(const char *filename, float a)
     {
         struct voice *V;
 
-        /* If we're already playing this sound, preempt the running copy. */
-
-        SDL_LockAudio();
-        {
-            for (V = voices; V; V = V->next)
-                if (strcmp(V->name, filename) == 0)
-                {
-                    ov_raw_seek(&V->vf, 0);
-
-                    V->amp = a;
-
-                    if (V->amp > 1.0f) V->amp = 1.0;
-                    if (V->amp < 0.0f) V->amp = 0.0;
-
-                    SDL_UnlockAudio();
-                    return;
-                }
-        }
-        SDL_UnlockAudio();
-
-        /* Create a new voice structure. */
-
-        V = voice_init(filename, a);
-
-        /* Add it to the list of sounding voices. */
+        /* Create a new voice structure and send it over. */
 
-        SDL_LockAudio();
-        {
-            V->next = voices;
-            voices  = V;
-        }
-        SDL_UnlockAudio();
+        if ((V = voice_sound(filename, a)))
+            audio_post_sound(V);
     }
 }
 
@@ -342,16 +788,15 @@ void audio_music_play(const char *filename)
 {
     if (audio_state)
     {
-        audio_music_stop();
+        struct voice *V;
 
-        SDL_LockAudio();
-        {
-            if ((music = voice_init(filename, 0.0f)))
-            {
-                music->loop = 1;
-            }
-        }
-        SDL_UnlockAudio();
+        if ((V = voice_init(filename, 0.0f)))
+            V->loop = 1;
+
+        /* A fade still waiting was meant for the track being replaced. */
+
+        SDL_AtomicSet(&post_fade, 0);
+        audio_post_voice(&post_music, V);
     }
 }
 
@@ -359,17 +804,17 @@ void audio_music_queue(const char *filename, float t)
 {
     if (audio_state)
     {
-        SDL_LockAudio();
+        struct voice *V;
+
+        if ((V = voice_init(filename, 0.0f)))
         {
-            if ((queue = voice_init(filename, 0.0f)))
-            {
-                queue->loop = 1;
+            V->loop = 1;
 
-                if (t > 0.0f)
-                    queue->damp = +1.0f / (AUDIO_RATE * t);
-            }
+            if (t > 0.0f)
+                V->damp = +1.0f / (AUDIO_RATE * t);
         }
-        SDL_UnlockAudio();
+
+        audio_post_voice(&post_queue, V);
     }
 }
 
@@ -377,15 +822,8 @@ void audio_music_stop(void)
 {
     if (audio_state)
     {
-        SDL_LockAudio();
-        {
-            if (music)
-            {
-                voice_free(music);
-            }
-            music = NULL;
-        }
-        SDL_UnlockAudio();
+        SDL_AtomicSet(&post_fade, 0);
+        audio_post_voice(&post_music, NULL);
     }
 }
 
@@ -393,27 +831,35 @@ void audio_music_stop(void)
 
 void audio_music_fade_out(float t)
 {
-    SDL_LockAudio();
-    {
-        if (music) music->damp = -1.0f / (AUDIO_RATE * t);
-    }
-    SDL_UnlockAudio();
+    if (audio_state)
+        audio_post_fade(-1.0f / (AUDIO_RATE * t));
 }
 
 void audio_music_fade_in(float t)
 {
-    SDL_LockAudio();
-    {
-        if (music) music->damp = +1.0f / (AUDIO_RATE * t);
-    }
-    SDL_UnlockAudio();
+    if (audio_state)
+        audio_post_fade(+1.0f / (AUDIO_RATE * t));
 }
 
 void audio_music_fade_to(float t, const char *filename)
 {
-    if (music)
+    struct voice *Q, *M;
+    int same;
+
+    /*
+     * The audio thread may move a queued track to the front at any
+     * time, but nothing else.  So read the queue before the music, and
+     * be done with both before posting, which may free them.
+     */
+
+    Q = (struct voice *) SDL_AtomicGetPtr((void **) &queue);
+    M = (struct voice *) SDL_AtomicGetPtr((void **) &music);
+
+    same = (M && strcmp(filename, M->name) == 0);
+
+    if (M)
     {
-        if (strcmp(filename, music->name) != 0)
+        if (!same)
         {
             audio_music_fade_out(t);
             audio_music_queue(filename, t);
@@ -426,11 +872,8 @@ void audio_music_fade_to(float t, const char *filename)
              * hear it anymore.
              */
 
-            if (queue)
-            {
-                voice_free(queue);
-                queue = NULL;
-            }
+            if (Q && audio_state)
+                audio_post_voice(&post_queue, NULL);
 
             audio_music_fade_in(t);
         }
@@ -444,8 +887,16 @@ void audio_music_fade_to(float t, const char *filename)
 
 void audio_volume(int s, int m)
 {
-    sound_vol = (float) s / 10.0f;
-    music_vol = (float) m / 10.0f;
+    const float a = (float) s / 10.0f;
+    const float b = (float) m / 10.0f;
+
+    if (audio_state)
+        SDL_AtomicSet(&post_volume, 0x10000 | (s & 0xFF) << 8 | (m & 0xFF));
+    else
+    {
+        sound_vol = a;
+        music_vol = b;
+    }
 }
 
 /*---------------------------------------------------------------------------*/
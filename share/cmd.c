@@ -125,7 +125,7 @@ DEFINE_CMD(CMD_SOUND, STRING_BYTES(cmd->sound.n) + FLOAT_BYTES, {
     put_string(fp, cmd->sound.n);
     put_float(fp, cmd->sound.a);
 }, {
-    static char buff[MAXSTR];
+    char buff[MAXSTR];
 
     get_string(fp, buff, sizeof (buff));
 
@@ -495,25 +495,25 @@ int cmd_get(fs_file fp, union cmd *cmd)
 
 /*---------------------------------------------------------------------------*/
 
-void cmd_free(union cmd *cmd)
+/*
+ * Free the strings held by CMD, but not CMD itself.
+ */
+void cmd_clear(union cmd *cmd)
 {
-    if (cmd)
+    switch (cmd->type)
     {
-        switch (cmd->type)
-        {
-        case CMD_SOUND:
-            free(cmd->sound.n);
-            break;
-
-        case CMD_MAP:
-            free(cmd->map.name);
-            break;
+    case CMD_SOUND:
+        free(cmd->sound.n);
+        cmd->sound.n = NULL;
+        break;
 
-        default:
-            break;
-        }
+    case CMD_MAP:
+        free(cmd->map.name);
+        cmd->map.name = NULL;
+        break;
 
-        free(cmd);
+    default:
+        break;
     }
 }
 
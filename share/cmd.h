@@ -338,7 +338,22 @@ union cmd
 int cmd_put(fs_file, const union cmd *);
 int cmd_get(fs_file, union cmd *);
 
-void cmd_free(union cmd *);
+void cmd_clear(union cmd *);
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * A destination for commands.  Each command is handed to FN along with
+ * DATA.  The receiver takes ownership of any strings the command holds.
+ */
+
+struct cmd_sink
+{
+    void (*fn)(void *data, const union cmd *);
+    void  *data;
+};
+
+#define cmd_sink_put(s, c) ((s)->fn((s)->data, (c)))
 
 /*---------------------------------------------------------------------------*/
 
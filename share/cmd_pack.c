@@ -0,0 +1,555 @@
+/*
+ * Copyright (C) 2003-2010 Neverball authors
+ *
+ * NEVERBALL is  free software; you can redistribute  it and/or modify
+ * it under the  terms of the GNU General  Public License as published
+ * by the Free  Software Foundation; either version 2  of the License,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT  ANY  WARRANTY;  without   even  the  implied  warranty  of
+ * MERCHANTABILITY or  FITNESS FOR A PARTICULAR PURPOSE.   See the GNU
+ * General Public License for more details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <limits.h>
+#include <math.h>
+
+#include "cmd_pack.h"
+#include "binary.h"
+#include "common.h"
+#include "zip.h"
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Each field is coded as the difference from a prediction.  Integers
+ * and exact floats are predicted to repeat.  Grid values and smooth
+ * floats are predicted to keep moving at the same rate, smooth floats
+ * by their bits.  A grid value that cannot be coded is escaped and
+ * stored as a float.
+ */
+
+enum
+{
+    FIELD_INT = 0,                      /* Integer                           */
+    FIELD_FLOAT,                        /* Float, stored exactly             */
+    FIELD_POSITION,                     /* Float, rounded to PACK_POSITION   */
+    FIELD_UNIT,                         /* Float, rounded to PACK_UNIT       */
+    FIELD_SMOOTH,                       /* Float, stored exactly             */
+    FIELD_STRING                        /* String, stored as is              */
+};
+
+struct field
+{
+    enum cmd_type type;
+    int           kind;
+    size_t        offset;
+};
+
+#define FIELD(t, k, m) { t, k, offsetof(union cmd, m) }
+
+#define FIELD_V(t, k, m) \
+    FIELD(t, k, m[0]),   \
+    FIELD(t, k, m[1]),   \
+    FIELD(t, k, m[2])
+
+/* Fields of each command type, in type order. */
+
+static const struct field fields[] = {
+    FIELD_V(CMD_MAKE_ITEM,         FIELD_POSITION, mkitem.p),
+    FIELD  (CMD_MAKE_ITEM,         FIELD_INT,      mkitem.t),
+    FIELD  (CMD_MAKE_ITEM,         FIELD_INT,      mkitem.n),
+    FIELD  (CMD_PICK_ITEM,         FIELD_INT,      pkitem.hi),
+    FIELD  (CMD_TILT_ANGLES,       FIELD_SMOOTH,   tiltangles.x),
+    FIELD  (CMD_TILT_ANGLES,       FIELD_SMOOTH,   tiltangles.z),
+    FIELD  (CMD_SOUND,             FIELD_STRING,   sound.n),
+    FIELD  (CMD_SOUND,             FIELD_FLOAT,    sound.a),
+    FIELD  (CMD_TIMER,             FIELD_FLOAT,    timer.t),
+    FIELD  (CMD_STATUS,            FIELD_INT,      status.t),
+    FIELD  (CMD_COINS,             FIELD_INT,      coins.n),
+    FIELD  (CMD_BODY_PATH,         FIELD_INT,      bodypath.bi),
+    FIELD  (CMD_BODY_PATH,         FIELD_INT,      bodypath.pi),
+    FIELD  (CMD_BODY_TIME,         FIELD_INT,      bodytime.bi),
+    FIELD  (CMD_BODY_TIME,         FIELD_FLOAT,    bodytime.t),
+    FIELD  (CMD_SWCH_ENTER,        FIELD_INT,      swchenter.xi),
+    FIELD  (CMD_SWCH_TOGGLE,       FIELD_INT,      swchtoggle.xi),
+    FIELD  (CMD_SWCH_EXIT,         FIELD_INT,      swchexit.xi),
+    FIELD  (CMD_UPDATES_PER_SECOND, FIELD_INT,     ups.n),
+    FIELD  (CMD_BALL_RADIUS,       FIELD_FLOAT,    ballradius.r),
+    FIELD_V(CMD_BALL_POSITION,     FIELD_POSITION, ballpos.p),
+    FIELD_V(CMD_BALL_BASIS,        FIELD_UNIT,     ballbasis.e[0]),
+    FIELD_V(CMD_BALL_BASIS,        FIELD_UNIT,     ballbasis.e[1]),
+    FIELD_V(CMD_BALL_PEND_BASIS,   FIELD_UNIT,     ballpendbasis.E[0]),
+    FIELD_V(CMD_BALL_PEND_BASIS,   FIELD_UNIT,     ballpendbasis.E[1]),
+    FIELD_V(CMD_VIEW_POSITION,     FIELD_POSITION, viewpos.p),
+    FIELD_V(CMD_VIEW_CENTER,       FIELD_POSITION, viewcenter.c),
+    FIELD_V(CMD_VIEW_BASIS,        FIELD_UNIT,     viewbasis.e[0]),
+    FIELD_V(CMD_VIEW_BASIS,        FIELD_UNIT,     viewbasis.e[1]),
+    FIELD  (CMD_CURRENT_BALL,      FIELD_INT,      currball.ui),
+    FIELD  (CMD_PATH_FLAG,         FIELD_INT,      pathflag.pi),
+    FIELD  (CMD_PATH_FLAG,         FIELD_INT,      pathflag.f),
+    FIELD  (CMD_STEP_SIMULATION,   FIELD_FLOAT,    stepsim.dt),
+    FIELD  (CMD_MAP,               FIELD_STRING,   map.name),
+    FIELD  (CMD_MAP,               FIELD_INT,      map.version.x),
+    FIELD  (CMD_MAP,               FIELD_INT,      map.version.y),
+    FIELD_V(CMD_TILT_AXES,         FIELD_SMOOTH,   tiltaxes.x),
+    FIELD_V(CMD_TILT_AXES,         FIELD_SMOOTH,   tiltaxes.z),
+    FIELD  (CMD_MOVE_PATH,         FIELD_INT,      movepath.mi),
+    FIELD  (CMD_MOVE_PATH,         FIELD_INT,      movepath.pi),
+    FIELD  (CMD_MOVE_TIME,         FIELD_INT,      movetime.mi),
+    FIELD  (CMD_MOVE_TIME,         FIELD_FLOAT,    movetime.t),
+};
+
+#define FIELD_COUNT ((int) (sizeof (fields) / sizeof (fields[0])))
+
+#define CODE_BYTES 10                   /* Longest variable-length integer   */
+#define ESCAPE     1                    /* Code of an escaped grid value     */
+
+#define PACK_MAX   (1 << 20)            /* Sanity limit on block size        */
+
+/*---------------------------------------------------------------------------*/
+
+static float grid_step(int kind)
+{
+    return kind == FIELD_POSITION ? PACK_POSITION : PACK_UNIT;
+}
+
+static int float_bits(float f)
+{
+    int i;
+    memcpy(&i, &f, sizeof (i));
+    return i;
+}
+
+static float bits_float(int i)
+{
+    float f;
+    memcpy(&f, &i, sizeof (f));
+    return f;
+}
+
+/*
+ * Find the grid point of F.
+ */
+static int to_grid(float f, int kind, int *v)
+{
+    const float q = grid_step(kind);
+
+    if (fabsf(f) < (float) (1 << 30) / q)
+    {
+        *v = (int) floorf(f * q + 0.5f);
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Round F to the grid of Q steps per unit.
+ */
+float cmd_pack_snap(float f, float q)
+{
+    if (fabsf(f) < (float) (1 << 30) / q)
+        return floorf(f * q + 0.5f) / q;
+
+    return f;
+}
+
+/*---------------------------------------------------------------------------*/
+
+static unsigned long long zig(long long v)
+{
+    return v < 0 ? ((unsigned long long) ~v << 1) | 1 :
+                   ((unsigned long long)  v << 1);
+}
+
+static long long zag(unsigned long long u)
+{
+    return (u & 1) ? ~(long long) (u >> 1) : (long long) (u >> 1);
+}
+
+static long long predict(const struct cmd_pack *pk, int i)
+{
+    if (fields[i].kind == FIELD_INT || fields[i].kind == FIELD_FLOAT)
+        return pk->last[i];
+
+    return 2LL * pk->last[i] - pk->prev[i];
+}
+
+static void remember(struct cmd_pack *pk, int i, int v)
+{
+    pk->prev[i] = pk->last[i];
+    pk->last[i] = v;
+}
+
+/*---------------------------------------------------------------------------*/
+
+static int grow(struct cmd_pack *pk, int n)
+{
+    if (pk->len + n > pk->size)
+    {
+        int size = MAX(MAX(pk->size * 2, pk->len + n), 4096);
+        unsigned char *data;
+
+        if (!(data = realloc(pk->data, size)))
+            return 0;
+
+        pk->data = data;
+        pk->size = size;
+    }
+    return 1;
+}
+
+static void put_code(struct cmd_pack *pk, unsigned long long u)
+{
+    while (u >= 0x80)
+    {
+        pk->data[pk->len++] = (unsigned char) (u | 0x80);
+        u >>= 7;
+    }
+    pk->data[pk->len++] = (unsigned char) u;
+}
+
+static void put_bits(struct cmd_pack *pk, int i)
+{
+    unsigned int u = (unsigned int) i;
+
+    pk->data[pk->len++] = (unsigned char) (u);
+    pk->data[pk->len++] = (unsigned char) (u >> 8);
+    pk->data[pk->len++] = (unsigned char) (u >> 16);
+    pk->data[pk->len++] = (unsigned char) (u >> 24);
+}
+
+static int put_field(struct cmd_pack *pk, int i, const union cmd *cmd)
+{
+    const void *p = (const char *) cmd + fields[i].offset;
+    int v;
+
+    if (fields[i].kind == FIELD_STRING)
+    {
+        const char *s = *(char * const *) p;
+        int n = s ? (int) MIN(strlen(s), MAXSTR - 1) : 0;
+
+        if (!grow(pk, n + 1))
+            return 0;
+
+        memcpy(pk->data + pk->len, s, n);
+        pk->len += n;
+        pk->data[pk->len++] = 0;
+
+        return 1;
+    }
+
+    if (!grow(pk, CODE_BYTES + 4))
+        return 0;
+
+    switch (fields[i].kind)
+    {
+    case FIELD_INT:
+        v = *(const int *) p;
+        put_code(pk, zig(v - predict(pk, i)));
+        break;
+
+    case FIELD_FLOAT:
+    case FIELD_SMOOTH:
+        v = float_bits(*(const float *) p);
+        put_code(pk, zig(v - predict(pk, i)));
+        break;
+
+    default:
+        if (to_grid(*(const float *) p, fields[i].kind, &v))
+            put_code(pk, zig(v - predict(pk, i)) << 1);
+        else
+        {
+            put_code(pk, ESCAPE);
+            put_bits(pk, float_bits(*(const float *) p));
+            v = 0;
+        }
+        break;
+    }
+
+    remember(pk, i, v);
+
+    return 1;
+}
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Each read is checked against the end of the block.  Reading past it
+ * yields zeroes and leaves the read position past the end.
+ */
+
+static unsigned long long get_code(struct cmd_pack *pk)
+{
+    unsigned long long u = 0;
+    int c, s;
+
+    for (s = 0; s < CODE_BYTES * 7; s += 7)
+    {
+        if (pk->pos >= pk->len)
+            break;
+
+        c = pk->data[pk->pos++];
+        u |= (unsigned long long) (c & 0x7f) << s;
+
+        if (!(c & 0x80))
+            return u;
+    }
+    pk->pos = pk->len + 1;
+    return 0;
+}
+
+static int get_bits(struct cmd_pack *pk)
+{
+    const unsigned char *p = pk->data + pk->pos;
+
+    if ((pk->pos += 4) > pk->len)
+        return 0;
+
+    return (int) ((unsigned int) p[0]       |
+                  (unsigned int) p[1] << 8  |
+                  (unsigned int) p[2] << 16 |
+                  (unsigned int) p[3] << 24);
+}
+
+static void get_field(struct cmd_pack *pk, int i, union cmd *cmd)
+{
+    void *p = (char *) cmd + fields[i].offset;
+    unsigned long long u;
+    int v;
+
+    if (fields[i].kind == FIELD_STRING)
+    {
+        const char *s = (const char *) pk->data + pk->pos;
+        int n = 0;
+
+        while (pk->pos + n < pk->len && n < MAXSTR && s[n])
+            n++;
+
+        if (pk->pos + n < pk->len && n < MAXSTR)
+        {
+            *(char **) p = strdup(s);
+            pk->pos += n + 1;
+        }
+        else
+        {
+            *(char **) p = strdup("");
+            pk->pos = pk->len + 1;
+        }
+        return;
+    }
+
+    switch (fields[i].kind)
+    {
+    case FIELD_INT:
+        v = (int) (predict(pk, i) + zag(get_code(pk)));
+        *(int *) p = v;
+        break;
+
+    case FIELD_FLOAT:
+    case FIELD_SMOOTH:
+        v = (int) (predict(pk, i) + zag(get_code(pk)));
+        *(float *) p = bits_float(v);
+        break;
+
+    default:
+        if ((u = get_code(pk)) & ESCAPE)
+        {
+            *(float *) p = bits_float(get_bits(pk));
+            v = 0;
+        }
+        else
+        {
+            v = (int) (predict(pk, i) + zag(u >> 1));
+            *(float *) p = (float) v / grid_step(fields[i].kind);
+        }
+        break;
+    }
+
+    remember(pk, i, v);
+}
+
+/*---------------------------------------------------------------------------*/
+
+void cmd_pack_init(struct cmd_pack *pk)
+{
+    int t, i = 0;
+
+    memset(pk, 0, sizeof (*pk));
+
+    for (t = 0; t <= CMD_MAX; t++)
+    {
+        while (i < FIELD_COUNT && (int) fields[i].type < t)
+            i++;
+
+        pk->first[t] = (short) i;
+    }
+}
+
+void cmd_pack_free(struct cmd_pack *pk)
+{
+    free(pk->data);
+    cmd_pack_init(pk);
+}
+
+/*
+ * Empty the block and start prediction over.
+ */
+void cmd_pack_clear(struct cmd_pack *pk)
+{
+    pk->len = 0;
+    pk->pos = 0;
+
+    memset(pk->last, 0, sizeof (pk->last));
+    memset(pk->prev, 0, sizeof (pk->prev));
+}
+
+int cmd_pack_put(struct cmd_pack *pk, const union cmd *cmd)
+{
+    int i;
+
+    if (cmd->type <= CMD_NONE || cmd->type >= CMD_MAX || !grow(pk, 1))
+        return 0;
+
+    pk->data[pk->len++] = (unsigned char) cmd->type;
+
+    for (i = pk->first[cmd->type]; i < pk->first[cmd->type + 1]; i++)
+        if (!put_field(pk, i, cmd))
+            return 0;
+
+    return 1;
+}
+
+/*
+ * Read the next command of the block.  Return 0 at the end of it.
+ */
+int cmd_pack_get(struct cmd_pack *pk, union cmd *cmd)
+{
+    int i, type;
+
+    if (pk->pos >= pk->len)
+        return 0;
+
+    type = pk->data[pk->pos++];
+
+    if (type <= CMD_NONE || type >= CMD_MAX)
+    {
+        pk->pos = pk->len;
+        return 0;
+    }
+
+    cmd->type = (enum cmd_type) type;
+
+    for (i = pk->first[type]; i < pk->first[type + 1]; i++)
+        get_field(pk, i, cmd);
+
+    if (pk->pos > pk->len)
+    {
+        if (type == CMD_SOUND) free(cmd->sound.n);
+        if (type == CMD_MAP)   free(cmd->map.name);
+
+        return 0;
+    }
+    return 1;
+}
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Write the block as a frame of the given type and empty it.  The frame
+ * holds the packed size followed by the deflated block, or by the
+ * block itself, with its size negated, if deflating does not help.
+ * Return zero if the block is too large or could not be written.
+ */
+int cmd_pack_write(fs_file fp, int type, struct cmd_pack *pk)
+{
+    const int size = SHRT_MAX - INDEX_BYTES;
+
+    unsigned char *data;
+    size_t n = 0;
+    int ok;
+
+    if (pk->len == 0)
+        return 1;
+
+    if (!(data = malloc(size)))
+        return 0;
+
+    n = tdefl_compress_mem_to_mem(data, size, pk->data, pk->len,
+                                  TDEFL_DEFAULT_MAX_PROBES);
+
+    if (n == 0 || n >= (size_t) pk->len)
+    {
+        if (pk->len > size)
+        {
+            free(data);
+            return 0;
+        }
+
+        fs_putc(type, fp);
+        put_short(fp, (short) (INDEX_BYTES + pk->len));
+        put_index(fp, -pk->len);
+
+        ok = (fs_write(pk->data, 1, pk->len, fp) == pk->len);
+    }
+    else
+    {
+        fs_putc(type, fp);
+        put_short(fp, (short) (INDEX_BYTES + n));
+        put_index(fp, pk->len);
+
+        ok = (fs_write(data, 1, (int) n, fp) == (int) n);
+    }
+
+    free(data);
+    cmd_pack_clear(pk);
+
+    return ok;
+}
+
+/*
+ * Read a block frame of SIZE bytes, its type and size already read.
+ */
+int cmd_pack_read(fs_file fp, int size, struct cmd_pack *pk)
+{
+    unsigned char *data;
+    int len, ok = 0;
+
+    cmd_pack_clear(pk);
+
+    if (size < INDEX_BYTES)
+        return 0;
+
+    len   = get_index(fp);
+    size -= INDEX_BYTES;
+
+    if (len < -PACK_MAX || len > PACK_MAX || !grow(pk, abs(len)))
+        return 0;
+
+    if (len < 0)
+    {
+        if (size == -len && fs_read(pk->data, 1, size, fp) == size)
+        {
+            pk->len = -len;
+            ok = 1;
+        }
+    }
+    else if ((data = malloc(size ? size : 1)))
+    {
+        if (fs_read(data, 1, size, fp) == size &&
+            tinfl_decompress_mem_to_mem(pk->data, len, data, size, 0) ==
+            (size_t) len)
+        {
+            pk->len = len;
+            ok = 1;
+        }
+        free(data);
+    }
+    return ok;
+}
+
+/*---------------------------------------------------------------------------*/
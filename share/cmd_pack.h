@@ -0,0 +1,50 @@
+#ifndef CMD_PACK_H
+#define CMD_PACK_H
+
+#include "cmd.h"
+#include "fs.h"
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Packed command blocks.  Commands are written as a type byte followed
+ * by their fields as variable-length integers, each one the difference
+ * from a prediction based on the same field of earlier commands of the
+ * same type.  Positions and directions are rounded to a fixed grid.
+ * Tilt is kept exact.  A block of such commands is deflated as a
+ * whole, and prediction starts over with every block.
+ */
+
+#define PACK_POSITION 4096.0f           /* Grid steps per unit of position   */
+#define PACK_UNIT     32768.0f          /* Steps per unit vector component   */
+
+#define PACK_FIELDS 80                  /* At least the number of fields     */
+
+struct cmd_pack
+{
+    unsigned char *data;                /* Packed commands                   */
+    int            size;                /* Allocated bytes                   */
+    int            len;                 /* Used bytes                        */
+    int            pos;                 /* Read position                     */
+
+    short first[CMD_MAX + 1];           /* First field of each command type  */
+
+    int last[PACK_FIELDS];              /* Previous value of each field      */
+    int prev[PACK_FIELDS];              /* ...and the one before it          */
+};
+
+void cmd_pack_init(struct cmd_pack *);
+void cmd_pack_free(struct cmd_pack *);
+void cmd_pack_clear(struct cmd_pack *);
+
+int  cmd_pack_put(struct cmd_pack *, const union cmd *);
+int  cmd_pack_get(struct cmd_pack *, union cmd *);
+
+int  cmd_pack_write(fs_file, int, struct cmd_pack *);
+int  cmd_pack_read(fs_file, int, struct cmd_pack *);
+
+float cmd_pack_snap(float, float);
+
+/*---------------------------------------------------------------------------*/
+
+#endif
@@ -17,6 +17,8 @@
  *  02111-1307 USA
  */
 
+#define _POSIX_C_SOURCE 200112L /* localtime_r(), gmtime_r() */
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -133,22 +135,32 @@ char *concat_string(const char *first, ...)
     return full;
 }
 
+/*
+ * Convert broken-down UTC to a time value.  This is safe to call from
+ * several threads at once.
+ */
 time_t make_time_from_utc(struct tm *tm)
 {
-    struct tm local, *utc;
+    struct tm local, utc;
     time_t t;
 
     t = mktime(tm);
 
+#ifdef _WIN32
+    /* The Windows C library keeps these buffers per thread. */
     local = *localtime(&t);
-    utc   =  gmtime(&t);
-
-    local.tm_year += local.tm_year - utc->tm_year;
-    local.tm_mon  += local.tm_mon  - utc->tm_mon ;
-    local.tm_mday += local.tm_mday - utc->tm_mday;
-    local.tm_hour += local.tm_hour - utc->tm_hour;
-    local.tm_min  += local.tm_min  - utc->tm_min ;
-    local.tm_sec  += local.tm_sec  - utc->tm_sec ;
+    utc   = *gmtime(&t);
+#else
+    localtime_r(&t, &local);
+    gmtime_r   (&t, &utc);
+#endif
+
+    local.tm_year += local.tm_year - utc.tm_year;
+    local.tm_mon  += local.tm_mon  - utc.tm_mon ;
+    local.tm_mday += local.tm_mday - utc.tm_mday;
+    local.tm_hour += local.tm_hour - utc.tm_hour;
+    local.tm_min  += local.tm_min  - utc.tm_min ;
+    local.tm_sec  += local.tm_sec  - utc.tm_sec ;
 
     return mktime(&local);
 }
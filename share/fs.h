@@ -8,6 +8,8 @@ int fs_quit(void);
 
 const char *fs_error(void);
 
+void fs_set_lock(void (*lock)(void *), void (*unlock)(void *), void *data);
+
 const char *fs_base_dir(void);
 int         fs_add_path(const char *);
 int         fs_add_path_with_archives(const char *);
@@ -31,6 +33,15 @@ int  fs_seek(fs_file, long offset, int whence);
 int  fs_eof(fs_file);
 int  fs_size(const char *);
 
+struct fs_stamp
+{
+    long          size;
+    unsigned long time;
+    unsigned long crc;
+};
+
+int  fs_stamp(const char *, struct fs_stamp *);
+
 int   fs_getc(fs_file);
 char *fs_gets(char *dst, int count, fs_file fh);
 int   fs_putc(int c, fs_file);
@@ -38,6 +49,21 @@ int   fs_puts(const char *src, fs_file);
 
 void *fs_load(const char *path, int *size);
 
+/*
+ * A read-only view of a whole file.  Directory files are mapped into
+ * memory where the platform allows it.  Others are loaded.  Writes to
+ * the data are private to the process.
+ */
+struct fs_map
+{
+    void *data;
+    int   size;
+    int   mapped;
+};
+
+int  fs_map  (const char *path, struct fs_map *);
+void fs_unmap(struct fs_map *);
+
 int fs_mkdir(const char *);
 
 #include <stdarg.h>
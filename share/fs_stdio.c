@@ -18,6 +18,16 @@
 #include <string.h>
 #include <errno.h>
 
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#define FS_MMAP 1
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #include "fs.h"
 #include "dir.h"
 #include "array.h"
@@ -57,6 +67,25 @@ static char *fs_dir_base;
 static char *fs_dir_write;
 static List  fs_path;
 
+/*
+ * Files in a package are all read through the package's one stdio
+ * handle.  Programs that read files from more than one thread provide
+ * a lock to serialize this.
+ */
+static void (*fs_lock_fn)  (void *);
+static void (*fs_unlock_fn)(void *);
+static void  *fs_lock_data;
+
+#define ZIP_LOCK()   do { if (fs_lock_fn)   fs_lock_fn  (fs_lock_data); } while (0)
+#define ZIP_UNLOCK() do { if (fs_unlock_fn) fs_unlock_fn(fs_lock_data); } while (0)
+
+void fs_set_lock(void (*lock)(void *), void (*unlock)(void *), void *data)
+{
+    fs_lock_fn   = lock;
+    fs_unlock_fn = unlock;
+    fs_lock_data = data;
+}
+
 int fs_init(const char *argv0)
 {
     fs_dir_base  = strdup(argv0 && *argv0 ? dir_name(argv0) : ".");
@@ -386,7 +415,11 @@ fs_file fs_open_read(const char *path)
             {
                 mz_zip_archive *zip = path_item->data;
 
-                if ((fh->zip_handle = mz_zip_reader_extract_file_iter_new(zip, path, 0)))
+                ZIP_LOCK();
+                fh->zip_handle = mz_zip_reader_extract_file_iter_new(zip, path, 0);
+                ZIP_UNLOCK();
+
+                if (fh->zip_handle)
                 {
                     fh->path_type = FS_PATH_ZIP;
                     opened = 1;
@@ -454,8 +487,12 @@ int fs_close(fs_file fh)
 
         if (fh->zip_handle)
         {
+            ZIP_LOCK();
+
             if (mz_zip_reader_extract_iter_free(fh->zip_handle))
                 closed = 1;
+
+            ZIP_UNLOCK();
         }
 
         free(fh);
@@ -516,8 +553,19 @@ int fs_read(void *data, int size, int count, fs_file fh)
     if (fh->handle)
         return fread(data, size, count, fh->handle);
 
-    if (fh->zip_handle)
-        return mz_zip_reader_extract_iter_read(fh->zip_handle, data, size * count);
+    /* Like fread, count whole items rather than bytes. */
+
+    if (fh->zip_handle && size > 0)
+    {
+        size_t n;
+
+        ZIP_LOCK();
+        n = mz_zip_reader_extract_iter_read(fh->zip_handle, data,
+                                            (size_t) size * count);
+        ZIP_UNLOCK();
+
+        return (int) (n / size);
+    }
 
     return 0;
 }
@@ -594,10 +642,15 @@ int fs_size(const char *path)
         if (path_item->type == FS_PATH_DIRECTORY)
         {
             char *real = path_join(path_item->path, path);
+            int size = -1;
 
-            if (file_exists(real)) {
-                return file_size(real);
-            }
+            if (file_exists(real))
+                size = file_size(real);
+
+            free(real);
+
+            if (size >= 0)
+                return size;
         }
         else if (path_item->type == FS_PATH_ZIP)
         {
@@ -607,8 +660,13 @@ int fs_size(const char *path)
             if (file_index >= 0)
             {
                 mz_zip_archive_file_stat file_stat;
+                int found;
+
+                ZIP_LOCK();
+                found = mz_zip_reader_file_stat(zip, file_index, &file_stat);
+                ZIP_UNLOCK();
 
-                if (mz_zip_reader_file_stat(zip, file_index, &file_stat))
+                if (found)
                     return file_stat.m_uncomp_size;
             }
         }
@@ -617,4 +675,146 @@ int fs_size(const char *path)
     return 0;
 }
 
+/*
+ * Identify the current contents of a file without reading it: by size
+ * and modification time for a directory file, by size and CRC for a
+ * package file.
+ */
+int fs_stamp(const char *path, struct fs_stamp *stamp)
+{
+    List p;
+
+    memset(stamp, 0, sizeof (*stamp));
+
+    for (p = fs_path; p; p = p->next)
+    {
+        struct fs_path_item *path_item = p->data;
+
+        if (path_item->type == FS_PATH_DIRECTORY)
+        {
+            char *real = path_join(path_item->path, path);
+            struct stat buf;
+            int found = (stat(real, &buf) == 0);
+
+            free(real);
+
+            if (found)
+            {
+                stamp->size = (long) buf.st_size;
+                stamp->time = (unsigned long) buf.st_mtime;
+                return 1;
+            }
+        }
+        else if (path_item->type == FS_PATH_ZIP)
+        {
+            mz_zip_archive *zip = path_item->data;
+            int file_index = mz_zip_reader_locate_file(zip, path, NULL, 0);
+
+            if (file_index >= 0)
+            {
+                mz_zip_archive_file_stat file_stat;
+                int found;
+
+                ZIP_LOCK();
+                found = mz_zip_reader_file_stat(zip, file_index, &file_stat);
+                ZIP_UNLOCK();
+
+                if (found)
+                {
+                    stamp->size = (long) file_stat.m_uncomp_size;
+                    stamp->crc  = (unsigned long) file_stat.m_crc32;
+                    return 1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+
+#if FS_MMAP
+static int fs_map_real(const char *real, struct fs_map *map)
+{
+    struct stat st;
+    void *data;
+    int fd;
+
+    if ((fd = open(real, O_RDONLY)) < 0)
+        return 0;
+
+    if (fstat(fd, &st) == 0 && st.st_size > 0 && st.st_size <= 0x7fffffff)
+    {
+        data = mmap(NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE, fd, 0);
+
+        if (data != MAP_FAILED)
+        {
+            map->data   = data;
+            map->size   = (int) st.st_size;
+            map->mapped = 1;
+        }
+    }
+
+    close(fd);
+
+    return map->mapped;
+}
+#endif
+
+int fs_map(const char *path, struct fs_map *map)
+{
+    memset(map, 0, sizeof (*map));
+
+#if FS_MMAP
+    {
+        List p;
+
+        /* Map the file only if a directory is where it would be read. */
+
+        for (p = fs_path; p; p = p->next)
+        {
+            struct fs_path_item *path_item = p->data;
+
+            if (path_item->type == FS_PATH_DIRECTORY)
+            {
+                char *real = path_join(path_item->path, path);
+                int found = file_exists(real);
+
+                if (found && fs_map_real(real, map))
+                {
+                    free(real);
+                    return 1;
+                }
+
+                free(real);
+
+                if (found)
+                    break;
+            }
+            else if (path_item->type == FS_PATH_ZIP)
+            {
+                if (mz_zip_reader_locate_file(path_item->data, path, NULL, 0) >= 0)
+                    break;
+            }
+        }
+    }
+#endif
+
+    return (map->data = fs_load(path, &map->size)) != NULL;
+}
+
+void fs_unmap(struct fs_map *map)
+{
+#if FS_MMAP
+    if (map->mapped)
+        munmap(map->data, (size_t) map->size);
+    else
+#endif
+        free(map->data);
+
+    memset(map, 0, sizeof (*map));
+}
+
 /*---------------------------------------------------------------------------*/
@@ -30,6 +30,7 @@
 
 #include "solid_draw.h"
 #include "solid_sim.h"
+#include "array.h"
 
 /*---------------------------------------------------------------------------*/
 
@@ -317,6 +318,62 @@ static struct s_full item[GEOM_MAX];
 
 static int back_state = 0;
 
+/*
+ * Beams, goals, jumps and items are drawn in batches, each model once
+ * per frame with all its instances.  Instances are pushed in a batch
+ * and drawn and cleared together.
+ */
+
+struct batch
+{
+    struct s_inst *iv;
+    int            ic;
+    struct alloc   alloc;
+};
+
+static struct batch beams;
+static struct batch goals;
+static struct batch jumps;
+static struct batch items[GEOM_MAX];
+
+/*---------------------------------------------------------------------------*/
+
+static void batch_init(struct batch *b)
+{
+    alloc_new(&b->alloc, sizeof (struct s_inst), (void **) &b->iv, &b->ic);
+}
+
+static void batch_free(struct batch *b)
+{
+    alloc_free(&b->alloc);
+}
+
+static void batch_push(struct batch *b, const GLfloat *p,
+                       GLfloat x, GLfloat y, GLfloat z, const GLfloat *c)
+{
+    struct s_inst *ip;
+
+    if ((ip = alloc_add(&b->alloc)))
+    {
+        ip->p[0] = p[0];
+        ip->p[1] = p[1];
+        ip->p[2] = p[2];
+        ip->s[0] = x;
+        ip->s[1] = y;
+        ip->s[2] = z;
+        ip->c    = c;
+    }
+}
+
+static void batch_draw(struct batch *b, struct s_rend *rend,
+                       const struct s_draw *draw)
+{
+    if (b->ic)
+        sol_draw_inst(draw, rend, 1, 1, b->iv, b->ic);
+
+    b->ic = 0;
+}
+
 /*---------------------------------------------------------------------------*/
 
 void geom_init(void)
@@ -332,6 +389,13 @@ void geom_init(void)
 
     for (i = 0; i < GEOM_MAX; i++)
         sol_load_full(&item[i], item_sols[i], 0);
+
+    batch_init(&beams);
+    batch_init(&goals);
+    batch_init(&jumps);
+
+    for (i = 0; i < GEOM_MAX; i++)
+        batch_init(&items[i]);
 }
 
 void geom_free(void)
@@ -347,6 +411,13 @@ void geom_free(void)
 
     for (i = 0; i < GEOM_MAX; i++)
         sol_free_full(&item[i]);
+
+    batch_free(&beams);
+    batch_free(&goals);
+    batch_free(&jumps);
+
+    for (i = 0; i < GEOM_MAX; i++)
+        batch_free(&items[i]);
 }
 
 void geom_step(float dt)
@@ -364,7 +435,7 @@ void geom_step(float dt)
 
 /*---------------------------------------------------------------------------*/
 
-static struct s_draw *item_file(const struct v_item *hp)
+static int item_geom(const struct v_item *hp)
 {
     int g = GEOM_COIN;
 
@@ -382,7 +453,12 @@ static struct s_draw *item_file(const struct v_item *hp)
         }
     }
 
-    return &item[g].draw;
+    return g;
+}
+
+static struct s_draw *item_file(const struct v_item *hp)
+{
+    return &item[item_geom(hp)].draw;
 }
 
 void item_color(const struct v_item *hp, float *c)
@@ -408,27 +484,53 @@ void item_color(const struct v_item *hp, float *c)
     }
 }
 
-void item_draw(struct s_rend *rend,
-               const struct v_item *hp,
-               const GLfloat *M, float t)
+void item_push(const struct v_item *hp)
 {
     const GLfloat s = ITEM_RADIUS;
 
-    struct s_draw *draw = item_file(hp);
+    batch_push(&items[item_geom(hp)], hp->p, s, s, s, NULL);
+}
 
-    glPushMatrix();
+void item_draw(struct s_rend *rend, const GLfloat *M, float t)
+{
+    int g, i;
+
+    for (g = 0; g < GEOM_MAX; g++)
     {
-        glScalef(s, s, s);
+        struct batch  *b    = &items[g];
+        struct s_draw *draw = &item[g].draw;
 
-        glDepthMask(GL_FALSE);
+        if (b->ic == 0 || !draw->base)
+            continue;
+
+        /* Billboards go under their own item, so draw those one by one. */
+
+        if (draw->base->rc)
         {
-            sol_bill(draw, rend, M, t);
+            for (i = 0; i < b->ic; i++)
+            {
+                const struct s_inst *ip = b->iv + i;
+
+                glPushMatrix();
+                {
+                    glTranslatef(ip->p[0], ip->p[1], ip->p[2]);
+                    glScalef    (ip->s[0], ip->s[1], ip->s[2]);
+
+                    glDepthMask(GL_FALSE);
+                    {
+                        sol_bill(draw, rend, M, t);
+                    }
+                    glDepthMask(GL_TRUE);
+
+                    sol_draw(draw, rend, 0, 1);
+                }
+                glPopMatrix();
+            }
         }
-        glDepthMask(GL_TRUE);
+        else sol_draw_inst(draw, rend, 0, 1, b->iv, b->ic);
 
-        sol_draw(draw, rend, 0, 1);
+        b->ic = 0;
     }
-    glPopMatrix();
 }
 
 /*---------------------------------------------------------------------------*/
@@ -460,49 +562,46 @@ void back_free(void)
 
 /*---------------------------------------------------------------------------*/
 
-/* Draw a column of light with position p, color c, radius r, and height h. */
+/*
+ * Push a column of light with position p, color c, radius r, and height
+ * h.  The color is not copied.
+ */
+void beam_push(const GLfloat *p, const GLfloat *c, GLfloat r, GLfloat h)
+{
+    batch_push(&beams, p, r, h, r, c);
+}
 
-void beam_draw(struct s_rend *rend, const GLfloat *p,
-                                    const GLfloat *c, GLfloat r, GLfloat h)
+void goal_push(const GLfloat *p, GLfloat r, GLfloat h)
 {
-    glPushMatrix();
-    {
-        glTranslatef(p[0], p[1], p[2]);
-        glScalef(r, h, r);
-        glColor4f(c[0], c[1], c[2], c[3]);
-        sol_draw(&beam.draw, rend, 1, 1);
-    }
-    glPopMatrix();
+    batch_push(&goals, p, r, h, r, NULL);
 }
 
-void goal_draw(struct s_rend *rend, const GLfloat *p, GLfloat r, GLfloat h, GLfloat t)
+void jump_push(const GLfloat *p, GLfloat r, GLfloat h)
+{
+    batch_push(&jumps, p, r, h, r, NULL);
+}
+
+void beam_draw(struct s_rend *rend)
+{
+    batch_draw(&beams, rend, &beam.draw);
+}
+
+void goal_draw(struct s_rend *rend)
 {
     GLfloat height = (hmd_stat() ? 0.3f : 1.0f) * video.device_h;
 
     glPointSize(height / 6);
 
-    glPushMatrix();
-    {
-        glTranslatef(p[0], p[1], p[2]);
-        glScalef(r, h, r);
-        sol_draw(&goal.draw, rend, 1, 1);
-    }
-    glPopMatrix();
+    batch_draw(&goals, rend, &goal.draw);
 }
 
-void jump_draw(struct s_rend *rend, const GLfloat *p, GLfloat r, GLfloat h)
+void jump_draw(struct s_rend *rend)
 {
     GLfloat height = (hmd_stat() ? 0.3f : 1.0f) * video.device_h;
 
     glPointSize(height / 12);
 
-    glPushMatrix();
-    {
-        glTranslatef(p[0], p[1], p[2]);
-        glScalef(r, h, r);
-        sol_draw(&jump.draw, rend, 1, 1);
-    }
-    glPopMatrix();
+    batch_draw(&jumps, rend, &jump.draw);
 }
 
 void flag_draw(struct s_rend *rend, const GLfloat *p)
@@ -22,16 +22,21 @@ void geom_init(void);
 void geom_free(void);
 void geom_step(float);
 
-void beam_draw(struct s_rend *, const GLfloat *, const GLfloat *, GLfloat, GLfloat);
-void goal_draw(struct s_rend *, const GLfloat *, GLfloat, GLfloat, GLfloat);
-void jump_draw(struct s_rend *, const GLfloat *, GLfloat, GLfloat);
+void beam_push(const GLfloat *, const GLfloat *, GLfloat, GLfloat);
+void goal_push(const GLfloat *, GLfloat, GLfloat);
+void jump_push(const GLfloat *, GLfloat, GLfloat);
+
+void beam_draw(struct s_rend *);
+void goal_draw(struct s_rend *);
+void jump_draw(struct s_rend *);
 void flag_draw(struct s_rend *, const GLfloat *);
 void mark_draw(struct s_rend *);
 void vect_draw(struct s_rend *);
 void back_draw(struct s_rend *);
 
 void item_color(const struct v_item *, float *);
-void item_draw(struct s_rend *, const struct v_item *, const GLfloat *, float);
+void item_push(const struct v_item *);
+void item_draw(struct s_rend *, const GLfloat *, float);
 
 /*---------------------------------------------------------------------------*/
 
@@ -136,6 +136,15 @@ int glext_init(void)
     if (glext_check("GL_EXT_texture_filter_anisotropic"))
         gli.texture_filter_anisotropic = 1;
 
+    /* 32-bit element indices are core on the desktop. */
+
+#if ENABLE_OPENGLES || defined(__EMSCRIPTEN__)
+    if (glext_check("GL_OES_element_index_uint"))
+        gli.element_index_uint = 1;
+#else
+    gli.element_index_uint = 1;
+#endif
+
     /* Desktop init. */
 
 #if !ENABLE_OPENGLES && !defined(__EMSCRIPTEN__)
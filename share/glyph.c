@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2003 Robert Kooima
+ *
+ * NEVERBALL is  free software; you can redistribute  it and/or modify
+ * it under the  terms of the GNU General  Public License as published
+ * by the Free  Software Foundation; either version 2  of the License,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT  ANY  WARRANTY;  without   even  the  implied  warranty  of
+ * MERCHANTABILITY or  FITNESS FOR A PARTICULAR PURPOSE.   See the GNU
+ * General Public License for more details.
+ */
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "glyph.h"
+#include "text.h"
+#include "common.h"
+#include "log.h"
+
+/*---------------------------------------------------------------------------*/
+
+#define GLYPH_ROWS 12                   /* Atlas side in font heights        */
+
+void glyph_init(struct glyph_atlas *ga, TTF_Font *ttf)
+{
+    int i;
+
+    memset(ga, 0, sizeof (*ga));
+
+    ga->ttf    = ttf;
+    ga->height = ttf ? TTF_FontHeight(ttf) : 0;
+
+    for (i = 0; i < GLYPH_HASH; i++)
+        ga->head[i] = -1;
+
+    alloc_new(&ga->alloc, sizeof (struct glyph), (void **) &ga->gv, &ga->gc);
+}
+
+void glyph_free(struct glyph_atlas *ga)
+{
+    if (ga->image)
+        glDeleteTextures(1, &ga->image);
+
+    alloc_free(&ga->alloc);
+
+    memset(ga, 0, sizeof (*ga));
+}
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Create the atlas texture, cleared, large enough for a few hundred
+ * glyphs.
+ */
+static int glyph_image(struct glyph_atlas *ga)
+{
+    void *p;
+    int   s = 64;
+
+    while (s < ga->height * GLYPH_ROWS && s < gli.max_texture_size)
+        s *= 2;
+
+    if ((p = calloc(s * s, 2)))
+    {
+        glGenTextures(1, &ga->image);
+        glBindTexture(GL_TEXTURE_2D, ga->image);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE_ALPHA, s, s, 0,
+                     GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, p);
+
+        free(p);
+
+        ga->w = s;
+        ga->h = s;
+
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Find room for a W by H glyph, leaving a clear texel around it.
+ */
+static int glyph_place(struct glyph_atlas *ga, int w, int h, int *x, int *y)
+{
+    if (ga->x + w + 1 > ga->w)
+    {
+        ga->x    = 0;
+        ga->y   += ga->line;
+        ga->line = 0;
+    }
+
+    if (ga->x + w + 1 > ga->w || ga->y + h + 1 > ga->h)
+    {
+        log_printf("Glyph atlas of size %d is full\n", ga->height);
+        ga->full = 1;
+        return 0;
+    }
+
+    *x = ga->x + 1;
+    *y = ga->y + 1;
+
+    ga->x   += w + 1;
+    ga->line = MAX(ga->line, h + 1);
+
+    return 1;
+}
+
+/*
+ * Render a glyph and copy its coverage into the atlas.  Transparent
+ * rows and columns are trimmed.
+ */
+static int glyph_load(struct glyph_atlas *ga, struct glyph *gp)
+{
+    SDL_Color    col = { 0xFF, 0xFF, 0xFF, 0xFF };
+    SDL_Surface *srf;
+
+    char str[8] = "";
+    int  ok = 0;
+
+    text_add_char(gp->c, str, sizeof (str));
+
+    if ((srf = TTF_RenderUTF8_Blended(ga->ttf, str, col)))
+    {
+        const SDL_PixelFormat *fmt = srf->format;
+
+        int x0 = srf->w, x1 = 0;
+        int y0 = srf->h, y1 = 0;
+        int i, j;
+
+        gp->a = srf->w;
+
+        if (gp->c <= 0xFFFF)
+            TTF_GlyphMetrics(ga->ttf, (Uint16) gp->c, NULL, NULL, NULL, NULL,
+                             &gp->a);
+
+        if (fmt->BytesPerPixel == 4 && SDL_LockSurface(srf) == 0)
+        {
+            /* Find the bounds of the coverage. */
+
+            for (i = 0; i < srf->h; i++)
+            {
+                const Uint32 *row = (const Uint32 *) ((const Uint8 *)
+                                                      srf->pixels +
+                                                      i * srf->pitch);
+                for (j = 0; j < srf->w; j++)
+                    if (row[j] & fmt->Amask)
+                    {
+                        x0 = MIN(x0, j);
+                        x1 = MAX(x1, j + 1);
+                        y0 = MIN(y0, i);
+                        y1 = MAX(y1, i + 1);
+                    }
+            }
+
+            if (x0 >= x1)
+                ok = 1;
+            else
+            {
+                const int w = x1 - x0;
+                const int h = y1 - y0;
+
+                Uint8 *p;
+
+                if (glyph_place(ga, w, h, &gp->x, &gp->y) &&
+                    (p = malloc(w * h * 2)))
+                {
+                    /* Keep the color white.  Modulate ONLY in alpha. */
+
+                    for (i = 0; i < h; i++)
+                    {
+                        const Uint32 *row = (const Uint32 *) ((const Uint8 *)
+                                                              srf->pixels +
+                                                              (y0 + i) *
+                                                              srf->pitch);
+                        for (j = 0; j < w; j++)
+                        {
+                            p[(i * w + j) * 2 + 0] = 0xFF;
+                            p[(i * w + j) * 2 + 1] = (Uint8)
+                                ((row[x0 + j] & fmt->Amask) >> fmt->Ashift);
+                        }
+                    }
+
+                    glBindTexture(GL_TEXTURE_2D, ga->image);
+                    glTexSubImage2D(GL_TEXTURE_2D, 0, gp->x, gp->y, w, h,
+                                    GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, p);
+                    free(p);
+
+                    gp->w = w;
+                    gp->h = h;
+                    gp->l = x0;
+                    gp->t = y0;
+
+                    ok = 1;
+                }
+            }
+            SDL_UnlockSurface(srf);
+        }
+        SDL_FreeSurface(srf);
+    }
+    return ok;
+}
+
+/*
+ * Return the glyph of the given code point, loading it if necessary.
+ * Return NULL if it cannot be rendered or no longer fits.  The glyph
+ * is valid until the next call.
+ */
+const struct glyph *glyph_get(struct glyph_atlas *ga, Uint32 c)
+{
+    struct glyph *gp;
+    int i;
+
+    for (i = ga->head[c % GLYPH_HASH]; i >= 0; i = ga->gv[i].next)
+        if (ga->gv[i].c == c)
+            return ga->gv + i;
+
+    if (!ga->ttf || ga->full)
+        return NULL;
+
+    if (!ga->image && !glyph_image(ga))
+        return NULL;
+
+    if ((gp = alloc_add(&ga->alloc)))
+    {
+        memset(gp, 0, sizeof (*gp));
+
+        gp->c = c;
+
+        if (glyph_load(ga, gp))
+        {
+            gp->next = ga->head[c % GLYPH_HASH];
+            ga->head[c % GLYPH_HASH] = ga->gc - 1;
+            return gp;
+        }
+
+        alloc_del(&ga->alloc);
+    }
+    return NULL;
+}
+
+/*
+ * Return the kerning between two code points.
+ */
+int glyph_kern(struct glyph_atlas *ga, Uint32 a, Uint32 b)
+{
+#if defined(SDL_TTF_COMPILEDVERSION) && \
+    SDL_TTF_COMPILEDVERSION >= SDL_VERSIONNUM(2, 0, 14)
+    if (ga->ttf && a && a <= 0xFFFF && b <= 0xFFFF)
+        return TTF_GetFontKerningSizeGlyphs(ga->ttf, (Uint16) a, (Uint16) b);
+#endif
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,57 @@
+#ifndef GLYPH_H
+#define GLYPH_H
+
+#include <SDL_ttf.h>
+
+#include "glext.h"
+#include "array.h"
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Glyph atlas.  Glyphs of one font at one size are rendered as they are
+ * first needed and packed into rows of a single texture, so that text
+ * may be drawn as a run of quads without a texture of its own.
+ */
+
+#define GLYPH_HASH 256
+
+struct glyph
+{
+    Uint32 c;                           /* Code point                        */
+    int    next;                        /* Next glyph in hash chain, or -1   */
+
+    int x, y;                           /* Position in the atlas             */
+    int w, h;                           /* Size in the atlas, zero if blank  */
+    int l, t;                           /* Offset from pen and top of line   */
+    int a;                              /* Advance                           */
+};
+
+struct glyph_atlas
+{
+    TTF_Font *ttf;
+    GLuint    image;
+
+    int w, h;                           /* Texture size                      */
+    int x, y;                           /* Next free spot                    */
+    int line;                           /* Height of the current row         */
+    int full;                           /* No room for a glyph was left      */
+
+    int height;                         /* Font height                       */
+
+    struct glyph *gv;
+    int           gc;
+    struct alloc  alloc;
+
+    int head[GLYPH_HASH];               /* First glyph of each hash chain    */
+};
+
+void glyph_init(struct glyph_atlas *, TTF_Font *);
+void glyph_free(struct glyph_atlas *);
+
+const struct glyph *glyph_get(struct glyph_atlas *, Uint32);
+int                 glyph_kern(struct glyph_atlas *, Uint32, Uint32);
+
+/*---------------------------------------------------------------------------*/
+
+#endif
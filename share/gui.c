@@ -25,6 +25,9 @@
 #include "gui.h"
 #include "common.h"
 #include "font.h"
+#include "glyph.h"
+#include "overlap.h"
+#include "text.h"
 #include "theme.h"
 
 #include "fs.h"
@@ -63,6 +66,7 @@ const GLubyte gui_shd[4] = { 0x00, 0x00, 0x00, 0x80 };  /* Shadow */
 #define GUI_FILL   2
 #define GUI_HILITE 4
 #define GUI_RECT   8
+#define GUI_SHARED 16                   /* Image belongs to the caller       */
 
 #define GUI_LINES 8
 
@@ -92,6 +96,10 @@ struct widget
     int     text_w;
     int     text_h;
 
+    struct vert *glyph_v;               /* Glyph quads, shadows first        */
+    int          glyph_n;               /* Glyph vertex count                */
+    int          glyph_m;               /* Glyph vertices allocated          */
+
     enum trunc trunc;
 };
 
@@ -126,6 +134,16 @@ static int gui_hot(int id)
     return (widget[id].flags & GUI_STATE);
 }
 
+static void gui_free_image(int id)
+{
+    if (widget[id].image && !(widget[id].flags & GUI_SHARED))
+        glDeleteTextures(1, &widget[id].image);
+
+    widget[id].image   = 0;
+    widget[id].flags  &= ~GUI_SHARED;
+    widget[id].glyph_n = 0;
+}
+
 static int gui_size(void)
 {
     const int w = video.device_w;
@@ -136,7 +154,7 @@ static int gui_size(void)
 
 /*---------------------------------------------------------------------------*/
 
-/* Vertex buffer definitions for widget rendering. */
+/* Vertex definitions for widget rendering. */
 
 /* Vertex count */
 
@@ -146,22 +164,50 @@ static int gui_size(void)
 
 #define WIDGET_VERT (RECT_VERT + MAX(TEXT_VERT, IMAGE_VERT))
 
-/* Element count */
-
-#define RECT_ELEM 28
-
-#define WIDGET_ELEM (RECT_ELEM)
-
 struct vert
 {
     GLubyte c[4];
     GLfloat u[2];
-    GLshort p[2];
+    GLfloat p[2];
 };
 
 static struct vert vert_buf[WIDGET_MAX * WIDGET_VERT];
-static GLuint      vert_vbo = 0;
-static GLuint      vert_ebo = 0;
+
+/*
+ * Painting gathers the triangles of all widgets, transformed to the
+ * screen, into batches sharing a texture (see overlap.h).  All batches
+ * go to a single vertex buffer, with one draw call each.
+ */
+
+struct xform
+{
+    GLfloat k;                          /* Scale                             */
+    GLfloat x, y;                       /* Translation                       */
+};
+
+struct part
+{
+    int batch;
+    int first;                          /* Vertex index in painting order    */
+    int count;
+};
+
+static struct vert  *paint_v;           /* Vertices in painting order        */
+static int           paint_vc;
+static int           paint_vm;
+
+static struct vert  *batch_v;           /* Vertices in batch order           */
+static int           batch_vm;
+
+static struct overlap *batch_b;
+static int             batch_c;
+static int             batch_m;
+
+static struct part  *part_p;
+static int           part_c;
+static int           part_m;
+
+static GLuint paint_vbo = 0;
 
 /*---------------------------------------------------------------------------*/
 
@@ -174,92 +220,172 @@ static void set_vert(struct vert *v, int x, int y,
     v->c[3] = c[3];
     v->u[0] = s;
     v->u[1] = t;
-    v->p[0] = x;
-    v->p[1] = y;
+    v->p[0] = (GLfloat) x;
+    v->p[1] = (GLfloat) y;
 }
 
-/*---------------------------------------------------------------------------*/
+static void xform_move(struct xform *m, GLfloat x, GLfloat y)
+{
+    m->x += m->k * x;
+    m->y += m->k * y;
+}
 
-static void draw_enable(GLboolean c, GLboolean u, GLboolean p)
+static void xform_scale(struct xform *m, GLfloat k)
 {
-    glBindBuffer_(GL_ARRAY_BUFFER,         vert_vbo);
-    glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, vert_ebo);
+    m->k *= k;
+}
 
-    if (c)
-    {
-        glEnableClientState(GL_COLOR_ARRAY);
-        glColorPointer   (4, GL_UNSIGNED_BYTE, sizeof (struct vert),
-                                  (GLvoid *) offsetof (struct vert, c));
-    }
-    if (u)
-    {
-        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-        glTexCoordPointer(2, GL_FLOAT,         sizeof (struct vert),
-                                  (GLvoid *) offsetof (struct vert, u));
-    }
-    if (p)
+/*
+ * Make room for N elements of the given size, keeping the allocation
+ * from frame to frame.
+ */
+static int room(void *data, int *m, int n, size_t size)
+{
+    void **p = (void **) data;
+
+    if (*m < n)
     {
-        glEnableClientState(GL_VERTEX_ARRAY);
-        glVertexPointer  (2, GL_SHORT,         sizeof (struct vert),
-                                  (GLvoid *) offsetof (struct vert, p));
+        int   k = MAX(n, *m * 2);
+        void *q;
+
+        if (!(q = realloc(*p, k * size)))
+            return 0;
+
+        *p = q;
+        *m = k;
     }
+    return 1;
 }
 
-static void draw_rect(int id)
-{
-    glDrawElements(GL_TRIANGLE_STRIP, RECT_ELEM, GL_UNSIGNED_SHORT,
-                   (const GLvoid *) (id * WIDGET_ELEM * sizeof (GLushort)));
-}
+/*---------------------------------------------------------------------------*/
 
-static void draw_text(int id)
+/*
+ * Add N vertices of triangles textured with the given image.
+ */
+static void paint_part(GLuint image, const struct vert *v, int n,
+                       const struct xform *m)
 {
-    glDrawArrays(GL_TRIANGLE_STRIP, id * WIDGET_VERT + RECT_VERT, TEXT_VERT);
+    struct vert *w;
+    GLfloat r[4];
+    int i;
+
+    if (n <= 0)
+        return;
+
+    if (!room(&paint_v, &paint_vm, paint_vc + n, sizeof (struct vert)) ||
+        !room(&part_p,  &part_m,   part_c   + 1, sizeof (struct part)) ||
+        !room(&batch_b, &batch_m,  batch_c  + 1, sizeof (struct overlap)))
+        return;
+
+    /* Transform the vertices to the screen, finding their bounds. */
+
+    w = paint_v + paint_vc;
+
+    for (i = 0; i < n; i++)
+    {
+        w[i] = v[i];
+
+        w[i].p[0] = m->k * v[i].p[0] + m->x;
+        w[i].p[1] = m->k * v[i].p[1] + m->y;
+
+        if (i == 0 || w[i].p[0] < r[0]) r[0] = w[i].p[0];
+        if (i == 0 || w[i].p[1] < r[1]) r[1] = w[i].p[1];
+        if (i == 0 || w[i].p[0] > r[2]) r[2] = w[i].p[0];
+        if (i == 0 || w[i].p[1] > r[3]) r[3] = w[i].p[1];
+    }
+
+    part_p[part_c].batch = overlap_join(batch_b, &batch_c, (int) image, r, n);
+    part_p[part_c].first = paint_vc;
+    part_p[part_c].count = n;
+
+    part_c   += 1;
+    paint_vc += n;
 }
 
-static void draw_image(int id)
+/*
+ * Split a quad given as a triangle strip into two triangles.
+ */
+static void quad_tris(struct vert *t, const struct vert *a, const struct vert *b,
+                                      const struct vert *c, const struct vert *d)
 {
-    glDrawArrays(GL_TRIANGLE_STRIP, id * WIDGET_VERT + RECT_VERT, IMAGE_VERT);
+    t[0] = *a;
+    t[1] = *b;
+    t[2] = *c;
+    t[3] = *c;
+    t[4] = *b;
+    t[5] = *d;
 }
 
-static void draw_disable(void)
+/*
+ * Sort the painted vertices by batch, upload them all at once, and draw
+ * each batch.
+ */
+static void paint_flush(void)
 {
-    glBindBuffer_(GL_ARRAY_BUFFER,         0);
-    glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, 0);
+    int b, i, n = overlap_order(batch_b, batch_c);
+
+    if (n && room(&batch_v, &batch_vm, n, sizeof (struct vert)))
+    {
+        for (i = 0; i < part_c; i++)
+        {
+            struct overlap *bp = batch_b + part_p[i].batch;
+
+            memcpy(batch_v + bp->first + bp->count,
+                   paint_v + part_p[i].first,
+                   part_p[i].count * sizeof (struct vert));
+
+            bp->count += part_p[i].count;
+        }
 
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-    glDisableClientState(GL_COLOR_ARRAY);
+        glBindBuffer_(GL_ARRAY_BUFFER, paint_vbo);
+        glBufferData_(GL_ARRAY_BUFFER, n * sizeof (struct vert), batch_v,
+                      GL_DYNAMIC_DRAW);
+
+        glEnableClientState(GL_COLOR_ARRAY);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glEnableClientState(GL_VERTEX_ARRAY);
+
+        glColorPointer   (4, GL_UNSIGNED_BYTE, sizeof (struct vert),
+                                  (GLvoid *) offsetof (struct vert, c));
+        glTexCoordPointer(2, GL_FLOAT,         sizeof (struct vert),
+                                  (GLvoid *) offsetof (struct vert, u));
+        glVertexPointer  (2, GL_FLOAT,         sizeof (struct vert),
+                                  (GLvoid *) offsetof (struct vert, p));
+
+        for (b = 0; b < batch_c; b++)
+        {
+            glBindTexture(GL_TEXTURE_2D, (GLuint) batch_b[b].key);
+            glDrawArrays(GL_TRIANGLES, batch_b[b].first, batch_b[b].count);
+        }
+
+        glDisableClientState(GL_VERTEX_ARRAY);
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glDisableClientState(GL_COLOR_ARRAY);
+
+        glBindBuffer_(GL_ARRAY_BUFFER, 0);
+    }
+
+    paint_vc = 0;
+    batch_c  = 0;
+    part_c   = 0;
 }
 
 /*---------------------------------------------------------------------------*/
 
 /*
- * Generate vertices for a 3x3 rectangle. Vertices are arranged
- * top-to-bottom and left-to-right, triangle strips are arranged
- * left-to-right and top-to-bottom (one strip per row). Degenerate
- * triangles (two extra indices per stitch) are inserted for a
- * continous strip.
+ * Generate vertices for a 3x3 rectangle.  Vertices are arranged
+ * top-to-bottom and left-to-right.
  */
-
-static const GLushort rect_elem_base[RECT_ELEM] = {
-    0, 1, 4, 5, 8, 9, 12, 13, 13, 1,    /* Top    */
-    1, 2, 5, 6, 9, 10, 13, 14, 14, 2,   /* Middle */
-    2, 3, 6, 7, 10, 11, 14, 15          /* Bottom */
-};
-
 static void gui_geom_rect(int id, int x, int y, int w, int h, int f)
 {
-    GLushort rect_elem[RECT_ELEM];
-
-    struct vert *v = vert_buf + id * WIDGET_VERT;
-    struct vert *p = v;
+    struct vert *p = vert_buf + id * WIDGET_VERT;
 
     int X[4];
     int Y[4];
 
     int i, j;
 
-    /* Generate vertex and element data for the widget's rectangle. */
+    /* Generate vertex data for the widget's rectangle. */
 
     X[0] = x;
     X[1] = x +     ((f & GUI_W) ? borders[0] : 0);
@@ -274,23 +400,28 @@ static void gui_geom_rect(int id, int x, int y, int w, int h, int f)
     for (i = 0; i < 4; i++)
         for (j = 0; j < 4; j++)
             set_vert(p++, X[i], Y[j], curr_theme.s[i], curr_theme.t[j], gui_wht);
+}
 
-    for (i = 0; i < RECT_ELEM; i++)
-        rect_elem[i] = id * WIDGET_VERT + rect_elem_base[i];
+/*
+ * Shade glyph text from c0 at the bottom to c1 at the top.  The quads
+ * were laid out around the widget center already.
+ */
+static void gui_geom_glyphs(int id, int y, int h,
+                            const GLubyte *c0, const GLubyte *c1)
+{
+    struct vert *v = widget[id].glyph_v;
+
+    const int n = widget[id].glyph_n;
 
-    /* Copy this off to the VBOs. */
+    int i, k;
 
-    glBindBuffer_   (GL_ARRAY_BUFFER, vert_vbo);
-    glBufferSubData_(GL_ARRAY_BUFFER,
-                     id * WIDGET_VERT * sizeof (struct vert),
-                            RECT_VERT * sizeof (struct vert), v);
-    glBindBuffer_   (GL_ARRAY_BUFFER, 0);
+    for (i = n / 2; i < n; i++)
+    {
+        const int t = h > 0 ? (int) (v[i].p[1] - y) * 256 / h : 0;
 
-    glBindBuffer_   (GL_ELEMENT_ARRAY_BUFFER, vert_ebo);
-    glBufferSubData_(GL_ELEMENT_ARRAY_BUFFER,
-                     id * WIDGET_ELEM * sizeof (GLushort),
-                            RECT_ELEM * sizeof (GLushort), rect_elem);
-    glBindBuffer_   (GL_ELEMENT_ARRAY_BUFFER, 0);
+        for (k = 0; k < 4; k++)
+            v[i].c[k] = (GLubyte) (c0[k] + (c1[k] - c0[k]) * t / 256);
+    }
 }
 
 static void gui_geom_text(int id, int x, int y, int w, int h,
@@ -303,6 +434,12 @@ static void gui_geom_text(int id, int x, int y, int w, int h,
     int W;
     int H;
 
+    if (widget[id].glyph_n)
+    {
+        gui_geom_glyphs(id, y, h, c0, c1);
+        return;
+    }
+
     image_size(&W, &H, w, h);
 
     if (w > 0 && h > 0 && W > 0 && H > 0)
@@ -331,14 +468,6 @@ static void gui_geom_text(int id, int x, int y, int w, int h,
 
     }
     else memset(v, 0, TEXT_VERT * sizeof (struct vert));
-
-    /* Copy this off to the VBO. */
-
-    glBindBuffer_   (GL_ARRAY_BUFFER, vert_vbo);
-    glBufferSubData_(GL_ARRAY_BUFFER,
-                     (id * WIDGET_VERT + RECT_VERT) * sizeof (struct vert),
-                                         TEXT_VERT  * sizeof (struct vert), v);
-    glBindBuffer_   (GL_ARRAY_BUFFER, 0);
 }
 
 static void gui_geom_image(int id, int x, int y, int w, int h, int f)
@@ -360,14 +489,6 @@ static void gui_geom_image(int id, int x, int y, int w, int h, int f)
     set_vert(v + 1, X[0], Y[1], 0.0f, 0.0f, gui_wht);
     set_vert(v + 2, X[1], Y[0], 1.0f, 1.0f, gui_wht);
     set_vert(v + 3, X[1], Y[1], 1.0f, 0.0f, gui_wht);
-
-    /* Copy this off to the VBO. */
-
-    glBindBuffer_   (GL_ARRAY_BUFFER, vert_vbo);
-    glBufferSubData_(GL_ARRAY_BUFFER,
-                     (id * WIDGET_VERT + RECT_VERT) * sizeof (struct vert),
-                     IMAGE_VERT * sizeof (struct vert), v);
-    glBindBuffer_   (GL_ARRAY_BUFFER, 0);
 }
 
 static void gui_geom_widget(int id, int flags)
@@ -420,8 +541,9 @@ static void gui_geom_widget(int id, int flags)
 
 #define FONT_MAX 4
 
-static struct font fonts[FONT_MAX];
-static int         fontc;
+static struct font        fonts[FONT_MAX];
+static struct glyph_atlas atlas[FONT_MAX][3];
+static int                fontc;
 
 static int font_sizes[3];
 
@@ -441,6 +563,9 @@ static int gui_font_load(const char *path)
     {
         if (font_load(&fonts[fontc], path, font_sizes))
         {
+            for (i = 0; i < 3; i++)
+                glyph_init(&atlas[fontc][i], fonts[fontc].ttf[i]);
+
             fontc++;
             return fontc - 1;
         }
@@ -476,7 +601,13 @@ static void gui_font_quit(void)
     int i;
 
     for (i = 0; i < fontc; i++)
+    {
+        glyph_free(&atlas[i][0]);
+        glyph_free(&atlas[i][1]);
+        glyph_free(&atlas[i][2]);
+
         font_free(&fonts[i]);
+    }
 
     fontc = 0;
 
@@ -522,21 +653,11 @@ void gui_init(void)
 
     gui_theme_init();
 
-    /* Initialize the VBOs. */
+    /* Initialize the vertex data and the VBO they are painted from. */
 
     memset(vert_buf, 0, sizeof (vert_buf));
 
-    glGenBuffers_(1,              &vert_vbo);
-    glBindBuffer_(GL_ARRAY_BUFFER, vert_vbo);
-    glBufferData_(GL_ARRAY_BUFFER, sizeof (vert_buf), vert_buf, GL_STATIC_DRAW);
-    glBindBuffer_(GL_ARRAY_BUFFER, 0);
-
-    glGenBuffers_(1,                      &vert_ebo);
-    glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, vert_ebo);
-    glBufferData_(GL_ELEMENT_ARRAY_BUFFER,
-                  WIDGET_MAX * WIDGET_ELEM * sizeof (GLushort),
-                  NULL, GL_STATIC_DRAW);
-    glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glGenBuffers_(1, &paint_vbo);
 
     /* Cache digit glyphs for HUD rendering. */
 
@@ -572,21 +693,34 @@ void gui_free(void)
 {
     int id;
 
-    /* Release the VBOs. */
+    /* Release the VBO and painting buffers. */
+
+    glDeleteBuffers_(1, &paint_vbo);
+
+    free(paint_v);
+    free(batch_v);
+    free(batch_b);
+    free(part_p);
+
+    paint_v = batch_v = NULL;
+    batch_b = NULL;
+    part_p  = NULL;
 
-    glDeleteBuffers_(1, &vert_vbo);
-    glDeleteBuffers_(1, &vert_ebo);
+    paint_vm = batch_vm = batch_m = part_m = 0;
 
     /* Release any remaining widget texture and display list indices. */
 
     for (id = 1; id < WIDGET_MAX; id++)
     {
-        if (widget[id].image)
-            glDeleteTextures(1, &widget[id].image);
+        gui_free_image(id);
+
+        free(widget[id].glyph_v);
+
+        widget[id].glyph_v = NULL;
+        widget[id].glyph_m = 0;
 
         widget[id].type  = GUI_FREE;
         widget[id].flags = 0;
-        widget[id].image = 0;
         widget[id].cdr   = 0;
         widget[id].car   = 0;
     }
@@ -630,6 +764,8 @@ static int gui_widget(int pd, int type)
             widget[id].text_w = 0;
             widget[id].text_h = 0;
 
+            widget[id].glyph_n = 0;
+
             /* Insert the new widget into the parent's widget list. */
 
             if (pd)
@@ -759,13 +895,161 @@ static char *gui_truncate(const char *text,
 
 /*---------------------------------------------------------------------------*/
 
+static void set_quad(struct vert *v, int x0, int y0, int x1, int y1,
+                     GLfloat s0, GLfloat t0, GLfloat s1, GLfloat t1,
+                     const GLubyte *c)
+{
+    set_vert(v + 0, x0, y1, s0, t0, c);
+    set_vert(v + 1, x0, y0, s0, t1, c);
+    set_vert(v + 2, x1, y1, s1, t0, c);
+    set_vert(v + 3, x1, y1, s1, t0, c);
+    set_vert(v + 4, x0, y0, s0, t1, c);
+    set_vert(v + 5, x1, y0, s1, t1, c);
+}
+
+/*
+ * Make room for the quads of N glyphs and their shadows.  Keep the
+ * allocation across label changes.
+ */
+static int gui_glyph_room(int id, int n)
+{
+    if (widget[id].glyph_m < n * 12)
+    {
+        int m = MAX(n * 12, widget[id].glyph_m * 2);
+
+        struct vert *v;
+
+        if (!(v = realloc(widget[id].glyph_v, m * sizeof (struct vert))))
+            return 0;
+
+        widget[id].glyph_v = v;
+        widget[id].glyph_m = m;
+    }
+    return 1;
+}
+
+/*
+ * Lay out text as quads from the glyph atlas of the widget's font and
+ * size, centered on the widget.  Return zero if the atlas cannot hold
+ * all of its glyphs.
+ */
+static int gui_glyph_text(int id, const char *text)
+{
+    struct glyph_atlas *ga = &atlas[widget[id].font][widget[id].size];
+
+    const struct glyph *gp;
+    const char *s = text;
+
+    Uint32 c, p = 0;
+
+    int x = 0, w = 0, h = ga->height, n = 0, i;
+
+    while ((c = text_get_char(&s)))
+    {
+        if (!(gp = glyph_get(ga, c)))
+            return 0;
+
+        x += glyph_kern(ga, p, c);
+
+        if (gp->w > 0 && gp->h > 0)
+        {
+            /* Lay the text down first.  It moves behind its shadow below. */
+
+            if (!gui_glyph_room(id, n + 1))
+                return 0;
+
+            set_quad(widget[id].glyph_v + n * 6,
+                     x + gp->l,         h - gp->t - gp->h,
+                     x + gp->l + gp->w, h - gp->t,
+                     (GLfloat) (gp->x)         / ga->w,
+                     (GLfloat) (gp->y)         / ga->h,
+                     (GLfloat) (gp->x + gp->w) / ga->w,
+                     (GLfloat) (gp->y + gp->h) / ga->h, gui_wht);
+            n++;
+
+            w = MAX(w, x + gp->l + gp->w);
+        }
+
+        x += gp->a;
+        p  = c;
+    }
+
+    w = MAX(w, x);
+
+    if (n)
+    {
+        struct vert *v = widget[id].glyph_v;
+
+        const int d = h / 16;  /* Shadow offset */
+
+        /* Center the text, and draw its shadow first. */
+
+        for (i = 0; i < n * 6; i++)
+        {
+            v[i].p[0] -= w / 2;
+            v[i].p[1] -= h / 2;
+        }
+
+        memcpy(v + n * 6, v, n * 6 * sizeof (struct vert));
+
+        for (i = 0; i < n * 6; i++)
+        {
+            v[i].p[0] += d;
+            v[i].p[1] -= d;
+
+            memcpy(v[i].c, gui_shd, sizeof (v[i].c));
+        }
+
+        widget[id].image  = ga->image;
+        widget[id].flags |= GUI_SHARED;
+    }
+
+    widget[id].glyph_n = n * 12;
+    widget[id].text_w  = *text ? w : 0;
+    widget[id].text_h  = *text ? h : 0;
+
+    return 1;
+}
+
+/*
+ * Give a widget its text, from the glyph atlas if possible, or else as
+ * a texture of its own.
+ */
+static void gui_text(int id, const char *text)
+{
+    if (!gui_glyph_text(id, text))
+    {
+        TTF_Font *ttf = fonts[widget[id].font].ttf[widget[id].size];
+
+        widget[id].glyph_n = 0;
+        widget[id].image   = make_image_from_font(NULL, NULL,
+                                                  &widget[id].text_w,
+                                                  &widget[id].text_h,
+                                                  text, ttf, 0);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+
 void gui_set_image(int id, const char *file)
 {
-    glDeleteTextures(1, &widget[id].image);
+    gui_free_image(id);
 
     widget[id].image = make_image_from_file(file, IF_MIPMAP);
 }
 
+/*
+ * Show a texture owned by the caller, who must keep it alive for as
+ * long as the widget shows it.
+ */
+void gui_set_texture(int id, GLuint image)
+{
+    gui_free_image(id);
+
+    widget[id].image  = image;
+    widget[id].flags |= GUI_SHARED;
+}
+
 void gui_set_label(int id, const char *text)
 {
     TTF_Font *ttf = fonts[widget[id].font].ttf[widget[id].size];
@@ -775,14 +1059,12 @@ void gui_set_label(int id, const char *text)
 
     char *str;
 
-    glDeleteTextures(1, &widget[id].image);
+    gui_free_image(id);
 
     str = gui_truncate(text, widget[id].w - padding, ttf, widget[id].trunc);
 
-    widget[id].image = make_image_from_font(NULL, NULL,
-                                            &widget[id].text_w,
-                                            &widget[id].text_h,
-                                            str, ttf, 0);
+    gui_text(id, str);
+
     w = widget[id].text_w;
     h = widget[id].text_h;
 
@@ -933,17 +1215,13 @@ int gui_state(int pd, const char *text, int size, int token, int value)
 
     if ((id = gui_widget(pd, GUI_BUTTON)))
     {
-        TTF_Font *ttf = fonts[widget[id].font].ttf[size];
-
         widget[id].flags |= (GUI_STATE | GUI_RECT);
+        widget[id].size   = size;
+
+        gui_text(id, text);
 
-        widget[id].image = make_image_from_font(NULL, NULL,
-                                                &widget[id].text_w,
-                                                &widget[id].text_h,
-                                                text, ttf, 0);
         widget[id].w     = widget[id].text_w;
         widget[id].h     = widget[id].text_h;
-        widget[id].size  = size;
         widget[id].token = token;
         widget[id].value = value;
     }
@@ -957,15 +1235,12 @@ int gui_label(int pd, const char *text, int size, const GLubyte *c0,
 
     if ((id = gui_widget(pd, GUI_LABEL)))
     {
-        TTF_Font *ttf = fonts[widget[id].font].ttf[size];
+        widget[id].size = size;
+
+        gui_text(id, text);
 
-        widget[id].image = make_image_from_font(NULL, NULL,
-                                                &widget[id].text_w,
-                                                &widget[id].text_h,
-                                                text, ttf, 0);
         widget[id].w      = widget[id].text_w;
         widget[id].h      = widget[id].text_h;
-        widget[id].size   = size;
         widget[id].color0 = c0 ? c0 : gui_yel;
         widget[id].color1 = c1 ? c1 : gui_red;
         widget[id].flags |= GUI_RECT;
@@ -1426,14 +1701,12 @@ int gui_delete(int id)
 
         /* Release any GL resources held by this widget. */
 
-        if (widget[id].image)
-            glDeleteTextures(1, &widget[id].image);
+        gui_free_image(id);
 
         /* Mark this widget unused. */
 
         widget[id].type  = GUI_FREE;
         widget[id].flags = 0;
-        widget[id].image = 0;
         widget[id].cdr   = 0;
         widget[id].car   = 0;
 
@@ -1460,15 +1733,31 @@ static void gui_paint_rect(int id, int st, int flags)
     {
         /* Draw a leaf's background, colored by widget state. */
 
-        glPushMatrix();
-        {
-            glTranslatef((GLfloat) (widget[id].x + widget[id].w / 2),
-                         (GLfloat) (widget[id].y + widget[id].h / 2), 0.f);
+        const struct vert *v = vert_buf + id * WIDGET_VERT;
 
-            glBindTexture(GL_TEXTURE_2D, curr_theme.tex[i]);
-            draw_rect(id);
-        }
-        glPopMatrix();
+        struct xform m = { 1.0f, 0.0f, 0.0f };
+        struct vert  t[54];
+
+        int j, k, n = 0;
+
+        xform_move(&m, (GLfloat) (widget[id].x + widget[id].w / 2),
+                       (GLfloat) (widget[id].y + widget[id].h / 2));
+
+        /* Skip cells of zero area, as there are no borders on some sides. */
+
+        for (j = 0; j < 3; j++)
+            for (k = 0; k < 3; k++)
+            {
+                const struct vert *a = v + j * 4 + k;
+
+                if (a[0].p[0] < a[4].p[0] && a[1].p[1] < a[0].p[1])
+                {
+                    quad_tris(t + n, a, a + 1, a + 4, a + 5);
+                    n += 6;
+                }
+            }
+
+        paint_part(curr_theme.tex[i], t, n, &m);
 
         flags |= GUI_RECT;
     }
@@ -1491,103 +1780,115 @@ static void gui_paint_rect(int id, int st, int flags)
 
 /*---------------------------------------------------------------------------*/
 
-static void gui_paint_text(int id);
-
-static void gui_paint_array(int id)
+/*
+ * Paint the text of the given widget, centered at the origin.
+ */
+static void gui_paint_glyphs(int id, const struct xform *m)
 {
-    int jd;
-
-    glPushMatrix();
+    if (widget[id].glyph_n)
+        paint_part(widget[id].image, widget[id].glyph_v,
+                   widget[id].glyph_n, m);
+    else
     {
-        GLfloat cx = widget[id].x + widget[id].w / 2.0f;
-        GLfloat cy = widget[id].y + widget[id].h / 2.0f;
-        GLfloat ck = widget[id].scale;
+        const struct vert *v = vert_buf + id * WIDGET_VERT + RECT_VERT;
 
-        if (1.0f < ck || ck < 1.0f)
-        {
-            glTranslatef(+cx, +cy, 0.0f);
-            glScalef(ck, ck, ck);
-            glTranslatef(-cx, -cy, 0.0f);
-        }
+        struct vert t[12];
 
-        /* Recursively paint all subwidgets. */
+        quad_tris(t + 0, v + 0, v + 1, v + 2, v + 3);
+        quad_tris(t + 6, v + 4, v + 5, v + 6, v + 7);
 
-        for (jd = widget[id].car; jd; jd = widget[jd].cdr)
-            gui_paint_text(jd);
+        paint_part(widget[id].image, t, 12, m);
     }
-    glPopMatrix();
 }
 
-static void gui_paint_image(int id)
+static void gui_paint_text(int id, const struct xform *m);
+
+static void gui_paint_array(int id, const struct xform *m)
 {
-    /* Draw the widget rect, textured using the image. */
+    struct xform n = *m;
 
-    glPushMatrix();
-    {
-        glTranslatef((GLfloat) (widget[id].x + widget[id].w / 2),
-                     (GLfloat) (widget[id].y + widget[id].h / 2), 0.f);
+    int jd;
 
-        glScalef(widget[id].scale,
-                 widget[id].scale,
-                 widget[id].scale);
+    GLfloat cx = widget[id].x + widget[id].w / 2.0f;
+    GLfloat cy = widget[id].y + widget[id].h / 2.0f;
+    GLfloat ck = widget[id].scale;
 
-        glBindTexture(GL_TEXTURE_2D, widget[id].image);
-        glColor4ub(gui_wht[0], gui_wht[1], gui_wht[2], gui_wht[3]);
-        draw_image(id);
+    if (1.0f < ck || ck < 1.0f)
+    {
+        xform_move (&n, +cx, +cy);
+        xform_scale(&n, ck);
+        xform_move (&n, -cx, -cy);
     }
-    glPopMatrix();
+
+    /* Recursively paint all subwidgets. */
+
+    for (jd = widget[id].car; jd; jd = widget[jd].cdr)
+        gui_paint_text(jd, &n);
 }
 
-static void gui_paint_count(int id)
+static void gui_paint_image(int id, const struct xform *m)
 {
-    int j, i = widget[id].size;
+    /* Draw the widget rect, textured using the image. */
 
-    glPushMatrix();
-    {
-        /* Translate to the widget center, and apply the pulse scale. */
+    const struct vert *v = vert_buf + id * WIDGET_VERT + RECT_VERT;
 
-        glTranslatef((GLfloat) (widget[id].x + widget[id].w / 2),
-                     (GLfloat) (widget[id].y + widget[id].h / 2), 0.f);
+    struct xform n = *m;
+    struct vert  t[6];
 
-        glScalef(widget[id].scale,
-                 widget[id].scale,
-                 widget[id].scale);
+    xform_move (&n, (GLfloat) (widget[id].x + widget[id].w / 2),
+                    (GLfloat) (widget[id].y + widget[id].h / 2));
+    xform_scale(&n, widget[id].scale);
 
-        if (widget[id].value > 0)
-        {
-            /* Translate right by half the total width of the rendered value. */
+    quad_tris(t, v + 0, v + 1, v + 2, v + 3);
 
-            GLfloat w = -widget[digit_id[i][0]].text_w * 0.5f;
+    paint_part(widget[id].image, t, 6, &n);
+}
 
-            for (j = widget[id].value; j; j /= 10)
-                w += widget[digit_id[i][j % 10]].text_w * 0.5f;
+static void gui_paint_count(int id, const struct xform *m)
+{
+    struct xform n = *m;
 
-            glTranslatef(w, 0.0f, 0.0f);
+    int j, i = widget[id].size;
 
-            /* Render each digit, moving left after each. */
+    /* Translate to the widget center, and apply the pulse scale. */
 
-            for (j = widget[id].value; j; j /= 10)
-            {
-                int jd = digit_id[i][j % 10];
+    xform_move (&n, (GLfloat) (widget[id].x + widget[id].w / 2),
+                    (GLfloat) (widget[id].y + widget[id].h / 2));
+    xform_scale(&n, widget[id].scale);
 
-                glBindTexture(GL_TEXTURE_2D, widget[jd].image);
-                draw_text(jd);
-                glTranslatef((GLfloat) -widget[jd].text_w, 0.0f, 0.0f);
-            }
-        }
-        else if (widget[id].value == 0)
+    if (widget[id].value > 0)
+    {
+        /* Translate right by half the total width of the rendered value. */
+
+        GLfloat w = -widget[digit_id[i][0]].text_w * 0.5f;
+
+        for (j = widget[id].value; j; j /= 10)
+            w += widget[digit_id[i][j % 10]].text_w * 0.5f;
+
+        xform_move(&n, w, 0.0f);
+
+        /* Render each digit, moving left after each. */
+
+        for (j = widget[id].value; j; j /= 10)
         {
-            /* If the value is zero, just display a zero in place. */
+            int jd = digit_id[i][j % 10];
 
-            glBindTexture(GL_TEXTURE_2D, widget[digit_id[i][0]].image);
-            draw_text(digit_id[i][0]);
+            gui_paint_glyphs(jd, &n);
+            xform_move(&n, (GLfloat) -widget[jd].text_w, 0.0f);
         }
     }
-    glPopMatrix();
+    else if (widget[id].value == 0)
+    {
+        /* If the value is zero, just display a zero in place. */
+
+        gui_paint_glyphs(digit_id[i][0], &n);
+    }
 }
 
-static void gui_paint_clock(int id)
+static void gui_paint_clock(int id, const struct xform *m)
 {
+    struct xform n = *m;
+
     int i  =   widget[id].size;
     int mt =  (widget[id].value / 6000) / 10;
     int mo =  (widget[id].value / 6000) % 10;
@@ -1602,69 +1903,57 @@ static void gui_paint_clock(int id)
     if (widget[id].value < 0)
         return;
 
-    glPushMatrix();
-    {
-        /* Translate to the widget center, and apply the pulse scale. */
-
-        glTranslatef((GLfloat) (widget[id].x + widget[id].w / 2),
-                     (GLfloat) (widget[id].y + widget[id].h / 2), 0.f);
+    /* Translate to the widget center, and apply the pulse scale. */
 
-        glScalef(widget[id].scale,
-                 widget[id].scale,
-                 widget[id].scale);
+    xform_move (&n, (GLfloat) (widget[id].x + widget[id].w / 2),
+                    (GLfloat) (widget[id].y + widget[id].h / 2));
+    xform_scale(&n, widget[id].scale);
 
-        /* Translate left by half the total width of the rendered value. */
+    /* Translate left by half the total width of the rendered value. */
 
-        if (mt > 0)
-            glTranslatef(-2.25f * dx_large, 0.0f, 0.0f);
-        else
-            glTranslatef(-1.75f * dx_large, 0.0f, 0.0f);
+    if (mt > 0)
+        xform_move(&n, -2.25f * dx_large, 0.0f);
+    else
+        xform_move(&n, -1.75f * dx_large, 0.0f);
 
-        /* Render the minutes counter. */
+    /* Render the minutes counter. */
 
-        if (mt > 0)
-        {
-            glBindTexture(GL_TEXTURE_2D, widget[digit_id[i][mt]].image);
-            draw_text(digit_id[i][mt]);
-            glTranslatef(dx_large, 0.0f, 0.0f);
-        }
+    if (mt > 0)
+    {
+        gui_paint_glyphs(digit_id[i][mt], &n);
+        xform_move(&n, dx_large, 0.0f);
+    }
 
-        glBindTexture(GL_TEXTURE_2D, widget[digit_id[i][mo]].image);
-        draw_text(digit_id[i][mo]);
-        glTranslatef(dx_small, 0.0f, 0.0f);
+    gui_paint_glyphs(digit_id[i][mo], &n);
+    xform_move(&n, dx_small, 0.0f);
 
-        /* Render the colon. */
+    /* Render the colon. */
 
-        glBindTexture(GL_TEXTURE_2D, widget[digit_id[i][10]].image);
-        draw_text(digit_id[i][10]);
-        glTranslatef(dx_small, 0.0f, 0.0f);
+    gui_paint_glyphs(digit_id[i][10], &n);
+    xform_move(&n, dx_small, 0.0f);
 
-        /* Render the seconds counter. */
+    /* Render the seconds counter. */
 
-        glBindTexture(GL_TEXTURE_2D, widget[digit_id[i][st]].image);
-        draw_text(digit_id[i][st]);
-        glTranslatef(dx_large, 0.0f, 0.0f);
+    gui_paint_glyphs(digit_id[i][st], &n);
+    xform_move(&n, dx_large, 0.0f);
 
-        glBindTexture(GL_TEXTURE_2D, widget[digit_id[i][so]].image);
-        draw_text(digit_id[i][so]);
-        glTranslatef(dx_small, 0.0f, 0.0f);
+    gui_paint_glyphs(digit_id[i][so], &n);
+    xform_move(&n, dx_small, 0.0f);
 
-        /* Render hundredths counter half size. */
+    /* Render hundredths counter half size. */
 
-        glScalef(0.5f, 0.5f, 1.0f);
+    xform_scale(&n, 0.5f);
 
-        glBindTexture(GL_TEXTURE_2D, widget[digit_id[i][ht]].image);
-        draw_text(digit_id[i][ht]);
-        glTranslatef(dx_large, 0.0f, 0.0f);
+    gui_paint_glyphs(digit_id[i][ht], &n);
+    xform_move(&n, dx_large, 0.0f);
 
-        glBindTexture(GL_TEXTURE_2D, widget[digit_id[i][ho]].image);
-        draw_text(digit_id[i][ho]);
-    }
-    glPopMatrix();
+    gui_paint_glyphs(digit_id[i][ho], &n);
 }
 
-static void gui_paint_label(int id)
+static void gui_paint_label(int id, const struct xform *m)
 {
+    struct xform n = *m;
+
     /* Short-circuit empty labels. */
 
     if (widget[id].image == 0)
@@ -1672,56 +1961,48 @@ static void gui_paint_label(int id)
 
     /* Draw the widget text box, textured using the glyph. */
 
-    glPushMatrix();
-    {
-        glTranslatef((GLfloat) (widget[id].x + widget[id].w / 2),
-                     (GLfloat) (widget[id].y + widget[id].h / 2), 0.f);
-
-        glScalef(widget[id].scale,
-                 widget[id].scale,
-                 widget[id].scale);
+    xform_move (&n, (GLfloat) (widget[id].x + widget[id].w / 2),
+                    (GLfloat) (widget[id].y + widget[id].h / 2));
+    xform_scale(&n, widget[id].scale);
 
-        glBindTexture(GL_TEXTURE_2D, widget[id].image);
-        draw_text(id);
-    }
-    glPopMatrix();
+    gui_paint_glyphs(id, &n);
 }
 
-static void gui_paint_text(int id)
+static void gui_paint_text(int id, const struct xform *m)
 {
     switch (widget[id].type)
     {
     case GUI_SPACE:  break;
     case GUI_FILLER: break;
-    case GUI_HARRAY: gui_paint_array(id); break;
-    case GUI_VARRAY: gui_paint_array(id); break;
-    case GUI_HSTACK: gui_paint_array(id); break;
-    case GUI_VSTACK: gui_paint_array(id); break;
-    case GUI_IMAGE:  gui_paint_image(id); break;
-    case GUI_COUNT:  gui_paint_count(id); break;
-    case GUI_CLOCK:  gui_paint_clock(id); break;
-    default:         gui_paint_label(id); break;
+    case GUI_HARRAY: gui_paint_array(id, m); break;
+    case GUI_VARRAY: gui_paint_array(id, m); break;
+    case GUI_HSTACK: gui_paint_array(id, m); break;
+    case GUI_VSTACK: gui_paint_array(id, m); break;
+    case GUI_IMAGE:  gui_paint_image(id, m); break;
+    case GUI_COUNT:  gui_paint_count(id, m); break;
+    case GUI_CLOCK:  gui_paint_clock(id, m); break;
+    default:         gui_paint_label(id, m); break;
     }
 }
 
 void gui_paint(int id)
 {
+    const struct xform m = { 1.0f, 0.0f, 0.0f };
+
     if (id)
     {
         video_push_ortho();
         {
             glDisable(GL_DEPTH_TEST);
             {
-                draw_enable(GL_FALSE, GL_TRUE, GL_TRUE);
                 gui_paint_rect(id, 0, 0);
-
-                draw_enable(GL_TRUE, GL_TRUE, GL_TRUE);
-                gui_paint_text(id);
+                gui_paint_text(id, &m);
 
                 if (cursor_st && cursor_id)
-                    gui_paint_image(cursor_id);
+                    gui_paint_image(cursor_id, &m);
+
+                paint_flush();
 
-                draw_disable();
                 glColor4ub(gui_wht[0], gui_wht[1], gui_wht[2], gui_wht[3]);
             }
             glEnable(GL_DEPTH_TEST);
@@ -72,6 +72,7 @@ void gui_free(void);
 
 void gui_set_label(int, const char *);
 void gui_set_image(int, const char *);
+void gui_set_texture(int, GLuint);
 void gui_set_font(int, const char *);
 void gui_set_multi(int, const char *);
 void gui_set_count(int, int);
@@ -166,6 +166,51 @@ GLuint make_texture(const void *p, int w, int h, int b, int fl)
     return o;
 }
 
+/*
+ * An image decoded ahead of time, waiting for the texture to be made.
+ */
+static struct
+{
+    char *name;
+    void *p;
+    int   w;
+    int   h;
+    int   b;
+} stash;
+
+/*
+ * Hand over the decoded image of the named file to the next call to
+ * make_image_from_file for it.  Any image stashed before is dropped.
+ */
+void image_stash(const char *filename, void *p, int w, int h, int b)
+{
+    free(stash.name);
+    free(stash.p);
+
+    stash.name = filename ? strdup(filename) : NULL;
+    stash.p    = p;
+    stash.w    = w;
+    stash.h    = h;
+    stash.b    = b;
+}
+
+static void *image_unstash(const char *filename, int *w, int *h, int *b)
+{
+    void *p = NULL;
+
+    if (stash.name && strcmp(stash.name, filename) == 0)
+    {
+        p  = stash.p;
+        *w = stash.w;
+        *h = stash.h;
+        *b = stash.b;
+
+        free(stash.name);
+        memset(&stash, 0, sizeof (stash));
+    }
+    return p;
+}
+
 /*
  * Load an image from the named file.  Return an OpenGL texture object.
  */
@@ -177,9 +222,10 @@ GLuint make_image_from_file(const char *filename, int fl)
     int    b;
     GLuint o = 0;
 
-    /* Load the image. */
+    /* Load the image, unless it has already been. */
 
-    if ((p = image_load(filename, &w, &h, &b)))
+    if ((p = image_unstash(filename, &w, &h, &b)) ||
+        (p = image_load(filename, &w, &h, &b)))
     {
         o = make_texture(p, w, h, b, fl);
         free(p);
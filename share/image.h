@@ -26,6 +26,7 @@
 void   image_snap(const char *);
 
 GLuint make_image_from_file(const char *, int);
+void   image_stash(const char *, void *, int, int, int);
 GLuint make_image_from_font(int *, int *,
                             int *, int *, const char *, TTF_Font *, int);
 GLuint make_texture(const void *, int, int, int, int);
@@ -30,6 +30,9 @@
 #include <SDL_net.h>
 #endif
 
+#include <SDL_thread.h>
+#include <SDL_cpuinfo.h>
+
 #include "solid_base.h"
 
 #include "vec3.h"
@@ -37,6 +40,8 @@
 #include "base_config.h"
 #include "fs.h"
 #include "common.h"
+#include "array.h"
+#include "dir.h"
 
 #define MAXSTR 256
 #define MAXKEY 16
@@ -53,9 +58,10 @@
 
 /*---------------------------------------------------------------------------*/
 
-static const char *input_file;
 static int         debug_output = 0;
 static int           csv_output = 0;
+static int          sect_output = 0;
+static int             csv_head = 0;
 
 /*---------------------------------------------------------------------------*/
 
@@ -216,269 +222,271 @@ static void bcast_quit(void)
 
 /*---------------------------------------------------------------------------*/
 
-/* Ohhhh... arbitrary! */
-
-#define MAXM    1024
-#define MAXV    65536
-#define MAXE    131072
-#define MAXS    65536
-#define MAXT    131072
-#define MAXO    262144
-#define MAXG    65536
-#define MAXL    4096
-#define MAXN    2048
-#define MAXP    2048
-#define MAXB    1024
-#define MAXH    2048
-#define MAXZ    1024
-#define MAXJ    1024
-#define MAXX    1024
-#define MAXR    2048
-#define MAXU    1024
-#define MAXW    1024
-#define MAXD    1024
-#define MAXA    16384
-#define MAXI    262144
-
-static int overflow(const char *s)
-{
-    char buf[64];
-    sprintf(buf, "%s overflow\n", s);
-    ERROR(buf);
-    exit(1);
-    return 0;
-}
+/*
+ * The following is a small  symbol table data structure.  Symbols and
+ * their integer  values are collected  in symv and  valv.  References
+ * and pointers  to their unsatisfied integer values  are collected in
+ * refv and pntv.  The resolve procedure matches references to symbols
+ * and fills waiting ints with the proper values.
+ */
 
-static int incm(struct s_base *fp)
+enum
 {
-    return (fp->mc < MAXM) ? fp->mc++ : overflow("mtrl");
-}
+    SYM_NONE = 0,
 
-static int incv(struct s_base *fp)
-{
-    return (fp->vc < MAXV) ? fp->vc++ : overflow("vert");
-}
+    SYM_PATH,
+    SYM_TARG,
 
-static int ince(struct s_base *fp)
-{
-    return (fp->ec < MAXE) ? fp->ec++ : overflow("edge");
-}
+    SYM_MAX
+};
 
-static int incs(struct s_base *fp)
+struct sym
 {
-    return (fp->sc < MAXS) ? fp->sc++ : overflow("side");
-}
+    int  type;
+    char name[MAXSTR];
+    int  val;
+};
 
-static int inct(struct s_base *fp)
+/*
+ * A reference names an int inside one of the growing arrays, by the
+ * array pointer and a byte offset, as the array may move before the
+ * reference is resolved.
+ */
+struct ref
 {
-    return (fp->tc < MAXT) ? fp->tc++ : overflow("texc");
-}
+    int    type;
+    char   name[MAXSTR];
+    void **base;
+    size_t off;
+};
 
-static int inco(struct s_base *fp)
+/*
+ * The planes of the sides read from the map, indexed by side.
+ */
+struct plane
 {
-    return (fp->oc < MAXO) ? fp->oc++ : overflow("offs");
-}
+    float d;
+    float n[3];
+    float p[3];
+    float u[3];
+    float v[3];
+    int   f;
+    int   m;
+};
 
-static int incg(struct s_base *fp)
+/*
+ * Everything that belongs to the compilation of a single map.  The SOL
+ * data comes first so that the  rest can be recovered from the s_base
+ * pointer handed  to every  routine below.  Maps in  a batch  are each
+ * compiled with one of these, concurrently.
+ */
+struct mapc
 {
-    return (fp->gc < MAXG) ? fp->gc++ : overflow("geom");
-}
+    struct s_base f;
 
-static int incl(struct s_base *fp)
-{
-    return (fp->lc < MAXL) ? fp->lc++ : overflow("lump");
-}
+    const char *input_file;
 
-static int incn(struct s_base *fp)
-{
-    return (fp->nc < MAXN) ? fp->nc++ : overflow("node");
-}
+    /* Storage for each SOL array, grown as the map is read. */
 
-static int incp(struct s_base *fp)
-{
-    return (fp->pc < MAXP) ? fp->pc++ : overflow("path");
-}
+    struct alloc mv, vv, ev, sv, tv, ov, gv, lv, nv, pv, bv;
+    struct alloc hv, zv, jv, xv, rv, uv, wv, dv, av, iv;
 
-static int incb(struct s_base *fp)
-{
-    return (fp->bc < MAXB) ? fp->bc++ : overflow("body");
-}
+    /* Symbol table. */
 
-static int inch(struct s_base *fp)
-{
-    return (fp->hc < MAXH) ? fp->hc++ : overflow("item");
-}
+    struct sym *syms;
+    struct ref *refs;
 
-static int incz(struct s_base *fp)
-{
-    return (fp->zc < MAXZ) ? fp->zc++ : overflow("goal");
-}
+    int symc;
+    int refc;
 
-static int incj(struct s_base *fp)
-{
-    return (fp->jc < MAXJ) ? fp->jc++ : overflow("jump");
-}
+    struct alloc syms_alloc;
+    struct alloc refs_alloc;
 
-static int incx(struct s_base *fp)
-{
-    return (fp->xc < MAXX) ? fp->xc++ : overflow("swch");
-}
+    /*
+     * Target positions.   They are  targeted by various  entities and
+     * must be resolved in a second pass.
+     */
 
-static int incr(struct s_base *fp)
-{
-    return (fp->rc < MAXR) ? fp->rc++ : overflow("bill");
-}
+    float (*targ_p)[3];
+    int    *targ_wi;
+    int    *targ_ji;
 
-static int incu(struct s_base *fp)
-{
-    return (fp->uc < MAXU) ? fp->uc++ : overflow("ball");
-}
+    int targ_n;
+    int targ_wc;
+    int targ_jc;
 
-static int incw(struct s_base *fp)
-{
-    return (fp->wc < MAXW) ? fp->wc++ : overflow("view");
-}
+    struct alloc targ_p_alloc;
+    struct alloc targ_wi_alloc;
+    struct alloc targ_ji_alloc;
 
-static int incd(struct s_base *fp)
-{
-    return (fp->dc < MAXD) ? fp->dc++ : overflow("dict");
-}
+    /* Planes of the lumps. */
 
-static int inci(struct s_base *fp)
-{
-    return (fp->ic < MAXI) ? fp->ic++ : overflow("indx");
-}
+    struct plane *planes;
+    int           planec;
+    struct alloc  planes_alloc;
 
-static void init_file(struct s_base *fp)
-{
-    fp->mc = 0;
-    fp->vc = 0;
-    fp->ec = 0;
-    fp->sc = 0;
-    fp->tc = 0;
-    fp->oc = 0;
-    fp->gc = 0;
-    fp->lc = 0;
-    fp->nc = 0;
-    fp->pc = 0;
-    fp->bc = 0;
-    fp->hc = 0;
-    fp->zc = 0;
-    fp->jc = 0;
-    fp->xc = 0;
-    fp->rc = 0;
-    fp->uc = 0;
-    fp->wc = 0;
-    fp->dc = 0;
-    fp->ac = 0;
-    fp->ic = 0;
-
-    fp->mv = (struct b_mtrl *) calloc(MAXM, sizeof (*fp->mv));
-    fp->vv = (struct b_vert *) calloc(MAXV, sizeof (*fp->vv));
-    fp->ev = (struct b_edge *) calloc(MAXE, sizeof (*fp->ev));
-    fp->sv = (struct b_side *) calloc(MAXS, sizeof (*fp->sv));
-    fp->tv = (struct b_texc *) calloc(MAXT, sizeof (*fp->tv));
-    fp->ov = (struct b_offs *) calloc(MAXO, sizeof (*fp->ov));
-    fp->gv = (struct b_geom *) calloc(MAXG, sizeof (*fp->gv));
-    fp->lv = (struct b_lump *) calloc(MAXL, sizeof (*fp->lv));
-    fp->nv = (struct b_node *) calloc(MAXN, sizeof (*fp->nv));
-    fp->pv = (struct b_path *) calloc(MAXP, sizeof (*fp->pv));
-    fp->bv = (struct b_body *) calloc(MAXB, sizeof (*fp->bv));
-    fp->hv = (struct b_item *) calloc(MAXH, sizeof (*fp->hv));
-    fp->zv = (struct b_goal *) calloc(MAXZ, sizeof (*fp->zv));
-    fp->jv = (struct b_jump *) calloc(MAXJ, sizeof (*fp->jv));
-    fp->xv = (struct b_swch *) calloc(MAXX, sizeof (*fp->xv));
-    fp->rv = (struct b_bill *) calloc(MAXR, sizeof (*fp->rv));
-    fp->uv = (struct b_ball *) calloc(MAXU, sizeof (*fp->uv));
-    fp->wv = (struct b_view *) calloc(MAXW, sizeof (*fp->wv));
-    fp->dv = (struct b_dict *) calloc(MAXD, sizeof (*fp->dv));
-    fp->av = (char *)          calloc(MAXA, sizeof (*fp->av));
-    fp->iv = (int *)           calloc(MAXI, sizeof (*fp->iv));
-}
+    int read_dict_entries;
+};
+
+#define MAPC(fp) ((struct mapc *) (fp))
 
 /*---------------------------------------------------------------------------*/
 
 /*
- * The following is a small  symbol table data structure.  Symbols and
- * their integer  values are collected  in symv and  valv.  References
- * and pointers  to their unsatisfied integer values  are collected in
- * refv and pntv.  The resolve procedure matches references to symbols
- * and fills waiting ints with the proper values.
+ * Add a zeroed element to an array and return its index.  The array may
+ * move: a pointer into it is good only until the next addition.
  */
+static int inc(struct alloc *a)
+{
+    void *p;
 
-#define MAXSYM 2048
+    if (!(p = alloc_add(a)))
+    {
+        ERROR("out of memory\n");
+        exit(1);
+    }
 
-enum
+    memset(p, 0, a->block);
+
+    return *a->count - 1;
+}
+
+static int incm(struct s_base *fp) { return inc(&MAPC(fp)->mv); }
+static int incv(struct s_base *fp) { return inc(&MAPC(fp)->vv); }
+static int ince(struct s_base *fp) { return inc(&MAPC(fp)->ev); }
+static int incs(struct s_base *fp) { return inc(&MAPC(fp)->sv); }
+static int inct(struct s_base *fp) { return inc(&MAPC(fp)->tv); }
+static int inco(struct s_base *fp) { return inc(&MAPC(fp)->ov); }
+static int incg(struct s_base *fp) { return inc(&MAPC(fp)->gv); }
+static int incl(struct s_base *fp) { return inc(&MAPC(fp)->lv); }
+static int incn(struct s_base *fp) { return inc(&MAPC(fp)->nv); }
+static int incp(struct s_base *fp) { return inc(&MAPC(fp)->pv); }
+static int incb(struct s_base *fp) { return inc(&MAPC(fp)->bv); }
+static int inch(struct s_base *fp) { return inc(&MAPC(fp)->hv); }
+static int incz(struct s_base *fp) { return inc(&MAPC(fp)->zv); }
+static int incj(struct s_base *fp) { return inc(&MAPC(fp)->jv); }
+static int incx(struct s_base *fp) { return inc(&MAPC(fp)->xv); }
+static int incr(struct s_base *fp) { return inc(&MAPC(fp)->rv); }
+static int incu(struct s_base *fp) { return inc(&MAPC(fp)->uv); }
+static int incw(struct s_base *fp) { return inc(&MAPC(fp)->wv); }
+static int incd(struct s_base *fp) { return inc(&MAPC(fp)->dv); }
+static int inci(struct s_base *fp) { return inc(&MAPC(fp)->iv); }
+
+/*
+ * Add a string to the character array and return its index.
+ */
+static int inca(struct s_base *fp, const char *str)
 {
-    SYM_NONE = 0,
+    int ai = fp->ac;
+    int i;
 
-    SYM_PATH,
-    SYM_TARG,
+    do
+    {
+        i = inc(&MAPC(fp)->av);
+        fp->av[i] = *str;
+    }
+    while (*str++);
 
-    SYM_MAX
-};
+    return ai;
+}
 
-struct sym
+#define ALLOC(a, v, c) alloc_new((a), sizeof (*(v)), (void **) &(v), &(c))
+
+static void init_file(struct s_base *fp)
 {
-    int  type;
-    char name[MAXSTR];
-    int  val;
-};
+    struct mapc *mc = MAPC(fp);
+
+    ALLOC(&mc->mv, fp->mv, fp->mc);
+    ALLOC(&mc->vv, fp->vv, fp->vc);
+    ALLOC(&mc->ev, fp->ev, fp->ec);
+    ALLOC(&mc->sv, fp->sv, fp->sc);
+    ALLOC(&mc->tv, fp->tv, fp->tc);
+    ALLOC(&mc->ov, fp->ov, fp->oc);
+    ALLOC(&mc->gv, fp->gv, fp->gc);
+    ALLOC(&mc->lv, fp->lv, fp->lc);
+    ALLOC(&mc->nv, fp->nv, fp->nc);
+    ALLOC(&mc->pv, fp->pv, fp->pc);
+    ALLOC(&mc->bv, fp->bv, fp->bc);
+    ALLOC(&mc->hv, fp->hv, fp->hc);
+    ALLOC(&mc->zv, fp->zv, fp->zc);
+    ALLOC(&mc->jv, fp->jv, fp->jc);
+    ALLOC(&mc->xv, fp->xv, fp->xc);
+    ALLOC(&mc->rv, fp->rv, fp->rc);
+    ALLOC(&mc->uv, fp->uv, fp->uc);
+    ALLOC(&mc->wv, fp->wv, fp->wc);
+    ALLOC(&mc->dv, fp->dv, fp->dc);
+    ALLOC(&mc->av, fp->av, fp->ac);
+    ALLOC(&mc->iv, fp->iv, fp->ic);
+
+    ALLOC(&mc->syms_alloc,    mc->syms,    mc->symc);
+    ALLOC(&mc->refs_alloc,    mc->refs,    mc->refc);
+    ALLOC(&mc->targ_p_alloc,  mc->targ_p,  mc->targ_n);
+    ALLOC(&mc->targ_wi_alloc, mc->targ_wi, mc->targ_wc);
+    ALLOC(&mc->targ_ji_alloc, mc->targ_ji, mc->targ_jc);
+    ALLOC(&mc->planes_alloc,  mc->planes,  mc->planec);
+}
 
-struct ref
+/*
+ * Release the compiler's own arrays.  The SOL arrays go with the file.
+ */
+static void free_file(struct s_base *fp)
 {
-    int  type;
-    char name[MAXSTR];
-    int *ptr;
-};
+    struct mapc *mc = MAPC(fp);
+
+    alloc_free(&mc->syms_alloc);
+    alloc_free(&mc->refs_alloc);
+    alloc_free(&mc->targ_p_alloc);
+    alloc_free(&mc->targ_wi_alloc);
+    alloc_free(&mc->targ_ji_alloc);
+    alloc_free(&mc->planes_alloc);
 
-static struct sym syms[MAXSYM];
-static struct ref refs[MAXSYM];
+    sol_free_base(fp);
+}
 
-static int symc;
-static int refc;
+/*---------------------------------------------------------------------------*/
 
-static void make_sym(int type, const char *name, int val)
+static void make_sym(struct s_base *fp, int type, const char *name, int val)
 {
-    if (symc < MAXSYM - 1)
-    {
-        struct sym *sym = &syms[symc];
-
-        sym->type = type;
-        strncpy(sym->name, name, MAXSTR - 1);
-        sym->val = val;
+    struct mapc *mc = MAPC(fp);
+    int          si = inc(&mc->syms_alloc);
+    struct sym *sym = mc->syms + si;
 
-        symc++;
-    }
+    sym->type = type;
+    strncpy(sym->name, name, MAXSTR - 1);
+    sym->val = val;
 }
 
-static void make_ref(int type, const char *name, int *ptr)
+/*
+ * Add a reference to the int at PTR, which lies in the array at *BASE.
+ */
+static void make_ref(struct s_base *fp, int type, const char *name,
+                     void **base, int *ptr)
 {
-    if (refc < MAXSYM - 1)
-    {
-        struct ref *ref = &refs[refc];
+    struct mapc *mc = MAPC(fp);
+    int          ri = inc(&mc->refs_alloc);
+    struct ref *ref = mc->refs + ri;
 
-        ref->type = type;
-        strncpy(ref->name, name, MAXSTR - 1);
-        ref->ptr = ptr;
-
-        refc++;
-    }
+    ref->type = type;
+    strncpy(ref->name, name, MAXSTR - 1);
+    ref->base = base;
+    ref->off  = (unsigned char *) ptr - (unsigned char *) *base;
 }
 
-static void resolve(void)
+static void resolve(struct s_base *fp)
 {
+    struct mapc *mc = MAPC(fp);
+
     int i, j;
 
-    for (i = 0; i < refc; i++)
-        for (j = 0; j < symc; j++)
+    for (i = 0; i < mc->refc; i++)
+        for (j = 0; j < mc->symc; j++)
         {
-            struct ref *ref = &refs[i];
-            struct sym *sym = &syms[j];
+            struct ref *ref = &mc->refs[i];
+            struct sym *sym = &mc->syms[j];
 
             if (ref->type == sym->type && strcmp(ref->name, sym->name) == 0)
             {
-                *(ref->ptr) = sym->val;
+                *(int *) ((unsigned char *) *ref->base + ref->off) = sym->val;
                 break;
             }
         }
@@ -486,25 +494,19 @@ static void resolve(void)
 
 /*---------------------------------------------------------------------------*/
 
-/*
- * The following globals are used to cache target_positions.  They are
- * targeted by various entities and must be resolved in a second pass.
- */
-
-static float targ_p [MAXW][3];
-static int   targ_wi[MAXW];
-static int   targ_ji[MAXW];
-static int   targ_n;
-
 static void targets(struct s_base *fp)
 {
+    struct mapc *mc = MAPC(fp);
+
     int i;
 
     for (i = 0; i < fp->wc; i++)
-        v_cpy(fp->wv[i].q, targ_p[targ_wi[i]]);
+        if (mc->targ_wi[i] < mc->targ_n)
+            v_cpy(fp->wv[i].q, mc->targ_p[mc->targ_wi[i]]);
 
     for (i = 0; i < fp->jc; i++)
-        v_cpy(fp->jv[i].q, targ_p[targ_ji[i]]);
+        if (mc->targ_ji[i] < mc->targ_n)
+            v_cpy(fp->jv[i].q, mc->targ_p[mc->targ_ji[i]]);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -526,6 +528,12 @@ static struct _imagedata *imagedata = NULL;
 static int image_n = 0;
 static int image_alloc = 0;
 
+/*
+ * Maps in a batch share the cache.  The lock is held only to look up
+ * or add an entry, never while an image loads.
+ */
+static SDL_mutex *image_lock;
+
 #define IMAGE_REALLOC 32
 
 static void free_imagedata()
@@ -554,9 +562,8 @@ static int size_load(const char *file, int *w, int *h)
     return 0;
 }
 
-static void size_image(const char *name, int *w, int *h)
+static int size_find(const char *name, int *w, int *h)
 {
-    char path[MAXSTR];
     int i;
 
     if (imagedata)
@@ -566,9 +573,24 @@ static void size_image(const char *name, int *w, int *h)
                 *w = imagedata[i].w;
                 *h = imagedata[i].h;
 
-                return;
+                return 1;
             }
 
+    return 0;
+}
+
+static void size_image(const char *name, int *w, int *h)
+{
+    char path[MAXSTR];
+    int i, found;
+
+    if (image_lock) SDL_mutexP(image_lock);
+    found = size_find(name, w, h);
+    if (image_lock) SDL_mutexV(image_lock);
+
+    if (found)
+        return;
+
     *w = 0;
     *h = 0;
 
@@ -582,30 +604,39 @@ static void size_image(const char *name, int *w, int *h)
 
     if (*w > 0 && *h > 0)
     {
-        if (image_n + 1 >= image_alloc)
+        if (image_lock) SDL_mutexP(image_lock);
+
+        /* Another map may have got here first. */
+
+        if (!size_find(name, w, h))
         {
-            struct _imagedata *tmp =
-                (struct _imagedata *) malloc(sizeof(struct _imagedata) * (image_alloc + IMAGE_REALLOC));
-            if (!tmp)
-            {
-                printf("malloc error\n");
-                exit(1);
-            }
-            if (imagedata)
+            if (image_n + 1 >= image_alloc)
             {
-                (void) memcpy(tmp, imagedata, sizeof(struct _imagedata) * image_alloc);
-                free(imagedata);
+                struct _imagedata *tmp =
+                    (struct _imagedata *) malloc(sizeof(struct _imagedata) * (image_alloc + IMAGE_REALLOC));
+                if (!tmp)
+                {
+                    printf("malloc error\n");
+                    exit(1);
+                }
+                if (imagedata)
+                {
+                    (void) memcpy(tmp, imagedata, sizeof(struct _imagedata) * image_alloc);
+                    free(imagedata);
+                }
+                imagedata = tmp;
+                image_alloc += IMAGE_REALLOC;
             }
-            imagedata = tmp;
-            image_alloc += IMAGE_REALLOC;
-        }
 
-        imagedata[image_n].s = (char *) calloc(strlen(name) + 1, 1);
-        imagedata[image_n].w = *w;
-        imagedata[image_n].h = *h;
-        strcpy(imagedata[image_n].s, name);
+            imagedata[image_n].s = (char *) calloc(strlen(name) + 1, 1);
+            imagedata[image_n].w = *w;
+            imagedata[image_n].h = *h;
+            strcpy(imagedata[image_n].s, name);
+
+            image_n++;
+        }
 
-        image_n++;
+        if (image_lock) SDL_mutexV(image_lock);
     }
 }
 
@@ -615,7 +646,9 @@ static void size_image(const char *name, int *w, int *h)
 
 static int read_mtrl(struct s_base *fp, const char *name)
 {
-    static char buf [MAXSTR];
+    struct mapc *mc = MAPC(fp);
+
+    char buf[MAXSTR];
 
     struct b_mtrl *mp;
     int mi;
@@ -624,11 +657,12 @@ static int read_mtrl(struct s_base *fp, const char *name)
         if (strncmp(name, fp->mv[mi].f, MAXSTR) == 0)
             return mi;
 
-    mp = fp->mv + incm(fp);
+    mi = incm(fp);
+    mp = fp->mv + mi;
 
     if (!mtrl_read(mp, name))
     {
-        SAFECPY(buf, input_file);
+        SAFECPY(buf, mc->input_file);
         SAFECAT(buf, ": unknown material \"");
         SAFECAT(buf, name);
         SAFECAT(buf, "\"\n");
@@ -727,21 +761,24 @@ static void move_file(struct s_base *fp)
 
 static void read_vt(struct s_base *fp, const char *line)
 {
-    struct b_texc *tp = fp->tv + inct(fp);
+    const int ti = inct(fp);
+    struct b_texc *tp = fp->tv + ti;
 
     sscanf(line, "%f %f", tp->u, tp->u + 1);
 }
 
 static void read_vn(struct s_base *fp, const char *line)
 {
-    struct b_side *sp = fp->sv + incs(fp);
+    const int si = incs(fp);
+    struct b_side *sp = fp->sv + si;
 
     sscanf(line, "%f %f %f", sp->n, sp->n + 1, sp->n + 2);
 }
 
 static void read_v(struct s_base *fp, const char *line)
 {
-    struct b_vert *vp = fp->vv + incv(fp);
+    const int vi = incv(fp);
+    struct b_vert *vp = fp->vv + vi;
 
     sscanf(line, "%f %f %f", vp->p, vp->p + 1, vp->p + 2);
 }
@@ -749,11 +786,16 @@ static void read_v(struct s_base *fp, const char *line)
 static void read_f(struct s_base *fp, const char *line,
                    int v0, int t0, int s0, int mi)
 {
-    struct b_geom *gp = fp->gv + incg(fp);
+    const int gi = incg(fp);
+    const int oi = inco(fp);
+    const int oj = inco(fp);
+    const int ok = inco(fp);
+
+    struct b_geom *gp = fp->gv + gi;
 
-    struct b_offs *op = fp->ov + (gp->oi = inco(fp));
-    struct b_offs *oq = fp->ov + (gp->oj = inco(fp));
-    struct b_offs *or = fp->ov + (gp->ok = inco(fp));
+    struct b_offs *op = fp->ov + (gp->oi = oi);
+    struct b_offs *oq = fp->ov + (gp->oj = oj);
+    struct b_offs *or = fp->ov + (gp->ok = ok);
 
     char c1;
     char c2;
@@ -812,15 +854,8 @@ static void read_obj(struct s_base *fp, const char *name, int mi)
 
 /*---------------------------------------------------------------------------*/
 
-static float plane_d[MAXS];
-static float plane_n[MAXS][3];
-static float plane_p[MAXS][3];
-static float plane_u[MAXS][3];
-static float plane_v[MAXS][3];
-static int   plane_f[MAXS];
-static int   plane_m[MAXS];
-
-static void make_plane(int   pi, float x0, float y0, float      z0,
+static void make_plane(struct s_base *fp, int pi,
+                       float x0, float y0, float z0,
                        float x1, float y1, float z1,
                        float x2, float y2, float z2,
                        float tu, float tv, float r,
@@ -835,6 +870,9 @@ static void make_plane(int   pi, float x0, float y0, float      z0,
         {{  0, -1,  0 }, {  1,  0,  0 }, {  0,  0, -1 }},
     };
 
+    struct mapc  *mc = MAPC(fp);
+    struct plane *pp;
+
     float R[16];
     float p0[3], p1[3], p2[3];
     float u[3],  v[3],  p[3];
@@ -842,9 +880,19 @@ static void make_plane(int   pi, float x0, float y0, float      z0,
     int   i, n = 0;
     int   w, h;
 
+    /* A plane outside of a lump belongs to no side. */
+
+    if (pi < 0)
+        return;
+
+    while (mc->planec <= pi)
+        inc(&mc->planes_alloc);
+
+    pp = mc->planes + pi;
+
     size_image(s, &w, &h);
 
-    plane_f[pi] = fl ? L_DETAIL : 0;
+    pp->f = fl ? L_DETAIL : 0;
 
     p0[0] = +x0 / SCALE;
     p0[1] = +z0 / SCALE;
@@ -861,13 +909,13 @@ static void make_plane(int   pi, float x0, float y0, float      z0,
     v_sub(u, p0, p1);
     v_sub(v, p2, p1);
 
-    v_crs(plane_n[pi], u, v);
-    v_nrm(plane_n[pi], plane_n[pi]);
+    v_crs(pp->n, u, v);
+    v_nrm(pp->n, pp->n);
 
-    plane_d[pi] = v_dot(plane_n[pi], p1);
+    pp->d = v_dot(pp->n, p1);
 
     for (i = 0; i < 6; i++)
-        if ((k = v_dot(plane_n[pi], base[i][0])) >= d)
+        if ((k = v_dot(pp->n, base[i][0])) >= d)
         {
             d = k;
             n = i;
@@ -884,15 +932,15 @@ static void make_plane(int   pi, float x0, float y0, float      z0,
     v_mad(p, p, base[n][1], +su * tu / SCALE);
     v_mad(p, p, base[n][2], -sv * tv / SCALE);
 
-    m_vxfm(plane_u[pi], R, base[n][1]);
-    m_vxfm(plane_v[pi], R, base[n][2]);
-    m_vxfm(plane_p[pi], R, p);
+    m_vxfm(pp->u, R, base[n][1]);
+    m_vxfm(pp->v, R, base[n][2]);
+    m_vxfm(pp->p, R, p);
 
-    v_scl(plane_u[pi], plane_u[pi], 64.f / w);
-    v_scl(plane_v[pi], plane_v[pi], 64.f / h);
+    v_scl(pp->u, pp->u, 64.f / w);
+    v_scl(pp->v, pp->v, 64.f / h);
 
-    v_scl(plane_u[pi], plane_u[pi], 1.f / su);
-    v_scl(plane_v[pi], plane_v[pi], 1.f / sv);
+    v_scl(pp->u, pp->u, 1.f / su);
+    v_scl(pp->v, pp->v, 1.f / sv);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -904,7 +952,30 @@ static void make_plane(int   pi, float x0, float y0, float      z0,
 #define T_END 4
 #define T_NOP 5
 
-static int map_token(fs_file fin, int pi, char key[MAXSTR], char val[MAXSTR])
+/*
+ * Split the next token off  of *S.  This is strtok without the hidden
+ * state, as maps in a batch are read concurrently.
+ */
+static char *map_field(char **s, const char *delim)
+{
+    char *p = *s + strspn(*s, delim);
+
+    if (*p == 0)
+    {
+        *s = p;
+        return NULL;
+    }
+
+    *s = p + strcspn(p, delim);
+
+    if (**s)
+        *(*s)++ = 0;
+
+    return p;
+}
+
+static int map_token(struct s_base *fp, fs_file fin, int pi,
+                     char key[MAXSTR], char val[MAXSTR])
 {
     char buf[MAXSTR];
 
@@ -927,9 +998,11 @@ static int map_token(fs_file fin, int pi, char key[MAXSTR], char val[MAXSTR])
 
         if (buf[0] == '\"')
         {
-            strcpy(key, strtok(buf,  "\""));
-            (void)      strtok(NULL, "\"");
-            strcpy(val, strtok(NULL, "\""));
+            char *s = buf;
+
+            strcpy(key, map_field(&s, "\""));
+            (void)      map_field(&s, "\"");
+            strcpy(val, map_field(&s, "\""));
 
             return T_KEY;
         }
@@ -946,7 +1019,7 @@ static int map_token(fs_file fin, int pi, char key[MAXSTR], char val[MAXSTR])
                    &c, &x2, &y2, &z2, &c,
                    key, &tu, &tv, &r, &su, &sv, &fl) == 22)
         {
-            make_plane(pi, x0, y0, z0,
+            make_plane(fp, pi, x0, y0, z0,
                        x1, y1, z1,
                        x2, y2, z2,
                        tu, tv, r, su, sv, fl, key);
@@ -966,28 +1039,32 @@ static int map_token(fs_file fin, int pi, char key[MAXSTR], char val[MAXSTR])
 
 static void read_lump(struct s_base *fp, fs_file fin)
 {
+    struct mapc *mc = MAPC(fp);
+
     char k[MAXSTR];
     char v[MAXSTR];
     int t;
 
-    struct b_lump *lp = fp->lv + incl(fp);
+    const int li = incl(fp);
+    struct b_lump *lp = fp->lv + li;
 
     lp->s0 = fp->ic;
 
-    while ((t = map_token(fin, fp->sc, k, v)))
+    while ((t = map_token(fp, fin, fp->sc, k, v)))
     {
         if (t == T_CLP)
         {
-            fp->sv[fp->sc].n[0] = plane_n[fp->sc][0];
-            fp->sv[fp->sc].n[1] = plane_n[fp->sc][1];
-            fp->sv[fp->sc].n[2] = plane_n[fp->sc][2];
-            fp->sv[fp->sc].d    = plane_d[fp->sc];
+            const int ii = inci(fp);
+            const int si = incs(fp);
 
-            plane_m[fp->sc] = read_mtrl(fp, k);
+            fp->sv[si].n[0] = mc->planes[si].n[0];
+            fp->sv[si].n[1] = mc->planes[si].n[1];
+            fp->sv[si].n[2] = mc->planes[si].n[2];
+            fp->sv[si].d    = mc->planes[si].d;
 
-            fp->iv[fp->ic] = fp->sc;
-            inci(fp);
-            incs(fp);
+            mc->planes[si].m = read_mtrl(fp, k);
+
+            fp->iv[ii] = si;
             lp->sc++;
         }
         if (t == T_END)
@@ -1016,10 +1093,10 @@ static void make_path(struct s_base *fp,
     for (i = 0; i < c; i++)
     {
         if (strcmp(k[i], "targetname") == 0)
-            make_sym(SYM_PATH, v[i], pi);
+            make_sym(fp, SYM_PATH, v[i], pi);
 
         if (strcmp(k[i], "target") == 0)
-            make_ref(SYM_PATH, v[i], &pp->pi);
+            make_ref(fp, SYM_PATH, v[i], (void **) &fp->pv, &pp->pi);
 
         if (strcmp(k[i], "state") == 0)
             pp->f = atoi(v[i]);
@@ -1092,33 +1169,20 @@ static void make_dict(struct s_base *fp,
                       const char *k,
                       const char *v)
 {
-    int space_left, space_needed, di = incd(fp);
-
-    struct b_dict *dp = fp->dv + di;
-
-    space_left   = MAXA - fp->ac;
-    space_needed = strlen(k) + 1 + strlen(v) + 1;
-
-    if (space_needed > space_left)
-    {
-        fp->dc--;
-        return;
-    }
-
-    dp->ai = fp->ac;
-    dp->aj = dp->ai + strlen(k) + 1;
-    fp->ac = dp->aj + strlen(v) + 1;
+    const int di = incd(fp);
+    const int ai = inca(fp, k);
+    const int aj = inca(fp, v);
 
-    strncpy(fp->av + dp->ai, k, space_left);
-    strncpy(fp->av + dp->aj, v, space_left - strlen(k) - 1);
+    fp->dv[di].ai = ai;
+    fp->dv[di].aj = aj;
 }
 
-static int read_dict_entries = 0;
-
 static void make_body(struct s_base *fp,
                       char k[][MAXSTR],
                       char v[][MAXSTR], int c, int l0)
 {
+    struct mapc *mc = MAPC(fp);
+
     int i, mi = 0, bi = incb(fp);
 
     int g0 = fp->gc;
@@ -1139,10 +1203,10 @@ static void make_body(struct s_base *fp,
     for (i = 0; i < c; i++)
     {
         if (strcmp(k[i], "target") == 0 || strcmp(k[i], "target1") == 0)
-            make_ref(SYM_PATH, v[i], &bp->pi);
+            make_ref(fp, SYM_PATH, v[i], (void **) &fp->bv, &bp->pi);
 
         else if (strcmp(k[i], "target2") == 0)
-            make_ref(SYM_PATH, v[i], &bp->pj);
+            make_ref(fp, SYM_PATH, v[i], (void **) &fp->bv, &bp->pj);
 
         else if (strcmp(k[i], "material") == 0)
             mi = read_mtrl(fp, v[i]);
@@ -1153,7 +1217,7 @@ static void make_body(struct s_base *fp,
         else if (strcmp(k[i], "origin") == 0)
             sscanf(v[i], "%f %f %f", &x, &y, &z);
 
-        else if (read_dict_entries && strcmp(k[i], "classname") != 0)
+        else if (mc->read_dict_entries && strcmp(k[i], "classname") != 0)
             make_dict(fp, k[i], v[i]);
     }
 
@@ -1163,7 +1227,10 @@ static void make_body(struct s_base *fp,
     bp->gc = fp->gc - g0;
 
     for (i = 0; i < bp->gc; i++)
-        fp->iv[inci(fp)] = g0++;
+    {
+        const int ii = inci(fp);
+        fp->iv[ii] = g0++;
+    }
 
     p[0] = +x / SCALE;
     p[1] = +z / SCALE;
@@ -1172,7 +1239,7 @@ static void make_body(struct s_base *fp,
     for (i = v0; i < fp->vc; i++)
         v_add(fp->vv[i].p, fp->vv[i].p, p);
 
-    read_dict_entries = 0;
+    mc->read_dict_entries = 0;
 }
 
 static void make_item(struct s_base *fp,
@@ -1304,10 +1371,14 @@ static void make_view(struct s_base *fp,
                       char k[][MAXSTR],
                       char v[][MAXSTR], int c)
 {
+    struct mapc *mc = MAPC(fp);
+
     int i, wi = incw(fp);
 
     struct b_view *wp = fp->wv + wi;
 
+    inc(&mc->targ_wi_alloc);
+
     wp->p[0] = 0.f;
     wp->p[1] = 0.f;
     wp->p[2] = 0.f;
@@ -1318,7 +1389,8 @@ static void make_view(struct s_base *fp,
     for (i = 0; i < c; i++)
     {
         if (strcmp(k[i], "target") == 0)
-            make_ref(SYM_TARG, v[i], targ_wi + wi);
+            make_ref(fp, SYM_TARG, v[i], (void **) &mc->targ_wi,
+                     mc->targ_wi + wi);
 
         if (strcmp(k[i], "origin") == 0)
         {
@@ -1337,10 +1409,14 @@ static void make_jump(struct s_base *fp,
                       char k[][MAXSTR],
                       char v[][MAXSTR], int c)
 {
+    struct mapc *mc = MAPC(fp);
+
     int i, ji = incj(fp);
 
     struct b_jump *jp = fp->jv + ji;
 
+    inc(&mc->targ_ji_alloc);
+
     jp->p[0] = 0.f;
     jp->p[1] = 0.f;
     jp->p[2] = 0.f;
@@ -1355,7 +1431,8 @@ static void make_jump(struct s_base *fp,
             sscanf(v[i], "%f", &jp->r);
 
         if (strcmp(k[i], "target") == 0)
-            make_ref(SYM_TARG, v[i], targ_ji + ji);
+            make_ref(fp, SYM_TARG, v[i], (void **) &mc->targ_ji,
+                     mc->targ_ji + ji);
 
         if (strcmp(k[i], "origin") == 0)
         {
@@ -1393,7 +1470,7 @@ static void make_swch(struct s_base *fp,
             sscanf(v[i], "%f", &xp->r);
 
         if (strcmp(k[i], "target") == 0)
-            make_ref(SYM_PATH, v[i], &xp->pi);
+            make_ref(fp, SYM_PATH, v[i], (void **) &fp->xv, &xp->pi);
 
         if (strcmp(k[i], "timer") == 0)
             sscanf(v[i], "%f", &xp->t);
@@ -1421,16 +1498,18 @@ static void make_targ(struct s_base *fp,
                       char k[][MAXSTR],
                       char v[][MAXSTR], int c)
 {
-    int i;
+    struct mapc *mc = MAPC(fp);
+
+    int i, ti = inc(&mc->targ_p_alloc);
 
-    targ_p[targ_n][0] = 0.f;
-    targ_p[targ_n][1] = 0.f;
-    targ_p[targ_n][2] = 0.f;
+    mc->targ_p[ti][0] = 0.f;
+    mc->targ_p[ti][1] = 0.f;
+    mc->targ_p[ti][2] = 0.f;
 
     for (i = 0; i < c; i++)
     {
         if (strcmp(k[i], "targetname") == 0)
-            make_sym(SYM_TARG, v[i], targ_n);
+            make_sym(fp, SYM_TARG, v[i], ti);
 
         if (strcmp(k[i], "origin") == 0)
         {
@@ -1438,13 +1517,11 @@ static void make_targ(struct s_base *fp,
 
             sscanf(v[i], "%f %f %f", &x, &y, &z);
 
-            targ_p[targ_n][0] = +x / SCALE;
-            targ_p[targ_n][1] = +z / SCALE;
-            targ_p[targ_n][2] = -y / SCALE;
+            mc->targ_p[ti][0] = +x / SCALE;
+            mc->targ_p[ti][1] = +z / SCALE;
+            mc->targ_p[ti][2] = -y / SCALE;
         }
     }
-
-    targ_n++;
 }
 
 static void make_ball(struct s_base *fp,
@@ -1484,13 +1561,15 @@ static void make_ball(struct s_base *fp,
 
 static void read_ent(struct s_base *fp, fs_file fin)
 {
+    struct mapc *mc = MAPC(fp);
+
     char k[MAXKEY][MAXSTR];
     char v[MAXKEY][MAXSTR];
     int t, i = 0, c = 0;
 
     int l0 = fp->lc;
 
-    while ((t = map_token(fin, -1, k[c], v[c])))
+    while ((t = map_token(fp, fin, -1, k[c], v[c])))
     {
         if (t == T_KEY)
         {
@@ -1515,7 +1594,7 @@ static void read_ent(struct s_base *fp, fs_file fin)
     if (!strcmp(v[i], "target_position"))          make_targ(fp, k, v, c);
     if (!strcmp(v[i], "worldspawn"))
     {
-        read_dict_entries = 1;
+        mc->read_dict_entries = 1;
         make_body(fp, k, v, c, l0);
     }
     if (!strcmp(v[i], "func_train"))               make_body(fp, k, v, c, l0);
@@ -1528,7 +1607,7 @@ static void read_map(struct s_base *fp, fs_file fin)
     char v[MAXSTR];
     int t;
 
-    while ((t = map_token(fin, -1, k, v)))
+    while ((t = map_token(fp, fin, -1, k, v)))
         if (t == T_BEG)
             read_ent(fp, fin);
 }
@@ -1618,11 +1697,12 @@ static void clip_vert(struct s_base *fp,
 
         if (ok_vert(fp, lp, p))
         {
-            v_cpy(fp->vv[fp->vc].p, p);
+            const int ii = inci(fp);
+            const int vi = incv(fp);
 
-            fp->iv[fp->ic] = fp->vc;
-            inci(fp);
-            incv(fp);
+            v_cpy(fp->vv[vi].p, p);
+
+            fp->iv[ii] = vi;
             lp->vc++;
         }
     }
@@ -1653,13 +1733,13 @@ static void clip_edge(struct s_base *fp,
             if (on_side(fp->vv[vj].p, fp->sv + si) &&
                 on_side(fp->vv[vj].p, fp->sv + sj))
             {
-                fp->ev[fp->ec].vi = vi;
-                fp->ev[fp->ec].vj = vj;
+                const int ii = inci(fp);
+                const int ei = ince(fp);
 
-                fp->iv[fp->ic] = fp->ec;
+                fp->ev[ei].vi = vi;
+                fp->ev[ei].vj = vj;
 
-                inci(fp);
-                ince(fp);
+                fp->iv[ii] = ei;
                 lp->ec++;
             }
         }
@@ -1674,6 +1754,8 @@ static void clip_edge(struct s_base *fp,
 static void clip_geom(struct s_base *fp,
                       struct b_lump *lp, int si)
 {
+    struct mapc *mc = MAPC(fp);
+
     int   m[256], t[256], d, i, j, n = 0;
     float u[3];
     float v[3];
@@ -1692,10 +1774,10 @@ static void clip_geom(struct s_base *fp,
             m[n] = vi;
             t[n] = inct(fp);
 
-            v_add(v, fp->vv[vi].p, plane_p[si]);
+            v_add(v, fp->vv[vi].p, mc->planes[si].p);
 
-            fp->tv[t[n]].u[0] = v_dot(v, plane_u[si]);
-            fp->tv[t[n]].u[1] = v_dot(v, plane_v[si]);
+            fp->tv[t[n]].u[0] = v_dot(v, mc->planes[si].u);
+            fp->tv[t[n]].u[1] = v_dot(v, mc->planes[si].v);
 
             n++;
         }
@@ -1727,14 +1809,18 @@ static void clip_geom(struct s_base *fp,
     for (i = 0; i < n - 2; i++)
     {
         const int gi = incg(fp);
+        const int oi = inco(fp);
+        const int oj = inco(fp);
+        const int ok = inco(fp);
+        const int ii = inci(fp);
 
         struct b_geom *gp = fp->gv + gi;
 
-        struct b_offs *op = fp->ov + (gp->oi = inco(fp));
-        struct b_offs *oq = fp->ov + (gp->oj = inco(fp));
-        struct b_offs *or = fp->ov + (gp->ok = inco(fp));
+        struct b_offs *op = fp->ov + (gp->oi = oi);
+        struct b_offs *oq = fp->ov + (gp->oj = oj);
+        struct b_offs *or = fp->ov + (gp->ok = ok);
 
-        gp->mi = plane_m[si];
+        gp->mi = mc->planes[si].m;
 
         op->ti = t[0];
         oq->ti = t[i + 1];
@@ -1748,9 +1834,8 @@ static void clip_geom(struct s_base *fp,
         oq->vi = m[i + 1];
         or->vi = m[i + 2];
 
-        fp->iv[fp->ic] = gi;
+        fp->iv[ii] = gi;
         lp->gc++;
-        inci(fp);
     }
 }
 
@@ -1761,6 +1846,8 @@ static void clip_geom(struct s_base *fp,
  */
 static void clip_lump(struct s_base *fp, struct b_lump *lp)
 {
+    struct mapc *mc = MAPC(fp);
+
     int i, j, k;
 
     lp->v0 = fp->ic;
@@ -1787,12 +1874,12 @@ static void clip_lump(struct s_base *fp, struct b_lump *lp)
     lp->gc = 0;
 
     for (i = 0; i < lp->sc; i++)
-        if (fp->mv[plane_m[fp->iv[lp->s0 + i]]].d[3] > 0.0f)
+        if (fp->mv[mc->planes[fp->iv[lp->s0 + i]].m].d[3] > 0.0f)
             clip_geom(fp, lp,
                       fp->iv[lp->s0 + i]);
 
     for (i = 0; i < lp->sc; i++)
-        if (plane_f[fp->iv[lp->s0 + i]])
+        if (mc->planes[fp->iv[lp->s0 + i]].f)
             lp->fl |= L_DETAIL;
 }
 
@@ -1814,8 +1901,10 @@ static void clip_file(struct s_base *fp)
  * the number of elements that can be eliminated.
  */
 
-static int comp_mtrl(const struct b_mtrl *mp, const struct b_mtrl *mq)
+static int comp_mtrl(const void *p, const void *q)
 {
+    const struct b_mtrl *mp = p, *mq = q;
+
     if (fabsf(mp->d[0] - mq->d[0]) > SMALL) return 0;
     if (fabsf(mp->d[1] - mq->d[1]) > SMALL) return 0;
     if (fabsf(mp->d[2] - mq->d[2]) > SMALL) return 0;
@@ -1843,8 +1932,10 @@ static int comp_mtrl(const struct b_mtrl *mp, const struct b_mtrl *mq)
     return 1;
 }
 
-static int comp_vert(const struct b_vert *vp, const struct b_vert *vq)
+static int comp_vert(const void *p, const void *q)
 {
+    const struct b_vert *vp = p, *vq = q;
+
     if (fabsf(vp->p[0] - vq->p[0]) > SMALL) return 0;
     if (fabsf(vp->p[1] - vq->p[1]) > SMALL) return 0;
     if (fabsf(vp->p[2] - vq->p[2]) > SMALL) return 0;
@@ -1852,32 +1943,40 @@ static int comp_vert(const struct b_vert *vp, const struct b_vert *vq)
     return 1;
 }
 
-static int comp_edge(const struct b_edge *ep, const struct b_edge *eq)
+static int comp_edge(const void *p, const void *q)
 {
+    const struct b_edge *ep = p, *eq = q;
+
     if (ep->vi != eq->vi && ep->vi != eq->vj) return 0;
     if (ep->vj != eq->vi && ep->vj != eq->vj) return 0;
 
     return 1;
 }
 
-static int comp_side(const struct b_side *sp, const struct b_side *sq)
+static int comp_side(const void *p, const void *q)
 {
+    const struct b_side *sp = p, *sq = q;
+
     if (fabsf(sp->d - sq->d) > SMALL) return 0;
     if (v_dot(sp->n,  sq->n) < 1.0f)  return 0;
 
     return 1;
 }
 
-static int comp_texc(const struct b_texc *tp, const struct b_texc *tq)
+static int comp_texc(const void *p, const void *q)
 {
+    const struct b_texc *tp = p, *tq = q;
+
     if (fabsf(tp->u[0] - tq->u[0]) > SMALL) return 0;
     if (fabsf(tp->u[1] - tq->u[1]) > SMALL) return 0;
 
     return 1;
 }
 
-static int comp_offs(const struct b_offs *op, const struct b_offs *oq)
+static int comp_offs(const void *p, const void *q)
 {
+    const struct b_offs *op = p, *oq = q;
+
     if (op->ti != oq->ti) return 0;
     if (op->si != oq->si) return 0;
     if (op->vi != oq->vi) return 0;
@@ -1885,8 +1984,10 @@ static int comp_offs(const struct b_offs *op, const struct b_offs *oq)
     return 1;
 }
 
-static int comp_geom(const struct b_geom *gp, const struct b_geom *gq)
+static int comp_geom(const void *p, const void *q)
 {
+    const struct b_geom *gp = p, *gq = q;
+
     if (gp->mi != gq->mi) return 0;
     if (gp->oi != gq->oi) return 0;
     if (gp->oj != gq->oj) return 0;
@@ -1897,309 +1998,462 @@ static int comp_geom(const struct b_geom *gp, const struct b_geom *gq)
 
 /*---------------------------------------------------------------------------*/
 
-static int mtrl_swaps[MAXM];
-static int vert_swaps[MAXV];
-static int edge_swaps[MAXE];
-static int side_swaps[MAXS];
-static int texc_swaps[MAXT];
-static int offs_swaps[MAXO];
-static int geom_swaps[MAXG];
-
 /*
- * For each file  element type, replace all references  to element 'i'
- * with a  reference to element  'j'.  These are used  when optimizing
- * and sorting the file.
+ * For each body element type, compute the hash cell of element 'p'.
+ * Any element that compares equal to 'p' lies in the same cell or, for
+ * the quantized types, in a cell adjacent to it.  Return the number of
+ * coordinates, or zero if 'p' can't be placed in a cell.
  */
 
-static void swap_mtrl(struct s_base *fp, int mi, int mj)
+#define CELL_SIZE (2.0f * SMALL)        /* Twice the snapping distance     */
+#define CELL_NRML 0.05f                 /* Side normal quantum             */
+#define CELL_UNIT 0.0001f               /* Side normal length tolerance    */
+
+static int cell_of(int *c, float x, float size)
 {
-    int i;
+    float k = floorf(x / size);
 
-    for (i = 0; i < fp->gc; i++)
-        if (fp->gv[i].mi == mi) fp->gv[i].mi = mj;
-    for (i = 0; i < fp->rc; i++)
-        if (fp->rv[i].mi == mi) fp->rv[i].mi = mj;
+    if (k > -1.0e9f && k < 1.0e9f)
+    {
+        *c = (int) k;
+        return 1;
+    }
+    return 0;
 }
 
-static void swap_vert(struct s_base *fp, int vi, int vj)
+static int cell_mtrl(int *c, const void *p)
 {
-    int i, j;
+    const struct b_mtrl *mp = p;
+    unsigned int h = 0;
+    int i;
 
-    for (i = 0; i < fp->ec; i++)
-    {
-        if (fp->ev[i].vi == vi) fp->ev[i].vi = vj;
-        if (fp->ev[i].vj == vi) fp->ev[i].vj = vj;
-    }
+    /* Only the texture name is exact. */
 
-    for (i = 0; i < fp->oc; i++)
-        if (fp->ov[i].vi == vi) fp->ov[i].vi = vj;
+    for (i = 0; i < PATHMAX && mp->f[i]; i++)
+        h = h * 31 + (unsigned char) mp->f[i];
 
-    for (i = 0; i < fp->lc; i++)
-        for (j = 0; j < fp->lv[i].vc; j++)
-            if (fp->iv[fp->lv[i].v0 + j] == vi)
-                fp->iv[fp->lv[i].v0 + j]  = vj;
+    c[0] = (int) h;
+
+    return 1;
 }
 
-static void apply_mtrl_swaps(struct s_base *fp)
+static int cell_vert(int *c, const void *p)
 {
-    int i;
+    const struct b_vert *vp = p;
 
-    for (i = 0; i < fp->gc; i++)
-        fp->gv[i].mi = mtrl_swaps[fp->gv[i].mi];
-    for (i = 0; i < fp->rc; i++)
-        fp->rv[i].mi = mtrl_swaps[fp->rv[i].mi];
-}
+    if (cell_of(c + 0, vp->p[0], CELL_SIZE) &&
+        cell_of(c + 1, vp->p[1], CELL_SIZE) &&
+        cell_of(c + 2, vp->p[2], CELL_SIZE))
+        return 3;
 
+    return 0;
+}
 
-static void apply_vert_swaps(struct s_base *fp)
+static int cell_edge(int *c, const void *p)
 {
-    int i, j;
+    const struct b_edge *ep = p;
 
-    for (i = 0; i < fp->ec; i++)
-    {
-        fp->ev[i].vi = vert_swaps[fp->ev[i].vi];
-        fp->ev[i].vj = vert_swaps[fp->ev[i].vj];
-    }
+    /* A degenerate edge matches any edge that shares its vert. */
 
-    for (i = 0; i < fp->oc; i++)
-        fp->ov[i].vi = vert_swaps[fp->ov[i].vi];
+    if (ep->vi == ep->vj)
+        return 0;
+
+    c[0] = MIN(ep->vi, ep->vj);
+    c[1] = MAX(ep->vi, ep->vj);
+
+    return 2;
+}
+
+static int cell_side(int *c, const void *p)
+{
+    const struct b_side *sp = p;
+
+    /*
+     * Normals that pass the dot product test are within a few quanta
+     * of one another, but only if they are of unit length.
+     */
+
+    if (fabsf(v_dot(sp->n, sp->n) - 1.0f) > CELL_UNIT)
+        return 0;
+
+    if (cell_of(c + 0, sp->d,    CELL_SIZE) &&
+        cell_of(c + 1, sp->n[0], CELL_NRML) &&
+        cell_of(c + 2, sp->n[1], CELL_NRML) &&
+        cell_of(c + 3, sp->n[2], CELL_NRML))
+        return 4;
+
+    return 0;
+}
+
+static int cell_texc(int *c, const void *p)
+{
+    const struct b_texc *tp = p;
+
+    if (cell_of(c + 0, tp->u[0], CELL_SIZE) &&
+        cell_of(c + 1, tp->u[1], CELL_SIZE))
+        return 2;
+
+    return 0;
+}
+
+static int cell_offs(int *c, const void *p)
+{
+    const struct b_offs *op = p;
+
+    c[0] = op->ti;
+    c[1] = op->si;
+    c[2] = op->vi;
+
+    return 3;
+}
+
+static int cell_geom(int *c, const void *p)
+{
+    const struct b_geom *gp = p;
+
+    c[0] = gp->mi;
+    c[1] = gp->oi;
+    c[2] = gp->oj;
+    c[3] = gp->ok;
+
+    return 4;
+}
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * For each file  element type, replace all references  to element 'i'
+ * with a  reference to element  'j'.  These are used  when optimizing
+ * and sorting the file.
+ */
+
+static void swap_mtrl(struct s_base *fp, int mi, int mj)
+{
+    int i;
+
+    for (i = 0; i < fp->gc; i++)
+        if (fp->gv[i].mi == mi) fp->gv[i].mi = mj;
+    for (i = 0; i < fp->rc; i++)
+        if (fp->rv[i].mi == mi) fp->rv[i].mi = mj;
+}
+
+static void swap_vert(struct s_base *fp, int vi, int vj)
+{
+    int i, j;
+
+    for (i = 0; i < fp->ec; i++)
+    {
+        if (fp->ev[i].vi == vi) fp->ev[i].vi = vj;
+        if (fp->ev[i].vj == vi) fp->ev[i].vj = vj;
+    }
+
+    for (i = 0; i < fp->oc; i++)
+        if (fp->ov[i].vi == vi) fp->ov[i].vi = vj;
 
     for (i = 0; i < fp->lc; i++)
         for (j = 0; j < fp->lv[i].vc; j++)
-            fp->iv[fp->lv[i].v0 + j] = vert_swaps[fp->iv[fp->lv[i].v0 + j]];
+            if (fp->iv[fp->lv[i].v0 + j] == vi)
+                fp->iv[fp->lv[i].v0 + j]  = vj;
+}
+
+static void apply_mtrl_swaps(struct s_base *fp, const int *swaps)
+{
+    int i;
+
+    for (i = 0; i < fp->gc; i++)
+        fp->gv[i].mi = swaps[fp->gv[i].mi];
+    for (i = 0; i < fp->rc; i++)
+        fp->rv[i].mi = swaps[fp->rv[i].mi];
 }
 
-static void apply_edge_swaps(struct s_base *fp)
+
+static void apply_vert_swaps(struct s_base *fp, const int *swaps)
+{
+    int i, j;
+
+    for (i = 0; i < fp->ec; i++)
+    {
+        fp->ev[i].vi = swaps[fp->ev[i].vi];
+        fp->ev[i].vj = swaps[fp->ev[i].vj];
+    }
+
+    for (i = 0; i < fp->oc; i++)
+        fp->ov[i].vi = swaps[fp->ov[i].vi];
+
+    for (i = 0; i < fp->lc; i++)
+        for (j = 0; j < fp->lv[i].vc; j++)
+            fp->iv[fp->lv[i].v0 + j] = swaps[fp->iv[fp->lv[i].v0 + j]];
+}
+
+static void apply_edge_swaps(struct s_base *fp, const int *swaps)
 {
     int i, j;
 
     for (i = 0; i < fp->lc; i++)
         for (j = 0; j < fp->lv[i].ec; j++)
-            fp->iv[fp->lv[i].e0 + j] = edge_swaps[fp->iv[fp->lv[i].e0 + j]];
+            fp->iv[fp->lv[i].e0 + j] = swaps[fp->iv[fp->lv[i].e0 + j]];
 }
 
-static void apply_side_swaps(struct s_base *fp)
+static void apply_side_swaps(struct s_base *fp, const int *swaps)
 {
     int i, j;
 
     for (i = 0; i < fp->oc; i++)
-        fp->ov[i].si = side_swaps[fp->ov[i].si];
+        fp->ov[i].si = swaps[fp->ov[i].si];
     for (i = 0; i < fp->nc; i++)
-        fp->nv[i].si = side_swaps[fp->nv[i].si];
+        fp->nv[i].si = swaps[fp->nv[i].si];
 
     for (i = 0; i < fp->lc; i++)
         for (j = 0; j < fp->lv[i].sc; j++)
-            fp->iv[fp->lv[i].s0 + j] = side_swaps[fp->iv[fp->lv[i].s0 + j]];
+            fp->iv[fp->lv[i].s0 + j] = swaps[fp->iv[fp->lv[i].s0 + j]];
 }
 
-static void apply_texc_swaps(struct s_base *fp)
+static void apply_texc_swaps(struct s_base *fp, const int *swaps)
 {
     int i;
 
     for (i = 0; i < fp->oc; i++)
-        fp->ov[i].ti = texc_swaps[fp->ov[i].ti];
+        fp->ov[i].ti = swaps[fp->ov[i].ti];
 }
 
-static void apply_offs_swaps(struct s_base *fp)
+static void apply_offs_swaps(struct s_base *fp, const int *swaps)
 {
     int i;
 
     for (i = 0; i < fp->gc; i++)
     {
-        fp->gv[i].oi = offs_swaps[fp->gv[i].oi];
-        fp->gv[i].oj = offs_swaps[fp->gv[i].oj];
-        fp->gv[i].ok = offs_swaps[fp->gv[i].ok];
+        fp->gv[i].oi = swaps[fp->gv[i].oi];
+        fp->gv[i].oj = swaps[fp->gv[i].oj];
+        fp->gv[i].ok = swaps[fp->gv[i].ok];
     }
 }
 
-static void apply_geom_swaps(struct s_base *fp)
+static void apply_geom_swaps(struct s_base *fp, const int *swaps)
 {
     int i, j;
 
     for (i = 0; i < fp->lc; i++)
         for (j = 0; j < fp->lv[i].gc; j++)
-            fp->iv[fp->lv[i].g0 + j] = geom_swaps[fp->iv[fp->lv[i].g0 + j]];
+            fp->iv[fp->lv[i].g0 + j] = swaps[fp->iv[fp->lv[i].g0 + j]];
 
     for (i = 0; i < fp->bc; i++)
         for (j = 0; j < fp->bv[i].gc; j++)
-            fp->iv[fp->bv[i].g0 + j] = geom_swaps[fp->iv[fp->bv[i].g0 + j]];
+            fp->iv[fp->bv[i].g0 + j] = swaps[fp->iv[fp->bv[i].g0 + j]];
 }
 
 /*---------------------------------------------------------------------------*/
 
-static void uniq_mtrl(struct s_base *fp)
-{
-    int i, j, k = 0;
-
-    for (i = 0; i < fp->mc; i++)
-    {
-        for (j = 0; j < k; j++)
-            if (comp_mtrl(fp->mv + i, fp->mv + j))
-                break;
+/*
+ * Eliminate duplicates from the list of N elements of the given SIZE
+ * at V, noting in SWAPS the index each element ends up at.  Each is
+ * matched to the first earlier survivor that COMP finds equal, found
+ * by hashing the CELL of each survivor.  Survivors without a cell are
+ * compared against every element.  Return the new element count.
+ */
 
-        mtrl_swaps[i] = j;
+#define CELL_MAX 4
 
-        if (j == k)
-        {
-            if (i != k)
-                fp->mv[k] = fp->mv[i];
-            k++;
-        }
-    }
+static unsigned int cell_hash(const int *c, int n)
+{
+    unsigned int h = 2166136261u;
+    int i;
 
-    apply_mtrl_swaps(fp);
+    for (i = 0; i < n; i++)
+        h = (h ^ (unsigned int) c[i]) * 16777619u;
 
-    fp->mc = k;
+    return h ^ (h >> 16);
 }
 
-static void uniq_vert(struct s_base *fp)
+static int *alloc_swaps(int n)
 {
-    int i, j, k = 0;
+    int *swaps;
 
-    for (i = 0; i < fp->vc; i++)
+    if (!(swaps = malloc(MAX(n, 1) * sizeof (*swaps))))
     {
-        for (j = 0; j < k; j++)
-            if (comp_vert(fp->vv + i, fp->vv + j))
-                break;
-
-        vert_swaps[i] = j;
-
-        if (j == k)
-        {
-            if (i != k)
-                fp->vv[k] = fp->vv[i];
-            k++;
-        }
+        ERROR("out of memory\n");
+        exit(1);
     }
-
-    apply_vert_swaps(fp);
-
-    fp->vc = k;
+    return swaps;
 }
 
-static void uniq_edge(struct s_base *fp)
+static int uniq_list(void *v, size_t size, int n, int *swaps,
+                     int (*comp)(const void *, const void *),
+                     int (*cell)(int *, const void *), int quantized)
 {
+    char *p = v;
+
+    int *head;
+    int *next;
+    int *rest;
+    int  mask = 1;
+    int  rc   = 0;
+
     int i, j, k = 0;
 
-    for (i = 0; i < fp->ec; i++)
-    {
-        for (j = 0; j < k; j++)
-            if (comp_edge(fp->ev + i, fp->ev + j))
-                break;
+    while (mask < n * 2)
+        mask <<= 1;
 
-        edge_swaps[i] = j;
+    head = malloc(mask * sizeof (*head));
+    next = malloc(MAX(n, 1) * sizeof (*next));
+    rest = malloc(MAX(n, 1) * sizeof (*rest));
 
-        if (j == k)
-        {
-            if (i != k)
-                fp->ev[k] = fp->ev[i];
-            k++;
-        }
+    if (!head || !next || !rest)
+    {
+        ERROR("out of memory\n");
+        exit(1);
     }
 
-    apply_edge_swaps(fp);
-
-    fp->ec = k;
-}
+    memset(head, 0xff, mask * sizeof (*head));
 
-static void uniq_offs(struct s_base *fp)
-{
-    int i, j, k = 0;
+    mask -= 1;
 
-    for (i = 0; i < fp->oc; i++)
+    for (i = 0; i < n; i++)
     {
-        for (j = 0; j < k; j++)
-            if (comp_offs(fp->ov + i, fp->ov + j))
-                break;
+        const char *q = p + i * size;
 
-        offs_swaps[i] = j;
+        int c[CELL_MAX];
+        int d[CELL_MAX];
+        int cn = cell(c, q);
 
-        if (j == k)
+        j = k;
+
+        if (cn)
         {
-            if (i != k)
-                fp->ov[k] = fp->ov[i];
-            k++;
-        }
-    }
+            int t, tn = 1;
+            int r;
 
-    apply_offs_swaps(fp);
+            /* Survivors without a cell might match anything. */
 
-    fp->oc = k;
-}
+            for (r = 0; r < rc; r++)
+                if (comp(q, p + rest[r] * size))
+                {
+                    j = rest[r];
+                    break;
+                }
 
-static void uniq_geom(struct s_base *fp)
-{
-    int i, j, k = 0;
+            /* Search the home cell and, if quantized, its neighbors. */
 
-    for (i = 0; i < fp->gc; i++)
-    {
-        for (j = 0; j < k; j++)
-            if (comp_geom(fp->gv + i, fp->gv + j))
-                break;
+            if (quantized)
+                for (r = 0; r < cn; r++)
+                    tn *= 3;
+
+            for (t = 0; t < tn; t++)
+            {
+                int u = t;
+
+                for (r = 0; r < cn; r++)
+                {
+                    d[r] = quantized ? c[r] + u % 3 - 1 : c[r];
+                    u /= 3;
+                }
+
+                for (r = head[cell_hash(d, cn) & mask]; r >= 0; r = next[r])
+                    if (r < j && comp(q, p + r * size))
+                        j = r;
+            }
+        }
+        else
+        {
+            for (j = 0; j < k; j++)
+                if (comp(q, p + j * size))
+                    break;
+        }
 
-        geom_swaps[i] = j;
+        swaps[i] = j;
 
         if (j == k)
         {
             if (i != k)
-                fp->gv[k] = fp->gv[i];
+                memcpy(p + k * size, q, size);
+
+            if (cn)
+            {
+                unsigned int h = cell_hash(c, cn) & mask;
+
+                next[k] = head[h];
+                head[h] = k;
+            }
+            else rest[rc++] = k;
+
             k++;
         }
     }
 
-    apply_geom_swaps(fp);
+    free(rest);
+    free(next);
+    free(head);
 
-    fp->gc = k;
+    return k;
 }
 
-static void uniq_texc(struct s_base *fp)
+static void uniq_mtrl(struct s_base *fp)
 {
-    int i, j, k = 0;
+    int *swaps = alloc_swaps(fp->mc);
 
-    for (i = 0; i < fp->tc; i++)
-    {
-        for (j = 0; j < k; j++)
-            if (comp_texc(fp->tv + i, fp->tv + j))
-                break;
+    fp->mc = uniq_list(fp->mv, sizeof (*fp->mv), fp->mc, swaps,
+                       comp_mtrl, cell_mtrl, 0);
+    apply_mtrl_swaps(fp, swaps);
+    free(swaps);
+}
 
-        texc_swaps[i] = j;
+static void uniq_vert(struct s_base *fp)
+{
+    int *swaps = alloc_swaps(fp->vc);
 
-        if (j == k)
-        {
-            if (i != k)
-                fp->tv[k] = fp->tv[i];
-            k++;
-        }
-    }
+    fp->vc = uniq_list(fp->vv, sizeof (*fp->vv), fp->vc, swaps,
+                       comp_vert, cell_vert, 1);
+    apply_vert_swaps(fp, swaps);
+    free(swaps);
+}
 
-    apply_texc_swaps(fp);
+static void uniq_edge(struct s_base *fp)
+{
+    int *swaps = alloc_swaps(fp->ec);
 
-    fp->tc = k;
+    fp->ec = uniq_list(fp->ev, sizeof (*fp->ev), fp->ec, swaps,
+                       comp_edge, cell_edge, 0);
+    apply_edge_swaps(fp, swaps);
+    free(swaps);
 }
 
-static void uniq_side(struct s_base *fp)
+static void uniq_offs(struct s_base *fp)
 {
-    int i, j, k = 0;
+    int *swaps = alloc_swaps(fp->oc);
 
-    for (i = 0; i < fp->sc; i++)
-    {
-        for (j = 0; j < k; j++)
-            if (comp_side(fp->sv + i, fp->sv + j))
-                break;
+    fp->oc = uniq_list(fp->ov, sizeof (*fp->ov), fp->oc, swaps,
+                       comp_offs, cell_offs, 0);
+    apply_offs_swaps(fp, swaps);
+    free(swaps);
+}
 
-        side_swaps[i] = j;
+static void uniq_geom(struct s_base *fp)
+{
+    int *swaps = alloc_swaps(fp->gc);
 
-        if (j == k)
-        {
-            if (i != k)
-                fp->sv[k] = fp->sv[i];
-            k++;
-        }
-    }
+    fp->gc = uniq_list(fp->gv, sizeof (*fp->gv), fp->gc, swaps,
+                       comp_geom, cell_geom, 0);
+    apply_geom_swaps(fp, swaps);
+    free(swaps);
+}
 
-    apply_side_swaps(fp);
+static void uniq_texc(struct s_base *fp)
+{
+    int *swaps = alloc_swaps(fp->tc);
 
-    fp->sc = k;
+    fp->tc = uniq_list(fp->tv, sizeof (*fp->tv), fp->tc, swaps,
+                       comp_texc, cell_texc, 1);
+    apply_texc_swaps(fp, swaps);
+    free(swaps);
+}
+
+static void uniq_side(struct s_base *fp)
+{
+    int *swaps = alloc_swaps(fp->sc);
+
+    fp->sc = uniq_list(fp->sv, sizeof (*fp->sv), fp->sc, swaps,
+                       comp_side, cell_side, 1);
+    apply_side_swaps(fp, swaps);
+    free(swaps);
 }
 
 static void uniq_file(struct s_base *fp)
@@ -2513,129 +2767,189 @@ static int test_lump_side(const struct s_base *fp,
     return 0;
 }
 
-static int node_node(struct s_base *fp, int l0, int lc, float bsphere[][4])
+/*
+ * Estimate the cost of a split in lump tests per visit of its node.  The
+ * lumps on the side are tested on every visit, and each child is visited
+ * with a probability given by  the share of the extent LO..HI of the range
+ * that lies on its side of the plane.  This is the surface area heuristic
+ * of ray tracing, reduced to the one dimension that a plane cuts.
+ */
+
+#define NODE_COST 0.5f
+
+static float node_cost(int nf, int no, int nb, float lo, float hi)
 {
-    if (lc < 8)
+    float pf = 1.0f;
+    float pb = 1.0f;
+
+    if (hi > lo)
+    {
+        pf = CLAMP(0.0f, +hi / (hi - lo), 1.0f);
+        pb = CLAMP(0.0f, -lo / (hi - lo), 1.0f);
+    }
+    return NODE_COST + no + pf * nf + pb * nb;
+}
+
+/*
+ * Choose a side of a lump in the given range to split the range.  Each
+ * distinct side is tried once, MARK recording the node that tried it.
+ * Return -1 if no split costs less than a leaf.
+ */
+static int node_side(struct s_base *fp, int l0, int lc,
+                     float bsphere[][4], int *mark)
+{
+    float sjc = (float) lc;
+    int   sj  = -1;
+    int   li, lj, i;
+
+    for (li = 0; li < lc; li++)
+    {
+        const struct b_lump *lp = fp->lv + l0 + li;
+
+        for (i = 0; i < lp->sc; i++)
+        {
+            const int si = fp->iv[lp->s0 + i];
+            const struct b_side *sp = fp->sv + si;
+
+            int   nf = 0, no = 0, nb = 0;
+            float lo = 0.0f;
+            float hi = 0.0f;
+            float c;
+
+            if (mark[si] == fp->nc)
+                continue;
+
+            mark[si] = fp->nc;
+
+            for (lj = 0; lj < lc; lj++)
+            {
+                float *bs = bsphere[l0 + lj];
+                float  d  = v_dot(bs, sp->n) - sp->d;
+
+                switch (test_lump_side(fp, fp->lv + l0 + lj, sp, bs))
+                {
+                case +1: nf++; break;
+                case  0: no++; break;
+                case -1: nb++; break;
+                }
+
+                lo = MIN(lo, d - bs[3]);
+                hi = MAX(hi, d + bs[3]);
+            }
+
+            /* A split must make progress. */
+
+            if (nf == lc || no == lc || nb == lc)
+                continue;
+
+            if ((c = node_cost(nf, no, nb, lo, hi)) < sjc)
+            {
+                sj  = si;
+                sjc = c;
+            }
+        }
+    }
+    return sj;
+}
+
+static int node_node(struct s_base *fp, int l0, int lc,
+                     float bsphere[][4], int *mark)
+{
+    int sj = -1;
+
+    if (lc >= 8 && !debug_output)
+        sj = node_side(fp, l0, lc, bsphere, mark);
+
+    if (sj < 0)
     {
         /* Base case.  Dump all given lumps into a leaf node. */
 
-        fp->nv[fp->nc].si = -1;
-        fp->nv[fp->nc].ni = -1;
-        fp->nv[fp->nc].nj = -1;
-        fp->nv[fp->nc].l0 = l0;
-        fp->nv[fp->nc].lc = lc;
+        const int ni = incn(fp);
+
+        fp->nv[ni].si = -1;
+        fp->nv[ni].ni = -1;
+        fp->nv[ni].nj = -1;
+        fp->nv[ni].l0 = l0;
+        fp->nv[ni].lc = lc;
 
-        return incn(fp);
+        return ni;
     }
     else
     {
-        int sj  = 0;
-        int sjd = lc;
-        int sjo = lc;
-        int si;
-        int li = 0, lic = 0;
-        int lj = 0, ljc = 0;
-        int lk = 0, lkc = 0;
+        struct b_lump *lv;
+        float (*bv)[4];
+        int   *kv;
+
+        int li = l0, lic = 0;
+        int lj = l0, ljc = 0;
+        int lk = l0, lkc = 0;
+        int ni, nj;
         int i;
 
-        /* Find the side that most evenly splits the given lumps. */
+        lv = (struct b_lump *) malloc(lc * sizeof (*lv));
+        bv = (float (*)[4])    malloc(lc * sizeof (*bv));
+        kv = (int *)           malloc(lc * sizeof (*kv));
 
-        for (si = 0; si < fp->sc; si++)
+        if (!lv || !bv || !kv)
         {
-            int o = 0;
-            int d = 0;
-            int k = 0;
-
-            for (li = 0; li < lc; li++)
-                if ((k = test_lump_side(fp,
-                                        fp->lv + l0 + li,
-                                        fp->sv + si,
-                                        bsphere[l0 + li])))
-                    d += k;
-                else
-                    o++;
-
-            d = abs(d);
-
-            if ((d < sjd) || (d == sjd && o < sjo))
-            {
-                sj  = si;
-                sjd = d;
-                sjo = o;
-            }
+            ERROR("out of memory\n");
+            exit(1);
         }
 
         /* Flag each lump with its position WRT the side. */
 
-        for (li = 0; li < lc; li++)
-            if (debug_output)
+        for (i = 0; i < lc; i++)
+        {
+            struct b_lump *lp = fp->lv + l0 + i;
+
+            switch ((kv[i] = test_lump_side(fp, lp, fp->sv + sj,
+                                            bsphere[l0 + i])))
             {
-                fp->lv[l0+li].fl = (fp->lv[l0+li].fl & 1) | 0x20;
+            case +1: lp->fl = (lp->fl & 1) | 0x10; lic++; break;
+            case  0: lp->fl = (lp->fl & 1) | 0x20; ljc++; break;
+            case -1: lp->fl = (lp->fl & 1) | 0x40; lkc++; break;
             }
-            else
-            {
-                switch (test_lump_side(fp,
-                                       fp->lv + l0 + li,
-                                       fp->sv + sj,
-                                       bsphere[l0 + li]))
-                {
-                case +1:
-                    fp->lv[l0+li].fl = (fp->lv[l0+li].fl & 1) | 0x10;
-                    break;
+        }
 
-                case  0:
-                    fp->lv[l0+li].fl = (fp->lv[l0+li].fl & 1) | 0x20;
-                    break;
+        /* Partition the range into in-front, on, and behind lumps. */
 
-                case -1:
-                    fp->lv[l0+li].fl = (fp->lv[l0+li].fl & 1) | 0x40;
-                    break;
-                }
-            }
+        lj = li + lic;
+        lk = lj + ljc;
 
-        /* Sort all lumps in the range by their flag values. */
+        {
+            int fi = 0, oi = lic, bi = lic + ljc, n = 0;
 
-        for (li = 1; li < lc; li++)
-            for (lj = 0; lj < li; lj++)
-                if (fp->lv[l0 + li].fl < fp->lv[l0 + lj].fl)
+            for (i = 0; i < lc; i++)
+            {
+                switch (kv[i])
                 {
-                    struct b_lump l;
-                    float f;
-
-                    for (i = 0; i < 4; i++)
-                    {
-                        f                   = bsphere[l0 + li][i];
-                        bsphere[l0 + li][i] = bsphere[l0 + lj][i];
-                        bsphere[l0 + lj][i] =                   f;
-                    }
-
-                    l               = fp->lv[l0 + li];
-                    fp->lv[l0 + li] = fp->lv[l0 + lj];
-                    fp->lv[l0 + lj] =               l;
+                case +1: n = fi++; break;
+                case  0: n = oi++; break;
+                case -1: n = bi++; break;
                 }
 
-        /* Establish the in-front, on, and behind lump ranges. */
+                lv[n] = fp->lv[l0 + i];
+                memcpy(bv[n], bsphere[l0 + i], sizeof (bv[n]));
+            }
+        }
 
-        li = lic = 0;
-        lj = ljc = 0;
-        lk = lkc = 0;
+        memcpy(fp->lv  + l0, lv, lc * sizeof (*lv));
+        memcpy(bsphere + l0, bv, lc * sizeof (*bv));
 
-        for (i = lc - 1; i >= 0; i--)
-            switch (fp->lv[l0 + i].fl & 0xf0)
-            {
-            case 0x10: li = l0 + i; lic++; break;
-            case 0x20: lj = l0 + i; ljc++; break;
-            case 0x40: lk = l0 + i; lkc++; break;
-            }
+        free(kv);
+        free(bv);
+        free(lv);
 
         /* Add the lumps on the side to the node. */
 
         i = incn(fp);
 
-        fp->nv[i].si = sj;
-        fp->nv[i].ni = node_node(fp, li, lic, bsphere);
+        ni = node_node(fp, li, lic, bsphere, mark);
+        nj = node_node(fp, lk, lkc, bsphere, mark);
 
-        fp->nv[i].nj = node_node(fp, lk, lkc, bsphere);
+        fp->nv[i].si = sj;
+        fp->nv[i].ni = ni;
+        fp->nv[i].nj = nj;
         fp->nv[i].l0 = lj;
         fp->nv[i].lc = ljc;
 
@@ -2688,9 +3002,22 @@ static void lump_bounding_sphere(struct s_base *fp,
 
 static void node_file(struct s_base *fp)
 {
-    float bsphere[MAXL][4];
+    float (*bsphere)[4];
+    int *mark;
     int i;
 
+    bsphere = (float (*)[4]) malloc(MAX(fp->lc, 1) * sizeof (*bsphere));
+    mark    = (int *)        malloc(MAX(fp->sc, 1) * sizeof (*mark));
+
+    if (!bsphere || !mark)
+    {
+        ERROR("out of memory\n");
+        exit(1);
+    }
+
+    for (i = 0; i < fp->sc; i++)
+        mark[i] = -1;
+
     /* Compute a bounding sphere for each lump. */
 
     for (i = 0; i < fp->lc; i++)
@@ -2709,8 +3036,11 @@ static void node_file(struct s_base *fp)
 
         /* Sort the solid lumps of each body into BSP nodes. */
 
-        fp->bv[i].ni = node_node(fp, fp->bv[i].l0, lc, bsphere);
+        fp->bv[i].ni = node_node(fp, fp->bv[i].l0, lc, bsphere, mark);
     }
+
+    free(mark);
+    free(bsphere);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -2758,14 +3088,55 @@ static void dump_init(struct s_base *fp)
         stats[i].ptr = (int *) &((unsigned char *) fp)[stats[i].off];
 }
 
+/*
+ * Measure the BSP of a body: the depth of its deepest node, and the
+ * number of leaves and of the lumps in them.
+ */
+struct tree_stats
+{
+    int depth;
+    int leaves;
+    int lumps;
+};
+
+static void tree_stats(const struct s_base *fp, int ni, int d,
+                       struct tree_stats *ts)
+{
+    const struct b_node *np;
+
+    if (ni < 0)
+        return;
+
+    np = fp->nv + ni;
+
+    ts->depth = MAX(ts->depth, d);
+
+    if (np->ni < 0 && np->nj < 0)
+    {
+        ts->leaves++;
+        ts->lumps += np->lc;
+    }
+    else
+    {
+        tree_stats(fp, np->ni, d + 1, ts);
+        tree_stats(fp, np->nj, d + 1, ts);
+    }
+}
+
 static void dump_file(struct s_base *p, const char *name, double t)
 {
+    struct tree_stats ts = { 0, 0, 0 };
     int i, j;
     int c = 0;
     int n = 0;
 
     dump_init(p);
 
+    /* Measure the BSP of every body. */
+
+    for (i = 0; i < p->bc; i++)
+        tree_stats(p, p->bv[i].ni, 1, &ts);
+
     /* Count the number of solid lumps. */
 
     for (i = 0; i < p->lc; i++)
@@ -2798,16 +3169,24 @@ static void dump_file(struct s_base *p, const char *name, double t)
 
     if (csv_output)
     {
-        printf("name,n,c,t,");
+        if (!csv_head)
+        {
+            printf("name,n,c,t,");
 
-        for (i = 0; i < ARRAYSIZE(stats); i++)
-            printf("%s%s", stats[i].name, (i + 1 < ARRAYSIZE(stats) ?
-                                           "," : "\n"));
+            for (i = 0; i < ARRAYSIZE(stats); i++)
+                printf("%s,", stats[i].name);
+
+            printf("depth,leaf\n");
+
+            csv_head = 1;
+        }
         printf("%s,%d,%d,%.3f,", name, n, c, t);
 
         for (i = 0; i < ARRAYSIZE(stats); i++)
-            printf("%d%s", *stats[i].ptr, (i + 1 < ARRAYSIZE(stats) ?
-                                           "," : "\n"));
+            printf("%d,", *stats[i].ptr);
+
+        printf("%d,%.2f\n", ts.depth,
+               ts.leaves ? (double) ts.lumps / ts.leaves : 0.0);
     }
     else
     {
@@ -2832,16 +3211,357 @@ static void dump_file(struct s_base *p, const char *name, double t)
     }
 }
 
-int main(int argc, char *argv[])
+/*---------------------------------------------------------------------------*/
+
+static void sol_name(char dst[MAXSTR], const char *src)
 {
-    char src[MAXSTR] = "";
-    char dst[MAXSTR] = "";
-    struct s_base f;
-    fs_file fin;
+    strncpy(dst, src, MAXSTR - 1);
+    dst[MAXSTR - 1] = 0;
+
+    if (strcmp(dst + strlen(dst) - 4, ".map") == 0)
+        strcpy(dst + strlen(dst) - 4, ".sol");
+    else
+        strncat(dst, ".sol", MAXSTR - strlen(dst) - 1);
+}
+
+/*
+ * Serializes the report of each compiled map.  Only created in batch
+ * mode.
+ */
+static SDL_mutex *dump_lock;
+
+/*
+ * Compile the map  read from FIN to a SOL named  after SRC, its path in
+ * the virtual file system.  INPUT names the map in messages.
+ */
+static void compile_map(fs_file fin, const char *input, const char *src)
+{
+    char out[MAXSTR];
+    char dst[MAXSTR];
+    struct mapc *mc;
+    struct s_base *fp;
 
     struct timeval time0;
     struct timeval time1;
 
+    if (!(mc = (struct mapc *) calloc(1, sizeof (*mc))))
+    {
+        ERROR("out of memory\n");
+        exit(1);
+    }
+
+    sol_name(out, input);
+    sol_name(dst, src);
+
+    fp = &mc->f;
+
+    mc->input_file = input;
+
+    gettimeofday(&time0, 0);
+    {
+        init_file(fp);
+        read_map(fp, fin);
+
+        resolve(fp);
+        targets(fp);
+
+        clip_file(fp);
+        move_file(fp);
+        uniq_file(fp);
+        smth_file(fp);
+        sort_file(fp);
+        node_file(fp);
+
+        if (sect_output)
+            sol_stor_sect(fp, dst);
+        else
+            sol_stor_base(fp, dst);
+    }
+    gettimeofday(&time1, 0);
+
+    if (dump_lock) SDL_mutexP(dump_lock);
+    {
+        dump_file(fp, out, (time1.tv_sec  - time0.tv_sec) +
+                           (time1.tv_usec - time0.tv_usec) / 1000000.0);
+        fflush(stdout);
+    }
+    if (dump_lock) SDL_mutexV(dump_lock);
+
+    free_file(fp);
+    free(mc);
+}
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Batch mode compiles a whole tree or list of maps in one process, on
+ * a pool of threads.  The file system is set up once, with the root of
+ * the batch in place of the directory of the map, and the image sizes
+ * are cached across maps.  Every map still gets its own compiler state
+ * and its output is the same as when compiled alone.
+ */
+
+struct batch_map
+{
+    char *path;                         /* Relative to the batch root        */
+    int   size;                         /* File size, for scheduling         */
+};
+
+struct batch
+{
+    const char *root;
+
+    SDL_mutex *lock;
+    Array      maps;
+    int        next;
+    int        fail;
+};
+
+static int is_map(const char *path)
+{
+    return (str_ends_with(path, ".map") &&
+            !str_ends_with(path, ".autosave.map"));
+}
+
+static void batch_add(struct batch *b, const char *path)
+{
+    struct batch_map *m;
+    char *sys;
+
+    if ((m = array_add(b->maps)))
+    {
+        if ((sys = path_join(b->root, path)))
+        {
+            m->path = strdup(path);
+            m->size = file_size(sys);
+
+            free(sys);
+        }
+        else array_del(b->maps);
+    }
+}
+
+/*
+ * Recursively add the maps under the directory PATH of the batch root.
+ */
+static void batch_scan(struct batch *b, const char *path)
+{
+    char *sys = *path ? path_join(b->root, path) : strdup(b->root);
+    Array items;
+    int i;
+
+    if (sys && (items = dir_scan(sys, NULL, NULL, NULL)))
+    {
+        for (i = 0; i < array_len(items); i++)
+        {
+            const char *item = DIR_ITEM_GET(items, i)->path;
+            char *name = path_join(path, base_name(item));
+
+            if (dir_exists(item))
+                batch_scan(b, name);
+            else if (is_map(name))
+                batch_add(b, name);
+
+            free(name);
+        }
+        dir_free(items);
+    }
+    free(sys);
+}
+
+/*
+ * Add the maps named in the list file LIST, one per line, relative to
+ * the directory of the list.
+ */
+static int batch_list(struct batch *b, const char *list)
+{
+    char line[MAXSTR];
+    FILE *fin;
+
+    if ((fin = fopen(list, "r")))
+    {
+        while (fgets(line, sizeof (line), fin))
+            if (*strip_newline(line))
+                batch_add(b, line);
+
+        fclose(fin);
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Start the biggest maps first, so that no thread is left compiling a
+ * large map long after the others have run out of work.
+ */
+static int cmp_batch_maps(const void *A, const void *B)
+{
+    const struct batch_map *a = A, *b = B;
+
+    if (a->size != b->size)
+        return (a->size < b->size) ? +1 : -1;
+
+    return strcmp(a->path, b->path);
+}
+
+static int batch_thread(void *data)
+{
+    struct batch *b = data;
+
+    while (1)
+    {
+        struct batch_map *m = NULL;
+        char *input;
+        fs_file fin;
+
+        SDL_mutexP(b->lock);
+        {
+            if (b->next < array_len(b->maps))
+                m = array_get(b->maps, b->next++);
+        }
+        SDL_mutexV(b->lock);
+
+        if (!m)
+            break;
+
+        if ((input = path_join(b->root, m->path)))
+        {
+            if ((fin = fs_open_read(m->path)))
+            {
+                compile_map(fin, input, m->path);
+                fs_close(fin);
+            }
+            else
+            {
+                SDL_mutexP(dump_lock);
+                fprintf(stderr, "%s: failed to read\n", input);
+                SDL_mutexV(dump_lock);
+
+                SDL_mutexP(b->lock);
+                b->fail++;
+                SDL_mutexV(b->lock);
+            }
+            free(input);
+        }
+    }
+    return 0;
+}
+
+/*
+ * Serialize package reads across the workers.
+ */
+static void lock_fs(void *data)
+{
+    SDL_mutexP((SDL_mutex *) data);
+}
+
+static void unlock_fs(void *data)
+{
+    SDL_mutexV((SDL_mutex *) data);
+}
+
+/*
+ * Compile every map in  the directory or list file SRC using up to JOBS
+ * threads.  Return the number of maps that could not be read.
+ */
+static int batch_run(const char *src, const char *data, int jobs)
+{
+    char root[MAXSTR];
+    struct batch b;
+    SDL_Thread **threads;
+    SDL_mutex *fs_lock;
+    int i, n;
+
+    memset(&b, 0, sizeof (b));
+
+    if (!(b.maps = array_new(sizeof (struct batch_map))))
+        return 1;
+
+    if (dir_exists(src))
+    {
+        b.root = src;
+        batch_scan(&b, "");
+    }
+    else
+    {
+        SAFECPY(root, dir_name(src));
+        b.root = root;
+
+        if (!batch_list(&b, src))
+        {
+            fprintf(stderr, "%s: not a directory or map list\n", src);
+            array_free(b.maps);
+            return 1;
+        }
+    }
+
+    fs_add_path     (b.root);
+    fs_set_write_dir(b.root);
+
+    if (!fs_add_path_with_archives(data))
+    {
+        fprintf(stderr, "Failure to establish data directory\n");
+        array_free(b.maps);
+        return 1;
+    }
+
+    array_sort(b.maps, cmp_batch_maps);
+
+    b.lock     = SDL_CreateMutex();
+    dump_lock  = SDL_CreateMutex();
+    image_lock = SDL_CreateMutex();
+
+    if ((fs_lock = SDL_CreateMutex()))
+        fs_set_lock(lock_fs, unlock_fs, fs_lock);
+
+    /* Start the workers.  This thread is one of them. */
+
+    n = MIN(MAX(jobs, 1), array_len(b.maps)) - 1;
+
+    if (n > 0 && (threads = calloc(n, sizeof (*threads))))
+    {
+        for (i = 0; i < n; i++)
+            threads[i] = SDL_CreateThread(batch_thread, "mapc", &b);
+
+        batch_thread(&b);
+
+        for (i = 0; i < n; i++)
+            if (threads[i])
+                SDL_WaitThread(threads[i], NULL);
+
+        free(threads);
+    }
+    else batch_thread(&b);
+
+    if (fs_lock)
+    {
+        fs_set_lock(NULL, NULL, NULL);
+        SDL_DestroyMutex(fs_lock);
+    }
+
+    SDL_DestroyMutex(image_lock);
+    SDL_DestroyMutex(dump_lock);
+    SDL_DestroyMutex(b.lock);
+
+    image_lock = NULL;
+    dump_lock  = NULL;
+
+    for (i = 0; i < array_len(b.maps); i++)
+        free(((struct batch_map *) array_get(b.maps, i))->path);
+
+    array_free(b.maps);
+
+    return b.fail;
+}
+
+/*---------------------------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+    int batch = 0;
+    int jobs  = 0;
+    int fail  = 0;
+
     if (!fs_init(argc > 0 ? argv[0] : NULL))
     {
         fprintf(stderr, "Failure to initialize virtual file system: %s\n",
@@ -2853,77 +3573,66 @@ int main(int argc, char *argv[])
     {
         int argi;
 
-        input_file = argv[1];
-
         for (argi = 3; argi < argc; ++argi)
         {
-            if (strcmp(argv[argi], "--debug") == 0) debug_output = 1;
-            if (strcmp(argv[argi], "--csv")   == 0)   csv_output = 1;
+            if      (strcmp(argv[argi], "--debug") == 0) debug_output = 1;
+            else if (strcmp(argv[argi], "--csv")   == 0)   csv_output = 1;
+            else if (strcmp(argv[argi], "--batch") == 0)        batch = 1;
+            else if (strcmp(argv[argi], "--sect")  == 0)  sect_output = 1;
 #if ENABLE_RADIANT_CONSOLE
-            if (strcmp(argv[argi], "--bcast") == 0) bcast_init();
+            else if (strcmp(argv[argi], "--bcast") == 0) bcast_init();
 #endif
-            if (strcmp(argv[argi], "--data")  == 0)
+            else if (strcmp(argv[argi], "--data")  == 0)
             {
                 if (++argi < argc)
                     fs_add_path(argv[argi]);
             }
+            else if (strcmp(argv[argi], "--jobs")  == 0)
+            {
+                if (++argi < argc)
+                    jobs = atoi(argv[argi]);
+            }
         }
 
-        strncpy(src, argv[1], MAXSTR - 1);
-        strncpy(dst, argv[1], MAXSTR - 1);
-
-        if (strcmp(dst + strlen(dst) - 4, ".map") == 0)
-            strcpy(dst + strlen(dst) - 4, ".sol");
+        if (batch)
+            fail = batch_run(argv[1], argv[2], jobs ? jobs : SDL_GetCPUCount());
         else
-            strcat(dst, ".sol");
-
-        fs_add_path     (dir_name(src));
-        fs_set_write_dir(dir_name(dst));
-
-        if ((fin = fs_open_read(base_name(src))))
         {
-            if (!fs_add_path_with_archives(argv[2]))
-            {
-                fprintf(stderr, "Failure to establish data directory\n");
-                fs_close(fin);
-                fs_quit();
-                return 1;
-            }
+            char src[MAXSTR] = "";
+            char dst[MAXSTR] = "";
+            fs_file fin;
 
-            gettimeofday(&time0, 0);
-            {
-                init_file(&f);
-                read_map(&f, fin);
+            strncpy(src, argv[1], MAXSTR - 1);
+            sol_name(dst, argv[1]);
 
-                resolve();
-                targets(&f);
+            fs_add_path     (dir_name(src));
+            fs_set_write_dir(dir_name(dst));
 
-                clip_file(&f);
-                move_file(&f);
-                uniq_file(&f);
-                smth_file(&f);
-                sort_file(&f);
-                node_file(&f);
+            if ((fin = fs_open_read(base_name(src))))
+            {
+                if (!fs_add_path_with_archives(argv[2]))
+                {
+                    fprintf(stderr, "Failure to establish data directory\n");
+                    fs_close(fin);
+                    fs_quit();
+                    return 1;
+                }
 
-                sol_stor_base(&f, base_name(dst));
+                compile_map(fin, argv[1], base_name(src));
+                fs_close(fin);
             }
-            gettimeofday(&time1, 0);
-
-            dump_file(&f, dst, (time1.tv_sec  - time0.tv_sec) +
-                               (time1.tv_usec - time0.tv_usec) / 1000000.0);
-
-            fs_close(fin);
-
-            free_imagedata();
         }
 
+        free_imagedata();
+
 #if ENABLE_RADIANT_CONSOLE
         bcast_quit();
 #endif
 
     }
-    else fprintf(stderr, "Usage: %s <map> <data> [--debug] [--csv]\n", argv[0]);
+    else fprintf(stderr, "Usage: %s <map> <data> [--debug] [--csv] [--sect]\n"
+                 "       %s <dir|list> <data> --batch [--jobs <n>] "
+                 "[--debug] [--csv] [--sect]\n", argv[0], argv[0]);
 
-    return 0;
+    return fail ? 1 : 0;
 }
-
@@ -97,6 +97,30 @@ static GLuint find_texture(const char *name)
     return 0;
 }
 
+/*
+ * Decode a material texture from the file find_texture would make it
+ * from.  No GL state is touched, so this is safe on any thread.
+ */
+int mtrl_load_image(const struct b_mtrl *base, struct mtrl_image *img)
+{
+    const char *name = _(base->f);
+    int i;
+
+    memset(img, 0, sizeof (*img));
+
+    if (!*name)
+        return 0;
+
+    for (i = 0; i < ARRAYSIZE(tex_paths); i++)
+    {
+        CONCAT_PATH(img->path, &tex_paths[i], name);
+
+        if ((img->p = image_load(img->path, &img->w, &img->h, &img->b)))
+            return 1;
+    }
+    return 0;
+}
+
 /*
  * Load GL resources of an initialized material.
  */
@@ -29,6 +29,16 @@ struct mtrl
     unsigned int refc;
 };
 
+/*
+ * Decoded texture of a material.
+ */
+struct mtrl_image
+{
+    char  path[MAXSTR];
+    void *p;
+    int   w, h, b;
+};
+
 extern int default_mtrl;
 
 void mtrl_init(void);
@@ -47,6 +57,8 @@ void mtrl_free_objects(void);
 
 void mtrl_reload(void);
 
+int  mtrl_load_image(const struct b_mtrl *, struct mtrl_image *);
+
 /*---------------------------------------------------------------------------*/
 
 GLenum mtrl_func(int);
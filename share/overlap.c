@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2003 Robert Kooima
+ *
+ * NEVERBALL is  free software; you can redistribute  it and/or modify
+ * it under the  terms of the GNU General  Public License as published
+ * by the Free  Software Foundation; either version 2  of the License,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT  ANY  WARRANTY;  without   even  the  implied  warranty  of
+ * MERCHANTABILITY or  FITNESS FOR A PARTICULAR PURPOSE.   See the GNU
+ * General Public License for more details.
+ */
+
+#include "overlap.h"
+#include "common.h"
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Add N elements of the given key with screen bounds R to the C
+ * batches at BV, which must have room for one more.  Return the index
+ * of the batch they join.
+ */
+int overlap_join(struct overlap *bv, int *c, int key, const float r[4], int n)
+{
+    int b;
+
+    /* Find a batch of this key with nothing drawn over it since. */
+
+    for (b = *c - 1; b >= 0; b--)
+    {
+        const float *q = bv[b].r;
+
+        if (bv[b].key == key)
+            break;
+
+        if (r[0] < q[2] && q[0] < r[2] && r[1] < q[3] && q[1] < r[3])
+        {
+            b = -1;
+            break;
+        }
+    }
+
+    if (b < 0)
+    {
+        b = (*c)++;
+
+        bv[b].key   = key;
+        bv[b].count = 0;
+        bv[b].r[0]  = r[0];
+        bv[b].r[1]  = r[1];
+        bv[b].r[2]  = r[2];
+        bv[b].r[3]  = r[3];
+    }
+    else
+    {
+        bv[b].r[0] = MIN(bv[b].r[0], r[0]);
+        bv[b].r[1] = MIN(bv[b].r[1], r[1]);
+        bv[b].r[2] = MAX(bv[b].r[2], r[2]);
+        bv[b].r[3] = MAX(bv[b].r[3], r[3]);
+    }
+
+    bv[b].count += n;
+
+    return b;
+}
+
+/*
+ * Give each of the C batches at BV its first element in batch order
+ * and zero its count, ready for the elements to be placed.  Return
+ * the total element count.
+ */
+int overlap_order(struct overlap *bv, int c)
+{
+    int b, n = 0;
+
+    for (b = 0; b < c; b++)
+    {
+        bv[b].first = n;
+        n += bv[b].count;
+        bv[b].count = 0;
+    }
+    return n;
+}
+
+/*---------------------------------------------------------------------------*/
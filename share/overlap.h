@@ -0,0 +1,27 @@
+#ifndef OVERLAP_H
+#define OVERLAP_H
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Screen-ordered draw batches.  Parts of a picture are gathered into
+ * batches of one key, such as a texture or a material.  A part joins
+ * an earlier batch of its key only if nothing added since overlaps it
+ * on screen, so that drawing the batches one after another gives the
+ * same picture as drawing the parts in order.
+ */
+
+struct overlap
+{
+    int   key;
+    int   first;                        /* First element in batch order      */
+    int   count;                        /* Element count                     */
+    float r[4];                         /* Left, bottom, right, top          */
+};
+
+int overlap_join(struct overlap *, int *, int, const float r[4], int);
+int overlap_order(struct overlap *, int);
+
+/*---------------------------------------------------------------------------*/
+
+#endif
@@ -0,0 +1,393 @@
+/*
+ * Copyright (C) 2003-2010 Neverball authors
+ *
+ * NEVERBALL is  free software; you can redistribute  it and/or modify
+ * it under the  terms of the GNU General  Public License as published
+ * by the Free  Software Foundation; either version 2  of the License,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT  ANY  WARRANTY;  without   even  the  implied  warranty  of
+ * MERCHANTABILITY or  FITNESS FOR A PARTICULAR PURPOSE.   See the GNU
+ * General Public License for more details.
+ */
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * This is a headless benchmark of the SOL physics.  It loads levels,
+ * tilts the floor about in a scripted, repeatable pattern, and times
+ * every call to sol_step.  No window, GL context, or audio is needed.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "solid_base.h"
+#include "solid_vary.h"
+#include "solid_sim.h"
+
+#include "vec3.h"
+#include "fs.h"
+#include "dir.h"
+#include "array.h"
+#include "common.h"
+
+#define UPS 90
+#define DT  (1.0f / (float) UPS)
+
+#define ANGLE_BOUND 20.0f
+
+static const float GRAVITY_DN[] = { 0.0f, -9.8f, 0.0f };
+
+/*---------------------------------------------------------------------------*/
+
+static int   csv_output = 0;
+static float sim_time   = 10.0f;
+
+static double now_ns(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+
+    if (!freq.QuadPart)
+        QueryPerformanceFrequency(&freq);
+
+    QueryPerformanceCounter(&count);
+
+    return (double) count.QuadPart * 1.0e9 / (double) freq.QuadPart;
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double) ts.tv_sec * 1.0e9 + (double) ts.tv_nsec;
+#endif
+}
+
+static int cmp_double(const void *p, const void *q)
+{
+    const double a = *(const double *) p;
+    const double b = *(const double *) q;
+
+    return (a < b) ? -1 : ((a > b) ? +1 : 0);
+}
+
+static int cmp_dir_items(const void *A, const void *B)
+{
+    const struct dir_item *a = A, *b = B;
+    return strcmp(a->path, b->path);
+}
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Compute the gravity vector at simulation time T.  The floor sweeps
+ * through two sinusoids of unrelated period, which rolls the ball all
+ * over the level without any randomness.
+ */
+static void bench_grav(float h[3], float t)
+{
+    static const float X[3] = { 1.0f, 0.0f, 0.0f };
+    static const float Z[3] = { 0.0f, 0.0f, 1.0f };
+
+    float rx = ANGLE_BOUND * fsinf(t * 2.0f * V_PI / 3.0f);
+    float rz = ANGLE_BOUND * fsinf(t * 2.0f * V_PI / 5.0f);
+
+    float MX[16];
+    float MZ[16];
+    float M[16];
+
+    m_rot (MZ, Z, V_RAD(rz));
+    m_rot (MX, X, V_RAD(rx));
+    m_mult(M, MZ, MX);
+    m_vxfm(h, M, GRAVITY_DN);
+}
+
+struct bench
+{
+    int    steps;
+    int    resets;
+    double total;
+    double p50;
+    double p99;
+
+    struct sol_stats stats;
+};
+
+static int bench_level(const char *path, struct bench *b)
+{
+    struct s_base base;
+    struct s_vary vary;
+
+    double *ns;
+    int i;
+
+    memset(b, 0, sizeof (*b));
+
+    if (!sol_load_base(&base, path))
+        return 0;
+
+    if (!sol_load_vary(&vary, &base))
+    {
+        sol_free_base(&base);
+        return 0;
+    }
+
+    sol_init_sim(&vary);
+
+    b->steps = (int) (sim_time * UPS);
+
+    if ((ns = (double *) calloc(b->steps ? b->steps : 1, sizeof (*ns))))
+    {
+        memset(&sol_stats, 0, sizeof (sol_stats));
+
+        for (i = 0; i < b->steps; i++)
+        {
+            float h[3];
+            double t0;
+
+            bench_grav(h, i * DT);
+
+            t0 = now_ns();
+            sol_step(&vary, NULL, h, DT, 0, NULL);
+            ns[i] = now_ns() - t0;
+
+            b->total += ns[i];
+
+            /* Put the ball back at the start if it falls out. */
+
+            if (base.vc && vary.uv[0].p[1] < base.vv[0].p[1])
+            {
+                sol_free_vary(&vary);
+                sol_load_vary(&vary, &base);
+                sol_init_sim(&vary);
+
+                b->resets++;
+            }
+        }
+
+        b->stats = sol_stats;
+
+        if (b->steps)
+        {
+            qsort(ns, b->steps, sizeof (*ns), cmp_double);
+
+            b->p50 = ns[(b->steps - 1) * 50 / 100];
+            b->p99 = ns[(b->steps - 1) * 99 / 100];
+        }
+
+        free(ns);
+    }
+
+    sol_free_vary(&vary);
+    sol_free_base(&base);
+
+    return 1;
+}
+
+/*---------------------------------------------------------------------------*/
+
+static void dump_head(void)
+{
+    if (csv_output)
+        printf("name,steps,resets,ns,p50,p99,body,node,lump,vert,edge,side\n");
+    else
+        printf("%-40s %6s %9s %9s %9s %7s %7s %8s\n",
+               "level", "steps", "ns/step", "p50", "p99",
+               "body", "lump", "prim");
+}
+
+static void dump_bench(const char *name, const struct bench *b)
+{
+    const double n = b->steps ? b->steps : 1;
+
+    if (csv_output)
+        printf("%s,%d,%d,%.0f,%.0f,%.0f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+               name, b->steps, b->resets, b->total / n, b->p50, b->p99,
+               b->stats.body / n,
+               b->stats.node / n,
+               b->stats.lump / n,
+               b->stats.vert / n,
+               b->stats.edge / n,
+               b->stats.side / n);
+    else
+        printf("%-40.40s %6d %9.0f %9.0f %9.0f %7.1f %7.1f %8.1f\n",
+               name, b->steps, b->total / n, b->p50, b->p99,
+               b->stats.body / n,
+               b->stats.lump / n,
+               (b->stats.vert + b->stats.edge + b->stats.side) / n);
+}
+
+/*---------------------------------------------------------------------------*/
+
+static int is_map_dir(struct dir_item *item)
+{
+    return str_starts_with(item->path, "map-");
+}
+
+static int is_sol(struct dir_item *item)
+{
+    return str_ends_with(item->path, ".sol");
+}
+
+/*
+ * Find every SOL file under data/map-*, in a stable order.
+ */
+static Array scan_levels(void)
+{
+    Array levels;
+    Array dirs;
+    Array sols;
+    int i, j;
+
+    if (!(levels = array_new(sizeof (char *))))
+        return NULL;
+
+    if ((dirs = fs_dir_scan("", is_map_dir)))
+    {
+        array_sort(dirs, cmp_dir_items);
+
+        for (i = 0; i < array_len(dirs); i++)
+        {
+            const char *dir = DIR_ITEM_GET(dirs, i)->path;
+
+            if ((sols = fs_dir_scan(dir, is_sol)))
+            {
+                array_sort(sols, cmp_dir_items);
+
+                for (j = 0; j < array_len(sols); j++)
+                {
+                    const char *path = DIR_ITEM_GET(sols, j)->path;
+                    char **item;
+
+                    if ((item = array_add(levels)))
+                        *item = strdup(path);
+                }
+
+                fs_dir_free(sols);
+            }
+        }
+
+        fs_dir_free(dirs);
+    }
+
+    return levels;
+}
+
+int main(int argc, char *argv[])
+{
+    struct bench b;
+    struct bench sum;
+    Array levels;
+    int argi, i, n = 0;
+
+    if (!fs_init(argc > 0 ? argv[0] : NULL))
+    {
+        fprintf(stderr, "Failure to initialize virtual file system: %s\n",
+                fs_error());
+        return 1;
+    }
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <data> [--time <seconds>] [--csv] "
+                "[<sol> ...]\n", argv[0]);
+        return 1;
+    }
+
+    if (!fs_add_path_with_archives(argv[1]))
+    {
+        fprintf(stderr, "Failure to establish data directory\n");
+        fs_quit();
+        return 1;
+    }
+
+    if (!(levels = array_new(sizeof (char *))))
+        return 1;
+
+    for (argi = 2; argi < argc; ++argi)
+    {
+        if (strcmp(argv[argi], "--csv") == 0)
+            csv_output = 1;
+        else if (strcmp(argv[argi], "--time") == 0)
+        {
+            if (++argi < argc)
+                sim_time = (float) atof(argv[argi]);
+        }
+        else
+        {
+            char **item;
+
+            if ((item = array_add(levels)))
+                *item = strdup(argv[argi]);
+        }
+    }
+
+    /* With no levels named, run the whole corpus. */
+
+    if (array_len(levels) == 0)
+    {
+        array_free(levels);
+        levels = scan_levels();
+    }
+
+    memset(&sum, 0, sizeof (sum));
+
+    dump_head();
+
+    for (i = 0; levels && i < array_len(levels); i++)
+    {
+        const char *path = *(char **) array_get(levels, i);
+
+        if (bench_level(path, &b))
+        {
+            dump_bench(path, &b);
+
+            sum.steps       += b.steps;
+            sum.resets      += b.resets;
+            sum.total       += b.total;
+            sum.p50         += b.p50;
+            sum.p99         += b.p99;
+            sum.stats.body  += b.stats.body;
+            sum.stats.node  += b.stats.node;
+            sum.stats.lump  += b.stats.lump;
+            sum.stats.vert  += b.stats.vert;
+            sum.stats.edge  += b.stats.edge;
+            sum.stats.side  += b.stats.side;
+
+            n++;
+        }
+        else fprintf(stderr, "%s: failed to load\n", path);
+    }
+
+    /* Report the overall step cost and the mean of the percentiles. */
+
+    if (n)
+    {
+        sum.p50 /= n;
+        sum.p99 /= n;
+
+        dump_bench("(all)", &sum);
+    }
+
+    for (i = 0; levels && i < array_len(levels); i++)
+        free(*(char **) array_get(levels, i));
+
+    array_free(levels);
+    fs_quit();
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
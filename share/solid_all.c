@@ -243,7 +243,7 @@ void sol_pendulum(struct v_ball *up,
 
 /*---------------------------------------------------------------------------*/
 
-static void sol_path_flag(struct s_vary *vary, cmd_fn cmd_func, int pi, int f)
+static void sol_path_flag(struct s_vary *vary, const struct cmd_sink *sink, int pi, int f)
 {
     if (pi < 0 || pi >= vary->pc)
         return;
@@ -253,16 +253,16 @@ static void sol_path_flag(struct s_vary *vary, cmd_fn cmd_func, int pi, int f)
 
     vary->pv[pi].f = f;
 
-    if (cmd_func)
+    if (sink)
     {
         union cmd cmd = { CMD_PATH_FLAG };
         cmd.pathflag.pi = pi;
         cmd.pathflag.f = vary->pv[pi].f;
-        cmd_func(&cmd);
+        cmd_sink_put(sink, &cmd);
     }
 }
 
-static void sol_path_loop(struct s_vary *vary, cmd_fn cmd_func, int p0, int f)
+static void sol_path_loop(struct s_vary *vary, const struct cmd_sink *sink, int p0, int f)
 {
     int pi = p0;
     int pj = p0;
@@ -273,7 +273,7 @@ static void sol_path_loop(struct s_vary *vary, cmd_fn cmd_func, int p0, int f)
 
     do  /* Tortoise and hare cycle traverser. */
     {
-        sol_path_flag(vary, cmd_func, pi, f);
+        sol_path_flag(vary, sink, pi, f);
 
         pi = vary->base->pv[pi].pi;
         pj = vary->base->pv[pj].pi;
@@ -294,7 +294,7 @@ static void sol_path_loop(struct s_vary *vary, cmd_fn cmd_func, int p0, int f)
 
     do
     {
-        sol_path_flag(vary, cmd_func, pi, f);
+        sol_path_flag(vary, sink, pi, f);
 
         pi = vary->base->pv[pi].pi;
         pj = vary->base->pv[pj].pi;
@@ -307,7 +307,7 @@ static void sol_path_loop(struct s_vary *vary, cmd_fn cmd_func, int p0, int f)
 /*
  * Compute the states of all switches after DT seconds have passed.
  */
-void sol_swch_step(struct s_vary *vary, cmd_fn cmd_func, float dt, int ms)
+void sol_swch_step(struct s_vary *vary, const struct cmd_sink *sink, float dt, int ms)
 {
     int xi;
 
@@ -322,15 +322,15 @@ void sol_swch_step(struct s_vary *vary, cmd_fn cmd_func, float dt, int ms)
 
             if (xp->tm >= xp->base->tm)
             {
-                sol_path_loop(vary, cmd_func, xp->base->pi, xp->base->f);
+                sol_path_loop(vary, sink, xp->base->pi, xp->base->f);
 
                 xp->f = xp->base->f;
 
-                if (cmd_func)
+                if (sink)
                 {
                     union cmd cmd = { CMD_SWCH_TOGGLE };
                     cmd.swchtoggle.xi = xi;
-                    cmd_func(&cmd);
+                    cmd_sink_put(sink, &cmd);
                 }
             }
         }
@@ -340,7 +340,7 @@ void sol_swch_step(struct s_vary *vary, cmd_fn cmd_func, float dt, int ms)
 /*
  * Compute the positions of all movers after DT seconds have passed.
  */
-void sol_move_step(struct s_vary *vary, cmd_fn cmd_func, float dt, int ms)
+void sol_move_step(struct s_vary *vary, const struct cmd_sink *sink, float dt, int ms)
 {
     int i;
 
@@ -361,19 +361,19 @@ void sol_move_step(struct s_vary *vary, cmd_fn cmd_func, float dt, int ms)
                 mp->tm = 0;
                 mp->pi = pp->base->pi;
 
-                if (cmd_func)
+                if (sink)
                 {
                     union cmd cmd;
 
                     cmd.type        = CMD_MOVE_TIME;
                     cmd.movetime.mi = i;
                     cmd.movetime.t  = mp->t;
-                    cmd_func(&cmd);
+                    cmd_sink_put(sink, &cmd);
 
                     cmd.type        = CMD_MOVE_PATH;
                     cmd.movepath.mi = i;
                     cmd.movepath.pi = mp->pi;
-                    cmd_func(&cmd);
+                    cmd_sink_put(sink, &cmd);
                 }
             }
         }
@@ -383,7 +383,7 @@ void sol_move_step(struct s_vary *vary, cmd_fn cmd_func, float dt, int ms)
 /*
  * Compute the positions of all balls after DT seconds have passed.
  */
-void sol_ball_step(struct s_vary *vary, cmd_fn cmd_func, float dt)
+void sol_ball_step(struct s_vary *vary, const struct cmd_sink *sink, float dt)
 {
     int i;
 
@@ -503,7 +503,7 @@ int sol_jump_test(struct s_vary *vary, float *p, int ui)
 /*
  * Test for a ball entering a switch.
  */
-int sol_swch_test(struct s_vary *vary, cmd_fn cmd_func, int ui)
+int sol_swch_test(struct s_vary *vary, const struct cmd_sink *sink, int ui)
 {
     const float *ball_p = vary->uv[ui].p;
     const float  ball_r = vary->uv[ui].r;
@@ -546,11 +546,11 @@ int sol_swch_test(struct s_vary *vary, cmd_fn cmd_func, int ui)
                     {
                         xp->e = 1;
 
-                        if (cmd_func)
+                        if (sink)
                         {
                             union cmd cmd = { CMD_SWCH_ENTER };
                             cmd.swchenter.xi = xi;
-                            cmd_func(&cmd);
+                            cmd_sink_put(sink, &cmd);
                         }
                     }
 
@@ -558,14 +558,14 @@ int sol_swch_test(struct s_vary *vary, cmd_fn cmd_func, int ui)
 
                     xp->f = xp->f ? 0 : 1;
 
-                    if (cmd_func)
+                    if (sink)
                     {
                         union cmd cmd = { CMD_SWCH_TOGGLE };
                         cmd.swchtoggle.xi = xi;
-                        cmd_func(&cmd);
+                        cmd_sink_put(sink, &cmd);
                     }
 
-                    sol_path_loop(vary, cmd_func, xp->base->pi, xp->f);
+                    sol_path_loop(vary, sink, xp->base->pi, xp->f);
 
                     /* It toggled to non-default state, start the timer. */
 
@@ -588,11 +588,11 @@ int sol_swch_test(struct s_vary *vary, cmd_fn cmd_func, int ui)
             {
                 xp->e = 0;
 
-                if (cmd_func)
+                if (sink)
                 {
                     union cmd cmd = { CMD_SWCH_EXIT };
                     cmd.swchexit.xi = xi;
-                    cmd_func(&cmd);
+                    cmd_sink_put(sink, &cmd);
                 }
             }
         }
@@ -14,8 +14,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 
+#include <SDL_endian.h>
+
 #include "solid_base.h"
 #include "base_config.h"
 #include "binary.h"
@@ -27,59 +30,269 @@ enum
 {
     SOL_VERSION_1_5 = 6,
     SOL_VERSION_1_6 = 7,
-    SOL_VERSION_DEV
+    SOL_VERSION_DEV,
+    SOL_VERSION_SECT
 };
 
 #define SOL_VERSION_MIN  SOL_VERSION_1_5
+#define SOL_VERSION_MAX  SOL_VERSION_SECT
 #define SOL_VERSION_CURR SOL_VERSION_DEV
 
 #define SOL_MAGIC (0xAF | 'S' << 8 | 'O' << 16 | 'L' << 24)
 
 /*---------------------------------------------------------------------------*/
 
-static int sol_version;
+/*
+ * SOL files are read into memory whole and decoded from there.  All
+ * values are little-endian 32-bit words.  A read past the end of the
+ * data yields zeros and flags the buffer as truncated.
+ */
+struct sol_buf
+{
+    const unsigned char *p;
+    size_t n;
+    int    err;
+};
+
+static void buf_bytes(struct sol_buf *b, void *dst, size_t n)
+{
+    if (n <= b->n)
+    {
+        memcpy(dst, b->p, n);
+
+        b->p += n;
+        b->n -= n;
+    }
+    else
+    {
+        memset(dst, 0, n);
+
+        b->p += b->n;
+        b->n  = 0;
+        b->err = 1;
+    }
+}
+
+static int buf_index(struct sol_buf *b)
+{
+    unsigned char p[4];
+
+    buf_bytes(b, p, 4);
+
+    return (int) ((unsigned int) p[0]       |
+                  (unsigned int) p[1] << 8  |
+                  (unsigned int) p[2] << 16 |
+                  (unsigned int) p[3] << 24);
+}
+
+static float buf_float(struct sol_buf *b)
+{
+    int   i = buf_index(b);
+    float f;
+
+    memcpy(&f, &i, sizeof (f));
+
+    return f;
+}
+
+static void buf_array(struct sol_buf *b, float *v, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        v[i] = buf_float(b);
+}
+
+/*
+ * Read N records of the given SIZE whose layout in memory is exactly
+ * their layout in the file: a run of 32-bit int and float fields.
+ */
+static void buf_words(struct sol_buf *b, void *dst, int n, size_t size)
+{
+    if (n > 0 && dst)
+    {
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+        int *v = (int *) dst;
+        size_t i;
+
+        for (i = 0; i < n * size / 4; i++)
+            v[i] = buf_index(b);
+#else
+        buf_bytes(b, dst, n * size);
+#endif
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * A sectioned SOL begins with the magic, the version, and a count of
+ * sections, followed by a directory of that many section entries.
+ * Each section is an array of records laid out exactly as the structs
+ * below, in little-endian order, aligned to SOL_SECT_ALIGN bytes from
+ * the start of the file.  A loaded file may thus be used in place.
+ * Text and dictionary come first, so that metadata may be read
+ * without reading any geometry.
+ */
+
+#define SOL_SECT_ALIGN 16
+
+#define SECT_ALIGN(n) (((n) + SOL_SECT_ALIGN - 1) / SOL_SECT_ALIGN * SOL_SECT_ALIGN)
+
+enum
+{
+    SOL_SECT_TEXT = 0,
+    SOL_SECT_DICT,
+    SOL_SECT_MTRL,
+    SOL_SECT_VERT,
+    SOL_SECT_EDGE,
+    SOL_SECT_SIDE,
+    SOL_SECT_TEXC,
+    SOL_SECT_OFFS,
+    SOL_SECT_GEOM,
+    SOL_SECT_LUMP,
+    SOL_SECT_NODE,
+    SOL_SECT_PATH,
+    SOL_SECT_BODY,
+    SOL_SECT_ITEM,
+    SOL_SECT_GOAL,
+    SOL_SECT_JUMP,
+    SOL_SECT_SWCH,
+    SOL_SECT_BILL,
+    SOL_SECT_BALL,
+    SOL_SECT_VIEW,
+    SOL_SECT_INDX,
+
+    SOL_SECT_MAX
+};
+
+struct sol_sect
+{
+    int id;                             /* Section identifier                */
+    int count;                          /* Record count                      */
+    int size;                           /* Record size in bytes              */
+    int offset;                         /* Byte offset from start of file    */
+};
+
+#define SECT(c, v) {                          \
+    offsetof (struct s_base, c),              \
+    offsetof (struct s_base, v),              \
+    sizeof (*((struct s_base *) 0)->v)        \
+}
+
+/*
+ * Location of the count and the array of each section in s_base, and
+ * the size of its records.
+ */
+static const struct
+{
+    size_t c;
+    size_t v;
+    size_t size;
+} sects[SOL_SECT_MAX] = {
+    SECT(ac, av),
+    SECT(dc, dv),
+    SECT(mc, mv),
+    SECT(vc, vv),
+    SECT(ec, ev),
+    SECT(sc, sv),
+    SECT(tc, tv),
+    SECT(oc, ov),
+    SECT(gc, gv),
+    SECT(lc, lv),
+    SECT(nc, nv),
+    SECT(pc, pv),
+    SECT(bc, bv),
+    SECT(hc, hv),
+    SECT(zc, zv),
+    SECT(jc, jv),
+    SECT(xc, xv),
+    SECT(rc, rv),
+    SECT(uc, uv),
+    SECT(wc, wv),
+    SECT(ic, iv),
+};
+
+#define SECT_COUNT(fp, i) (*(int   *) ((char *) (fp) + sects[i].c))
+#define SECT_DATA(fp, i)  (*(void **) ((char *) (fp) + sects[i].v))
 
-static int sol_file(fs_file fin)
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+static void swap_words(void *data, size_t n)
+{
+    Uint32 *w = (Uint32 *) data;
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        w[i] = SDL_SwapLE32(w[i]);
+}
+
+/*
+ * Convert the records of a section between file and host order.  All
+ * fields are 32-bit except for text and material names.
+ */
+static void sol_swap_sect(int id, void *data, int count)
+{
+    if (id == SOL_SECT_MTRL)
+    {
+        struct b_mtrl *mp = (struct b_mtrl *) data;
+        int i;
+
+        for (i = 0; i < count; i++, mp++)
+        {
+            swap_words(mp, offsetof (struct b_mtrl, f) / 4);
+            swap_words(&mp->alpha_func, 2);
+        }
+    }
+    else if (id != SOL_SECT_TEXT)
+        swap_words(data, (size_t) count * sects[id].size / 4);
+}
+#endif
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Check the file header.  Return the file version, or 0 if the file
+ * cannot be read.
+ */
+static int sol_file(struct sol_buf *b)
 {
     int magic;
     int version;
 
-    magic   = get_index(fin);
-    version = get_index(fin);
+    magic   = buf_index(b);
+    version = buf_index(b);
 
     if (magic != SOL_MAGIC || (version < SOL_VERSION_MIN ||
-                               version > SOL_VERSION_CURR))
+                               version > SOL_VERSION_MAX))
         return 0;
 
-    sol_version = version;
-
-    return 1;
+    return version;
 }
 
-static void sol_load_mtrl(fs_file fin, struct b_mtrl *mp)
+static void sol_load_mtrl(struct sol_buf *b, int ver, struct b_mtrl *mp)
 {
-    get_array(fin, mp->d, 4);
-    get_array(fin, mp->a, 4);
-    get_array(fin, mp->s, 4);
-    get_array(fin, mp->e, 4);
-    get_array(fin, mp->h, 1);
+    buf_array(b, mp->d, 4);
+    buf_array(b, mp->a, 4);
+    buf_array(b, mp->s, 4);
+    buf_array(b, mp->e, 4);
+    buf_array(b, mp->h, 1);
 
-    mp->fl = get_index(fin);
+    mp->fl = buf_index(b);
 
-    fs_read(mp->f, 1, PATHMAX, fin);
+    buf_bytes(b, mp->f, PATHMAX);
 
-    if (sol_version >= SOL_VERSION_1_6)
+    if (ver >= SOL_VERSION_1_6)
     {
         if (mp->fl & M_ALPHA_TEST)
         {
-            mp->alpha_func = get_index(fin);
-            mp->alpha_ref  = get_float(fin);
+            mp->alpha_func = buf_index(b);
+            mp->alpha_ref  = buf_float(b);
         }
     }
 
     /* Convert 1.5.4 material flags. */
 
-    if (sol_version == SOL_VERSION_1_5)
+    if (ver == SOL_VERSION_1_5)
     {
         static const int flags[][2] = {
             { 1, M_SHADOWED },
@@ -112,129 +325,71 @@ static void sol_load_mtrl(fs_file fin, struct b_mtrl *mp)
     }
 }
 
-static void sol_load_vert(fs_file fin, struct b_vert *vp)
+static void sol_load_geom(struct sol_buf *b, struct b_geom *gp,
+                          struct s_base *fp)
 {
-    get_array(fin, vp->p, 3);
-}
+    struct b_offs ov[3];
+    int i, j, iv[3], oc;
+    void *p;
 
-static void sol_load_edge(fs_file fin, struct b_edge *ep)
-{
-    ep->vi = get_index(fin);
-    ep->vj = get_index(fin);
-}
+    /* Convert a 1.5 geom, which lists its offsets in place. */
 
-static void sol_load_side(fs_file fin, struct b_side *sp)
-{
-    get_array(fin, sp->n, 3);
+    gp->mi = buf_index(b);
 
-    sp->d = get_float(fin);
-}
+    oc = 0;
 
-static void sol_load_texc(fs_file fin, struct b_texc *tp)
-{
-    get_array(fin, tp->u, 2);
-}
+    for (i = 0; i < 3; i++)
+    {
+        ov[i].ti = buf_index(b);
+        ov[i].si = buf_index(b);
+        ov[i].vi = buf_index(b);
 
-static void sol_load_offs(fs_file fin, struct b_offs *op)
-{
-    op->ti = get_index(fin);
-    op->si = get_index(fin);
-    op->vi = get_index(fin);
-}
+        iv[i] = -1;
 
-static void sol_load_geom(fs_file fin, struct b_geom *gp, struct s_base *fp)
-{
-    gp->mi = get_index(fin);
+        for (j = 0; j < fp->oc; j++)
+            if (ov[i].ti == fp->ov[j].ti &&
+                ov[i].si == fp->ov[j].si &&
+                ov[i].vi == fp->ov[j].vi)
+            {
+                iv[i] = j;
+                break;
+            }
 
-    if (sol_version >= SOL_VERSION_1_6)
-    {
-        gp->oi = get_index(fin);
-        gp->oj = get_index(fin);
-        gp->ok = get_index(fin);
+        if (j == fp->oc)
+            oc++;
     }
-    else
-    {
-        struct b_offs ov[3];
-        int i, j, iv[3], oc;
-        void *p;
 
-        oc = 0;
+    if (oc && (p = realloc(fp->ov, sizeof (struct b_offs) * (fp->oc + oc))))
+    {
+        fp->ov = p;
 
         for (i = 0; i < 3; i++)
-        {
-            ov[i].ti = get_index(fin);
-            ov[i].si = get_index(fin);
-            ov[i].vi = get_index(fin);
-
-            iv[i] = -1;
-
-            for (j = 0; j < fp->oc; j++)
-                if (ov[i].ti == fp->ov[j].ti &&
-                    ov[i].si == fp->ov[j].si &&
-                    ov[i].vi == fp->ov[j].vi)
-                {
-                    iv[i] = j;
-                    break;
-                }
-
-            if (j == fp->oc)
-                oc++;
-        }
-
-        if (oc && (p = realloc(fp->ov, sizeof (struct b_offs) * (fp->oc + oc))))
-        {
-            fp->ov = p;
-
-            for (i = 0; i < 3; i++)
-                if (iv[i] < 0)
-                {
-                    fp->ov[fp->oc] = ov[i];
-                    iv[i] = fp->oc++;
-                }
-        }
-
-        gp->oi = iv[0];
-        gp->oj = iv[1];
-        gp->ok = iv[2];
+            if (iv[i] < 0)
+            {
+                fp->ov[fp->oc] = ov[i];
+                iv[i] = fp->oc++;
+            }
     }
-}
 
-static void sol_load_lump(fs_file fin, struct b_lump *lp)
-{
-    lp->fl = get_index(fin);
-    lp->v0 = get_index(fin);
-    lp->vc = get_index(fin);
-    lp->e0 = get_index(fin);
-    lp->ec = get_index(fin);
-    lp->g0 = get_index(fin);
-    lp->gc = get_index(fin);
-    lp->s0 = get_index(fin);
-    lp->sc = get_index(fin);
+    gp->oi = iv[0];
+    gp->oj = iv[1];
+    gp->ok = iv[2];
 }
 
-static void sol_load_node(fs_file fin, struct b_node *np)
+static void sol_load_path(struct sol_buf *b, int ver, struct b_path *pp)
 {
-    np->si = get_index(fin);
-    np->ni = get_index(fin);
-    np->nj = get_index(fin);
-    np->l0 = get_index(fin);
-    np->lc = get_index(fin);
-}
+    buf_array(b, pp->p, 3);
 
-static void sol_load_path(fs_file fin, struct b_path *pp)
-{
-    get_array(fin, pp->p, 3);
-
-    pp->t  = get_float(fin);
-    pp->pi = get_index(fin);
-    pp->f  = get_index(fin);
-    pp->s  = get_index(fin);
+    pp->t  = buf_float(b);
+    pp->pi = buf_index(b);
+    pp->f  = buf_index(b);
+    pp->s  = buf_index(b);
 
     pp->tm = TIME_TO_MS(pp->t);
     pp->t  = MS_TO_TIME(pp->tm);
 
-    if (sol_version >= SOL_VERSION_1_6)
-        pp->fl = get_index(fin);
+    if (ver >= SOL_VERSION_1_6)
+        pp->fl = buf_index(b);
 
     pp->e[0] = 1.0f;
     pp->e[1] = 0.0f;
@@ -242,16 +397,16 @@ static void sol_load_path(fs_file fin, struct b_path *pp)
     pp->e[3] = 0.0f;
 
     if (pp->fl & P_ORIENTED)
-        get_array(fin, pp->e, 4);
+        buf_array(b, pp->e, 4);
 }
 
-static void sol_load_body(fs_file fin, struct b_body *bp)
+static void sol_load_body(struct sol_buf *b, int ver, struct b_body *bp)
 {
-    bp->pi = get_index(fin);
+    bp->pi = buf_index(b);
 
-    if (sol_version >= SOL_VERSION_1_6)
+    if (ver >= SOL_VERSION_1_6)
     {
-        bp->pj = get_index(fin);
+        bp->pj = buf_index(b);
 
         if (bp->pj < 0)
             bp->pj = bp->pi;
@@ -259,123 +414,72 @@ static void sol_load_body(fs_file fin, struct b_body *bp)
     else
         bp->pj = bp->pi;
 
-    bp->ni = get_index(fin);
-    bp->l0 = get_index(fin);
-    bp->lc = get_index(fin);
-    bp->g0 = get_index(fin);
-    bp->gc = get_index(fin);
-}
-
-static void sol_load_item(fs_file fin, struct b_item *hp)
-{
-    get_array(fin, hp->p, 3);
-
-    hp->t = get_index(fin);
-    hp->n = get_index(fin);
-}
-
-static void sol_load_goal(fs_file fin, struct b_goal *zp)
-{
-    get_array(fin, zp->p, 3);
-
-    zp->r = get_float(fin);
+    bp->ni = buf_index(b);
+    bp->l0 = buf_index(b);
+    bp->lc = buf_index(b);
+    bp->g0 = buf_index(b);
+    bp->gc = buf_index(b);
 }
 
-static void sol_load_swch(fs_file fin, struct b_swch *xp)
+static void sol_load_swch(struct sol_buf *b, struct b_swch *xp)
 {
-    get_array(fin, xp->p, 3);
+    buf_array(b, xp->p, 3);
 
-    xp->r  = get_float(fin);
-    xp->pi = get_index(fin);
-    xp->t  = get_float(fin);
-    (void)   get_float(fin);
-    xp->f  = get_index(fin);
-    (void)   get_index(fin);
-    xp->i  = get_index(fin);
+    xp->r  = buf_float(b);
+    xp->pi = buf_index(b);
+    xp->t  = buf_float(b);
+    (void)   buf_float(b);
+    xp->f  = buf_index(b);
+    (void)   buf_index(b);
+    xp->i  = buf_index(b);
 
     xp->tm = TIME_TO_MS(xp->t);
     xp->t = MS_TO_TIME(xp->tm);
 }
 
-static void sol_load_bill(fs_file fin, struct b_bill *rp)
-{
-    rp->fl = get_index(fin);
-    rp->mi = get_index(fin);
-    rp->t  = get_float(fin);
-    rp->d  = get_float(fin);
-
-    get_array(fin, rp->w,  3);
-    get_array(fin, rp->h,  3);
-    get_array(fin, rp->rx, 3);
-    get_array(fin, rp->ry, 3);
-    get_array(fin, rp->rz, 3);
-    get_array(fin, rp->p,  3);
-}
-
-static void sol_load_jump(fs_file fin, struct b_jump *jp)
-{
-    get_array(fin, jp->p, 3);
-    get_array(fin, jp->q, 3);
-
-    jp->r = get_float(fin);
-}
-
-static void sol_load_ball(fs_file fin, struct b_ball *up)
-{
-    get_array(fin, up->p, 3);
-
-    up->r = get_float(fin);
-}
-
-static void sol_load_view(fs_file fin, struct b_view *wp)
-{
-    get_array(fin, wp->p, 3);
-    get_array(fin, wp->q, 3);
-}
-
-static void sol_load_dict(fs_file fin, struct b_dict *dp)
-{
-    dp->ai = get_index(fin);
-    dp->aj = get_index(fin);
-}
-
-static void sol_load_indx(fs_file fin, struct s_base *fp)
+static int sol_load_indx(struct sol_buf *b, int ver, struct s_base *fp)
 {
-    fp->ac = get_index(fin);
-    fp->dc = get_index(fin);
-    fp->mc = get_index(fin);
-    fp->vc = get_index(fin);
-    fp->ec = get_index(fin);
-    fp->sc = get_index(fin);
-    fp->tc = get_index(fin);
-
-    if (sol_version >= SOL_VERSION_1_6)
-        fp->oc = get_index(fin);
-
-    fp->gc = get_index(fin);
-    fp->lc = get_index(fin);
-    fp->nc = get_index(fin);
-    fp->pc = get_index(fin);
-    fp->bc = get_index(fin);
-    fp->hc = get_index(fin);
-    fp->zc = get_index(fin);
-    fp->jc = get_index(fin);
-    fp->xc = get_index(fin);
-    fp->rc = get_index(fin);
-    fp->uc = get_index(fin);
-    fp->wc = get_index(fin);
-    fp->ic = get_index(fin);
+    fp->ac = buf_index(b);
+    fp->dc = buf_index(b);
+    fp->mc = buf_index(b);
+    fp->vc = buf_index(b);
+    fp->ec = buf_index(b);
+    fp->sc = buf_index(b);
+    fp->tc = buf_index(b);
+
+    if (ver >= SOL_VERSION_1_6)
+        fp->oc = buf_index(b);
+
+    fp->gc = buf_index(b);
+    fp->lc = buf_index(b);
+    fp->nc = buf_index(b);
+    fp->pc = buf_index(b);
+    fp->bc = buf_index(b);
+    fp->hc = buf_index(b);
+    fp->zc = buf_index(b);
+    fp->jc = buf_index(b);
+    fp->xc = buf_index(b);
+    fp->rc = buf_index(b);
+    fp->uc = buf_index(b);
+    fp->wc = buf_index(b);
+    fp->ic = buf_index(b);
+
+    /* Reject counts that cannot be right. */
+
+    return !b->err && (fp->ac | fp->dc | fp->mc | fp->vc | fp->ec |
+                       fp->sc | fp->tc | fp->oc | fp->gc | fp->lc |
+                       fp->nc | fp->pc | fp->bc | fp->hc | fp->zc |
+                       fp->jc | fp->xc | fp->rc | fp->uc | fp->wc |
+                       fp->ic) >= 0;
 }
 
-static int sol_load_file(fs_file fin, struct s_base *fp)
+static int sol_load_file(struct sol_buf *b, int ver, struct s_base *fp)
 {
     int i;
 
-    if (!sol_file(fin))
+    if (!sol_load_indx(b, ver, fp))
         return 0;
 
-    sol_load_indx(fin, fp);
-
     if (fp->ac)
         fp->av = (char *)          calloc(fp->ac, sizeof (*fp->av));
     if (fp->mc)
@@ -419,29 +523,45 @@ static int sol_load_file(fs_file fin, struct s_base *fp)
     if (fp->ic)
         fp->iv = (int *)           calloc(fp->ic, sizeof (*fp->iv));
 
-    if (fp->ac)
-        fs_read(fp->av, 1, fp->ac, fin);
-
-    for (i = 0; i < fp->dc; i++) sol_load_dict(fin, fp->dv + i);
-    for (i = 0; i < fp->mc; i++) sol_load_mtrl(fin, fp->mv + i);
-    for (i = 0; i < fp->vc; i++) sol_load_vert(fin, fp->vv + i);
-    for (i = 0; i < fp->ec; i++) sol_load_edge(fin, fp->ev + i);
-    for (i = 0; i < fp->sc; i++) sol_load_side(fin, fp->sv + i);
-    for (i = 0; i < fp->tc; i++) sol_load_texc(fin, fp->tv + i);
-    for (i = 0; i < fp->oc; i++) sol_load_offs(fin, fp->ov + i);
-    for (i = 0; i < fp->gc; i++) sol_load_geom(fin, fp->gv + i, fp);
-    for (i = 0; i < fp->lc; i++) sol_load_lump(fin, fp->lv + i);
-    for (i = 0; i < fp->nc; i++) sol_load_node(fin, fp->nv + i);
-    for (i = 0; i < fp->pc; i++) sol_load_path(fin, fp->pv + i);
-    for (i = 0; i < fp->bc; i++) sol_load_body(fin, fp->bv + i);
-    for (i = 0; i < fp->hc; i++) sol_load_item(fin, fp->hv + i);
-    for (i = 0; i < fp->zc; i++) sol_load_goal(fin, fp->zv + i);
-    for (i = 0; i < fp->jc; i++) sol_load_jump(fin, fp->jv + i);
-    for (i = 0; i < fp->xc; i++) sol_load_swch(fin, fp->xv + i);
-    for (i = 0; i < fp->rc; i++) sol_load_bill(fin, fp->rv + i);
-    for (i = 0; i < fp->uc; i++) sol_load_ball(fin, fp->uv + i);
-    for (i = 0; i < fp->wc; i++) sol_load_view(fin, fp->wv + i);
-    for (i = 0; i < fp->ic; i++) fp->iv[i] = get_index(fin);
+    if (fp->ac && fp->av)
+        buf_bytes(b, fp->av, fp->ac);
+
+    /* Sections laid out in the file as they are in memory are copied. */
+
+    buf_words(b, fp->dv, fp->dc, sizeof (*fp->dv));
+
+    for (i = 0; i < fp->mc; i++) sol_load_mtrl(b, ver, fp->mv + i);
+
+    buf_words(b, fp->vv, fp->vc, sizeof (*fp->vv));
+    buf_words(b, fp->ev, fp->ec, sizeof (*fp->ev));
+    buf_words(b, fp->sv, fp->sc, sizeof (*fp->sv));
+    buf_words(b, fp->tv, fp->tc, sizeof (*fp->tv));
+    buf_words(b, fp->ov, fp->oc, sizeof (*fp->ov));
+
+    if (ver >= SOL_VERSION_1_6)
+        buf_words(b, fp->gv, fp->gc, sizeof (*fp->gv));
+    else
+        for (i = 0; i < fp->gc; i++) sol_load_geom(b, fp->gv + i, fp);
+
+    buf_words(b, fp->lv, fp->lc, sizeof (*fp->lv));
+    buf_words(b, fp->nv, fp->nc, sizeof (*fp->nv));
+
+    for (i = 0; i < fp->pc; i++) sol_load_path(b, ver, fp->pv + i);
+    for (i = 0; i < fp->bc; i++) sol_load_body(b, ver, fp->bv + i);
+
+    buf_words(b, fp->hv, fp->hc, sizeof (*fp->hv));
+    buf_words(b, fp->zv, fp->zc, sizeof (*fp->zv));
+    buf_words(b, fp->jv, fp->jc, sizeof (*fp->jv));
+
+    for (i = 0; i < fp->xc; i++) sol_load_swch(b, fp->xv + i);
+
+    buf_words(b, fp->rv, fp->rc, sizeof (*fp->rv));
+    buf_words(b, fp->uv, fp->uc, sizeof (*fp->uv));
+    buf_words(b, fp->wv, fp->wc, sizeof (*fp->wv));
+    buf_words(b, fp->iv, fp->ic, sizeof (*fp->iv));
+
+    if (b->err)
+        return 0;
 
     /* Magically "fix" all of our code. */
 
@@ -453,7 +573,7 @@ static int sol_load_file(fs_file fin, struct s_base *fp)
 
     /* Add lit flag to old materials. */
 
-    if (sol_version <= SOL_VERSION_1_6)
+    if (ver <= SOL_VERSION_1_6)
     {
         for (i = 0; i < fp->mc; ++i)
             fp->mv[i].fl |= M_LIT;
@@ -465,43 +585,395 @@ static int sol_load_file(fs_file fin, struct s_base *fp)
     return 1;
 }
 
+/*
+ * Check a section entry against the file SIZE and the expected record
+ * size of its section.
+ */
+static int sol_sect_valid(const struct sol_sect *sp, int size)
+{
+    return (sp->count  >= 0 &&
+            sp->offset >= 0 && sp->offset % 4 == 0 &&
+            sp->size == (int) sects[sp->id].size &&
+            (double) sp->offset +
+            (double) sp->count * sp->size <= (double) size);
+}
+
+/*
+ * Read a directory of N entries.
+ */
+static int sol_load_sect_head(struct sol_buf *b, int n, struct sol_sect *sv)
+{
+    int i;
+
+    memset(sv, 0, SOL_SECT_MAX * sizeof (*sv));
+
+    for (i = 0; i < SOL_SECT_MAX; i++)
+        sv[i].id = -1;
+
+    /* Keep the entry of each known section.  Skip any others. */
+
+    for (i = 0; i < n && !b->err; i++)
+    {
+        struct sol_sect s;
+
+        s.id     = buf_index(b);
+        s.count  = buf_index(b);
+        s.size   = buf_index(b);
+        s.offset = buf_index(b);
+
+        if (s.id >= 0 && s.id < SOL_SECT_MAX)
+            sv[s.id] = s;
+    }
+    return !b->err;
+}
+
+/*
+ * Point the arrays of FP into its mapped file.  On big-endian hosts,
+ * the private mapping is converted in place.
+ */
+static int sol_load_sect(struct sol_buf *b, struct s_base *fp)
+{
+    struct sol_sect sv[SOL_SECT_MAX];
+    unsigned char *data = (unsigned char *) fp->map.data;
+    int i;
+
+    if (!sol_load_sect_head(b, buf_index(b), sv))
+        return 0;
+
+    for (i = 0; i < SOL_SECT_MAX; i++)
+    {
+        if (sv[i].id < 0)
+            continue;
+
+        if (!sol_sect_valid(sv + i, fp->map.size))
+            return 0;
+
+        if (sv[i].count)
+        {
+            SECT_COUNT(fp, i) = sv[i].count;
+            SECT_DATA (fp, i) = data + sv[i].offset;
+
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+            sol_swap_sect(i, SECT_DATA(fp, i), sv[i].count);
+#endif
+        }
+    }
+
+    if (!fp->uc)
+    {
+        fp->uc = 1;
+        fp->uv = (struct b_ball *) calloc(fp->uc, sizeof (*fp->uv));
+    }
+
+    return 1;
+}
+
+/*
+ * Read the text and dictionary of a sectioned file, which follow its
+ * directory.
+ */
+static int sol_load_sect_meta(fs_file fin, struct s_base *fp)
+{
+    struct sol_sect sv[SOL_SECT_MAX];
+    struct sol_buf b;
+    unsigned char head[4];
+    unsigned char *data;
+    int i, n, pos, end = 0;
+
+    /* Read the directory. */
+
+    b.p   = head;
+    b.n   = fs_read(head, 1, 4, fin);
+    b.err = 0;
+
+    if ((n = buf_index(&b)) < 0 || n > 0x10000)
+        return 0;
+
+    pos = 12 + n * (int) sizeof (struct sol_sect);
+
+    if (!(data = malloc(n * sizeof (struct sol_sect) + 1)))
+        return 0;
+
+    b.p   = data;
+    b.n   = fs_read(data, 1, n * sizeof (struct sol_sect), fin);
+    b.err = 0;
+
+    i = sol_load_sect_head(&b, n, sv);
+
+    free(data);
+
+    if (!i)
+        return 0;
+
+    /* Report every count, as the stream format does. */
+
+    for (i = 0; i < SOL_SECT_MAX; i++)
+        if (sv[i].id >= 0 && i != SOL_SECT_TEXT && i != SOL_SECT_DICT)
+            SECT_COUNT(fp, i) = sv[i].count;
+
+    /* Read up to the end of the text and dictionary. */
+
+    for (i = SOL_SECT_TEXT; i <= SOL_SECT_DICT; i++)
+        if (sv[i].id >= 0)
+        {
+            if (!sol_sect_valid(sv + i, 0x7fffffff) || sv[i].offset < pos)
+                return 0;
+
+            end = MAX(end, sv[i].offset + sv[i].count * sv[i].size);
+        }
+
+    if (end <= pos)
+        return 1;
+
+    if (!(data = malloc(end - pos)))
+        return 0;
+
+    if (fs_read(data, 1, end - pos, fin) == end - pos)
+    {
+        if (sv[SOL_SECT_TEXT].count > 0 &&
+            (fp->av = (char *) malloc(sv[SOL_SECT_TEXT].count)))
+        {
+            fp->ac = sv[SOL_SECT_TEXT].count;
+            memcpy(fp->av, data + sv[SOL_SECT_TEXT].offset - pos, fp->ac);
+        }
+
+        if (sv[SOL_SECT_DICT].count > 0 &&
+            (fp->dv = (struct b_dict *) calloc(sv[SOL_SECT_DICT].count,
+                                               sizeof (*fp->dv))))
+        {
+            fp->dc = sv[SOL_SECT_DICT].count;
+
+            b.p   = data + sv[SOL_SECT_DICT].offset - pos;
+            b.n   = fp->dc * sizeof (*fp->dv);
+            b.err = 0;
+
+            buf_words(&b, fp->dv, fp->dc, sizeof (*fp->dv));
+        }
+        free(data);
+        return 1;
+    }
+
+    free(data);
+    return 0;
+}
+
+/*
+ * Read only the header, text, and dictionary of a file.  These are
+ * small and come first, so read them piecemeal instead of whole.
+ */
 static int sol_load_head(fs_file fin, struct s_base *fp)
 {
-    if (!sol_file(fin))
+    unsigned char data[23 * 4];
+    struct sol_buf b;
+    int ver, n;
+
+    /* Read the magic and version, then the counts this version has. */
+
+    b.p   = data;
+    b.n   = fs_read(data, 1, 8, fin);
+    b.err = 0;
+
+    if (!(ver = sol_file(&b)))
         return 0;
 
-    sol_load_indx(fin, fp);
+    if (ver == SOL_VERSION_SECT)
+        return sol_load_sect_meta(fin, fp);
+
+    n = (ver >= SOL_VERSION_1_6 ? 21 : 20) * 4;
+
+    b.p   = data;
+    b.n   = fs_read(data, 1, n, fin);
+    b.err = 0;
+
+    if (!sol_load_indx(&b, ver, fp))
+        return 0;
 
     if (fp->ac)
     {
         fp->av = (char *) calloc(fp->ac, sizeof (*fp->av));
-        fs_read(fp->av, 1, fp->ac, fin);
+
+        if (!fp->av || fs_read(fp->av, 1, fp->ac, fin) != fp->ac)
+            return 0;
     }
 
     if (fp->dc)
     {
-        int i;
+        n = fp->dc * sizeof (*fp->dv);
 
         fp->dv = (struct b_dict *) calloc(fp->dc, sizeof (*fp->dv));
 
-        for (i = 0; i < fp->dc; i++)
-            sol_load_dict(fin, fp->dv + i);
+        if (!fp->dv || fs_read(fp->dv, 1, n, fin) != n)
+            return 0;
+
+        /* Decode the dictionary in place. */
+
+        b.p   = (const unsigned char *) fp->dv;
+        b.n   = n;
+        b.err = 0;
+
+        buf_words(&b, fp->dv, fp->dc, sizeof (*fp->dv));
     }
 
     return 1;
 }
 
+static void sol_free_soa(struct s_base *fp)
+{
+    struct s_soa *sp = &fp->soa;
+
+    free(sp->lv0);
+    free(sp->le0);
+    free(sp->ls0);
+    free(sp->vx);
+    free(sp->vy);
+    free(sp->vz);
+    free(sp->qx);
+    free(sp->qy);
+    free(sp->qz);
+    free(sp->ux);
+    free(sp->uy);
+    free(sp->uz);
+    free(sp->nx);
+    free(sp->ny);
+    free(sp->nz);
+    free(sp->nd);
+
+    memset(sp, 0, sizeof (*sp));
+}
+
+#define SOA_RUN(n) (((n) + SOL_SOA_PAD - 1) / SOL_SOA_PAD * SOL_SOA_PAD)
+
+/*
+ * Build structure-of-arrays copies of lump verts, edges, and sides.  On
+ * allocation failure the copies are simply absent and the simulation
+ * tests lumps one element at a time.
+ */
+static void sol_load_soa(struct s_base *fp)
+{
+    struct s_soa *sp = &fp->soa;
+
+    int vn = 0;
+    int en = 0;
+    int sn = 0;
+    int i, j;
+
+    if (!fp->lc)
+        return;
+
+    sp->lv0 = (int *) calloc(fp->lc, sizeof (*sp->lv0));
+    sp->le0 = (int *) calloc(fp->lc, sizeof (*sp->le0));
+    sp->ls0 = (int *) calloc(fp->lc, sizeof (*sp->ls0));
+
+    if (!sp->lv0 || !sp->le0 || !sp->ls0)
+        goto fail;
+
+    for (i = 0; i < fp->lc; i++)
+    {
+        sp->lv0[i] = vn;
+        sp->le0[i] = en;
+        sp->ls0[i] = sn;
+
+        vn += SOA_RUN(fp->lv[i].vc);
+        en += SOA_RUN(fp->lv[i].ec);
+        sn += SOA_RUN(fp->lv[i].sc);
+    }
+
+    vn = MAX(vn, 1);
+    en = MAX(en, 1);
+    sn = MAX(sn, 1);
+
+    sp->vx = (float *) calloc(vn, sizeof (float));
+    sp->vy = (float *) calloc(vn, sizeof (float));
+    sp->vz = (float *) calloc(vn, sizeof (float));
+    sp->qx = (float *) calloc(en, sizeof (float));
+    sp->qy = (float *) calloc(en, sizeof (float));
+    sp->qz = (float *) calloc(en, sizeof (float));
+    sp->ux = (float *) calloc(en, sizeof (float));
+    sp->uy = (float *) calloc(en, sizeof (float));
+    sp->uz = (float *) calloc(en, sizeof (float));
+    sp->nx = (float *) calloc(sn, sizeof (float));
+    sp->ny = (float *) calloc(sn, sizeof (float));
+    sp->nz = (float *) calloc(sn, sizeof (float));
+    sp->nd = (float *) calloc(sn, sizeof (float));
+
+    if (!sp->vx || !sp->vy || !sp->vz ||
+        !sp->qx || !sp->qy || !sp->qz ||
+        !sp->ux || !sp->uy || !sp->uz ||
+        !sp->nx || !sp->ny || !sp->nz || !sp->nd)
+        goto fail;
+
+    for (i = 0; i < fp->lc; i++)
+    {
+        const struct b_lump *lp = fp->lv + i;
+
+        for (j = 0; j < lp->vc; j++)
+        {
+            const struct b_vert *vp = fp->vv + fp->iv[lp->v0 + j];
+
+            sp->vx[sp->lv0[i] + j] = vp->p[0];
+            sp->vy[sp->lv0[i] + j] = vp->p[1];
+            sp->vz[sp->lv0[i] + j] = vp->p[2];
+        }
+
+        for (j = 0; j < lp->ec; j++)
+        {
+            const struct b_edge *ep = fp->ev + fp->iv[lp->e0 + j];
+
+            const float *p = fp->vv[ep->vi].p;
+            const float *q = fp->vv[ep->vj].p;
+
+            sp->qx[sp->le0[i] + j] = p[0];
+            sp->qy[sp->le0[i] + j] = p[1];
+            sp->qz[sp->le0[i] + j] = p[2];
+            sp->ux[sp->le0[i] + j] = q[0] - p[0];
+            sp->uy[sp->le0[i] + j] = q[1] - p[1];
+            sp->uz[sp->le0[i] + j] = q[2] - p[2];
+        }
+
+        for (j = 0; j < lp->sc; j++)
+        {
+            const struct b_side *sq = fp->sv + fp->iv[lp->s0 + j];
+
+            sp->nx[sp->ls0[i] + j] = sq->n[0];
+            sp->ny[sp->ls0[i] + j] = sq->n[1];
+            sp->nz[sp->ls0[i] + j] = sq->n[2];
+            sp->nd[sp->ls0[i] + j] = sq->d;
+        }
+    }
+    return;
+
+fail:
+    sol_free_soa(fp);
+}
+
 int sol_load_base(struct s_base *fp, const char *filename)
 {
-    fs_file fin;
-    int res = 0;
+    struct sol_buf b;
+    int ver, res = 0;
 
     memset(fp, 0, sizeof (*fp));
 
-    if ((fin = fs_open_read(filename)))
+    if (fs_map(filename, &fp->map))
     {
-        res = sol_load_file(fin, fp);
-        fs_close(fin);
+        b.p   = (const unsigned char *) fp->map.data;
+        b.n   = (size_t) fp->map.size;
+        b.err = 0;
+
+        if ((ver = sol_file(&b)) == SOL_VERSION_SECT)
+            res = sol_load_sect(&b, fp);
+        else if (ver)
+        {
+            res = sol_load_file(&b, ver, fp);
+
+            /* Everything has been copied out of the file. */
+
+            fs_unmap(&fp->map);
+        }
+
+        if (res)
+            sol_load_soa(fp);
+        else
+            sol_free_base(fp);
     }
     return res;
 }
@@ -515,7 +987,9 @@ int sol_load_meta(struct s_base *fp, const char *filename)
 
     if ((fin = fs_open_read(filename)))
     {
-        res = sol_load_head(fin, fp);
+        if (!(res = sol_load_head(fin, fp)))
+            sol_free_base(fp);
+
         fs_close(fin);
     }
     return res;
@@ -523,27 +997,25 @@ int sol_load_meta(struct s_base *fp, const char *filename)
 
 void sol_free_base(struct s_base *fp)
 {
-    if (fp->av) free(fp->av);
-    if (fp->mv) free(fp->mv);
-    if (fp->vv) free(fp->vv);
-    if (fp->ev) free(fp->ev);
-    if (fp->sv) free(fp->sv);
-    if (fp->tv) free(fp->tv);
-    if (fp->ov) free(fp->ov);
-    if (fp->gv) free(fp->gv);
-    if (fp->lv) free(fp->lv);
-    if (fp->nv) free(fp->nv);
-    if (fp->pv) free(fp->pv);
-    if (fp->bv) free(fp->bv);
-    if (fp->hv) free(fp->hv);
-    if (fp->zv) free(fp->zv);
-    if (fp->jv) free(fp->jv);
-    if (fp->xv) free(fp->xv);
-    if (fp->rv) free(fp->rv);
-    if (fp->uv) free(fp->uv);
-    if (fp->wv) free(fp->wv);
-    if (fp->dv) free(fp->dv);
-    if (fp->iv) free(fp->iv);
+    const char *a = (const char *) fp->map.data;
+    const char *z = (const char *) fp->map.data + fp->map.size;
+
+    int i;
+
+    /* Free each array, unless it is part of the file. */
+
+    for (i = 0; i < SOL_SECT_MAX; i++)
+    {
+        const char *p = (const char *) SECT_DATA(fp, i);
+
+        if (p && !(a && a <= p && p < z))
+            free(SECT_DATA(fp, i));
+    }
+
+    if (fp->map.data)
+        fs_unmap(&fp->map);
+
+    sol_free_soa(fp);
 
     memset(fp, 0, sizeof (*fp));
 }
@@ -746,7 +1218,8 @@ static void sol_stor_file(fs_file fout, struct s_base *fp)
     put_index(fout, fp->wc);
     put_index(fout, fp->ic);
 
-    fs_write(fp->av, 1, fp->ac, fout);
+    if (fp->ac)
+        fs_write(fp->av, 1, fp->ac, fout);
 
     for (i = 0; i < fp->dc; i++) sol_stor_dict(fout, fp->dv + i);
     for (i = 0; i < fp->mc; i++) sol_stor_mtrl(fout, fp->mv + i);
@@ -784,6 +1257,128 @@ int sol_stor_base(struct s_base *fp, const char *filename)
     return 0;
 }
 
+/*
+ * Bring records into the form in which they are loaded.  The stream
+ * loader derives these values as it goes.  A sectioned file is used
+ * as it is, so they must be stored.
+ */
+static void sol_stor_sect_fix(int id, void *data, int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (id == SOL_SECT_PATH)
+        {
+            struct b_path *pp = (struct b_path *) data + i;
+
+            pp->tm = TIME_TO_MS(pp->t);
+            pp->t  = MS_TO_TIME(pp->tm);
+
+            if (!(pp->fl & P_ORIENTED))
+            {
+                pp->e[0] = 1.0f;
+                pp->e[1] = 0.0f;
+                pp->e[2] = 0.0f;
+                pp->e[3] = 0.0f;
+            }
+        }
+        if (id == SOL_SECT_BODY)
+        {
+            struct b_body *bp = (struct b_body *) data + i;
+
+            if (bp->pj < 0)
+                bp->pj = bp->pi;
+        }
+        if (id == SOL_SECT_SWCH)
+        {
+            struct b_swch *xp = (struct b_swch *) data + i;
+
+            xp->tm = TIME_TO_MS(xp->t);
+            xp->t  = MS_TO_TIME(xp->tm);
+        }
+    }
+}
+
+static int sol_stor_sect_file(fs_file fout, struct s_base *fp)
+{
+    static const char pad[SOL_SECT_ALIGN];
+
+    struct sol_sect sv[SOL_SECT_MAX];
+    int i, pos;
+
+    /* Lay out the sections after the directory. */
+
+    pos = 12 + (int) sizeof (sv);
+
+    for (i = 0; i < SOL_SECT_MAX; i++)
+    {
+        pos = SECT_ALIGN(pos);
+
+        sv[i].id     = i;
+        sv[i].count  = SECT_COUNT(fp, i);
+        sv[i].size   = (int) sects[i].size;
+        sv[i].offset = pos;
+
+        pos += sv[i].count * sv[i].size;
+    }
+
+    put_index(fout, SOL_MAGIC);
+    put_index(fout, SOL_VERSION_SECT);
+    put_index(fout, SOL_SECT_MAX);
+
+    for (i = 0; i < SOL_SECT_MAX; i++)
+    {
+        put_index(fout, sv[i].id);
+        put_index(fout, sv[i].count);
+        put_index(fout, sv[i].size);
+        put_index(fout, sv[i].offset);
+    }
+
+    pos = 12 + (int) sizeof (sv);
+
+    /* Write each section from a copy in file form. */
+
+    for (i = 0; i < SOL_SECT_MAX; i++)
+    {
+        const int n = sv[i].count * sv[i].size;
+        void *data;
+
+        fs_write(pad, 1, sv[i].offset - pos, fout);
+
+        if (n > 0)
+        {
+            if (!(data = malloc(n)))
+                return 0;
+
+            memcpy(data, SECT_DATA(fp, i), n);
+
+            sol_stor_sect_fix(i, data, sv[i].count);
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+            sol_swap_sect(i, data, sv[i].count);
+#endif
+            fs_write(data, 1, n, fout);
+            free(data);
+        }
+
+        pos = sv[i].offset + n;
+    }
+    return 1;
+}
+
+int sol_stor_sect(struct s_base *fp, const char *filename)
+{
+    fs_file fout;
+    int res = 0;
+
+    if ((fout = fs_open_write(filename)))
+    {
+        res = sol_stor_sect_file(fout, fp);
+        fs_close(fout);
+    }
+    return res;
+}
+
 /*---------------------------------------------------------------------------*/
 
 const struct path tex_paths[4] = {
@@ -834,8 +1429,8 @@ static const struct
 
 int mtrl_read(struct b_mtrl *mp, const char *name)
 {
-    static char line[MAXSTR];
-    static char word[MAXSTR];
+    char line[MAXSTR];
+    char word[MAXSTR];
 
     fs_file fp;
     int i;
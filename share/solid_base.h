@@ -16,6 +16,7 @@
 #define SOLID_BASE_H
 
 #include "base_config.h"
+#include "fs.h"
 
 /*
  * Some might  be taken  aback at  the terseness of  the names  of the
@@ -284,6 +285,26 @@ struct b_dict
     int aj;
 };
 
+/*
+ * Each lump's verts, edges, and sides occupy runs of SOL_SOA_PAD slots
+ * starting at LV0[li], LE0[li], and LS0[li] respectively.  Slots past
+ * the end of a run are zero.
+ */
+
+#define SOL_SOA_PAD 8
+
+struct s_soa
+{
+    int *lv0;                                  /* lump vert run offsets      */
+    int *le0;                                  /* lump edge run offsets      */
+    int *ls0;                                  /* lump side run offsets      */
+
+    float *vx, *vy, *vz;                       /* vert positions             */
+    float *qx, *qy, *qz;                       /* edge origins               */
+    float *ux, *uy, *uz;                       /* edge vectors               */
+    float *nx, *ny, *nz, *nd;                  /* side normals and distances */
+};
+
 struct s_base
 {
     int ac;
@@ -334,6 +355,18 @@ struct s_base
      * A mapping from internal to cached material indices.
      */
     int *mtrls;
+
+    /*
+     * Structure-of-arrays copies of lump verts, edges, and side
+     * planes, for batched collision tests.  See sol_load_soa.
+     */
+    struct s_soa soa;
+
+    /*
+     * The file a sectioned SOL was read from.  Its arrays point into
+     * this data rather than being allocated.  See sol_load_sect.
+     */
+    struct fs_map map;
 };
 
 /*---------------------------------------------------------------------------*/
@@ -342,6 +375,7 @@ int  sol_load_base(struct s_base *, const char *);
 int  sol_load_meta(struct s_base *, const char *);
 void sol_free_base(struct s_base *);
 int  sol_stor_base(struct s_base *, const char *);
+int  sol_stor_sect(struct s_base *, const char *);
 
 /*---------------------------------------------------------------------------*/
 
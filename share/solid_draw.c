@@ -29,6 +29,9 @@
 #include "config.h"
 #include "base_config.h"
 #include "lang.h"
+#include "array.h"
+#include "common.h"
+#include "overlap.h"
 
 #include "solid_draw.h"
 #include "solid_all.h"
@@ -130,6 +133,43 @@ static void sol_transform(const struct s_vary *vary,
 
 /*---------------------------------------------------------------------------*/
 
+/*
+ * Billboards are transformed on the CPU and streamed to the GL in one
+ * vertex buffer per call, drawn in batches of one material each (see
+ * overlap.h).
+ */
+
+struct d_bvert
+{
+    GLfloat t[2];
+    GLfloat p[3];
+};
+
+enum
+{
+    BILL_T = 0,
+    BILL_W,
+    BILL_H,
+    BILL_RX,
+    BILL_RY,
+    BILL_RZ,
+    BILL_MAX
+};
+
+struct d_bill
+{
+    GLuint vbo;                         /* Streamed vertex buffer            */
+
+    float          *fv;                 /* Evaluated parameters, by kind     */
+    struct d_bvert *vv;                 /* Vertices, 6 per billboard         */
+    struct d_bvert *uv;                 /* ...sorted by batch                */
+    int            *iv;                 /* Batch of each billboard, or -1    */
+    struct overlap *bv;                 /* Batches, keyed by material        */
+    int             bc;
+
+    float C[16];                        /* Current model-to-clip transform   */
+};
+
 static void sol_load_bill(struct s_draw *draw)
 {
     static const GLfloat data[] = {
@@ -144,16 +184,61 @@ static void sol_load_bill(struct s_draw *draw)
         1.0f,  1.0f,  0.5f,  0.5f,
     };
 
+    const int n = draw->base->rc;
+
+    struct d_bill *bp;
+
     /* Initialize a vertex buffer object for billboard drawing. */
 
     glGenBuffers_(1,              &draw->bill);
     glBindBuffer_(GL_ARRAY_BUFFER, draw->bill);
     glBufferData_(GL_ARRAY_BUFFER, sizeof (data), data, GL_STATIC_DRAW);
     glBindBuffer_(GL_ARRAY_BUFFER, 0);
+
+    /* Allocate batching state for the billboards of this file. */
+
+    if (n > 0 && (bp = calloc(1, sizeof (*bp))))
+    {
+        bp->fv = malloc(n * BILL_MAX * sizeof (*bp->fv));
+        bp->vv = malloc(n * 6 * sizeof (*bp->vv));
+        bp->uv = malloc(n * 6 * sizeof (*bp->uv));
+        bp->iv = malloc(n * sizeof (*bp->iv));
+        bp->bv = malloc(n * sizeof (*bp->bv));
+
+        if (bp->fv && bp->vv && bp->uv && bp->iv && bp->bv)
+        {
+            glGenBuffers_(1, &bp->vbo);
+            draw->bills = bp;
+        }
+        else
+        {
+            free(bp->fv);
+            free(bp->vv);
+            free(bp->uv);
+            free(bp->iv);
+            free(bp->bv);
+            free(bp);
+        }
+    }
 }
 
 static void sol_free_bill(struct s_draw *draw)
 {
+    struct d_bill *bp;
+
+    if ((bp = draw->bills))
+    {
+        glDeleteBuffers_(1, &bp->vbo);
+
+        free(bp->fv);
+        free(bp->vv);
+        free(bp->uv);
+        free(bp->iv);
+        free(bp->bv);
+        free(bp);
+
+        draw->bills = NULL;
+    }
     glDeleteBuffers_(1, &draw->bill);
 }
 
@@ -167,6 +252,137 @@ static void sol_draw_bill(GLboolean edge)
 
 /*---------------------------------------------------------------------------*/
 
+/*
+ * Post-multiply matrix L by a rotation of A degrees about (X, Y, Z).
+ */
+static void sol_bill_rot(float *L, float a, float x, float y, float z)
+{
+    const float v[3] = { x, y, z };
+
+    float R[16];
+    float N[16];
+
+    m_rot (R, v, V_RAD(a));
+    m_mult(N, L, R);
+    m_cpy (L, N);
+}
+
+/*
+ * Post-multiply matrix L by a translation.
+ */
+static void sol_bill_xlt(float *L, float x, float y, float z)
+{
+    const float v[3] = { x, y, z };
+
+    float T[16];
+    float N[16];
+
+    m_xlt (T, v);
+    m_mult(N, L, T);
+    m_cpy (L, N);
+}
+
+static void sol_bill_begin(struct d_bill *bp)
+{
+    float P[16], M[16];
+
+    glGetFloatv(GL_PROJECTION_MATRIX, P);
+    glGetFloatv(GL_MODELVIEW_MATRIX,  M);
+
+    m_mult(bp->C, P, M);
+
+    bp->bc = 0;
+}
+
+/*
+ * Add billboard RI of material MI, placed by matrix L and scaled by W
+ * and H.  Skip it if it is entirely out of view.
+ */
+static void sol_bill_add(struct d_bill *bp, int ri, int mi, const float *L,
+                         float w, float h, int edge)
+{
+    static const float s[4] = { 0.0f, 1.0f, 0.0f, 1.0f };
+    static const float t[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+
+    static const int tris[6] = { 0, 1, 2, 2, 1, 3 };
+
+    const float y0 = edge ? 0.0f : -0.5f;
+    const float *C = bp->C;
+
+    float p[4][3], r[4] = { +1.0f, +1.0f, -1.0f, -1.0f };
+    int i, in = 0x3F, far = 0;
+
+    bp->iv[ri] = -1;
+
+    /* Find the corners and their bounds on screen. */
+
+    for (i = 0; i < 4; i++)
+    {
+        const float x = (s[i] - 0.5f) * w;
+        const float y = (t[i] + y0)   * h;
+
+        float cx, cy, cz, cw;
+        int out = 0;
+
+        p[i][0] = L[12] + L[0] * x + L[4] * y;
+        p[i][1] = L[13] + L[1] * x + L[5] * y;
+        p[i][2] = L[14] + L[2] * x + L[6] * y;
+
+        cx = C[0] * p[i][0] + C[4] * p[i][1] + C[ 8] * p[i][2] + C[12];
+        cy = C[1] * p[i][0] + C[5] * p[i][1] + C[ 9] * p[i][2] + C[13];
+        cz = C[2] * p[i][0] + C[6] * p[i][1] + C[10] * p[i][2] + C[14];
+        cw = C[3] * p[i][0] + C[7] * p[i][1] + C[11] * p[i][2] + C[15];
+
+        if (cx < -cw) out |= 0x01;
+        if (cx >  cw) out |= 0x02;
+        if (cy < -cw) out |= 0x04;
+        if (cy >  cw) out |= 0x08;
+        if (cz < -cw) out |= 0x10;
+        if (cz >  cw) out |= 0x20;
+
+        in &= out;
+
+        if (cw > 0.0f)
+        {
+            cx = CLAMP(-1.0f, cx / cw, +1.0f);
+            cy = CLAMP(-1.0f, cy / cw, +1.0f);
+
+            r[0] = MIN(r[0], cx);
+            r[1] = MIN(r[1], cy);
+            r[2] = MAX(r[2], cx);
+            r[3] = MAX(r[3], cy);
+        }
+        else far = 1;
+    }
+
+    if (in)
+        return;
+
+    /* A corner behind the viewer may land anywhere. */
+
+    if (far)
+    {
+        r[0] = -1.0f;
+        r[1] = -1.0f;
+        r[2] = +1.0f;
+        r[3] = +1.0f;
+    }
+
+    bp->iv[ri] = overlap_join(bp->bv, &bp->bc, mi, r, 1);
+
+    /* Emit the quad as two triangles. */
+
+    for (i = 0; i < 6; i++)
+    {
+        struct d_bvert *vp = bp->vv + ri * 6 + i;
+
+        vp->t[0] = s[tris[i]];
+        vp->t[1] = t[tris[i]];
+
+        v_cpy(vp->p, p[tris[i]]);
+    }
+}
+
 /* NOTE: The state management here presumes that billboard rendering is      */
 /* NESTED within a wider SOL rendering process. That is: r_draw_enable       */
 /* has been called and r_draw_disable will be called in the future.          */
@@ -192,6 +408,52 @@ static void sol_bill_disable(void)
     glBindBuffer_(GL_ARRAY_BUFFER, 0);
 }
 
+/*
+ * Sort the N billboards by batch, upload them, and draw each batch.
+ */
+static void sol_bill_flush(const struct s_draw *draw,
+                           struct s_rend *rend, int n)
+{
+    struct d_bill *bp = draw->bills;
+
+    const size_t s = sizeof (struct d_bvert);
+
+    int ri, b, c;
+
+    if (bp->bc == 0)
+        return;
+
+    c = overlap_order(bp->bv, bp->bc);
+
+    for (ri = 0; ri < n; ri++)
+        if ((b = bp->iv[ri]) >= 0)
+        {
+            struct overlap *bb = bp->bv + b;
+
+            memcpy(bp->uv + (bb->first + bb->count) * 6,
+                   bp->vv + ri * 6, 6 * s);
+
+            bb->count++;
+        }
+
+    glBindBuffer_(GL_ARRAY_BUFFER, bp->vbo);
+    glBufferData_(GL_ARRAY_BUFFER, c * 6 * s, bp->uv, GL_STREAM_DRAW);
+
+    glDisableClientState(GL_NORMAL_ARRAY);
+
+    glTexCoordPointer(2, GL_FLOAT, s, (GLvoid *) offsetof (struct d_bvert, t));
+    glVertexPointer  (3, GL_FLOAT, s, (GLvoid *) offsetof (struct d_bvert, p));
+
+    for (b = 0; b < bp->bc; b++)
+    {
+        r_apply_mtrl(rend, draw->base->mtrls[bp->bv[b].key]);
+
+        glDrawArrays(GL_TRIANGLES, bp->bv[b].first * 6, bp->bv[b].count * 6);
+    }
+
+    sol_bill_disable();
+}
+
 /*---------------------------------------------------------------------------*/
 
 static int sol_test_mtrl(int mi, int p)
@@ -206,54 +468,39 @@ static int sol_test_mtrl(int mi, int p)
 
 /*---------------------------------------------------------------------------*/
 
-static int sol_count_geom(const struct s_base *base, int g0, int gc, int mi)
+/*
+ * All meshes of a SOL share one vertex buffer and one element buffer.
+ * Each mesh is the geometry of one body in one material, its elements
+ * indexing relative to its own first vertex.  The following holds the
+ * temporary state of the buffer creation.
+ */
+struct d_load
 {
-    int gi, c = 0;
+    const struct s_base *base;
 
-    /* The arguments g0 and gc specify a range of the index array. These     */
-    /* indices refer to geoms. Determine how many of these geoms use the     */
-    /* given material                                                        */
+    struct d_vert *vv;                  /* Vertex data                       */
+    GLuint        *ev;                  /* Element data                      */
+    int            vn;
+    int            en;
 
-    for (gi = 0; gi < gc; gi++)
-        if (base->gv[base->iv[g0 + gi]].mi == mi)
-            c++;
+    int *iv;                            /* Vertex index of each b_offs       */
+    int *tv;                            /* Geoms of the current body         */
+    int *gv;                            /* ... sorted by material            */
+    int *cv;                            /* Geom count of each material       */
 
-    return c;
-}
+    GLuint vmax;                        /* Vertex limit of a mesh            */
+};
 
-static int sol_count_body(const struct b_body *bp,
-                          const struct s_base *base, int mi)
+static int sol_count_body(const struct b_body *bp, const struct s_base *base)
 {
-    int li, c = 0;
-
-    /* Count all lump geoms with the given material. */
+    int li, c = bp->gc;
 
     for (li = 0; li < bp->lc; li++)
-        c += sol_count_geom(base, base->lv[bp->l0 + li].g0,
-                                  base->lv[bp->l0 + li].gc, mi);
-
-    /* Count all body geoms with the given material. */
-
-    c += sol_count_geom(base, bp->g0, bp->gc, mi);
-
-    return c;
-}
-
-static int sol_count_mesh(const struct d_body *bp, int p)
-{
-    int mi, c = 0;
-
-    /* Count the body meshes matching the given material flags. */
-
-    for (mi = 0; mi < bp->mc; ++mi)
-        if (sol_test_mtrl(bp->mv[mi].mtrl, p))
-            c++;
+        c += base->lv[bp->l0 + li].gc;
 
     return c;
 }
 
-/*---------------------------------------------------------------------------*/
-
 static void sol_mesh_vert(struct d_vert *vp,
                           const struct s_base *base, int oi)
 {
@@ -275,213 +522,314 @@ static void sol_mesh_vert(struct d_vert *vp,
     vp->t[1] = tq->u[1];
 }
 
-static void sol_mesh_geom(struct d_vert *vv,   int *vn,
-                          struct d_geom *gv,   int *gn,
-                          const struct s_base *base, int *iv, int g0, int gc, int mi)
+static GLuint sol_mesh_elem(struct d_load *L, struct d_mesh *mp, int oi)
 {
-    int gi;
+    /* Insert a d_vert for each b_offs not yet referenced by this mesh. */
 
-    /* Insert all geoms with material mi into the vertex and element data. */
+    if (L->iv[oi] < (int) mp->v0)
+    {
+        L->iv[oi] = L->vn;
+        sol_mesh_vert(L->vv + L->vn++, L->base, oi);
+        mp->vbc++;
+    }
+    return (GLuint) L->iv[oi] - mp->v0;
+}
 
-    for (gi = 0; gi < gc; gi++)
+static int sol_sort_body(struct d_load *L, const struct b_body *bp)
+{
+    const struct s_base *base = L->base;
+
+    int li, gi, mi, i, n = 0;
+
+    /* List the lump geoms and then the body geoms. */
+
+    for (li = 0; li < bp->lc; li++)
     {
-        const struct b_geom *gq = base->gv + base->iv[g0 + gi];
+        const struct b_lump *lp = base->lv + bp->l0 + li;
 
-        if (gq->mi == mi)
-        {
-            /* Insert a d_vert into the VBO data for each referenced b_off. */
+        for (gi = 0; gi < lp->gc; gi++)
+            L->tv[n++] = base->iv[lp->g0 + gi];
+    }
 
-            if (iv[gq->oi] == -1)
-            {
-                iv[gq->oi] = *vn;
-                sol_mesh_vert(vv + (*vn)++, base, gq->oi);
-            }
-            if (iv[gq->oj] == -1)
-            {
-                iv[gq->oj] = *vn;
-                sol_mesh_vert(vv + (*vn)++, base, gq->oj);
-            }
-            if (iv[gq->ok] == -1)
-            {
-                iv[gq->ok] = *vn;
-                sol_mesh_vert(vv + (*vn)++, base, gq->ok);
-            }
+    for (gi = 0; gi < bp->gc; gi++)
+        L->tv[n++] = base->iv[bp->g0 + gi];
+
+    /* Order them by material, keeping the order within each material. */
 
-            /* Populate the EBO data using remapped b_off indices. */
+    memset(L->cv, 0, (base->mc + 1) * sizeof (int));
+
+    for (i = 0; i < n; i++)
+        L->cv[base->gv[L->tv[i]].mi + 1]++;
+    for (mi = 0; mi < base->mc; mi++)
+        L->cv[mi + 1] += L->cv[mi];
+    for (i = 0; i < n; i++)
+        L->gv[L->cv[base->gv[L->tv[i]].mi]++] = L->tv[i];
+
+    return n;
+}
 
-            gv[*gn].i = iv[gq->oi];
-            gv[*gn].j = iv[gq->oj];
-            gv[*gn].k = iv[gq->ok];
+static void sol_load_body(struct d_load *L, struct alloc *meshes,
+                          const struct s_draw *draw, int bi)
+{
+    const int n = sol_sort_body(L, draw->base->bv + bi);
+
+    struct d_mesh *mp = NULL;
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        const struct b_geom *gp = draw->base->gv + L->gv[i];
 
-            (*gn)++;
+        /* Begin a new mesh at each material, or when this one is full. */
+
+        if (!mp || mp->mtrl != draw->base->mtrls[gp->mi]
+                || mp->vbc + 3 > L->vmax)
+        {
+            if (!(mp = alloc_add(meshes)))
+                return;
+
+            mp->mtrl = draw->base->mtrls[gp->mi];
+            mp->body = bi;
+            mp->v0   = L->vn;
+            mp->vbc  = 0;
+            mp->e0   = L->en;
+            mp->ebc  = 0;
         }
+
+        L->ev[L->en++] = sol_mesh_elem(L, mp, gp->oi);
+        L->ev[L->en++] = sol_mesh_elem(L, mp, gp->oj);
+        L->ev[L->en++] = sol_mesh_elem(L, mp, gp->ok);
+
+        mp->ebc += 3;
     }
 }
 
-static void sol_load_mesh(struct d_mesh *mp,
-                          const struct b_body *bp,
-                          const struct s_draw *draw, int mi)
+/*
+ * Find a sphere bounding the vertices of a mesh.  Particles are drawn
+ * as points of some size on screen, so they are never culled.
+ */
+static void sol_mesh_bound(struct d_mesh *mp, const struct d_vert *vv)
 {
-    struct d_vert *vv = 0;
-    struct d_geom *gv = 0;
-    int           *iv = 0;
+    float lo[3], hi[3], d[3];
+    GLuint i;
 
-    int oc = draw->base->oc;
-    int vn = 0;
-    int gn = 0;
+    v_cpy(lo, vv[mp->v0].p);
+    v_cpy(hi, vv[mp->v0].p);
 
-    const int gc = sol_count_body(bp, draw->base, mi);
+    for (i = mp->v0; i < mp->v0 + mp->vbc; i++)
+    {
+        lo[0] = MIN(lo[0], vv[i].p[0]); hi[0] = MAX(hi[0], vv[i].p[0]);
+        lo[1] = MIN(lo[1], vv[i].p[1]); hi[1] = MAX(hi[1], vv[i].p[1]);
+        lo[2] = MIN(lo[2], vv[i].p[2]); hi[2] = MAX(hi[2], vv[i].p[2]);
+    }
 
-    /* Get temporary storage for vertex and element array creation. */
+    v_mid(mp->c, lo, hi);
 
-    if ((vv = (struct d_vert *) calloc(oc, sizeof (*vv))) &&
-        (gv = (struct d_geom *) calloc(gc, sizeof (*gv))) &&
-        (iv = (int           *) calloc(oc, sizeof (int))))
-    {
-        int li, i;
+    mp->r = 0.0f;
 
-        /* Initialize the index remapping. */
+    for (i = mp->v0; i < mp->v0 + mp->vbc; i++)
+    {
+        v_sub(d, vv[i].p, mp->c);
+        mp->r = MAX(mp->r, v_len(d));
+    }
 
-        for (i = 0; i < oc; ++i) iv[i] = -1;
+    if (mtrl_get(mp->mtrl)->base.fl & M_PARTICLE)
+        mp->r = -1.0f;
+}
 
-        /* Include all matching lump geoms in the arrays. */
+static void sol_load_mesh(struct s_draw *draw)
+{
+    const struct s_base *base = draw->base;
 
-        for (li = 0; li < bp->lc; li++)
-            sol_mesh_geom(vv, &vn, gv, &gn, draw->base, iv,
-                          draw->base->lv[bp->l0 + li].g0,
-                          draw->base->lv[bp->l0 + li].gc, mi);
+    struct alloc meshes;
+    struct d_load L;
 
-        /* Include all matching body geoms in the arrays. */
+    int bi, mi, i, gn = 0, gm = 0;
 
-        sol_mesh_geom(vv, &vn, gv, &gn, draw->base, iv, bp->g0, bp->gc, mi);
+    memset(&L, 0, sizeof (L));
 
-        /* Initialize buffer objects for all data. */
+    L.base = base;
 
-        glGenBuffers_(1, &mp->vbo);
-        glBindBuffer_(GL_ARRAY_BUFFER,         mp->vbo);
-        glBufferData_(GL_ARRAY_BUFFER,         vn * sizeof (*vv), vv,
-                      GL_STATIC_DRAW);
-        glBindBuffer_(GL_ARRAY_BUFFER,         0);
+    alloc_new(&meshes, sizeof (struct d_mesh), (void **) &draw->mv, &draw->mc);
 
-        glGenBuffers_(1, &mp->ebo);
-        glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, mp->ebo);
-        glBufferData_(GL_ELEMENT_ARRAY_BUFFER, gn * sizeof (*gv), gv,
-                      GL_STATIC_DRAW);
-        glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, 0);
+    draw->ebt = GL_UNSIGNED_SHORT;
 
-        /* Note cached material index. */
+    /* Find the total and the largest geom count over all bodies. */
 
-        mp->mtrl = draw->base->mtrls[mi];
+    for (bi = 0; bi < base->bc; bi++)
+    {
+        const int c = sol_count_body(base->bv + bi, base);
 
-        mp->ebc = gn * 3;
-        mp->vbc = vn;
+        gn += c;
+        gm  = MAX(gm, c);
     }
 
-    free(iv);
-    free(gv);
-    free(vv);
-}
+    /* Without 32-bit element support, split meshes at 16 bits. */
 
-static void sol_free_mesh(struct d_mesh *mp)
-{
-    glDeleteBuffers_(1, &mp->ebo);
-    glDeleteBuffers_(1, &mp->vbo);
-}
+    L.vmax = gli.element_index_uint ? (GLuint) gn * 3 : 0x10000;
 
-void sol_draw_mesh(const struct d_mesh *mp, struct s_rend *rend, int p)
-{
-    /* If this mesh has material matching the given flags... */
+    /* Get temporary storage for vertex and element array creation. */
 
-    if (sol_test_mtrl(mp->mtrl, p))
+    if ((L.vv = (struct d_vert *) calloc(gn * 3,       sizeof (*L.vv))) &&
+        (L.ev = (GLuint        *) calloc(gn * 3,       sizeof (*L.ev))) &&
+        (L.iv = (int           *) calloc(base->oc,     sizeof (*L.iv))) &&
+        (L.tv = (int           *) calloc(gm,           sizeof (*L.tv))) &&
+        (L.gv = (int           *) calloc(gm,           sizeof (*L.gv))) &&
+        (L.cv = (int           *) calloc(base->mc + 1, sizeof (*L.cv))))
     {
-        const size_t s = sizeof (struct d_vert);
-        const GLenum T = GL_FLOAT;
+        for (i = 0; i < base->oc; ++i)
+            L.iv[i] = -1;
 
-        /* Apply the material state. */
+        for (bi = 0; bi < base->bc; bi++)
+            sol_load_body(&L, &meshes, draw, bi);
 
-        r_apply_mtrl(rend, mp->mtrl);
+        for (mi = 0; mi < draw->mc; mi++)
+            if (draw->mv[mi].vbc > 0)
+                sol_mesh_bound(draw->mv + mi, L.vv);
 
-        /* Bind the mesh data. */
+        /* Use 16-bit elements unless some mesh is too large for them. */
 
-        glBindBuffer_(GL_ARRAY_BUFFER,         mp->vbo);
-        glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, mp->ebo);
+        for (mi = 0; mi < draw->mc; mi++)
+            if (draw->mv[mi].vbc > 0x10000)
+                draw->ebt = GL_UNSIGNED_INT;
 
-        glVertexPointer  (3, T, s, (GLvoid *) offsetof (struct d_vert, p));
-        glNormalPointer  (   T, s, (GLvoid *) offsetof (struct d_vert, n));
+        /* Initialize buffer objects for all data. */
 
-        if (tex_env_stage(TEX_STAGE_SHADOW))
-        {
-            glTexCoordPointer(3, T, s, (GLvoid *) offsetof (struct d_vert, p));
+        glGenBuffers_(1, &draw->vbo);
+        glBindBuffer_(GL_ARRAY_BUFFER,         draw->vbo);
+        glBufferData_(GL_ARRAY_BUFFER,         L.vn * sizeof (*L.vv), L.vv,
+                      GL_STATIC_DRAW);
+        glBindBuffer_(GL_ARRAY_BUFFER,         0);
 
-            if (tex_env_stage(TEX_STAGE_CLIP))
-                glTexCoordPointer(3, T, s, (GLvoid *) offsetof (struct d_vert, p));
+        glGenBuffers_(1, &draw->ebo);
+        glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, draw->ebo);
 
-            tex_env_stage(TEX_STAGE_TEXTURE);
-        }
-        glTexCoordPointer(2, T, s, (GLvoid *) offsetof (struct d_vert, t));
+        if (draw->ebt == GL_UNSIGNED_INT)
+            glBufferData_(GL_ELEMENT_ARRAY_BUFFER, L.en * sizeof (GLuint),
+                          L.ev, GL_STATIC_DRAW);
+        else
+        {
+            GLushort *sv;
 
-        /* Draw the mesh. */
+            if ((sv = (GLushort *) calloc(L.en + 1, sizeof (*sv))))
+            {
+                for (i = 0; i < L.en; i++)
+                    sv[i] = (GLushort) L.ev[i];
 
-        if (rend->curr_mtrl.base.fl & M_PARTICLE)
-            glDrawArrays(GL_POINTS, 0, mp->vbc);
-        else
-            glDrawElements(GL_TRIANGLES, mp->ebc, GL_UNSIGNED_SHORT, 0);
+                glBufferData_(GL_ELEMENT_ARRAY_BUFFER, L.en * sizeof (*sv),
+                              sv, GL_STATIC_DRAW);
+                free(sv);
+            }
+        }
+        glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, 0);
     }
+
+    free(L.cv);
+    free(L.gv);
+    free(L.tv);
+    free(L.iv);
+    free(L.ev);
+    free(L.vv);
 }
 
-/*---------------------------------------------------------------------------*/
+static void sol_free_mesh(struct s_draw *draw)
+{
+    glDeleteBuffers_(1, &draw->ebo);
+    glDeleteBuffers_(1, &draw->vbo);
+
+    free(draw->mv);
+}
 
-static void sol_load_body(struct d_body *bp,
-                          const struct b_body *bq,
-                          const struct s_draw *draw)
+static void sol_bind_mesh(const struct s_draw *draw,
+                          const struct d_mesh *mp, struct s_rend *rend)
 {
-    int mi;
+    const size_t s = sizeof (struct d_vert);
+    const size_t o = mp->v0 * s;
+    const GLenum T = GL_FLOAT;
 
-    bp->base = bq;
-    bp->mc   =  0;
+    /* Apply the material state. */
 
-    /* Determine how many materials this body uses. */
+    r_apply_mtrl(rend, mp->mtrl);
 
-    for (mi = 0; mi < draw->base->mc; ++mi)
-        if (sol_count_body(bq, draw->base, mi))
-            bp->mc++;
+    /* Point at the mesh data. */
 
-    /* Allocate and initialize a mesh for each material. */
+    glVertexPointer  (3, T, s, (GLvoid *) (o + offsetof (struct d_vert, p)));
+    glNormalPointer  (   T, s, (GLvoid *) (o + offsetof (struct d_vert, n)));
 
-    if ((bp->mv = (struct d_mesh *) calloc(bp->mc, sizeof (struct d_mesh))))
+    if (tex_env_stage(TEX_STAGE_SHADOW))
     {
-        int mj = 0;
+        glTexCoordPointer(3, T, s, (GLvoid *) (o + offsetof (struct d_vert, p)));
+
+        if (tex_env_stage(TEX_STAGE_CLIP))
+            glTexCoordPointer(3, T, s, (GLvoid *) (o + offsetof (struct d_vert, p)));
 
-        for (mi = 0; mi < draw->base->mc; ++mi)
-            if (sol_count_body(bq, draw->base, mi))
-                sol_load_mesh(bp->mv + mj++, bq, draw, mi);
+        tex_env_stage(TEX_STAGE_TEXTURE);
     }
+    glTexCoordPointer(2, T, s, (GLvoid *) (o + offsetof (struct d_vert, t)));
+}
 
-    /* Cache a mesh count for each pass. */
+static void sol_draw_elem(const struct s_draw *draw,
+                          const struct d_mesh *mp, struct s_rend *rend)
+{
+    const size_t e = (draw->ebt == GL_UNSIGNED_INT ?
+                      sizeof (GLuint) : sizeof (GLushort));
 
-    bp->pass[0] = sol_count_mesh(bp, 0);
-    bp->pass[1] = sol_count_mesh(bp, 1);
-    bp->pass[2] = sol_count_mesh(bp, 2);
-    bp->pass[3] = sol_count_mesh(bp, 3);
-    bp->pass[4] = sol_count_mesh(bp, 4);
+    if (rend->curr_mtrl.base.fl & M_PARTICLE)
+        glDrawArrays(GL_POINTS, 0, mp->vbc);
+    else
+        glDrawElements(GL_TRIANGLES, mp->ebc, draw->ebt,
+                       (GLvoid *) (mp->e0 * e));
 }
 
-static void sol_free_body(struct d_body *bp)
+static void sol_draw_mesh(const struct s_draw *draw,
+                          const struct d_mesh *mp, struct s_rend *rend)
 {
-    int mi;
+    sol_bind_mesh(draw, mp, rend);
+    sol_draw_elem(draw, mp, rend);
+}
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Opaque meshes are drawn in material order to minimize state changes.
+ * Transparent meshes keep body order, as blending is order-dependent.
+ */
+
+static int cmp_mesh_mtrl(const void *A, const void *B)
+{
+    const struct d_mesh *a = *(const struct d_mesh * const *) A;
+    const struct d_mesh *b = *(const struct d_mesh * const *) B;
 
-    for (mi = 0; mi < bp->mc; ++mi)
-        sol_free_mesh(bp->mv + mi);
+    if (a->mtrl != b->mtrl)
+        return a->mtrl < b->mtrl ? -1 : +1;
 
-    free(bp->mv);
+    return (a->e0 < b->e0) ? -1 : ((a->e0 > b->e0) ? +1 : 0);
 }
 
-static void sol_draw_body(const struct d_body *bp, struct s_rend *rend, int p)
+static int cmp_mesh_body(const void *A, const void *B)
 {
-    int i;
+    const struct d_mesh *a = *(const struct d_mesh * const *) A;
+    const struct d_mesh *b = *(const struct d_mesh * const *) B;
 
-    for (i = 0; i < bp->mc; ++i)
-        sol_draw_mesh(bp->mv + i, rend, p);
+    return (a->e0 < b->e0) ? -1 : ((a->e0 > b->e0) ? +1 : 0);
+}
+
+static void sol_load_pass(struct s_draw *draw, int p)
+{
+    int mi;
+
+    draw->pc[p] = 0;
+
+    if ((draw->pv[p] = calloc(draw->mc + 1, sizeof (*draw->pv[p]))))
+    {
+        for (mi = 0; mi < draw->mc; mi++)
+            if (sol_test_mtrl(draw->mv[mi].mtrl, p))
+                draw->pv[p][draw->pc[p]++] = draw->mv + mi;
+
+        qsort(draw->pv[p], draw->pc[p], sizeof (*draw->pv[p]),
+              (p == PASS_TRANSPARENT_DECAL || p == PASS_TRANSPARENT) ?
+              cmp_mesh_body : cmp_mesh_mtrl);
+    }
 }
 
 /*---------------------------------------------------------------------------*/
@@ -513,18 +861,12 @@ int sol_load_draw(struct s_draw *draw, struct s_vary *vary, int s)
     draw->shadow_ui = -1;
     draw->shadowed = s;
 
-    /* Initialize all bodies for this file. */
+    /* Initialize all meshes for this file and order them for drawing. */
 
-    if (draw->base->bc)
-    {
-        if ((draw->bv = calloc(draw->base->bc, sizeof (*draw->bv))))
-        {
-            draw->bc = draw->base->bc;
+    sol_load_mesh(draw);
 
-            for (i = 0; i < draw->bc; i++)
-                sol_load_body(draw->bv + i, draw->base->bv + i, draw);
-        }
-    }
+    for (i = 0; i < PASS_MAX; i++)
+        sol_load_pass(draw, i);
 
     sol_load_bill(draw);
 
@@ -539,52 +881,232 @@ void sol_free_draw(struct s_draw *draw)
 
     sol_free_bill(draw);
 
-    for (i = 0; i < draw->bc; i++)
-        sol_free_body(draw->bv + i);
+    for (i = 0; i < PASS_MAX; i++)
+        free(draw->pv[i]);
 
-    free(draw->bv);
+    sol_free_mesh(draw);
 }
 
 /*---------------------------------------------------------------------------*/
 
-static void sol_draw_all(const struct s_draw *draw, struct s_rend *rend, int p)
+/*
+ * Find the planes of the view frustum in the current model space, each
+ * normalized and facing in.  The far plane makes for distance culling.
+ */
+static void sol_load_view(float V[6][4])
 {
-    int bi;
+    float P[16], M[16], C[16], k;
+    int i, j;
+
+    glGetFloatv(GL_PROJECTION_MATRIX, P);
+    glGetFloatv(GL_MODELVIEW_MATRIX,  M);
+
+    m_mult(C, P, M);
 
-    /* Draw all meshes of all bodies matching the given material flags. */
+    for (i = 0; i < 6; i++)
+    {
+        const float s = (i % 2) ? -1.0f : +1.0f;
+
+        for (j = 0; j < 4; j++)
+            V[i][j] = C[4 * j + 3] + s * C[4 * j + i / 2];
 
-    for (bi = 0; bi < draw->bc; ++bi)
-        if (draw->bv[bi].pass[p])
+        if ((k = v_len(V[i])) > 0.0f)
         {
-            glPushMatrix();
+            V[i][0] /= k;
+            V[i][1] /= k;
+            V[i][2] /= k;
+            V[i][3] /= k;
+        }
+    }
+}
+
+/*
+ * Test whether a mesh of a body at position P and orientation E may be
+ * in view, as placed by instance IP, if any.
+ */
+static int sol_test_mesh(float V[6][4], const float p[3],
+                         const float e[4], const struct d_mesh *mp,
+                         const struct s_inst *ip)
+{
+    float c[3], r = mp->r;
+    int i;
+
+    if (r < 0.0f)
+        return 1;
+
+    q_rot(c, e, mp->c);
+    v_add(c, c, p);
+
+    if (ip)
+    {
+        c[0] = ip->p[0] + ip->s[0] * c[0];
+        c[1] = ip->p[1] + ip->s[1] * c[1];
+        c[2] = ip->p[2] + ip->s[2] * c[2];
+
+        r *= MAX(MAX(fabsf(ip->s[0]), fabsf(ip->s[1])), fabsf(ip->s[2]));
+    }
+
+    for (i = 0; i < 6; i++)
+        if (v_dot(V[i], c) + V[i][3] < -r)
+            return 0;
+
+    return 1;
+}
+
+static void sol_draw_all(const struct s_draw *draw, struct s_rend *rend, int p,
+                         float V[6][4])
+{
+    int i, bi = -1, vi = -1;
+
+    float bp[3];
+    float be[4];
+
+    /* Draw all meshes matching the given material flags. */
+
+    if (draw->pc[p])
+    {
+        glBindBuffer_(GL_ARRAY_BUFFER,         draw->vbo);
+        glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, draw->ebo);
+
+        for (i = 0; i < draw->pc[p]; ++i)
+        {
+            const struct d_mesh *mp = draw->pv[p][i];
+
+            /* Skip meshes out of view. */
+
+            if (vi != mp->body)
+            {
+                vi = mp->body;
+
+                sol_body_p(bp, draw->vary, draw->vary->bv + vi, 0.0f);
+                sol_body_e(be, draw->vary, draw->vary->bv + vi, 0.0f);
+            }
+
+            if (!sol_test_mesh(V, bp, be, mp, NULL))
+                continue;
+
+            /* Apply the body transform when the body changes. */
+
+            if (bi != mp->body)
             {
+                if (bi >= 0)
+                    glPopMatrix();
+
+                bi = mp->body;
+
+                glPushMatrix();
                 sol_transform(draw->vary, draw->vary->bv + bi, draw->shadow_ui);
-                sol_draw_body(draw->bv + bi, rend, p);
             }
+
+            sol_draw_mesh(draw, mp, rend);
+        }
+
+        if (bi >= 0)
             glPopMatrix();
+    }
+}
+
+/*
+ * Draw each mesh matching the given material flags once for each of
+ * many instances, applying its material and vertex state only once.
+ */
+static void sol_draw_many(const struct s_draw *draw, struct s_rend *rend,
+                          int p, float V[6][4],
+                          const struct s_inst *iv, int ic)
+{
+    int i, j;
+
+    float bp[3];
+    float be[4];
+
+    if (draw->pc[p])
+    {
+        glBindBuffer_(GL_ARRAY_BUFFER,         draw->vbo);
+        glBindBuffer_(GL_ELEMENT_ARRAY_BUFFER, draw->ebo);
+
+        for (i = 0; i < draw->pc[p]; ++i)
+        {
+            const struct d_mesh *mp = draw->pv[p][i];
+
+            int bound = 0;
+
+            sol_body_p(bp, draw->vary, draw->vary->bv + mp->body, 0.0f);
+            sol_body_e(be, draw->vary, draw->vary->bv + mp->body, 0.0f);
+
+            for (j = 0; j < ic; j++)
+            {
+                const struct s_inst *ip = iv + j;
+
+                if (!sol_test_mesh(V, bp, be, mp, ip))
+                    continue;
+
+                if (!bound)
+                {
+                    sol_bind_mesh(draw, mp, rend);
+                    bound = 1;
+                }
+
+                if (ip->c)
+                    glColor4f(ip->c[0], ip->c[1], ip->c[2], ip->c[3]);
+
+                glPushMatrix();
+                {
+                    glTranslatef(ip->p[0], ip->p[1], ip->p[2]);
+                    glScalef    (ip->s[0], ip->s[1], ip->s[2]);
+
+                    sol_transform(draw->vary, draw->vary->bv + mp->body,
+                                  draw->shadow_ui);
+                    sol_draw_elem(draw, mp, rend);
+                }
+                glPopMatrix();
+            }
         }
+    }
+}
+
+static void sol_draw_pass(const struct s_draw *draw, struct s_rend *rend,
+                          int p, float V[6][4],
+                          const struct s_inst *iv, int ic)
+{
+    if (iv)
+        sol_draw_many(draw, rend, p, V, iv, ic);
+    else
+        sol_draw_all(draw, rend, p, V);
 }
 
 /*---------------------------------------------------------------------------*/
 
 void sol_draw(const struct s_draw *draw, struct s_rend *rend, int mask, int test)
 {
+    sol_draw_inst(draw, rend, mask, test, NULL, 0);
+}
+
+/*
+ * Draw IC instances of a SOL, or just the one in place if IV is NULL.
+ */
+void sol_draw_inst(const struct s_draw *draw, struct s_rend *rend,
+                   int mask, int test, const struct s_inst *iv, int ic)
+{
+    float V[6][4];
+
     /* Disable shadowed material setup if not requested. */
 
     rend->skip_flags |= (draw->shadowed ? 0 : M_SHADOWED);
 
+    sol_load_view(V);
+
     /* Render all opaque geometry, decals last. */
 
-    sol_draw_all(draw, rend, PASS_OPAQUE);
-    sol_draw_all(draw, rend, PASS_OPAQUE_DECAL);
+    sol_draw_pass(draw, rend, PASS_OPAQUE,       V, iv, ic);
+    sol_draw_pass(draw, rend, PASS_OPAQUE_DECAL, V, iv, ic);
 
     /* Render all transparent geometry, decals first. */
 
     if (!test) glDisable(GL_DEPTH_TEST);
     if (!mask) glDepthMask(GL_FALSE);
     {
-        sol_draw_all(draw, rend, PASS_TRANSPARENT_DECAL);
-        sol_draw_all(draw, rend, PASS_TRANSPARENT);
+        sol_draw_pass(draw, rend, PASS_TRANSPARENT_DECAL, V, iv, ic);
+        sol_draw_pass(draw, rend, PASS_TRANSPARENT,       V, iv, ic);
     }
     if (!mask) glDepthMask(GL_TRUE);
     if (!test) glEnable(GL_DEPTH_TEST);
@@ -599,13 +1121,17 @@ void sol_draw(const struct s_draw *draw, struct s_rend *rend, int mask, int test
 
 void sol_refl(const struct s_draw *draw, struct s_rend *rend)
 {
+    float V[6][4];
+
     /* Disable shadowed material setup if not requested. */
 
     rend->skip_flags |= (draw->shadowed ? 0 : M_SHADOWED);
 
+    sol_load_view(V);
+
     /* Render all reflective geometry. */
 
-    sol_draw_all(draw, rend, PASS_REFLECTIVE);
+    sol_draw_all(draw, rend, PASS_REFLECTIVE, V);
 
     /* Revert the buffer object state. */
 
@@ -619,114 +1145,153 @@ void sol_back(const struct s_draw *draw,
               struct s_rend *rend,
               float n, float f, float t)
 {
-    if (!(draw && draw->base && draw->base->rc))
+    struct d_bill *bp;
+
+    const struct b_bill *rv;
+    int rc, ri;
+
+    float *T, *W, *H, *RX, *RY, *RZ;
+
+    if (!(draw && draw->base && draw->base->rc && (bp = draw->bills)))
         return;
 
-    glDepthMask(GL_FALSE);
+    rv = draw->base->rv;
+    rc = draw->base->rc;
 
-    sol_bill_enable(draw);
-    {
-        int ri;
+    T  = bp->fv + rc * BILL_T;
+    W  = bp->fv + rc * BILL_W;
+    H  = bp->fv + rc * BILL_H;
+    RX = bp->fv + rc * BILL_RX;
+    RY = bp->fv + rc * BILL_RY;
+    RZ = bp->fv + rc * BILL_RZ;
 
-        /* Consider each billboard. */
+    /* Evaluate the animation of all billboards. */
 
-        for (ri = 0; ri < draw->base->rc; ri++)
-        {
-            const struct b_bill *rp = draw->base->rv + ri;
+    for (ri = 0; ri < rc; ri++)
+        T[ri] = (rv[ri].t > 0.0f) ? (fmodf(t, rv[ri].t) - rv[ri].t / 2) : 0;
 
-            /* Render only billboards at distances between n and f. */
+    for (ri = 0; ri < rc; ri++)
+    {
+        const float T1 = T[ri], T2 = T[ri] * T[ri];
 
-            if (n <= rp->d && rp->d < f)
-            {
-                float T = (rp->t > 0.0f) ? (fmodf(t, rp->t) - rp->t / 2) : 0;
+        W [ri] = rv[ri].w [0] + rv[ri].w [1] * T1 + rv[ri].w [2] * T2;
+        H [ri] = rv[ri].h [0] + rv[ri].h [1] * T1 + rv[ri].h [2] * T2;
+        RX[ri] = rv[ri].rx[0] + rv[ri].rx[1] * T1 + rv[ri].rx[2] * T2;
+        RY[ri] = rv[ri].ry[0] + rv[ri].ry[1] * T1 + rv[ri].ry[2] * T2;
+        RZ[ri] = rv[ri].rz[0] + rv[ri].rz[1] * T1 + rv[ri].rz[2] * T2;
+    }
 
-                float w = rp->w[0] + rp->w[1] * T + rp->w[2] * T * T;
-                float h = rp->h[0] + rp->h[1] * T + rp->h[2] * T * T;
+    /* Place billboards at distances between n and f facing the viewer. */
 
-                /* Render only billboards facing the viewer. */
+    sol_bill_begin(bp);
 
-                if (w > 0 && h > 0)
-                {
-                    float rx = rp->rx[0] + rp->rx[1] * T + rp->rx[2] * T * T;
-                    float ry = rp->ry[0] + rp->ry[1] * T + rp->ry[2] * T * T;
-                    float rz = rp->rz[0] + rp->rz[1] * T + rp->rz[2] * T * T;
+    for (ri = 0; ri < rc; ri++)
+    {
+        const struct b_bill *rp = rv + ri;
 
-                    r_apply_mtrl(rend, draw->base->mtrls[rp->mi]);
+        bp->iv[ri] = -1;
 
-                    glPushMatrix();
-                    {
-                        if (ry) glRotatef(ry, 0.0f, 1.0f, 0.0f);
-                        if (rx) glRotatef(rx, 1.0f, 0.0f, 0.0f);
+        if (n <= rp->d && rp->d < f && W[ri] > 0 && H[ri] > 0)
+        {
+            const float rx = RX[ri];
+            const float ry = RY[ri];
+            const float rz = RZ[ri];
 
-                        glTranslatef(0.0f, 0.0f, -rp->d);
+            float L[16];
 
-                        if (rp->fl & B_FLAT)
-                        {
-                            glRotatef(-rx - 90.0f, 1.0f, 0.0f, 0.0f);
-                            glRotatef(-ry,         0.0f, 0.0f, 1.0f);
-                        }
-                        if (rp->fl & B_EDGE)
-                            glRotatef(-rx,         1.0f, 0.0f, 0.0f);
+            m_ident(L);
 
-                        if (rz) glRotatef(rz, 0.0f, 0.0f, 1.0f);
+            if (ry) sol_bill_rot(L, ry, 0.0f, 1.0f, 0.0f);
+            if (rx) sol_bill_rot(L, rx, 1.0f, 0.0f, 0.0f);
 
-                        glScalef(w, h, 1.0f);
+            sol_bill_xlt(L, 0.0f, 0.0f, -rp->d);
 
-                        sol_draw_bill(rp->fl & B_EDGE);
-                    }
-                    glPopMatrix();
-                }
+            if (rp->fl & B_FLAT)
+            {
+                sol_bill_rot(L, -rx - 90.0f, 1.0f, 0.0f, 0.0f);
+                sol_bill_rot(L, -ry,         0.0f, 0.0f, 1.0f);
             }
+            if (rp->fl & B_EDGE)
+                sol_bill_rot(L, -rx,         1.0f, 0.0f, 0.0f);
+
+            if (rz) sol_bill_rot(L, rz, 0.0f, 0.0f, 1.0f);
+
+            sol_bill_add(bp, ri, rp->mi, L, W[ri], H[ri], rp->fl & B_EDGE);
         }
     }
-    sol_bill_disable();
 
+    glDepthMask(GL_FALSE);
+    sol_bill_flush(draw, rend, rc);
     glDepthMask(GL_TRUE);
 }
 
 void sol_bill(const struct s_draw *draw,
               struct s_rend *rend, const float *M, float t)
 {
-    if (!(draw && draw->base && draw->base->rc))
+    struct d_bill *bp;
+
+    const struct b_bill *rv;
+    int rc, ri;
+
+    float *T, *W, *H, *RX, *RY, *RZ;
+
+    if (!(draw && draw->base && draw->base->rc && (bp = draw->bills)))
         return;
 
-    sol_bill_enable(draw);
-    {
-        int ri;
+    rv = draw->base->rv;
+    rc = draw->base->rc;
 
-        for (ri = 0; ri < draw->base->rc; ++ri)
-        {
-            const struct b_bill *rp = draw->base->rv + ri;
+    T  = bp->fv + rc * BILL_T;
+    W  = bp->fv + rc * BILL_W;
+    H  = bp->fv + rc * BILL_H;
+    RX = bp->fv + rc * BILL_RX;
+    RY = bp->fv + rc * BILL_RY;
+    RZ = bp->fv + rc * BILL_RZ;
 
-            float T = rp->t * t;
-            float S = fsinf(T);
+    /* Evaluate the animation of all billboards. */
 
-            float w  = rp->w [0] + rp->w [1] * T + rp->w [2] * S;
-            float h  = rp->h [0] + rp->h [1] * T + rp->h [2] * S;
-            float rx = rp->rx[0] + rp->rx[1] * T + rp->rx[2] * S;
-            float ry = rp->ry[0] + rp->ry[1] * T + rp->ry[2] * S;
-            float rz = rp->rz[0] + rp->rz[1] * T + rp->rz[2] * S;
+    for (ri = 0; ri < rc; ri++)
+        T[ri] = rv[ri].t * t;
 
-            r_apply_mtrl(rend, draw->base->mtrls[rp->mi]);
+    for (ri = 0; ri < rc; ri++)
+    {
+        const float T1 = T[ri], S = fsinf(T[ri]);
 
-            glPushMatrix();
-            {
-                glTranslatef(rp->p[0], rp->p[1], rp->p[2]);
+        W [ri] = rv[ri].w [0] + rv[ri].w [1] * T1 + rv[ri].w [2] * S;
+        H [ri] = rv[ri].h [0] + rv[ri].h [1] * T1 + rv[ri].h [2] * S;
+        RX[ri] = rv[ri].rx[0] + rv[ri].rx[1] * T1 + rv[ri].rx[2] * S;
+        RY[ri] = rv[ri].ry[0] + rv[ri].ry[1] * T1 + rv[ri].ry[2] * S;
+        RZ[ri] = rv[ri].rz[0] + rv[ri].rz[1] * T1 + rv[ri].rz[2] * S;
+    }
 
-                if (M && ((rp->fl & B_NOFACE) == 0)) glMultMatrixf(M);
+    /* Place each billboard. */
 
-                if (fabsf(rx) > 0.0f) glRotatef(rx, 1.0f, 0.0f, 0.0f);
-                if (fabsf(ry) > 0.0f) glRotatef(ry, 0.0f, 1.0f, 0.0f);
-                if (fabsf(rz) > 0.0f) glRotatef(rz, 0.0f, 0.0f, 1.0f);
+    sol_bill_begin(bp);
 
-                glScalef(w, h, 1.0f);
+    for (ri = 0; ri < rc; ri++)
+    {
+        const struct b_bill *rp = rv + ri;
 
-                sol_draw_bill(GL_FALSE);
-            }
-            glPopMatrix();
+        float L[16];
+
+        m_xlt(L, rp->p);
+
+        if (M && ((rp->fl & B_NOFACE) == 0))
+        {
+            float N[16];
+
+            m_mult(N, L, M);
+            m_cpy (L, N);
         }
+
+        if (fabsf(RX[ri]) > 0.0f) sol_bill_rot(L, RX[ri], 1.0f, 0.0f, 0.0f);
+        if (fabsf(RY[ri]) > 0.0f) sol_bill_rot(L, RY[ri], 0.0f, 1.0f, 0.0f);
+        if (fabsf(RZ[ri]) > 0.0f) sol_bill_rot(L, RZ[ri], 0.0f, 0.0f, 1.0f);
+
+        sol_bill_add(bp, ri, rp->mi, L, W[ri], H[ri], 0);
     }
-    sol_bill_disable();
+
+    sol_bill_flush(draw, rend, rc);
 }
 
 void sol_fade(const struct s_draw *draw, struct s_rend *rend, float k)
@@ -47,45 +47,42 @@ struct d_vert
     float t[2];
 };
 
-struct d_geom
-{
-    GLushort i;
-    GLushort j;
-    GLushort k;
-};
-
 /*---------------------------------------------------------------------------*/
 
 struct d_mesh
 {
     int mtrl;                                  /* Cached material            */
+    int body;                                  /* Owning body                */
 
-    GLuint vbo;                                /* Vertex  buffer object      */
+    GLuint v0;                                 /* Vertex  buffer offset      */
     GLuint vbc;                                /* Vertex  buffer count       */
-    GLuint ebo;                                /* Element buffer object      */
+    GLuint e0;                                 /* Element buffer offset      */
     GLuint ebc;                                /* Element buffer count       */
-};
 
-struct d_body
-{
-    const struct b_body *base;
-
-    int pass[PASS_MAX];
-    int mc;
-
-    struct d_mesh *mv;
+    float c[3];                                /* Bounding sphere in body    */
+    float r;                                   /* ...or r < 0 to never cull  */
 };
 
+struct d_bill;
+
 struct s_draw
 {
     struct s_base *base;
     struct s_vary *vary;
 
-    int bc;
+    int mc;
 
-    struct d_body *bv;
+    struct d_mesh *mv;
+
+    const struct d_mesh **pv[PASS_MAX];        /* Draw order of each pass    */
+    int                   pc[PASS_MAX];        /* Mesh count of each pass    */
+
+    GLuint vbo;                                /* Vertex  buffer object      */
+    GLuint ebo;                                /* Element buffer object      */
+    GLenum ebt;                                /* Element type               */
 
     GLuint bill;
+    struct d_bill *bills;                      /* Billboard batching state   */
 
     unsigned int reflective:1;
     unsigned int shadowed:1;
@@ -117,12 +114,26 @@ void r_apply_mtrl(struct s_rend *, int);
 
 /*---------------------------------------------------------------------------*/
 
+/*
+ * Placement of one of many copies of a SOL drawn together.
+ */
+
+struct s_inst
+{
+    float p[3];                         /* Position                          */
+    float s[3];                         /* Scale                             */
+
+    const float *c;                     /* Color, or NULL to leave as is     */
+};
+
 int  sol_load_draw(struct s_draw *, struct s_vary *, int);
 void sol_free_draw(struct s_draw *);
 
 void sol_back(const struct s_draw *, struct s_rend *, float, float, float);
 void sol_refl(const struct s_draw *, struct s_rend *);
 void sol_draw(const struct s_draw *, struct s_rend *, int, int);
+void sol_draw_inst(const struct s_draw *, struct s_rend *, int, int,
+                   const struct s_inst *, int);
 void sol_bill(const struct s_draw *, struct s_rend *, const float *, float);
 void sol_fade(const struct s_draw *, struct s_rend *, float);
 
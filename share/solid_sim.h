@@ -23,8 +23,27 @@
 void sol_init_sim(struct s_vary *);
 void sol_quit_sim(void);
 
-void  sol_move(struct s_vary *, cmd_fn, float);
-float sol_step(struct s_vary *, cmd_fn, const float *, float, int, int *);
+void  sol_move(struct s_vary *, const struct cmd_sink *, float);
+float sol_step(struct s_vary *, const struct cmd_sink *, const float *, float, int, int *);
+
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Collision test counters.  These are only maintained by builds with
+ * ENABLE_SOL_STATS (see solbench) so as not to burden the game.
+ */
+
+struct sol_stats
+{
+    unsigned long body;                 /* Body tests                        */
+    unsigned long node;                 /* BSP node visits                   */
+    unsigned long lump;                 /* Lump tests                        */
+    unsigned long vert;                 /* Vertex tests                      */
+    unsigned long edge;                 /* Edge tests                        */
+    unsigned long side;                 /* Side tests                        */
+};
+
+extern struct sol_stats sol_stats;
 
 /*---------------------------------------------------------------------------*/
 
@@ -14,6 +14,10 @@
 
 #include <math.h>
 
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 #include "vec3.h"
 #include "common.h"
 
@@ -24,6 +28,14 @@
 #define LARGE 1.0e+5f
 #define SMALL 1.0e-3f
 
+struct sol_stats sol_stats;
+
+#if ENABLE_SOL_STATS
+#define SOL_STAT(x) (sol_stats.x++)
+#else
+#define SOL_STAT(x) ((void) 0)
+#endif
+
 /*---------------------------------------------------------------------------*/
 /* Solves (p + v * t) . (p + v * t) == r * r for smallest t.                 */
 
@@ -290,6 +302,8 @@ static float sol_test_vert(float dt,
                            const float o[3],
                            const float w[3])
 {
+    SOL_STAT(vert);
+
     return v_vert(T, o, vp->p, w, up->p, up->v, up->r);
 }
 
@@ -304,12 +318,40 @@ static float sol_test_edge(float dt,
     float q[3];
     float u[3];
 
+    SOL_STAT(edge);
+
     v_cpy(q, base->vv[ep->vi].p);
     v_sub(u, base->vv[ep->vj].p, base->vv[ep->vi].p);
 
     return v_edge(T, o, q, u, w, up->p, up->v, up->r);
 }
 
+/*
+ * Determine whether a point of contact T with side SP at time t lies
+ * within the other sides of the lump.
+ */
+static int sol_test_side_in(const float T[3], float t,
+                            const struct s_base *base,
+                            const struct b_lump *lp,
+                            const struct b_side *sp,
+                            const float o[3],
+                            const float w[3])
+{
+    int i;
+
+    for (i = 0; i < lp->sc; i++)
+    {
+        const struct b_side *sq = base->sv + base->iv[lp->s0 + i];
+
+        if (sp != sq &&
+            v_dot(T, sq->n) -
+            v_dot(o, sq->n) -
+            v_dot(w, sq->n) * t > sq->d)
+            return 0;
+    }
+    return 1;
+}
+
 static float sol_test_side(float dt,
                            float T[3],
                            const struct v_ball *up,
@@ -320,19 +362,12 @@ static float sol_test_side(float dt,
                            const float w[3])
 {
     float t = v_side(T, o, w, sp->n, sp->d, up->p, up->v, up->r);
-    int i;
 
-    if (t < dt)
-        for (i = 0; i < lp->sc; i++)
-        {
-            const struct b_side *sq = base->sv + base->iv[lp->s0 + i];
+    SOL_STAT(side);
+
+    if (t < dt && !sol_test_side_in(T, t, base, lp, sp, o, w))
+        return LARGE;
 
-            if (sp != sq &&
-                v_dot(T, sq->n) -
-                v_dot(o, sq->n) -
-                v_dot(w, sq->n) * t > sq->d)
-                return LARGE;
-        }
     return t;
 }
 
@@ -398,6 +433,430 @@ static int sol_test_back(float dt,
 
 /*---------------------------------------------------------------------------*/
 
+/*
+ * Batched vertex, edge, and side tests over the structure-of-arrays
+ * copies of a lump.  These compute the same times as v_vert, v_edge,
+ * and v_side, with the same operations in the same order, for
+ * SOL_LANES elements at a time.
+ * The caller scans the results in order, so a batched lump test picks
+ * the very same contact as the one-at-a-time tests do.
+ */
+
+#if defined(__AVX__)
+
+#define SOL_LANES 8
+
+typedef __m256 sol_vf;
+
+#define vf_set(a)       _mm256_set1_ps(a)
+#define vf_load(p)      _mm256_loadu_ps(p)
+#define vf_store(p, a)  _mm256_storeu_ps(p, a)
+#define vf_add(a, b)    _mm256_add_ps(a, b)
+#define vf_sub(a, b)    _mm256_sub_ps(a, b)
+#define vf_mul(a, b)    _mm256_mul_ps(a, b)
+#define vf_div(a, b)    _mm256_div_ps(a, b)
+#define vf_sqrt(a)      _mm256_sqrt_ps(a)
+#define vf_min(a, b)    _mm256_min_ps(a, b)
+#define vf_max(a, b)    _mm256_max_ps(a, b)
+#define vf_lt(a, b)     _mm256_cmp_ps(a, b, _CMP_LT_OQ)
+#define vf_gt(a, b)     _mm256_cmp_ps(a, b, _CMP_GT_OQ)
+#define vf_ne(a, b)     _mm256_cmp_ps(a, b, _CMP_NEQ_UQ)
+#define vf_ge(a, b)     _mm256_cmp_ps(a, b, _CMP_GE_OQ)
+#define vf_and(a, b)    _mm256_and_ps(a, b)
+#define vf_neg(a)       _mm256_xor_ps(a, _mm256_set1_ps(-0.0f))
+#define vf_sel(m, a, b) _mm256_blendv_ps(b, a, m)
+#define vf_any(m)       _mm256_movemask_ps(m)
+
+#elif defined(__SSE2__)
+
+#define SOL_LANES 4
+
+typedef __m128 sol_vf;
+
+#define vf_set(a)       _mm_set1_ps(a)
+#define vf_load(p)      _mm_loadu_ps(p)
+#define vf_store(p, a)  _mm_storeu_ps(p, a)
+#define vf_add(a, b)    _mm_add_ps(a, b)
+#define vf_sub(a, b)    _mm_sub_ps(a, b)
+#define vf_mul(a, b)    _mm_mul_ps(a, b)
+#define vf_div(a, b)    _mm_div_ps(a, b)
+#define vf_sqrt(a)      _mm_sqrt_ps(a)
+#define vf_min(a, b)    _mm_min_ps(a, b)
+#define vf_max(a, b)    _mm_max_ps(a, b)
+#define vf_lt(a, b)     _mm_cmplt_ps(a, b)
+#define vf_gt(a, b)     _mm_cmpgt_ps(a, b)
+#define vf_ne(a, b)     _mm_cmpneq_ps(a, b)
+#define vf_ge(a, b)     _mm_cmpge_ps(a, b)
+#define vf_and(a, b)    _mm_and_ps(a, b)
+#define vf_neg(a)       _mm_xor_ps(a, _mm_set1_ps(-0.0f))
+#define vf_sel(m, a, b) _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b))
+#define vf_any(m)       _mm_movemask_ps(m)
+
+#endif
+
+#ifdef SOL_LANES
+
+/*
+ * Compute into TV the times at which a sphere hits each of N verts
+ * given by VX, VY, VZ.  See v_vert.
+ */
+static void vf_vert(float *tv, int n,
+                    const float *vx,
+                    const float *vy,
+                    const float *vz,
+                    const float o[3],
+                    const float w[3],
+                    const float p[3],
+                    const float v[3], float r)
+{
+    const float V[3] = { v[0] - w[0], v[1] - w[1], v[2] - w[2] };
+    const float a = v_dot(V, V);
+
+    const sol_vf A  = vf_set(a);
+    const sol_vf A4 = vf_set(4.0f * a);
+    const sol_vf RR = vf_set(r * r);
+    const sol_vf L  = vf_set(LARGE);
+    const sol_vf Z  = vf_set(0.0f);
+    const sol_vf H  = vf_set(0.5f);
+    const sol_vf N2 = vf_set(2.0f);
+
+    int i;
+
+    if (a == 0.0f)
+    {
+        for (i = 0; i < n; i++)
+            tv[i] = LARGE;
+        return;
+    }
+
+    for (i = 0; i < n; i += SOL_LANES)
+    {
+        sol_vf Px = vf_sub(vf_set(p[0]), vf_add(vf_set(o[0]), vf_load(vx + i)));
+        sol_vf Py = vf_sub(vf_set(p[1]), vf_add(vf_set(o[1]), vf_load(vy + i)));
+        sol_vf Pz = vf_sub(vf_set(p[2]), vf_add(vf_set(o[2]), vf_load(vz + i)));
+
+        sol_vf b = vf_add(vf_add(vf_mul(Px, vf_set(V[0])),
+                                 vf_mul(Py, vf_set(V[1]))),
+                                 vf_mul(Pz, vf_set(V[2])));
+        sol_vf c = vf_sub(vf_add(vf_add(vf_mul(Px, Px),
+                                        vf_mul(Py, Py)),
+                                        vf_mul(Pz, Pz)), RR);
+
+        sol_vf m = vf_lt(b, Z);
+
+        if (vf_any(m))
+        {
+            sol_vf d, s, t0, t1, t;
+
+            b = vf_mul(b, N2);
+            d = vf_sub(vf_mul(b, b), vf_mul(A4, c));
+            s = vf_sqrt(vf_max(d, Z));
+
+            t0 = vf_div(vf_mul(H, vf_sub(vf_neg(b), s)), A);
+            t1 = vf_div(vf_mul(H, vf_add(vf_neg(b), s)), A);
+            t  = vf_min(t0, t1);
+
+            m = vf_and(m, vf_ge(d, Z));
+            m = vf_and(m, vf_ge(t, Z));
+
+            vf_store(tv + i, vf_sel(m, t, L));
+        }
+        else vf_store(tv + i, L);
+    }
+}
+
+/*
+ * Compute into TV the times at which a sphere hits each of N edges
+ * given by origins QX, QY, QZ and vectors UX, UY, UZ, and into SV the
+ * positions along those edges.  See v_edge.  Edges that the sphere
+ * already intersects are left to v_edge and flagged in the return.
+ */
+static int vf_edge(float *tv, float *sv, int n,
+                   const float *qx,
+                   const float *qy,
+                   const float *qz,
+                   const float *ux,
+                   const float *uy,
+                   const float *uz,
+                   const float o[3],
+                   const float w[3],
+                   const float p[3],
+                   const float v[3], float r)
+{
+    const sol_vf RR = vf_set(r * r);
+    const sol_vf L  = vf_set(LARGE);
+    const sol_vf Z  = vf_set(0.0f);
+    const sol_vf H  = vf_set(0.5f);
+    const sol_vf N1 = vf_set(1.0f);
+    const sol_vf N2 = vf_set(2.0f);
+    const sol_vf N4 = vf_set(4.0f);
+
+    const sol_vf ex = vf_set(v[0] - w[0]);
+    const sol_vf ey = vf_set(v[1] - w[1]);
+    const sol_vf ez = vf_set(v[2] - w[2]);
+
+    int i, f = 0;
+
+    for (i = 0; i < n; i += SOL_LANES)
+    {
+        sol_vf Ux = vf_load(ux + i);
+        sol_vf Uy = vf_load(uy + i);
+        sol_vf Uz = vf_load(uz + i);
+
+        sol_vf dx = vf_sub(vf_set(p[0] - o[0]), vf_load(qx + i));
+        sol_vf dy = vf_sub(vf_set(p[1] - o[1]), vf_load(qy + i));
+        sol_vf dz = vf_sub(vf_set(p[2] - o[2]), vf_load(qz + i));
+
+        sol_vf du = vf_add(vf_add(vf_mul(dx, Ux), vf_mul(dy, Uy)), vf_mul(dz, Uz));
+        sol_vf eu = vf_add(vf_add(vf_mul(ex, Ux), vf_mul(ey, Uy)), vf_mul(ez, Uz));
+        sol_vf uu = vf_add(vf_add(vf_mul(Ux, Ux), vf_mul(Uy, Uy)), vf_mul(Uz, Uz));
+
+        sol_vf k  = vf_div(vf_neg(du), uu);
+        sol_vf Px = vf_add(dx, vf_mul(Ux, k));
+        sol_vf Py = vf_add(dy, vf_mul(Uy, k));
+        sol_vf Pz = vf_add(dz, vf_mul(Uz, k));
+
+        sol_vf Vx, Vy, Vz, a, b, c, d, t, t0, t1, s, m, x;
+
+        sol_vf PP = vf_add(vf_add(vf_mul(Px, Px), vf_mul(Py, Py)), vf_mul(Pz, Pz));
+
+        /* Flag edges the sphere already intersects. */
+
+        x = vf_lt(PP, RR);
+        f |= vf_any(x) << i;
+
+        k  = vf_div(vf_neg(eu), uu);
+        Vx = vf_add(ex, vf_mul(Ux, k));
+        Vy = vf_add(ey, vf_mul(Uy, k));
+        Vz = vf_add(ez, vf_mul(Uz, k));
+
+        /* Solve the quadratic as v_sol does. */
+
+        a = vf_add(vf_add(vf_mul(Vx, Vx), vf_mul(Vy, Vy)), vf_mul(Vz, Vz));
+        b = vf_mul(vf_add(vf_add(vf_mul(Vx, Px), vf_mul(Vy, Py)), vf_mul(Vz, Pz)), N2);
+        c = vf_sub(PP, RR);
+        d = vf_sub(vf_mul(b, b), vf_mul(vf_mul(N4, a), c));
+
+        s  = vf_sqrt(vf_max(d, Z));
+        t0 = vf_div(vf_mul(H, vf_sub(vf_neg(b), s)), a);
+        t1 = vf_div(vf_mul(H, vf_add(vf_neg(b), s)), a);
+        t  = vf_min(t0, t1);
+
+        m = vf_and(vf_ne(a, Z), vf_ge(d, Z));
+        m = vf_and(m, vf_ge(t, Z));
+
+        /* Find the projection of D + E * t on U and test its range. */
+
+        s = vf_div(vf_add(du, vf_mul(eu, t)), uu);
+
+        m = vf_and(m, vf_gt(s, Z));
+        m = vf_and(m, vf_lt(s, N1));
+        m = vf_and(m, vf_lt(t, L));
+
+        vf_store(tv + i, vf_sel(m, t, L));
+        vf_store(sv + i, s);
+    }
+    return f;
+}
+
+/*
+ * Compute into TV the times at which a sphere hits each of N planes
+ * given by NX, NY, NZ, ND.  See v_side.
+ */
+static void vf_side(float *tv, int n,
+                    const float *nx,
+                    const float *ny,
+                    const float *nz,
+                    const float *nd,
+                    const float o[3],
+                    const float w[3],
+                    const float p[3],
+                    const float v[3], float r)
+{
+    const sol_vf R = vf_set(r);
+    const sol_vf L = vf_set(LARGE);
+    const sol_vf Z = vf_set(0.0f);
+
+    int i;
+
+    for (i = 0; i < n; i += SOL_LANES)
+    {
+        sol_vf Nx = vf_load(nx + i);
+        sol_vf Ny = vf_load(ny + i);
+        sol_vf Nz = vf_load(nz + i);
+
+        sol_vf vn = vf_add(vf_add(vf_mul(vf_set(v[0]), Nx),
+                                  vf_mul(vf_set(v[1]), Ny)),
+                                  vf_mul(vf_set(v[2]), Nz));
+        sol_vf wn = vf_add(vf_add(vf_mul(vf_set(w[0]), Nx),
+                                  vf_mul(vf_set(w[1]), Ny)),
+                                  vf_mul(vf_set(w[2]), Nz));
+        sol_vf dn = vf_sub(vn, wn);
+        sol_vf m  = vf_lt(dn, Z);
+
+        if (vf_any(m))
+        {
+            sol_vf on = vf_add(vf_add(vf_mul(vf_set(o[0]), Nx),
+                                      vf_mul(vf_set(o[1]), Ny)),
+                                      vf_mul(vf_set(o[2]), Nz));
+            sol_vf pn = vf_add(vf_add(vf_mul(vf_set(p[0]), Nx),
+                                      vf_mul(vf_set(p[1]), Ny)),
+                                      vf_mul(vf_set(p[2]), Nz));
+            sol_vf D  = vf_load(nd + i);
+
+            sol_vf u = vf_div(vf_sub(vf_add(vf_add(R, D), on), pn), dn);
+            sol_vf a = vf_div(vf_sub(vf_add(D, on), pn), dn);
+
+            sol_vf t = vf_sel(vf_ge(a, Z), Z, L);
+
+            t = vf_sel(vf_ge(u, Z), u, t);
+
+            vf_store(tv + i, vf_sel(m, t, L));
+        }
+        else vf_store(tv + i, L);
+    }
+}
+
+#endif /* SOL_LANES */
+
+/*---------------------------------------------------------------------------*/
+
+#ifdef SOL_LANES
+
+/*
+ * Test the verts, edges, and sides of a lump in batches.  Return the earliest
+ * time of contact before DT, as sol_test_lump does.
+ */
+static float sol_test_lump_soa(float dt,
+                               float T[3],
+                               const struct v_ball *up,
+                               const struct s_base *base,
+                               const struct b_lump *lp,
+                               const float o[3],
+                               const float w[3])
+{
+    const struct s_soa *sp = &base->soa;
+    const int li = (int) (lp - base->lv);
+
+    float U[3] = { 0.0f, 0.0f, 0.0f };
+    float tv[SOL_SOA_PAD];
+    float u, t = dt;
+    int i, j, k;
+
+    /* Test all verts */
+
+    if (up->r > 0.0f)
+        for (i = 0; i < lp->vc; i += SOL_SOA_PAD)
+        {
+            const int v0 = sp->lv0[li] + i;
+
+            k = MIN(SOL_SOA_PAD, lp->vc - i);
+
+            vf_vert(tv, k, sp->vx + v0, sp->vy + v0, sp->vz + v0,
+                    o, w, up->p, up->v, up->r);
+
+            for (j = 0; j < k; j++)
+                if ((u = tv[j]) < t)
+                {
+                    const float *q = base->vv[base->iv[lp->v0 + i + j]].p;
+
+                    v_add(U, o, q);
+                    v_mad(T, U, w, u);
+                    t = u;
+                }
+        }
+
+#if ENABLE_SOL_STATS
+    if (up->r > 0.0f)
+        sol_stats.vert += lp->vc;
+#endif
+
+    /* Test all edges */
+
+    if (up->r > 0.0f)
+        for (i = 0; i < lp->ec; i += SOL_SOA_PAD)
+        {
+            const int e0 = sp->le0[li] + i;
+            float sv[SOL_SOA_PAD];
+            int f;
+
+            k = MIN(SOL_SOA_PAD, lp->ec - i);
+
+            f = vf_edge(tv, sv, k,
+                        sp->qx + e0, sp->qy + e0, sp->qz + e0,
+                        sp->ux + e0, sp->uy + e0, sp->uz + e0,
+                        o, w, up->p, up->v, up->r);
+
+            for (j = 0; j < k; j++)
+            {
+                const float q[3] = { sp->qx[e0 + j],
+                                     sp->qy[e0 + j],
+                                     sp->qz[e0 + j] };
+                const float e[3] = { sp->ux[e0 + j],
+                                     sp->uy[e0 + j],
+                                     sp->uz[e0 + j] };
+
+                if (f & (1 << j))
+                {
+                    if ((u = v_edge(U, o, q, e, w, up->p, up->v, up->r)) < t)
+                    {
+                        v_cpy(T, U);
+                        t = u;
+                    }
+                }
+                else if ((u = tv[j]) < t)
+                {
+                    float d[3];
+
+                    v_mad(d, o, w, u);
+                    v_mad(U, q, e, sv[j]);
+                    v_add(T, U, d);
+                    t = u;
+                }
+            }
+        }
+
+#if ENABLE_SOL_STATS
+    if (up->r > 0.0f)
+        sol_stats.edge += lp->ec;
+#endif
+
+    /* Test all sides */
+
+    for (i = 0; i < lp->sc; i += SOL_SOA_PAD)
+    {
+        const int s0 = sp->ls0[li] + i;
+
+        k = MIN(SOL_SOA_PAD, lp->sc - i);
+
+        vf_side(tv, k, sp->nx + s0, sp->ny + s0, sp->nz + s0, sp->nd + s0,
+                o, w, up->p, up->v, up->r);
+
+        for (j = 0; j < k; j++)
+            if ((u = tv[j]) < t)
+            {
+                const struct b_side *sq = base->sv + base->iv[lp->s0 + i + j];
+
+                v_mad(U, up->p, up->v, +u);
+                v_mad(U, U, sq->n, -up->r);
+
+                if (sol_test_side_in(U, u, base, lp, sq, o, w))
+                {
+                    v_cpy(T, U);
+                    t = u;
+                }
+            }
+    }
+
+#if ENABLE_SOL_STATS
+    sol_stats.side += lp->sc;
+#endif
+
+    return t;
+}
+
+#endif /* SOL_LANES */
+
 static float sol_test_lump(float dt,
                            float T[3],
                            const struct v_ball *up,
@@ -414,6 +873,13 @@ static float sol_test_lump(float dt,
 
     if (lp->fl & L_DETAIL) return t;
 
+    SOL_STAT(lump);
+
+#ifdef SOL_LANES
+    if (base->soa.lv0)
+        return sol_test_lump_soa(dt, T, up, base, lp, o, w);
+#endif
+
     /* Test all verts */
 
     if (up->r > 0.0f)
@@ -468,6 +934,8 @@ static float sol_test_node(float dt,
     float U[3], u, t = dt;
     int i;
 
+    SOL_STAT(node);
+
     /* Test all lumps */
 
     for (i = 0; i < np->lc; i++)
@@ -510,16 +978,98 @@ static float sol_test_node(float dt,
     return t;
 }
 
+/*
+ * Determine whether a ball of radius R moving from P along V over time
+ * DT comes near a bounding sphere BS.  All are in the same space.
+ */
+static int sol_test_bound(float dt, float r,
+                          const float p[3], const float v[3],
+                          const float bs[4])
+{
+    float c[3], d[3], s, vv;
+
+    if (bs[3] < 0.0f)
+        return 1;
+
+    v_sub(c, bs, p);
+
+    /* Find the point of closest approach within the time interval. */
+
+    if ((vv = v_dot(v, v)) > 0.0f)
+    {
+        s = v_dot(c, v) / vv;
+        s = CLAMP(0.0f, s, dt);
+
+        v_mad(d, c, v, -s);
+    }
+    else v_cpy(d, c);
+
+    return v_dot(d, d) <= (bs[3] + r + SMALL) * (bs[3] + r + SMALL);
+}
+
+/*
+ * Find a world space sphere that holds body BP anywhere along its
+ * current path segment and in any orientation, without computing its
+ * transform.
+ */
+static void sol_body_bound(float bs[4],
+                           const struct s_vary *vary,
+                           const struct v_body *bp)
+{
+    bs[0] = bp->bs[0];
+    bs[1] = bp->bs[1];
+    bs[2] = bp->bs[2];
+    bs[3] = bp->bs[3];
+
+    if (bs[3] < 0.0f)
+        return;
+
+    /* A body that may rotate stays within reach of its origin. */
+
+    if (bp->mj >= 0)
+    {
+        bs[3] += v_len(bs);
+        bs[0]  = 0.0f;
+        bs[1]  = 0.0f;
+        bs[2]  = 0.0f;
+    }
+
+    /* A body that may translate stays near its path segment. */
+
+    if (bp->mi >= 0)
+    {
+        const struct v_move *mp = vary->mv + bp->mi;
+
+        const struct b_path *pp = vary->base->pv + mp->pi;
+        const struct b_path *pq = vary->base->pv + pp->pi;
+
+        float c[3], d[3];
+
+        v_sub(d, pq->p, pp->p);
+        v_mad(c, pp->p, d, 0.5f);
+        v_add(bs, bs, c);
+
+        bs[3] += 0.5f * v_len(d);
+    }
+}
+
 static float sol_test_body(float dt,
                            float T[3], float V[3],
                            const struct v_ball *up,
                            const struct s_vary *vary,
                            const struct v_body *bp)
 {
-    float U[3], O[3], E[4], W[3], u;
+    float U[3], O[3], E[4], W[3], B[4], u;
 
     const struct b_node *np = vary->base->nv + bp->base->ni;
 
+    /* Pass over bodies out of reach before working out where they are. */
+
+    sol_body_bound(B, vary, bp);
+
+    if (!sol_test_bound(dt, up->r, up->p, up->v, B))
+        return dt;
+
     sol_body_p(O, vary, bp, 0.0f);
     sol_body_v(W, vary, bp, dt);
     sol_body_e(E, vary, bp, 0.0f);
@@ -567,6 +1117,11 @@ static float sol_test_body(float dt,
         v_sub(ball.v, p1, p0);
         v_scl(ball.v, ball.v, 1.0f / dt);
 
+        if (!sol_test_bound(dt, ball.r, ball.p, ball.v, bp->bs))
+            return dt;
+
+        SOL_STAT(body);
+
         if ((u = sol_test_node(dt, U, &ball, vary->base, np, z, z)) < dt)
         {
             /* Compute the final orientation. */
@@ -592,6 +1147,16 @@ static float sol_test_body(float dt,
     }
     else
     {
+        float p[3], v[3];
+
+        v_sub(p, up->p, O);
+        v_sub(v, up->v, W);
+
+        if (!sol_test_bound(dt, up->r, p, v, bp->bs))
+            return dt;
+
+        SOL_STAT(body);
+
         if ((u = sol_test_node(dt, U, up, vary->base, np, O, W)) < dt)
         {
             v_cpy(T, U);
@@ -695,35 +1260,35 @@ static float sol_path_time(struct s_vary *vary, float dt)
 /*
  * Move SOL state forward DT seconds.
  */
-static void sol_move_once(struct s_vary *vary, cmd_fn cmd_func, float dt)
+static void sol_move_once(struct s_vary *vary, const struct cmd_sink *sink, float dt)
 {
     int ms;
 
-    if (cmd_func)
+    if (sink)
     {
         union cmd cmd = { CMD_STEP_SIMULATION };
         cmd.stepsim.dt = dt;
-        cmd_func(&cmd);
+        cmd_sink_put(sink, &cmd);
     }
 
     ms = ms_step(&vary->ms_accum, dt);
 
-    sol_move_step(vary, cmd_func, dt, ms);
-    sol_swch_step(vary, cmd_func, dt, ms);
-    sol_ball_step(vary, cmd_func, dt);
+    sol_move_step(vary, sink, dt, ms);
+    sol_swch_step(vary, sink, dt, ms);
+    sol_ball_step(vary, sink, dt);
 }
 
 /*
  * Move SOL state forward DT seconds across multiple path changes.
  */
-void sol_move(struct s_vary *vary, cmd_fn cmd_func, float dt)
+void sol_move(struct s_vary *vary, const struct cmd_sink *sink, float dt)
 {
     if (vary && vary->base)
     {
         while (dt > 0.0f)
         {
             float pt = sol_path_time(vary, dt);
-            sol_move_once(vary, cmd_func, pt);
+            sol_move_once(vary, sink, pt);
             dt -= pt;
         }
     }
@@ -737,7 +1302,7 @@ void sol_move(struct s_vary *vary, cmd_fn cmd_func, float dt)
  * iterations, punt it.
  */
 
-float sol_step(struct s_vary *vary, cmd_fn cmd_func,
+float sol_step(struct s_vary *vary, const struct cmd_sink *sink,
                const float *g, float dt, int ui, int *m)
 {
     float P[3], V[3], v[3], r[3], a[3], d, nt, b = 0.0f, tt = dt;
@@ -806,7 +1371,7 @@ float sol_step(struct s_vary *vary, cmd_fn cmd_func,
             else
                 nt = tt;
 
-            sol_move_once(vary, cmd_func, nt);
+            sol_move_once(vary, sink, nt);
 
             if (nt < pt)
                 if (b < (d = sol_bounce(up, P, V, nt)))
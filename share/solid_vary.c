@@ -20,6 +20,70 @@
 
 /*---------------------------------------------------------------------------*/
 
+/*
+ * Compute a bounding sphere of the solid lumps of a body, for use in
+ * collision culling.  A body with a solid lump lacking verts can't be
+ * bounded this way and gets a negative radius.
+ */
+static void sol_body_bounds(const struct s_base *base, struct v_body *bp)
+{
+    const struct b_body *bq = bp->base;
+
+    float bmin[3] = { 0.0f, 0.0f, 0.0f };
+    float bmax[3] = { 0.0f, 0.0f, 0.0f };
+    float d[3];
+
+    int i, j, k, n = 0;
+
+    bp->bs[3] = 0.0f;
+
+    for (i = 0; i < bq->lc; i++)
+    {
+        const struct b_lump *lp = base->lv + bq->l0 + i;
+
+        if (lp->fl & L_DETAIL)
+            continue;
+
+        if (lp->vc == 0 && lp->sc > 0)
+        {
+            bp->bs[3] = -1.0f;
+            return;
+        }
+
+        for (j = 0; j < lp->vc; j++, n++)
+        {
+            const float *p = base->vv[base->iv[lp->v0 + j]].p;
+
+            for (k = 0; k < 3; k++)
+            {
+                if (n == 0 || bmin[k] > p[k]) bmin[k] = p[k];
+                if (n == 0 || bmax[k] < p[k]) bmax[k] = p[k];
+            }
+        }
+    }
+
+    v_add(bp->bs, bmin, bmax);
+    v_scl(bp->bs, bp->bs, 0.5f);
+
+    for (i = 0; i < bq->lc; i++)
+    {
+        const struct b_lump *lp = base->lv + bq->l0 + i;
+
+        if (lp->fl & L_DETAIL)
+            continue;
+
+        for (j = 0; j < lp->vc; j++)
+        {
+            v_sub(d, base->vv[base->iv[lp->v0 + j]].p, bp->bs);
+
+            if (bp->bs[3] < v_len(d))
+                bp->bs[3] = v_len(d);
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+
 int sol_load_vary(struct s_vary *fp, struct s_base *base)
 {
     int i;
@@ -82,6 +146,8 @@ int sol_load_vary(struct s_vary *fp, struct s_base *base)
                 vbody->mj = fp->mc - 1;
                 vmove->pi = bbody->pj;
             }
+
+            sol_body_bounds(fp->base, vbody);
         }
     }
 
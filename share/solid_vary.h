@@ -37,6 +37,8 @@ struct v_body
 
     int mi;
     int mj;
+
+    float bs[4];                               /* body space bounding sphere */
 };
 
 struct v_move
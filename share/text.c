@@ -75,6 +75,41 @@ int text_del_char(char *string)
     return 0;
 }
 
+/*
+ * Decode the character at the start of the string and step past it.
+ * Return zero at the end of the string.
+ */
+Uint32 text_get_char(const char **string)
+{
+    const unsigned char *p = (const unsigned char *) *string;
+
+    Uint32 unicode = 0;
+    int l = 0, i;
+
+    if (p[0] == 0)
+        return 0;
+
+    if      (p[0] < 0x80) { unicode = p[0];        l = 0; }
+    else if (p[0] < 0xC0) { unicode = 0xFFFD;      l = 0; }
+    else if (p[0] < 0xE0) { unicode = p[0] & 0x1F; l = 1; }
+    else if (p[0] < 0xF0) { unicode = p[0] & 0x0F; l = 2; }
+    else                  { unicode = p[0] & 0x07; l = 3; }
+
+    for (i = 1; i <= l; i++)
+    {
+        if ((p[i] & 0xC0) != 0x80)
+        {
+            *string += i;
+            return 0xFFFD;
+        }
+        unicode = (unicode << 6) | (p[i] & 0x3F);
+    }
+
+    *string += l + 1;
+
+    return unicode;
+}
+
 int text_length(const char *string)
 {
     int result = 0;
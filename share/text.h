@@ -11,6 +11,7 @@
 
 int text_add_char(Uint32, char *, int);
 int text_del_char(char *);
+Uint32 text_get_char(const char **);
 int text_length(const char *);
 
 /*---------------------------------------------------------------------------*/